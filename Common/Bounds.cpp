@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Bounds.h"
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // 第一遍的结果: 包围盒, 以及沿 x/y/z 坐标最小和最大的顶点
+    struct Extremes
+    {
+        XMFLOAT3 min_point[3];
+        XMFLOAT3 max_point[3];
+    };
+
+    // 第二遍的结果
+    struct SphereGrowth
+    {
+        XMFLOAT4 sphere;
+        // 到包围盒中心的最大距离的平方
+        float center_distance_sq = 0.0f;
+    };
+
+    class StridedPositions
+    {
+        public:
+            StridedPositions(const void* positions, std::uint32_t stride)
+            :base(static_cast<const std::uint8_t*>(positions)), stride(stride)
+            {
+            }
+
+            XMVECTOR XM_CALLCONV operator()(std::size_t i) const
+            {
+                return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(base + i * stride));
+            }
+
+        private:
+            const std::uint8_t* base;
+            std::uint32_t stride;
+    };
+
+    template<typename T>
+    class IndexedPositions
+    {
+        public:
+            IndexedPositions(const T* indices, const void* positions, std::uint32_t stride)
+            :indices(indices), positions(positions, stride)
+            {
+            }
+
+            XMVECTOR XM_CALLCONV operator()(std::size_t i) const
+            {
+                return positions(indices[i]);
+            }
+
+        private:
+            const T* indices;
+            StridedPositions positions;
+    };
+
+    // 每个轴向的最小/最大点用比较结果的 splat 做 select, 坐标本身就是包围盒
+    template<typename Fetch>
+    Extremes FindExtremes(const Fetch& fetch, std::size_t begin, std::size_t end)
+    {
+        XMVECTOR min_x = fetch(begin), min_y = min_x, min_z = min_x;
+        XMVECTOR max_x = min_x, max_y = min_x, max_z = min_x;
+        XMVECTOR min_value = min_x, max_value = min_x;
+
+        for(std::size_t i = begin + 1; i < end; ++i)
+        {
+            const XMVECTOR p = fetch(i);
+            const XMVECTOR less = XMVectorLess(p, min_value);
+            const XMVECTOR greater = XMVectorGreater(p, max_value);
+            min_value = XMVectorMin(p, min_value);
+            max_value = XMVectorMax(p, max_value);
+
+            min_x = XMVectorSelect(min_x, p, XMVectorSplatX(less));
+            min_y = XMVectorSelect(min_y, p, XMVectorSplatY(less));
+            min_z = XMVectorSelect(min_z, p, XMVectorSplatZ(less));
+            max_x = XMVectorSelect(max_x, p, XMVectorSplatX(greater));
+            max_y = XMVectorSelect(max_y, p, XMVectorSplatY(greater));
+            max_z = XMVectorSelect(max_z, p, XMVectorSplatZ(greater));
+        }
+
+        Extremes extremes;
+        XMStoreFloat3(&extremes.min_point[0], min_x);
+        XMStoreFloat3(&extremes.min_point[1], min_y);
+        XMStoreFloat3(&extremes.min_point[2], min_z);
+        XMStoreFloat3(&extremes.max_point[0], max_x);
+        XMStoreFloat3(&extremes.max_point[1], max_y);
+        XMStoreFloat3(&extremes.max_point[2], max_z);
+        return extremes;
+    }
+
+    void MergeExtremes(Extremes& a, const Extremes& b)
+    {
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            if((&b.min_point[axis].x)[axis] < (&a.min_point[axis].x)[axis])
+                a.min_point[axis] = b.min_point[axis];
+            if((&b.max_point[axis].x)[axis] > (&a.max_point[axis].x)[axis])
+                a.max_point[axis] = b.max_point[axis];
+        }
+    }
+
+    // Ritter: 初始球的直径取三个轴向极值点对中距离最远的一对
+    XMVECTOR InitialSphere(const Extremes& extremes)
+    {
+        XMVECTOR a = XMLoadFloat3(&extremes.min_point[0]);
+        XMVECTOR b = XMLoadFloat3(&extremes.max_point[0]);
+        float diameter_sq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(b, a)));
+        for(int axis = 1; axis < 3; ++axis)
+        {
+            const XMVECTOR p = XMLoadFloat3(&extremes.min_point[axis]);
+            const XMVECTOR q = XMLoadFloat3(&extremes.max_point[axis]);
+            const float d = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(q, p)));
+            if(d > diameter_sq)
+            {
+                a = p;
+                b = q;
+                diameter_sq = d;
+            }
+        }
+        const XMVECTOR center = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+        return XMVectorSetW(center, 0.5f * std::sqrt(diameter_sq));
+    }
+
+    XMVECTOR XM_CALLCONV BoxCenter(const Extremes& extremes)
+    {
+        const XMVECTOR lo = XMVectorSet(extremes.min_point[0].x, extremes.min_point[1].y, extremes.min_point[2].z, 0.0f);
+        const XMVECTOR hi = XMVectorSet(extremes.max_point[0].x, extremes.max_point[1].y, extremes.max_point[2].z, 0.0f);
+        return XMVectorScale(XMVectorAdd(lo, hi), 0.5f);
+    }
+
+    // 顶点在球外时把球扩大到刚好包含它和原来的球
+    template<typename Fetch>
+    SphereGrowth GrowSphere(const Fetch& fetch, std::size_t begin, std::size_t end, FXMVECTOR initial, FXMVECTOR box_center)
+    {
+        XMVECTOR center = XMVectorSetW(initial, 0.0f);
+        float radius = XMVectorGetW(initial);
+        float radius_sq = radius * radius;
+        XMVECTOR max_distance_sq = XMVectorZero();
+
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            const XMVECTOR p = fetch(i);
+            const XMVECTOR to_box_center = XMVectorSubtract(p, box_center);
+            max_distance_sq = XMVectorMax(max_distance_sq, XMVector3LengthSq(to_box_center));
+
+            const XMVECTOR d = XMVectorSubtract(p, center);
+            const float distance_sq = XMVectorGetX(XMVector3LengthSq(d));
+            if(distance_sq > radius_sq)
+            {
+                const float distance = std::sqrt(distance_sq);
+                const float new_radius = 0.5f * (radius + distance);
+                center = XMVectorMultiplyAdd(d, XMVectorReplicate((new_radius - radius) / distance), center);
+                radius = new_radius;
+                radius_sq = radius * radius;
+            }
+        }
+
+        SphereGrowth growth;
+        XMStoreFloat4(&growth.sphere, XMVectorSetW(center, radius));
+        growth.center_distance_sq = XMVectorGetX(max_distance_sq);
+        return growth;
+    }
+
+    // 包含两个球的最小球
+    XMVECTOR XM_CALLCONV MergeSpheres(FXMVECTOR a, FXMVECTOR b)
+    {
+        const float ra = XMVectorGetW(a);
+        const float rb = XMVectorGetW(b);
+        const XMVECTOR d = XMVectorSubtract(XMVectorSetW(b, 0.0f), XMVectorSetW(a, 0.0f));
+        const float distance = XMVectorGetX(XMVector3Length(d));
+
+        if(distance + rb <= ra)
+            return a;
+        if(distance + ra <= rb)
+            return b;
+
+        const float radius = 0.5f * (ra + rb + distance);
+        const XMVECTOR center = XMVectorMultiplyAdd(d, XMVectorReplicate((radius - ra) / distance), XMVectorSetW(a, 0.0f));
+        return XMVectorSetW(center, radius);
+    }
+
+    MeshBounds MakeBounds(const Extremes& extremes, FXMVECTOR ritter, float center_distance_sq)
+    {
+        MeshBounds bounds;
+        const XMVECTOR lo = XMVectorSet(extremes.min_point[0].x, extremes.min_point[1].y, extremes.min_point[2].z, 0.0f);
+        const XMVECTOR hi = XMVectorSet(extremes.max_point[0].x, extremes.max_point[1].y, extremes.max_point[2].z, 0.0f);
+        XMStoreFloat3(&bounds.box.Center, XMVectorScale(XMVectorAdd(lo, hi), 0.5f));
+        XMStoreFloat3(&bounds.box.Extents, XMVectorScale(XMVectorSubtract(hi, lo), 0.5f));
+
+        const float center_radius = std::sqrt(center_distance_sq);
+        if(center_radius < XMVectorGetW(ritter))
+        {
+            bounds.sphere.Center = bounds.box.Center;
+            bounds.sphere.Radius = center_radius;
+        }
+        else
+        {
+            XMStoreFloat3(&bounds.sphere.Center, ritter);
+            bounds.sphere.Radius = XMVectorGetW(ritter);
+        }
+        return bounds;
+    }
+
+    MeshBounds EmptyBounds()
+    {
+        MeshBounds bounds;
+        bounds.box.Center = {0.0f, 0.0f, 0.0f};
+        bounds.box.Extents = {0.0f, 0.0f, 0.0f};
+        bounds.sphere.Center = {0.0f, 0.0f, 0.0f};
+        bounds.sphere.Radius = 0.0f;
+        return bounds;
+    }
+
+    template<typename Fetch>
+    MeshBounds ComputeBoundsSerial(const Fetch& fetch, std::size_t count)
+    {
+        if(count == 0)
+            return EmptyBounds();
+
+        const Extremes extremes = FindExtremes(fetch, 0, count);
+        const SphereGrowth growth = GrowSphere(fetch, 0, count, InitialSphere(extremes), BoxCenter(extremes));
+        return MakeBounds(extremes, XMLoadFloat4(&growth.sphere), growth.center_distance_sq);
+    }
+}
+
+MeshBounds ComputeBounds(const void* positions, std::size_t vertex_count, std::uint32_t stride, JobSystem* jobs)
+{
+    const StridedPositions fetch(positions, stride);
+    if(jobs == nullptr || vertex_count <= bounds_chunk_size)
+        return ComputeBoundsSerial(fetch, vertex_count);
+
+    // 每块独立归约, 结果按块下标存放, 最后在当前线程合并
+    const std::uint32_t count = (std::uint32_t)vertex_count;
+    const std::uint32_t chunk_count = (count + bounds_chunk_size - 1) / bounds_chunk_size;
+
+    std::vector<Extremes> chunk_extremes(chunk_count);
+    jobs->ParallelFor(count, bounds_chunk_size, [&](std::uint32_t begin, std::uint32_t end){
+        chunk_extremes[begin / bounds_chunk_size] = FindExtremes(fetch, begin, end);
+    });
+
+    Extremes extremes = chunk_extremes[0];
+    for(std::uint32_t i = 1; i < chunk_count; ++i)
+        MergeExtremes(extremes, chunk_extremes[i]);
+
+    // 每块从同一个初始球开始扩大, 得到的球都包含初始球, 合并后包含所有顶点
+    const XMVECTOR initial = InitialSphere(extremes);
+    const XMVECTOR box_center = BoxCenter(extremes);
+    std::vector<SphereGrowth> chunk_growth(chunk_count);
+    jobs->ParallelFor(count, bounds_chunk_size, [&](std::uint32_t begin, std::uint32_t end){
+        chunk_growth[begin / bounds_chunk_size] = GrowSphere(fetch, begin, end, initial, box_center);
+    });
+
+    XMVECTOR ritter = XMLoadFloat4(&chunk_growth[0].sphere);
+    float center_distance_sq = chunk_growth[0].center_distance_sq;
+    for(std::uint32_t i = 1; i < chunk_count; ++i)
+    {
+        ritter = MergeSpheres(ritter, XMLoadFloat4(&chunk_growth[i].sphere));
+        center_distance_sq = std::max(center_distance_sq, chunk_growth[i].center_distance_sq);
+    }
+    return MakeBounds(extremes, ritter, center_distance_sq);
+}
+
+template<typename T>
+MeshBounds ComputeBounds(const T* indices, std::size_t index_count, const void* positions, std::uint32_t stride)
+{
+    return ComputeBoundsSerial(IndexedPositions<T>(indices, positions, stride), index_count);
+}
+
+template MeshBounds ComputeBounds<std::uint16_t>(const std::uint16_t*, std::size_t, const void*, std::uint32_t);
+template MeshBounds ComputeBounds<std::uint32_t>(const std::uint32_t*, std::size_t, const void*, std::uint32_t);
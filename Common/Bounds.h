@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+class JobSystem;
+
+//-----------------------------Bounds--------------------------------
+// submesh / meshlet 的包围盒和包围球, 位置是 XMFLOAT3, stride 为相邻顶点的字节间隔
+struct MeshBounds
+{
+    DirectX::BoundingBox box;
+    DirectX::BoundingSphere sphere;
+};
+
+// 顶点数超过这个值并且给了 jobs 时按块并行
+constexpr std::uint32_t bounds_chunk_size = 1 << 16;
+
+// 包围盒是精确的 (SIMD min/max 归约)
+// 包围球取 Ritter 球和以包围盒中心为球心的最小球中半径较小的一个, 不一定最小, 但保证包含所有顶点
+// 一共读两遍顶点: 第一遍包围盒和 6 个方向的极值点, 第二遍扩大 Ritter 球并求到包围盒中心的最大距离
+MeshBounds ComputeBounds(const void* positions, std::size_t vertex_count, std::uint32_t stride, JobSystem* jobs = nullptr);
+
+// 只统计 indices 用到的顶点, 用于 meshlet 这类小范围, 单线程
+template<typename T>
+MeshBounds ComputeBounds(const T* indices, std::size_t index_count, const void* positions, std::uint32_t stride);
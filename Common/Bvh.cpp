@@ -0,0 +1,822 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+#include "Bvh.h"
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // 超过这个对象数的节点分桶时按块并行
+    constexpr std::uint32_t bvh_parallel_bin_threshold = 1u << 16;
+    constexpr std::uint32_t bvh_bin_chunk_size = 1u << 14;
+    // 超过这个对象数的子树作为单独的 job 构建
+    constexpr std::uint32_t bvh_parallel_subtree_threshold = 1u << 13;
+    // 每层最多压入 3 个兄弟节点
+    constexpr std::uint32_t bvh_stack_size = 3 * bvh_max_depth + 4;
+
+    struct Box
+    {
+        float min[3];
+        float max[3];
+
+        static Box Empty() { return {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}}; }
+
+        void Grow(const float* lo, const float* hi)
+        {
+            for(int a = 0; a < 3; ++a)
+            {
+                min[a] = std::min(min[a], lo[a]);
+                max[a] = std::max(max[a], hi[a]);
+            }
+        }
+
+        void Grow(const Box& box) { Grow(box.min, box.max); }
+    };
+
+    // 4 个通道的符号位, 第 k 位对应第 k 个子节点
+    std::uint32_t LaneMask(FXMVECTOR mask)
+    {
+#if defined(_XM_SSE_INTRINSICS_)
+        return (std::uint32_t)_mm_movemask_ps(mask);
+#else
+        std::uint32_t bits[4];
+        XMStoreInt4(bits, mask);
+        return (bits[0] >> 31) | (bits[1] >> 31 << 1) | (bits[2] >> 31 << 2) | (bits[3] >> 31 << 3);
+#endif
+    }
+
+    XMVECTOR LoadLanes(const float* lanes)
+    {
+        return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(lanes));
+    }
+
+    void SetSlot(BvhNode& node, std::uint32_t slot, const Box& box)
+    {
+        node.min_x[slot] = box.min[0];
+        node.min_y[slot] = box.min[1];
+        node.min_z[slot] = box.min[2];
+        node.max_x[slot] = box.max[0];
+        node.max_y[slot] = box.max[1];
+        node.max_z[slot] = box.max[2];
+    }
+
+    Box SlotBox(const BvhNode& node, std::uint32_t slot)
+    {
+        Box box;
+        box.min[0] = node.min_x[slot];
+        box.min[1] = node.min_y[slot];
+        box.min[2] = node.min_z[slot];
+        box.max[0] = node.max_x[slot];
+        box.max[1] = node.max_y[slot];
+        box.max[2] = node.max_z[slot];
+        return box;
+    }
+
+    // 方向分量为 0 时用一个很小的值代替, 避免 0 * inf 得到 NaN
+    float SafeReciprocal(float d)
+    {
+        return 1.0f / (std::fabs(d) > 1e-20f ? d : 1e-20f);
+    }
+
+    // 射线和包围盒的进入距离, 不相交时返回 false
+    bool RayBox(const float* origin, const float* inv_direction, const XMFLOAT3& lo, const XMFLOAT3& hi, float max_distance, float& distance)
+    {
+        const float lo_axis[3] = {lo.x, lo.y, lo.z};
+        const float hi_axis[3] = {hi.x, hi.y, hi.z};
+        float t_enter = 0.0f;
+        float t_exit = max_distance;
+        for(int a = 0; a < 3; ++a)
+        {
+            const float t0 = (lo_axis[a] - origin[a]) * inv_direction[a];
+            const float t1 = (hi_axis[a] - origin[a]) * inv_direction[a];
+            t_enter = std::max(t_enter, std::min(t0, t1));
+            t_exit = std::min(t_exit, std::max(t0, t1));
+        }
+        distance = t_enter;
+        return t_enter <= t_exit;
+    }
+
+    // 视锥的一个平面: 按法线分量的符号选择 AABB 上离平面最远 (positive) 和最近 (negative) 的顶点
+    struct FrustumPlane
+    {
+        XMVECTOR normal_x;
+        XMVECTOR normal_y;
+        XMVECTOR normal_z;
+        XMVECTOR distance;
+        bool positive[3];
+    };
+
+    // 建树用的包围盒, 用向量的 min/max 一次更新 3 个轴, w 分量不使用
+    // 没有默认初始化, 建树时大块分配的节点只有用到的部分才会写入
+    struct BuildBox
+    {
+        XMVECTOR min;
+        XMVECTOR max;
+
+        static BuildBox Empty() { return {XMVectorReplicate(FLT_MAX), XMVectorReplicate(-FLT_MAX)}; }
+
+        void Grow(FXMVECTOR lo, FXMVECTOR hi)
+        {
+            min = XMVectorMin(min, lo);
+            max = XMVectorMax(max, hi);
+        }
+
+        void Grow(const BuildBox& box) { Grow(box.min, box.max); }
+
+        // 表面积的一半, 只用于比较 SAH 代价
+        float HalfArea() const
+        {
+            const XMVECTOR d = XMVectorMax(XMVectorSubtract(max, min), XMVectorZero());
+            return XMVectorGetX(XMVector3Dot(d, XMVectorSwizzle<XM_SWIZZLE_Y, XM_SWIZZLE_Z, XM_SWIZZLE_X, XM_SWIZZLE_W>(d)));
+        }
+
+        Box ToBox() const
+        {
+            XMFLOAT3 lo, hi;
+            XMStoreFloat3(&lo, min);
+            XMStoreFloat3(&hi, max);
+            return {{lo.x, lo.y, lo.z}, {hi.x, hi.y, hi.z}};
+        }
+    };
+
+    // 建树时对象的包围盒跟着编号一起分区, 分桶时顺序读取
+    // min 和 object 正好是一个对齐的 16 字节, 读取时把 object 所在的 w 分量清零
+    struct alignas(16) BuildObject
+    {
+        XMFLOAT3 min;
+        std::uint32_t object;
+        XMFLOAT3 max;
+        float padding;
+
+        XMVECTOR Min() const { return XMVectorSelect(XMVectorZero(), XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&min)), g_XMSelect1110); }
+        XMVECTOR Max() const { return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&max)); }
+        float Centroid(std::uint32_t axis) const { return 0.5f * ((&min.x)[axis] + (&max.x)[axis]); }
+    };
+
+    struct Bin
+    {
+        BuildBox box = BuildBox::Empty();
+        BuildBox centroid_box = BuildBox::Empty();
+        std::uint32_t count = 0;
+
+        void Grow(const Bin& bin)
+        {
+            box.Grow(bin.box);
+            centroid_box.Grow(bin.centroid_box);
+            count += bin.count;
+        }
+    };
+
+    // 对象少的节点用较少的桶, 每个节点扫描桶的开销不超过对象数
+    std::uint32_t BinCount(std::uint32_t object_count)
+    {
+        return std::min(bvh_bin_count, object_count);
+    }
+}
+
+//-----------------------------BvhBuilder--------------------------------
+// 先建二叉树 (节点编号通过原子计数分配, 子树可以并行), 再按先序展开成 4 叉树, 子节点的编号总是大于父节点
+class BvhBuilder
+{
+    public:
+        BvhBuilder(Bvh& bvh, const BoundingBox* boxes, std::uint32_t count, JobSystem* jobs)
+        : bvh(bvh), count(count), jobs(jobs), build_objects(count),
+          binary(std::make_unique_for_overwrite<BinaryNode[]>(2 * (std::size_t)count)){
+            for(std::uint32_t i = 0; i < count; ++i)
+            {
+                const XMVECTOR center = XMLoadFloat3(&boxes[i].Center);
+                const XMVECTOR extents = XMLoadFloat3(&boxes[i].Extents);
+                BuildObject& object = build_objects[i];
+                XMStoreFloat3(&object.min, XMVectorSubtract(center, extents));
+                XMStoreFloat3(&object.max, XMVectorAdd(center, extents));
+                object.object = i;
+                object.padding = 0.0f;
+            }
+        }
+
+        void Build()
+        {
+            Bin root = BinRange(build_objects.data(), count);
+            SetNode(0, 0, root);
+            binary_count = 1;
+            BuildBinary(0, 0);
+
+            bvh.nodes.reserve(binary_count / 2 + 1);
+            bvh.object_node.resize(count);
+            Collapse(0, bvh_invalid_index);
+
+            bvh.objects.resize(count);
+            bvh.object_min.resize(count);
+            bvh.object_max.resize(count);
+            bvh.object_position.resize(count);
+            for(std::uint32_t i = 0; i < count; ++i)
+            {
+                const BuildObject& object = build_objects[i];
+                bvh.objects[i] = object.object;
+                bvh.object_min[i] = object.min;
+                bvh.object_max[i] = object.max;
+                bvh.object_position[object.object] = i;
+            }
+            bvh.node_dirty.assign(bvh.nodes.size(), 0);
+        }
+
+    private:
+        struct BinaryNode
+        {
+            BuildBox box;
+            BuildBox centroid_box;
+            std::uint32_t first;
+            std::uint32_t count;
+            // 叶子为 bvh_invalid_index, 否则 left + 1 为右子节点
+            std::uint32_t left;
+        };
+
+        struct Split
+        {
+            // 桶编号小于 bin 的对象在左边, 没有可用的分割位置时 cost 为 FLT_MAX
+            std::uint32_t bin = 0;
+            float cost = FLT_MAX;
+            Bin left;
+            Bin right;
+        };
+
+        // 只沿中心范围最大的轴分桶
+        struct Binning
+        {
+            std::uint32_t axis;
+            std::uint32_t bin_count;
+            float min_centroid;
+            float scale;
+
+            std::uint32_t Index(const BuildObject& object) const
+            {
+                return std::min(bin_count - 1, (std::uint32_t)((object.Centroid(axis) - min_centroid) * scale));
+            }
+        };
+
+        static void Add(Bin& bin, const BuildObject& object)
+        {
+            const XMVECTOR lo = object.Min();
+            const XMVECTOR hi = object.Max();
+            const XMVECTOR centroid = XMVectorScale(XMVectorAdd(lo, hi), 0.5f);
+            bin.box.Grow(lo, hi);
+            bin.centroid_box.Grow(centroid, centroid);
+            ++bin.count;
+        }
+
+        static Bin BinRange(const BuildObject* objects, std::uint32_t count)
+        {
+            Bin bin;
+            for(std::uint32_t i = 0; i < count; ++i)
+                Add(bin, objects[i]);
+            return bin;
+        }
+
+        static void BinObjects(const BuildObject* objects, std::uint32_t count, const Binning& binning, Bin* bins)
+        {
+            for(std::uint32_t i = 0; i < count; ++i)
+                Add(bins[binning.Index(objects[i])], objects[i]);
+        }
+
+        void SetNode(std::uint32_t index, std::uint32_t first, const Bin& bin)
+        {
+            BinaryNode& node = binary[index];
+            node.box = bin.box;
+            node.centroid_box = bin.centroid_box;
+            node.first = first;
+            node.count = bin.count;
+            node.left = bvh_invalid_index;
+        }
+
+        Split FindSplit(const BinaryNode& node, const Binning& binning) const
+        {
+            Bin bins[bvh_bin_count];
+            const BuildObject* first = build_objects.data() + node.first;
+            if(jobs != nullptr && node.count >= bvh_parallel_bin_threshold)
+            {
+                const std::uint32_t chunk_count = (node.count + bvh_bin_chunk_size - 1) / bvh_bin_chunk_size;
+                std::vector<Bin> chunk_bins((std::size_t)chunk_count * bvh_bin_count);
+                jobs->ParallelFor(chunk_count, 1, [&](std::uint32_t begin, std::uint32_t end){
+                    for(std::uint32_t c = begin; c < end; ++c)
+                    {
+                        const std::uint32_t offset = c * bvh_bin_chunk_size;
+                        BinObjects(first + offset, std::min(bvh_bin_chunk_size, node.count - offset), binning, &chunk_bins[c * bvh_bin_count]);
+                    }
+                });
+                for(std::uint32_t c = 0; c < chunk_count; ++c)
+                {
+                    for(std::uint32_t b = 0; b < binning.bin_count; ++b)
+                        bins[b].Grow(chunk_bins[c * bvh_bin_count + b]);
+                }
+            }
+            else
+            {
+                BinObjects(first, node.count, binning, bins);
+            }
+
+            // 从右往左累计右侧, 再从左往右扫描每个分割位置的 SAH 代价
+            Bin right[bvh_bin_count];
+            right[binning.bin_count - 1] = bins[binning.bin_count - 1];
+            for(std::uint32_t b = binning.bin_count - 1; b > 0; --b)
+            {
+                right[b - 1] = right[b];
+                right[b - 1].Grow(bins[b - 1]);
+            }
+
+            Split best;
+            Bin left;
+            for(std::uint32_t b = 1; b < binning.bin_count; ++b)
+            {
+                left.Grow(bins[b - 1]);
+                if(left.count == 0 || right[b].count == 0)
+                    continue;
+
+                const float cost = left.box.HalfArea() * left.count + right[b].box.HalfArea() * right[b].count;
+                if(cost < best.cost)
+                {
+                    best.bin = b;
+                    best.cost = cost;
+                    best.left = left;
+                    best.right = right[b];
+                }
+            }
+            return best;
+        }
+
+        void BuildBinary(std::uint32_t index, std::uint32_t depth)
+        {
+            BinaryNode& node = binary[index];
+            if(node.count <= bvh_max_leaf_size || depth + 1 >= bvh_max_depth)
+                return;
+
+            XMFLOAT3 centroid_min, centroid_extent;
+            XMStoreFloat3(&centroid_min, node.centroid_box.min);
+            XMStoreFloat3(&centroid_extent, XMVectorSubtract(node.centroid_box.max, node.centroid_box.min));
+            const float* extents = &centroid_extent.x;
+
+            Binning binning;
+            binning.axis = 0;
+            for(std::uint32_t a = 1; a < 3; ++a)
+            {
+                if(extents[a] > extents[binning.axis])
+                    binning.axis = a;
+            }
+            binning.bin_count = BinCount(node.count);
+            binning.min_centroid = (&centroid_min.x)[binning.axis];
+            binning.scale = extents[binning.axis] > 0.0f ? binning.bin_count / extents[binning.axis] : 0.0f;
+
+            BuildObject* first = build_objects.data() + node.first;
+            Split split;
+            if(binning.scale > 0.0f)
+                split = FindSplit(node, binning);
+            if(split.cost != FLT_MAX)
+            {
+                // 和分桶时的计算完全相同, 分区后左边正好是 split.left.count 个
+                std::partition(first, first + node.count, [&](const BuildObject& object){
+                    return binning.Index(object) < split.bin;
+                });
+            }
+            else
+            {
+                // 所有中心重合时按位置对半分
+                split.left = BinRange(first, node.count / 2);
+                split.right = BinRange(first + node.count / 2, node.count - node.count / 2);
+            }
+
+            const std::uint32_t left = binary_count.fetch_add(2);
+            node.left = left;
+            SetNode(left, node.first, split.left);
+            SetNode(left + 1, node.first + split.left.count, split.right);
+
+            if(jobs != nullptr && node.count >= bvh_parallel_subtree_threshold)
+            {
+                JobSystem::JobHandle left_job = jobs->Schedule("BuildBvh subtree", [this, left, depth]{
+                    BuildBinary(left, depth + 1);
+                });
+                BuildBinary(left + 1, depth + 1);
+                jobs->Wait(left_job);
+            }
+            else
+            {
+                BuildBinary(left, depth + 1);
+                BuildBinary(left + 1, depth + 1);
+            }
+        }
+
+        // 返回 4 叉树节点的编号
+        std::uint32_t Collapse(std::uint32_t index, std::uint32_t parent)
+        {
+            const std::uint32_t node_index = (std::uint32_t)bvh.nodes.size();
+            bvh.nodes.emplace_back();
+            bvh.node_first.push_back(binary[index].first);
+            bvh.node_object_count.push_back(binary[index].count);
+            bvh.node_parent.push_back(parent);
+
+            // 反复展开表面积最大的内部节点, 直到凑满 4 个子节点
+            std::uint32_t slots[4];
+            std::uint32_t slot_count = 0;
+            if(binary[index].left == bvh_invalid_index)
+            {
+                slots[slot_count++] = index;
+            }
+            else
+            {
+                slots[slot_count++] = binary[index].left;
+                slots[slot_count++] = binary[index].left + 1;
+            }
+            while(slot_count < 4)
+            {
+                std::uint32_t expand = bvh_invalid_index;
+                float expand_area = -1.0f;
+                for(std::uint32_t k = 0; k < slot_count; ++k)
+                {
+                    const BinaryNode& slot = binary[slots[k]];
+                    if(slot.left != bvh_invalid_index && slot.box.HalfArea() > expand_area)
+                    {
+                        expand = k;
+                        expand_area = slot.box.HalfArea();
+                    }
+                }
+                if(expand == bvh_invalid_index)
+                    break;
+
+                const std::uint32_t left = binary[slots[expand]].left;
+                slots[expand] = left;
+                slots[slot_count++] = left + 1;
+            }
+
+            // 递归时 nodes 会扩容, 先在局部填好再写回
+            BvhNode node;
+            for(std::uint32_t k = 0; k < 4; ++k)
+            {
+                node.child[k] = bvh_invalid_index;
+                node.count[k] = 0;
+                SetSlot(node, k, Box::Empty());
+            }
+            for(std::uint32_t k = 0; k < slot_count; ++k)
+            {
+                const BinaryNode& slot = binary[slots[k]];
+                SetSlot(node, k, slot.box.ToBox());
+                if(slot.left == bvh_invalid_index)
+                {
+                    node.child[k] = slot.first;
+                    node.count[k] = slot.count;
+                    for(std::uint32_t i = 0; i < slot.count; ++i)
+                        bvh.object_node[slot.first + i] = node_index;
+                }
+                else
+                {
+                    node.child[k] = Collapse(slots[k], node_index);
+                }
+            }
+            bvh.nodes[node_index] = node;
+            return node_index;
+        }
+
+    private:
+        Bvh& bvh;
+        std::uint32_t count;
+        JobSystem* jobs;
+        std::vector<BuildObject> build_objects;
+        // 二叉树最多 2 * count - 1 个节点
+        std::unique_ptr<BinaryNode[]> binary;
+        std::atomic<std::uint32_t> binary_count = 0;
+};
+
+void Bvh::Build(const BoundingBox* boxes, std::uint32_t count, JobSystem* jobs)
+{
+    nodes.clear();
+    node_first.clear();
+    node_object_count.clear();
+    node_parent.clear();
+    objects.clear();
+    object_min.clear();
+    object_max.clear();
+    object_node.clear();
+    object_position.clear();
+    node_dirty.clear();
+    if(count == 0)
+        return;
+
+    BvhBuilder builder(*this, boxes, count, jobs);
+    builder.Build();
+}
+
+void Bvh::RefitNode(std::uint32_t node_index)
+{
+    BvhNode& node = nodes[node_index];
+    for(std::uint32_t k = 0; k < 4; ++k)
+    {
+        if(node.child[k] == bvh_invalid_index)
+            continue;
+
+        Box box = Box::Empty();
+        if(node.count[k] > 0)
+        {
+            for(std::uint32_t i = node.child[k]; i < node.child[k] + node.count[k]; ++i)
+                box.Grow(&object_min[i].x, &object_max[i].x);
+        }
+        else
+        {
+            // 空位的包围盒是空的, 不影响结果
+            const BvhNode& child = nodes[node.child[k]];
+            for(std::uint32_t j = 0; j < 4; ++j)
+                box.Grow(SlotBox(child, j));
+        }
+        SetSlot(node, k, box);
+    }
+}
+
+void Bvh::Refit(const BoundingBox* boxes)
+{
+    for(std::uint32_t i = 0; i < Size(); ++i)
+    {
+        const BoundingBox& box = boxes[objects[i]];
+        XMStoreFloat3(&object_min[i], XMVectorSubtract(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+        XMStoreFloat3(&object_max[i], XMVectorAdd(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+    }
+
+    // 子节点的编号大于父节点, 倒序处理保证子节点先更新
+    for(std::uint32_t node = (std::uint32_t)nodes.size(); node > 0; --node)
+        RefitNode(node - 1);
+}
+
+void Bvh::Refit(const BoundingBox* boxes, const std::uint32_t* moved, std::uint32_t moved_count)
+{
+    dirty_nodes.clear();
+    for(std::uint32_t m = 0; m < moved_count; ++m)
+    {
+        const std::uint32_t position = object_position[moved[m]];
+        const BoundingBox& box = boxes[moved[m]];
+        XMStoreFloat3(&object_min[position], XMVectorSubtract(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+        XMStoreFloat3(&object_max[position], XMVectorAdd(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+
+        // 向上标记到已经标记过的祖先为止
+        for(std::uint32_t node = object_node[position]; node != bvh_invalid_index && !node_dirty[node]; node = node_parent[node])
+        {
+            node_dirty[node] = 1;
+            dirty_nodes.push_back(node);
+        }
+    }
+
+    std::sort(dirty_nodes.begin(), dirty_nodes.end(), std::greater<std::uint32_t>());
+    for(std::uint32_t node : dirty_nodes)
+    {
+        RefitNode(node);
+        node_dirty[node] = 0;
+    }
+}
+
+std::uint32_t Bvh::CullFrustum(const CullingFrustum& frustum, std::uint32_t* visible) const
+{
+    if(nodes.empty())
+        return 0;
+
+    FrustumPlane planes[6];
+    for(std::uint32_t p = 0; p < 6; ++p)
+    {
+        planes[p].normal_x = XMVectorReplicate(frustum.normal_x[p]);
+        planes[p].normal_y = XMVectorReplicate(frustum.normal_y[p]);
+        planes[p].normal_z = XMVectorReplicate(frustum.normal_z[p]);
+        planes[p].distance = XMVectorReplicate(frustum.distance[p]);
+        planes[p].positive[0] = frustum.normal_x[p] >= 0.0f;
+        planes[p].positive[1] = frustum.normal_y[p] >= 0.0f;
+        planes[p].positive[2] = frustum.normal_z[p] >= 0.0f;
+    }
+
+    // 每项带着还需要测试的平面, 父节点已经完全在某个平面内侧时子节点不再测试它
+    struct Entry
+    {
+        std::uint32_t node;
+        std::uint32_t plane_mask;
+    };
+    Entry stack[bvh_stack_size];
+    std::uint32_t stack_size = 0;
+    stack[stack_size++] = {0, 0x3f};
+
+    std::uint32_t visible_count = 0;
+    while(stack_size > 0)
+    {
+        const Entry entry = stack[--stack_size];
+        const BvhNode& node = nodes[entry.node];
+        const XMVECTOR lo[3] = {LoadLanes(node.min_x), LoadLanes(node.min_y), LoadLanes(node.min_z)};
+        const XMVECTOR hi[3] = {LoadLanes(node.max_x), LoadLanes(node.max_y), LoadLanes(node.max_z)};
+
+        std::uint32_t outside_mask = 0;
+        std::uint32_t child_planes[4] = {entry.plane_mask, entry.plane_mask, entry.plane_mask, entry.plane_mask};
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            if((entry.plane_mask & (1u << p)) == 0)
+                continue;
+
+            // 最远的顶点在外侧时整个盒子在外侧, 最近的顶点在内侧时整个盒子在内侧
+            const FrustumPlane& plane = planes[p];
+            const XMVECTOR far_x = plane.positive[0] ? hi[0] : lo[0];
+            const XMVECTOR far_y = plane.positive[1] ? hi[1] : lo[1];
+            const XMVECTOR far_z = plane.positive[2] ? hi[2] : lo[2];
+            const XMVECTOR near_x = plane.positive[0] ? lo[0] : hi[0];
+            const XMVECTOR near_y = plane.positive[1] ? lo[1] : hi[1];
+            const XMVECTOR near_z = plane.positive[2] ? lo[2] : hi[2];
+            const XMVECTOR far_distance = XMVectorMultiplyAdd(plane.normal_x, far_x,
+                                          XMVectorMultiplyAdd(plane.normal_y, far_y,
+                                          XMVectorMultiplyAdd(plane.normal_z, far_z, plane.distance)));
+            const XMVECTOR near_distance = XMVectorMultiplyAdd(plane.normal_x, near_x,
+                                           XMVectorMultiplyAdd(plane.normal_y, near_y,
+                                           XMVectorMultiplyAdd(plane.normal_z, near_z, plane.distance)));
+            outside_mask |= LaneMask(XMVectorLess(far_distance, XMVectorZero()));
+            const std::uint32_t inside_mask = LaneMask(XMVectorGreaterOrEqual(near_distance, XMVectorZero()));
+            for(std::uint32_t k = 0; k < 4; ++k)
+            {
+                if(inside_mask & (1u << k))
+                    child_planes[k] &= ~(1u << p);
+            }
+        }
+
+        for(std::uint32_t k = 0; k < 4; ++k)
+        {
+            if((outside_mask & (1u << k)) || node.child[k] == bvh_invalid_index)
+                continue;
+
+            if(child_planes[k] == 0)
+            {
+                // 整个子树可见, 对象在 objects 中是连续的
+                const std::uint32_t first = node.count[k] > 0 ? node.child[k] : node_first[node.child[k]];
+                const std::uint32_t count = node.count[k] > 0 ? node.count[k] : node_object_count[node.child[k]];
+                std::memcpy(visible + visible_count, objects.data() + first, count * sizeof(std::uint32_t));
+                visible_count += count;
+            }
+            else if(node.count[k] > 0)
+            {
+                for(std::uint32_t i = node.child[k]; i < node.child[k] + node.count[k]; ++i)
+                {
+                    const float lo_object[3] = {object_min[i].x, object_min[i].y, object_min[i].z};
+                    const float hi_object[3] = {object_max[i].x, object_max[i].y, object_max[i].z};
+                    bool inside = true;
+                    for(std::uint32_t p = 0; p < 6 && inside; ++p)
+                    {
+                        if((child_planes[k] & (1u << p)) == 0)
+                            continue;
+                        float d = frustum.distance[p];
+                        d += frustum.normal_x[p] * (planes[p].positive[0] ? hi_object[0] : lo_object[0]);
+                        d += frustum.normal_y[p] * (planes[p].positive[1] ? hi_object[1] : lo_object[1]);
+                        d += frustum.normal_z[p] * (planes[p].positive[2] ? hi_object[2] : lo_object[2]);
+                        inside = d >= 0.0f;
+                    }
+                    if(inside)
+                        visible[visible_count++] = objects[i];
+                }
+            }
+            else
+            {
+                stack[stack_size++] = {node.child[k], child_planes[k]};
+            }
+        }
+    }
+    return visible_count;
+}
+
+BvhHit Bvh::Raycast(const BvhRay& ray) const
+{
+    BvhHit hit;
+    hit.distance = ray.max_distance;
+    if(nodes.empty())
+        return hit;
+
+    const float origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+    const float inv_direction[3] = {SafeReciprocal(ray.direction.x), SafeReciprocal(ray.direction.y), SafeReciprocal(ray.direction.z)};
+    const XMVECTOR origin_lanes[3] = {XMVectorReplicate(origin[0]), XMVectorReplicate(origin[1]), XMVectorReplicate(origin[2])};
+    const XMVECTOR inv_lanes[3] = {XMVectorReplicate(inv_direction[0]), XMVectorReplicate(inv_direction[1]), XMVectorReplicate(inv_direction[2])};
+
+    // 每项带着进入距离, 出栈时已经比最近的命中远就跳过
+    struct Entry
+    {
+        std::uint32_t node;
+        float distance;
+    };
+    Entry stack[bvh_stack_size];
+    std::uint32_t stack_size = 0;
+    stack[stack_size++] = {0, 0.0f};
+
+    while(stack_size > 0)
+    {
+        const Entry entry = stack[--stack_size];
+        if(entry.distance > hit.distance)
+            continue;
+
+        const BvhNode& node = nodes[entry.node];
+        const float* lo[3] = {node.min_x, node.min_y, node.min_z};
+        const float* hi[3] = {node.max_x, node.max_y, node.max_z};
+        XMVECTOR t_enter = XMVectorZero();
+        XMVECTOR t_exit = XMVectorReplicate(hit.distance);
+        for(std::uint32_t a = 0; a < 3; ++a)
+        {
+            const XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(LoadLanes(lo[a]), origin_lanes[a]), inv_lanes[a]);
+            const XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(LoadLanes(hi[a]), origin_lanes[a]), inv_lanes[a]);
+            t_enter = XMVectorMax(t_enter, XMVectorMin(t0, t1));
+            t_exit = XMVectorMin(t_exit, XMVectorMax(t0, t1));
+        }
+        const std::uint32_t hit_mask = LaneMask(XMVectorLessOrEqual(t_enter, t_exit));
+        if(hit_mask == 0)
+            continue;
+
+        XMFLOAT4A enter;
+        XMStoreFloat4A(&enter, t_enter);
+        const float enter_distance[4] = {enter.x, enter.y, enter.z, enter.w};
+
+        // 内部子节点按进入距离从远到近入栈, 近的先出栈
+        Entry children[4];
+        std::uint32_t child_count = 0;
+        for(std::uint32_t k = 0; k < 4; ++k)
+        {
+            if((hit_mask & (1u << k)) == 0 || node.child[k] == bvh_invalid_index)
+                continue;
+
+            if(node.count[k] > 0)
+            {
+                for(std::uint32_t i = node.child[k]; i < node.child[k] + node.count[k]; ++i)
+                {
+                    float distance;
+                    if(RayBox(origin, inv_direction, object_min[i], object_max[i], hit.distance, distance) && distance < hit.distance)
+                    {
+                        hit.object = objects[i];
+                        hit.distance = distance;
+                    }
+                }
+            }
+            else
+            {
+                children[child_count++] = {node.child[k], enter_distance[k]};
+            }
+        }
+        for(std::uint32_t c = 1; c < child_count; ++c)
+        {
+            const Entry child = children[c];
+            std::uint32_t j = c;
+            for(; j > 0 && children[j - 1].distance < child.distance; --j)
+                children[j] = children[j - 1];
+            children[j] = child;
+        }
+        for(std::uint32_t c = 0; c < child_count; ++c)
+            stack[stack_size++] = children[c];
+    }
+    return hit;
+}
+
+std::uint32_t Bvh::QueryOverlap(const BoundingBox& box, std::vector<std::uint32_t>& result) const
+{
+    if(nodes.empty())
+        return 0;
+
+    XMFLOAT3 query_min, query_max;
+    XMStoreFloat3(&query_min, XMVectorSubtract(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+    XMStoreFloat3(&query_max, XMVectorAdd(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+    const XMVECTOR lo_lanes[3] = {XMVectorReplicate(query_min.x), XMVectorReplicate(query_min.y), XMVectorReplicate(query_min.z)};
+    const XMVECTOR hi_lanes[3] = {XMVectorReplicate(query_max.x), XMVectorReplicate(query_max.y), XMVectorReplicate(query_max.z)};
+
+    std::uint32_t stack[bvh_stack_size];
+    std::uint32_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    const std::size_t first_result = result.size();
+    while(stack_size > 0)
+    {
+        const BvhNode& node = nodes[stack[--stack_size]];
+        const float* lo[3] = {node.min_x, node.min_y, node.min_z};
+        const float* hi[3] = {node.max_x, node.max_y, node.max_z};
+        XMVECTOR separated = XMVectorFalseInt();
+        for(std::uint32_t a = 0; a < 3; ++a)
+        {
+            separated = XMVectorOrInt(separated, XMVectorGreater(LoadLanes(lo[a]), hi_lanes[a]));
+            separated = XMVectorOrInt(separated, XMVectorLess(LoadLanes(hi[a]), lo_lanes[a]));
+        }
+        const std::uint32_t overlap_mask = ~LaneMask(separated) & 0xf;
+
+        for(std::uint32_t k = 0; k < 4; ++k)
+        {
+            if((overlap_mask & (1u << k)) == 0 || node.child[k] == bvh_invalid_index)
+                continue;
+
+            if(node.count[k] > 0)
+            {
+                for(std::uint32_t i = node.child[k]; i < node.child[k] + node.count[k]; ++i)
+                {
+                    if(object_min[i].x <= query_max.x && object_max[i].x >= query_min.x &&
+                       object_min[i].y <= query_max.y && object_max[i].y >= query_min.y &&
+                       object_min[i].z <= query_max.z && object_max[i].z >= query_min.z)
+                        result.push_back(objects[i]);
+                }
+            }
+            else
+            {
+                stack[stack_size++] = node.child[k];
+            }
+        }
+    }
+    return (std::uint32_t)(result.size() - first_result);
+}
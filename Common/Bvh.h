@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include "FrustumCulling.h"
+
+class JobSystem;
+
+//-----------------------------Bvh--------------------------------
+// 场景对象 (世界空间 AABB) 的 4 叉 BVH, 用于层次化的视锥剔除, 射线拾取和包围盒重叠查询
+// 先用分桶 SAH 建二叉树, 再把每个节点的子节点和孙节点合并成最多 4 个子节点
+// 节点按 SoA 存放 4 个子节点的包围盒并对齐到缓存行, 查询时用 DirectXMath 向量一次测试 4 个子节点
+// 对象移动后 Refit 自底向上更新包围盒, 树的结构不变; 移动幅度大时质量会下降, 需要重新 Build
+constexpr std::uint32_t bvh_invalid_index = UINT32_MAX;
+// 叶子中对象数的上限
+constexpr std::uint32_t bvh_max_leaf_size = 4;
+// SAH 每个轴的桶数
+constexpr std::uint32_t bvh_bin_count = 16;
+// 二叉树达到这个深度时不再分割 (叶子可能超过 bvh_max_leaf_size 个对象), 查询用固定大小的栈
+constexpr std::uint32_t bvh_max_depth = 64;
+
+struct alignas(64) BvhNode
+{
+    float min_x[4];
+    float min_y[4];
+    float min_z[4];
+    float max_x[4];
+    float max_y[4];
+    float max_z[4];
+    // count 为 0 时 child 是子节点编号; 否则是叶子, 包含 Objects() 中 [child, child + count) 的对象
+    // 空位的 child 为 bvh_invalid_index, 包围盒为空 (min > max), 任何测试都不会通过
+    std::uint32_t child[4];
+    std::uint32_t count[4];
+};
+static_assert(sizeof(BvhNode) == 128, "BvhNode 占两个缓存行");
+
+struct BvhRay
+{
+    DirectX::XMFLOAT3 origin = {0.0f, 0.0f, 0.0f};
+    // 不要求归一化, 距离以 direction 的长度为单位
+    DirectX::XMFLOAT3 direction = {0.0f, 0.0f, 1.0f};
+    float max_distance = FLT_MAX;
+};
+
+struct BvhHit
+{
+    std::uint32_t object = bvh_invalid_index;
+    // 射线进入对象包围盒的距离, 起点在包围盒内时为 0
+    float distance = FLT_MAX;
+};
+
+class Bvh
+{
+    public:
+        // 替换原有的树, boxes[i] 为对象 i 的包围盒
+        // 对象较多并且给了 jobs 时, 上层节点的分桶按块并行, 较大的子树作为 job 并行构建
+        void Build(const DirectX::BoundingBox* boxes, std::uint32_t count, JobSystem* jobs = nullptr);
+
+        // boxes 和 Build 时的对象一一对应, 更新所有包围盒
+        void Refit(const DirectX::BoundingBox* boxes);
+        // 只有 moved 中的对象移动了: 只更新它们所在的叶子和祖先节点
+        void Refit(const DirectX::BoundingBox* boxes, const std::uint32_t* moved, std::uint32_t moved_count);
+
+        // 可见对象的编号写进 visible (至少 Size() 个), 返回数量; 顺序为树中的顺序, 不是递增的
+        // 完全在视锥内的节点不再测试, 直接输出整个子树; 节点已经在某个平面内侧时子节点跳过这个平面
+        std::uint32_t CullFrustum(const CullingFrustum& frustum, std::uint32_t* visible) const;
+
+        // 返回包围盒和射线最先相交的对象, 没有相交时 object 为 bvh_invalid_index
+        BvhHit Raycast(const BvhRay& ray) const;
+
+        // 包围盒和 box 重叠的对象追加到 result, 返回追加的数量
+        std::uint32_t QueryOverlap(const DirectX::BoundingBox& box, std::vector<std::uint32_t>& result) const;
+
+        std::uint32_t Size() const { return (std::uint32_t)objects.size(); }
+        const std::vector<BvhNode>& Nodes() const { return nodes; }
+        // 按叶子顺序排列的对象编号
+        const std::vector<std::uint32_t>& Objects() const { return objects; }
+
+    private:
+        friend class BvhBuilder;
+
+        void RefitNode(std::uint32_t node);
+
+    private:
+        std::vector<BvhNode> nodes;
+        // 每个节点所有子树的对象在 objects 中是连续的一段
+        std::vector<std::uint32_t> node_first;
+        std::vector<std::uint32_t> node_object_count;
+        std::vector<std::uint32_t> node_parent;
+
+        // 以下按叶子顺序排列
+        std::vector<std::uint32_t> objects;
+        std::vector<DirectX::XMFLOAT3> object_min;
+        std::vector<DirectX::XMFLOAT3> object_max;
+        // 所在叶子属于哪个节点
+        std::vector<std::uint32_t> object_node;
+        // 对象编号 -> 在 objects 中的位置
+        std::vector<std::uint32_t> object_position;
+
+        // 增量 Refit 时标记需要更新的节点
+        std::vector<std::uint8_t> node_dirty;
+        std::vector<std::uint32_t> dirty_nodes;
+};
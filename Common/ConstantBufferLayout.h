@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include <DirectXMath.h>
+
+//-----------------------------ConstantBufferLayout--------------------------------
+// 编译期检查 C++ 结构体和 HLSL cbuffer 的打包规则一致:
+// 1. 成员不能跨越 16 字节的寄存器边界
+// 2. 矩阵/数组/结构体从新的寄存器开始
+// 3. 数组的每个元素都从新的寄存器开始, 最后一个元素之后不补齐
+// 4. cbuffer 大小向上取整到 16 字节, CBV 大小向上取整到 256 字节
+// HLSL 里没有对应表示的成员 (C++ bool, 8/16 位整数, 元素大小不是 16 的倍数的数组) 直接报错
+namespace CBLayout
+{
+    constexpr std::size_t register_size = 16;
+    constexpr std::size_t cbv_alignment = 256;
+
+    constexpr std::size_t AlignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // HLSL 中必须从新寄存器开始的类型
+    template<typename T>
+    struct StartsRegister : std::bool_constant<std::is_array_v<T> || std::is_class_v<T>> {};
+
+    // DirectXMath 的向量类型在 HLSL 里是 floatN, 可以和前面的标量共用寄存器
+    template<> struct StartsRegister<DirectX::XMFLOAT2> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMFLOAT3> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMFLOAT4> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMINT2> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMINT3> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMINT4> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMUINT2> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMUINT3> : std::false_type {};
+    template<> struct StartsRegister<DirectX::XMUINT4> : std::false_type {};
+
+    // 成员在 HLSL 中占的字节数 (不包括最后的补齐)
+    // representable 为 false 时 C++ 的内存表示不可能和 HLSL 一致:
+    // HLSL 的 bool 是 4 字节, 没有 8/16 位标量; 数组元素的步长是 16 字节, C++ 数组是紧密排列的
+    template<typename T>
+    struct HlslType
+    {
+        static constexpr std::size_t bytesize = sizeof(T);
+        static constexpr bool representable = !(std::is_arithmetic_v<T> && sizeof(T) < 4);
+    };
+
+    template<typename T, std::size_t N>
+    struct HlslType<T[N]>
+    {
+        static constexpr std::size_t stride = AlignUp(HlslType<T>::bytesize, register_size);
+        static constexpr std::size_t bytesize = stride * (N - 1) + HlslType<T>::bytesize;
+        // 元素补齐到 16 字节的倍数时两边步长相同, 例如 XMFLOAT4 a[4]
+        static constexpr bool representable = HlslType<T>::representable && sizeof(T) % register_size == 0;
+    };
+
+    struct Field
+    {
+        std::size_t offset;
+        std::size_t bytesize;
+        bool starts_register;
+        bool representable;
+    };
+
+    template<std::size_t N>
+    constexpr bool AllRepresentable(const Field (&fields)[N])
+    {
+        for(std::size_t i = 0; i < N; ++i)
+        {
+            if(!fields[i].representable)
+                return false;
+        }
+        return true;
+    }
+
+    // 按 HLSL 规则依次放置成员, 每个成员的 C++ 偏移都必须等于 HLSL 偏移
+    template<std::size_t N>
+    constexpr bool MatchesHlsl(const Field (&fields)[N])
+    {
+        std::size_t cursor = 0;
+        for(std::size_t i = 0; i < N; ++i)
+        {
+            const Field& field = fields[i];
+            const bool straddles = (cursor % register_size) + field.bytesize > register_size;
+            if(field.starts_register || straddles)
+                cursor = AlignUp(cursor, register_size);
+
+            if(field.offset != cursor)
+                return false;
+
+            cursor += field.bytesize;
+        }
+        return true;
+    }
+
+    // HLSL 中 cbuffer 的大小
+    template<typename T>
+    constexpr std::size_t HlslSize = AlignUp(sizeof(T), register_size);
+
+    // 作为一个CBV时需要的大小, 对应运行时的 CalcConstantBufferByteSize
+    template<typename T>
+    constexpr std::size_t CBVSize = AlignUp(sizeof(T), cbv_alignment);
+}
+
+#define CB_FIELD(type, member) \
+    CBLayout::Field{offsetof(type, member), \
+                    CBLayout::HlslType<decltype(type::member)>::bytesize, \
+                    CBLayout::StartsRegister<decltype(type::member)>::value, \
+                    CBLayout::HlslType<decltype(type::member)>::representable}
+
+// 按声明顺序列出全部成员: CB_VALIDATE_LAYOUT(ObjectConstants, CB_FIELD(ObjectConstants, a), CB_FIELD(ObjectConstants, b))
+#define CB_VALIDATE_LAYOUT(type, ...) \
+    static_assert(std::is_standard_layout_v<type>, #type " must be standard layout to match a cbuffer"); \
+    static_assert([]{ constexpr CBLayout::Field fields[] = { __VA_ARGS__ }; return CBLayout::AllRepresentable(fields); }(), \
+                  #type " has a member with no HLSL equivalent (bool, 8/16-bit type, or array of non-16-byte elements)"); \
+    static_assert([]{ constexpr CBLayout::Field fields[] = { __VA_ARGS__ }; return CBLayout::MatchesHlsl(fields); }(), \
+                  #type " does not match HLSL cbuffer packing")
+
+//-----------------------------PackedConstants--------------------------------
+// 把同一次绘制用到的几个小常量结构体打包进同一个 256 字节的 CBV,
+// 每个结构体在 HLSL 中作为同一个 cbuffer 里按顺序声明的 struct 成员, 从新寄存器开始
+// 例如 ObjectConstants(80) + MaterialConstants(32) 只占一个 256 字节, 而不是两个
+template<typename... Ts>
+class PackedConstants
+{
+    public:
+        static constexpr std::size_t count = sizeof...(Ts);
+
+        template<std::size_t I>
+        using Type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+        template<std::size_t I>
+        static constexpr std::size_t Offset()
+        {
+            constexpr std::size_t sizes[] = { CBLayout::HlslSize<Ts>... };
+            std::size_t offset = 0;
+            for(std::size_t i = 0; i < I; ++i)
+                offset += sizes[i];
+            return offset;
+        }
+
+        static constexpr std::size_t hlsl_bytesize = (CBLayout::HlslSize<Ts> + ... + 0);
+        static constexpr std::size_t bytesize = CBLayout::AlignUp(hlsl_bytesize, CBLayout::cbv_alignment);
+        // 分开放时需要的大小, 用来比较节省的上传带宽
+        static constexpr std::size_t unpacked_bytesize = (CBLayout::CBVSize<Ts> + ... + 0);
+
+        template<std::size_t I>
+        static void Write(void* slot, const Type<I>& value)
+        {
+            static_assert(std::is_trivially_copyable_v<Type<I>>, "constants must be trivially copyable");
+            std::memcpy(static_cast<std::uint8_t*>(slot) + Offset<I>(), &value, sizeof(Type<I>));
+        }
+};
@@ -535,7 +535,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM param, LPARAM l_param)
         case WM_LBUTTONDOWN:
         case WM_RBUTTONDOWN:
         case WM_MBUTTONDOWN:
-            OnMouseDown(param, GET_X_LPARAM(l_param), GET_X_LPARAM(l_param));
+            OnMouseDown(param, GET_X_LPARAM(l_param), GET_Y_LPARAM(l_param));
             return 0;
         case WM_LBUTTONUP:
         case WM_RBUTTONUP:
@@ -0,0 +1,240 @@
+#include <algorithm>
+
+#include "FileWatcher.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
+namespace fs = std::filesystem;
+
+struct FileWatcher::WatchedDirectory
+{
+    fs::path path;
+    std::thread thread;
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    // 析构时置位, 等待中的线程立刻醒来; 线程还没开始等待时也能看到
+    HANDLE stop_event = nullptr;
+    HANDLE io_event = nullptr;
+#else
+    int fd = -1;
+    // inotify 不支持递归, 每个子目录单独一个 watch
+    std::unordered_map<int, fs::path> watch_paths;
+#endif
+};
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    stopping = true;
+
+    for(auto& watched : directories)
+    {
+#ifdef _WIN32
+        SetEvent(watched->stop_event);
+#endif
+        watched->thread.join();
+
+#ifdef _WIN32
+        CloseHandle(watched->handle);
+        CloseHandle(watched->stop_event);
+        CloseHandle(watched->io_event);
+#else
+        close(watched->fd);
+#endif
+    }
+}
+
+bool FileWatcher::Watch(const fs::path& directory)
+{
+    std::error_code error;
+    fs::path absolute_path = fs::absolute(directory, error).lexically_normal();
+    if(error || !fs::is_directory(absolute_path, error))
+        return false;
+
+    auto watched = std::make_unique<WatchedDirectory>();
+    watched->path = absolute_path;
+
+#ifdef _WIN32
+    watched->handle = CreateFileW(
+        absolute_path.c_str(),
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        nullptr);
+    if(watched->handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    watched->stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    watched->io_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if(watched->stop_event == nullptr || watched->io_event == nullptr)
+    {
+        CloseHandle(watched->handle);
+        if(watched->stop_event != nullptr)
+            CloseHandle(watched->stop_event);
+        if(watched->io_event != nullptr)
+            CloseHandle(watched->io_event);
+        return false;
+    }
+#else
+    watched->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watched->fd < 0)
+        return false;
+
+    const uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    auto add_watch = [&watched, watch_mask](const fs::path& path){
+        int wd = inotify_add_watch(watched->fd, path.c_str(), watch_mask);
+        if(wd >= 0)
+            watched->watch_paths[wd] = path;
+    };
+
+    add_watch(absolute_path);
+    for(const auto& entry : fs::recursive_directory_iterator(absolute_path, error))
+    {
+        if(entry.is_directory())
+            add_watch(entry.path());
+    }
+#endif
+
+    WatchedDirectory* raw = watched.get();
+    watched->thread = std::thread(&FileWatcher::WatchLoop, this, raw);
+    directories.push_back(std::move(watched));
+
+    return true;
+}
+
+void FileWatcher::Push(const fs::path& file)
+{
+    fs::path normalized = file.lexically_normal();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    // 编辑器保存时通常会触发好几次事件
+    if(std::find(changes.begin(), changes.end(), normalized) == changes.end())
+        changes.push_back(normalized);
+}
+
+std::vector<fs::path> FileWatcher::PollChanges()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<fs::path> result;
+    result.swap(changes);
+    return result;
+}
+
+#ifdef _WIN32
+void FileWatcher::WatchLoop(WatchedDirectory* watched)
+{
+    // FILE_NOTIFY_INFORMATION 需要 DWORD 对齐
+    alignas(DWORD) BYTE buffer[16 * 1024];
+
+    while(!stopping)
+    {
+        // 异步读取, 和 stop_event 一起等待; 同步读取只能取消已经开始的调用, 析构可能卡在 join
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = watched->io_event;
+        ResetEvent(watched->io_event);
+        BOOL ok = ReadDirectoryChangesW(
+            watched->handle,
+            buffer,
+            sizeof(buffer),
+            TRUE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+            nullptr,
+            &overlapped,
+            nullptr);
+
+        // 目录被删除
+        if(!ok)
+            return;
+
+        HANDLE events[] = {watched->io_event, watched->stop_event};
+        DWORD bytes_returned = 0;
+        if(WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0)
+        {
+            // 取消后还要等读取真正结束, buffer 和 overlapped 才能释放
+            CancelIoEx(watched->handle, &overlapped);
+            GetOverlappedResult(watched->handle, &overlapped, &bytes_returned, TRUE);
+            return;
+        }
+
+        if(!GetOverlappedResult(watched->handle, &overlapped, &bytes_returned, FALSE))
+            return;
+
+        // 缓冲区溢出时 bytes_returned 为0, 事件丢失, 只能等下一次修改
+        if(bytes_returned == 0)
+            continue;
+
+        const BYTE* cursor = buffer;
+        while(true)
+        {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(cursor);
+            if(info->Action == FILE_ACTION_MODIFIED ||
+               info->Action == FILE_ACTION_ADDED ||
+               info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+            {
+                std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+                Push(watched->path / name);
+            }
+
+            if(info->NextEntryOffset == 0)
+                break;
+            cursor += info->NextEntryOffset;
+        }
+    }
+}
+#else
+void FileWatcher::WatchLoop(WatchedDirectory* watched)
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    while(!stopping)
+    {
+        // 定时醒来检查 stopping
+        pollfd pfd = {watched->fd, POLLIN, 0};
+        if(poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        ssize_t length = read(watched->fd, buffer, sizeof(buffer));
+        if(length <= 0)
+            continue;
+
+        for(char* cursor = buffer; cursor < buffer + length; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+
+            auto it = watched->watch_paths.find(event->wd);
+            if(it == watched->watch_paths.end() || event->len == 0)
+                continue;
+
+            fs::path path = it->second / event->name;
+            if(event->mask & IN_ISDIR)
+            {
+                // 新建的子目录也要监视
+                if(event->mask & IN_CREATE)
+                {
+                    int wd = inotify_add_watch(watched->fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                    if(wd >= 0)
+                        watched->watch_paths[wd] = path;
+                }
+                continue;
+            }
+
+            // IN_CREATE 之后还会有 IN_CLOSE_WRITE, 只在写完时通知
+            if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                Push(path);
+        }
+    }
+}
+#endif
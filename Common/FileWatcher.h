@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------------------------FileWatcher--------------------------------
+// 监视目录 (包括子目录) 下的文件修改
+// Windows 使用 ReadDirectoryChangesW, Linux 使用 inotify, 每个目录一个后台线程
+// 变化的文件先攒在队列里, 由使用者在合适的时机 PollChanges 取走
+class FileWatcher
+{
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher& rhs) = delete;
+        FileWatcher& operator=(const FileWatcher& rhs) = delete;
+
+        bool Watch(const std::filesystem::path& directory);
+
+        // 返回上次调用之后变化过的文件 (绝对路径, 已去重), 可以在任意线程调用
+        std::vector<std::filesystem::path> PollChanges();
+
+    private:
+        struct WatchedDirectory;
+
+        void Push(const std::filesystem::path& file);
+        void WatchLoop(WatchedDirectory* watched);
+
+    private:
+        std::vector<std::unique_ptr<WatchedDirectory>> directories;
+
+        std::mutex mutex;
+        std::vector<std::filesystem::path> changes;
+        std::atomic<bool> stopping = false;
+};
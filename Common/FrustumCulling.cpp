@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CULLING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC 不需要为指令集单独标记函数; clang(-cl) 和 gcc 只有标记过的函数才能使用 AVX2 intrinsic
+#if defined(__clang__) || defined(__GNUC__)
+#define CULLING_TARGET(features) __attribute__((target(features)))
+#else
+#define CULLING_TARGET(features)
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+    // 每块的对象数, 是 8 的倍数, 块内的 SIMD 循环不会跨块
+    constexpr std::uint32_t culling_chunk_size = 1u << 16;
+
+    // 每批待测的对象数, 预取发出之后过一段时间才用到
+    constexpr std::uint32_t refine_batch_size = 64;
+    // 测试后不可见的输出位置先写成这个值, 最后一起删掉
+    constexpr std::uint32_t rejected_object = 0xFFFFFFFFu;
+
+    // 包围球和某个平面相交时用 AABB 再测一次: AABB 在平面法线上的投影半径为 |n| . extent
+    bool BoxVisible(const CullingFrustum& frustum, const CullingBox& box)
+    {
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            const float d = frustum.normal_x[p] * box.center.x + frustum.normal_y[p] * box.center.y + frustum.normal_z[p] * box.center.z + frustum.distance[p];
+            const float r = std::fabs(frustum.normal_x[p]) * box.extents.x + std::fabs(frustum.normal_y[p]) * box.extents.y + std::fabs(frustum.normal_z[p]) * box.extents.z;
+            if(d < -r)
+                return false;
+        }
+        return true;
+    }
+
+    // 包围球和平面相交的对象先当作可见写进输出, 这里记下它在输出中的位置并预取 AABB
+    // 攒够一批再统一测试, 几个缓存未命中可以同时进行; 逐个测试时主循环每次都要停下来等内存
+    class BoundaryRefiner
+    {
+        public:
+            BoundaryRefiner(const CullingObjects& objects, const CullingFrustum& frustum, std::uint32_t* out)
+            :boxes(objects.boxes.data()), frustum(frustum), out(out)
+            {
+            }
+
+            // out[position] 为 object
+            void Add(std::uint32_t position, std::uint32_t object)
+            {
+#if defined(CULLING_X86)
+                _mm_prefetch((const char*)(boxes + object), _MM_HINT_T0);
+#endif
+                pending[pending_count++] = position;
+                if(pending_count == refine_batch_size)
+                    Flush();
+            }
+
+            // visible_mask 中的对象已经从 out[count] 开始按顺序写出, 第 k 位对应 first + k
+            // 在 visible_mask 中而不在 inside_mask 中的位需要测试 AABB
+            void AddMask(std::uint32_t visible_mask, std::uint32_t inside_mask, std::uint32_t count, std::uint32_t first)
+            {
+                std::uint32_t boundary = visible_mask & ~inside_mask;
+                while(boundary != 0)
+                {
+                    const std::uint32_t bit = (std::uint32_t)std::countr_zero(boundary);
+                    Add(count + (std::uint32_t)std::popcount(visible_mask & ((1u << bit) - 1)), first + bit);
+                    boundary &= boundary - 1;
+                }
+            }
+
+            // 测试剩下的对象, 删掉不可见的, 返回 out 中剩下的数量
+            std::uint32_t Finish(std::uint32_t count)
+            {
+                Flush();
+                if(first_rejected >= count)
+                    return count;
+
+                std::uint32_t kept = first_rejected;
+                for(std::uint32_t i = first_rejected + 1; i < count; ++i)
+                {
+                    if(out[i] != rejected_object)
+                        out[kept++] = out[i];
+                }
+                return kept;
+            }
+
+        private:
+            void Flush()
+            {
+                for(std::uint32_t i = 0; i < pending_count; ++i)
+                {
+                    const std::uint32_t position = pending[i];
+                    if(!BoxVisible(frustum, boxes[out[position]]))
+                    {
+                        out[position] = rejected_object;
+                        first_rejected = std::min(first_rejected, position);
+                    }
+                }
+                pending_count = 0;
+            }
+
+        private:
+            const CullingBox* boxes;
+            const CullingFrustum& frustum;
+            std::uint32_t* out;
+
+            std::uint32_t pending[refine_batch_size];
+            std::uint32_t pending_count = 0;
+            std::uint32_t first_rejected = rejected_object;
+    };
+
+    std::uint32_t CullRangeScalar(const CullingObjects& objects, const CullingFrustum& frustum,
+                                  std::uint32_t begin, std::uint32_t end, std::uint32_t* out)
+    {
+        BoundaryRefiner refiner(objects, frustum, out);
+        std::uint32_t count = 0;
+        for(std::uint32_t i = begin; i < end; ++i)
+        {
+            const float x = objects.sphere_x[i];
+            const float y = objects.sphere_y[i];
+            const float z = objects.sphere_z[i];
+            const float r = objects.sphere_radius[i];
+            float nearest = frustum.normal_x[0] * x + frustum.normal_y[0] * y + frustum.normal_z[0] * z + frustum.distance[0];
+            for(std::uint32_t p = 1; p < 6; ++p)
+                nearest = std::min(nearest, frustum.normal_x[p] * x + frustum.normal_y[p] * y + frustum.normal_z[p] * z + frustum.distance[p]);
+            if(nearest < -r)
+                continue;
+            out[count] = i;
+            if(nearest < r)
+                refiner.Add(count, i);
+            ++count;
+        }
+        return refiner.Finish(count);
+    }
+
+#if defined(CULLING_X86)
+    // 8 位掩码 -> 可见通道的编号按顺序排在前面, 每个编号一个字节
+    constexpr std::array<std::uint64_t, 256> BuildCompactLanes()
+    {
+        std::array<std::uint64_t, 256> table{};
+        for(std::uint32_t mask = 0; mask < 256; ++mask)
+        {
+            std::uint32_t count = 0;
+            for(std::uint32_t lane = 0; lane < 8; ++lane)
+            {
+                if(mask & (1u << lane))
+                    table[mask] |= (std::uint64_t)lane << (8 * count++);
+            }
+        }
+        return table;
+    }
+
+    constexpr std::array<std::uint64_t, 256> compact_lanes = BuildCompactLanes();
+
+    std::uint32_t CullRangeSse(const CullingObjects& objects, const CullingFrustum& frustum,
+                               std::uint32_t begin, std::uint32_t end, std::uint32_t* out)
+    {
+        __m128 nx[6], ny[6], nz[6], nw[6];
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            nx[p] = _mm_set1_ps(frustum.normal_x[p]);
+            ny[p] = _mm_set1_ps(frustum.normal_y[p]);
+            nz[p] = _mm_set1_ps(frustum.normal_z[p]);
+            nw[p] = _mm_set1_ps(frustum.distance[p]);
+        }
+
+        const float* sx = objects.sphere_x.data();
+        const float* sy = objects.sphere_y.data();
+        const float* sz = objects.sphere_z.data();
+        const float* sr = objects.sphere_radius.data();
+        BoundaryRefiner refiner(objects, frustum, out);
+        std::uint32_t count = 0;
+        std::uint32_t i = begin;
+        for(; i + 4 <= end; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(sx + i);
+            const __m128 y = _mm_loadu_ps(sy + i);
+            const __m128 z = _mm_loadu_ps(sz + i);
+            const __m128 r = _mm_loadu_ps(sr + i);
+
+            // 半径和平面无关, 只需要到 6 个平面的最小距离
+            __m128 nearest = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[0], x), _mm_mul_ps(ny[0], y)),
+                                        _mm_add_ps(_mm_mul_ps(nz[0], z), nw[0]));
+            for(std::uint32_t p = 1; p < 6; ++p)
+            {
+                const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+                                            _mm_add_ps(_mm_mul_ps(nz[p], z), nw[p]));
+                nearest = _mm_min_ps(nearest, d);
+            }
+
+            const __m128 visible = _mm_cmpge_ps(nearest, _mm_sub_ps(_mm_setzero_ps(), r));
+            const __m128 inside = _mm_cmpge_ps(nearest, r);
+            const std::uint32_t visible_mask = (std::uint32_t)_mm_movemask_ps(visible);
+            const std::uint32_t inside_mask = (std::uint32_t)_mm_movemask_ps(inside);
+
+            // 不分支的压缩写入: 每个编号都写, 只有可见的才让 count 前进
+            const std::uint32_t group_begin = count;
+            for(std::uint32_t k = 0; k < 4; ++k)
+            {
+                out[count] = i + k;
+                count += (visible_mask >> k) & 1u;
+            }
+            // 写出之后才能交给 refiner, 它随时可能读 out
+            if(visible_mask != inside_mask)
+                refiner.AddMask(visible_mask, inside_mask, group_begin, i);
+        }
+        count = refiner.Finish(count);
+        return count + CullRangeScalar(objects, frustum, i, end, out + count);
+    }
+
+    CULLING_TARGET("avx2,fma")
+    std::uint32_t CullRangeAvx2(const CullingObjects& objects, const CullingFrustum& frustum,
+                                std::uint32_t begin, std::uint32_t end, std::uint32_t* out)
+    {
+        __m256 nx[6], ny[6], nz[6], nw[6];
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            nx[p] = _mm256_set1_ps(frustum.normal_x[p]);
+            ny[p] = _mm256_set1_ps(frustum.normal_y[p]);
+            nz[p] = _mm256_set1_ps(frustum.normal_z[p]);
+            nw[p] = _mm256_set1_ps(frustum.distance[p]);
+        }
+
+        const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const float* sx = objects.sphere_x.data();
+        const float* sy = objects.sphere_y.data();
+        const float* sz = objects.sphere_z.data();
+        const float* sr = objects.sphere_radius.data();
+        BoundaryRefiner refiner(objects, frustum, out);
+        std::uint32_t count = 0;
+        std::uint32_t i = begin;
+        for(; i + 8 <= end; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(sx + i);
+            const __m256 y = _mm256_loadu_ps(sy + i);
+            const __m256 z = _mm256_loadu_ps(sz + i);
+            const __m256 r = _mm256_loadu_ps(sr + i);
+
+            __m256 nearest = _mm256_fmadd_ps(nx[0], x, _mm256_fmadd_ps(ny[0], y, _mm256_fmadd_ps(nz[0], z, nw[0])));
+            for(std::uint32_t p = 1; p < 6; ++p)
+            {
+                const __m256 d = _mm256_fmadd_ps(nx[p], x, _mm256_fmadd_ps(ny[p], y, _mm256_fmadd_ps(nz[p], z, nw[p])));
+                nearest = _mm256_min_ps(nearest, d);
+            }
+
+            const __m256 visible = _mm256_cmp_ps(nearest, _mm256_sub_ps(_mm256_setzero_ps(), r), _CMP_GE_OQ);
+            const __m256 inside = _mm256_cmp_ps(nearest, r, _CMP_GE_OQ);
+            const std::uint32_t visible_mask = (std::uint32_t)_mm256_movemask_ps(visible);
+            const std::uint32_t inside_mask = (std::uint32_t)_mm256_movemask_ps(inside);
+
+            // 按掩码查表把可见的编号排到前面, 8 个一起写出, count 只前进可见的个数
+            const __m128i lanes = _mm_loadl_epi64((const __m128i*)&compact_lanes[visible_mask]);
+            const __m256i permute = _mm256_cvtepu8_epi32(lanes);
+            const __m256i objects_in_group = _mm256_add_epi32(_mm256_set1_epi32((int)i), lane_offsets);
+            _mm256_storeu_si256((__m256i*)(out + count), _mm256_permutevar8x32_epi32(objects_in_group, permute));
+            if(visible_mask != inside_mask)
+                refiner.AddMask(visible_mask, inside_mask, count, i);
+            count += (std::uint32_t)std::popcount(visible_mask);
+        }
+        count = refiner.Finish(count);
+        return count + CullRangeScalar(objects, frustum, i, end, out + count);
+    }
+
+    CULLING_TARGET("avx512f")
+    std::uint32_t CullRangeAvx512(const CullingObjects& objects, const CullingFrustum& frustum,
+                                  std::uint32_t begin, std::uint32_t end, std::uint32_t* out)
+    {
+        // 24 个平面分量加上循环里的 5 个向量, 正好放得进 32 个 ZMM 寄存器
+        __m512 nx[6], ny[6], nz[6], nw[6];
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            nx[p] = _mm512_set1_ps(frustum.normal_x[p]);
+            ny[p] = _mm512_set1_ps(frustum.normal_y[p]);
+            nz[p] = _mm512_set1_ps(frustum.normal_z[p]);
+            nw[p] = _mm512_set1_ps(frustum.distance[p]);
+        }
+
+        const __m512i lane_offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const float* sx = objects.sphere_x.data();
+        const float* sy = objects.sphere_y.data();
+        const float* sz = objects.sphere_z.data();
+        const float* sr = objects.sphere_radius.data();
+        BoundaryRefiner refiner(objects, frustum, out);
+        std::uint32_t count = 0;
+        std::uint32_t i = begin;
+        for(; i + 16 <= end; i += 16)
+        {
+            const __m512 x = _mm512_loadu_ps(sx + i);
+            const __m512 y = _mm512_loadu_ps(sy + i);
+            const __m512 z = _mm512_loadu_ps(sz + i);
+            const __m512 r = _mm512_loadu_ps(sr + i);
+
+            __m512 nearest = _mm512_fmadd_ps(nx[0], x, _mm512_fmadd_ps(ny[0], y, _mm512_fmadd_ps(nz[0], z, nw[0])));
+            for(std::uint32_t p = 1; p < 6; ++p)
+            {
+                const __m512 d = _mm512_fmadd_ps(nx[p], x, _mm512_fmadd_ps(ny[p], y, _mm512_fmadd_ps(nz[p], z, nw[p])));
+                nearest = _mm512_min_ps(nearest, d);
+            }
+
+            const __mmask16 visible = _mm512_cmp_ps_mask(nearest, _mm512_sub_ps(_mm512_setzero_ps(), r), _CMP_GE_OQ);
+            const __mmask16 inside = _mm512_cmp_ps_mask(nearest, r, _CMP_GE_OQ);
+
+            // 寄存器内压缩后 16 个一起写出; 直接压缩写内存在一些 CPU 上很慢
+            const __m512i objects_in_group = _mm512_add_epi32(_mm512_set1_epi32((int)i), lane_offsets);
+            _mm512_storeu_si512(out + count, _mm512_maskz_compress_epi32(visible, objects_in_group));
+            if(visible != inside)
+                refiner.AddMask(visible, inside, count, i);
+            count += (std::uint32_t)std::popcount((std::uint32_t)visible);
+        }
+        count = refiner.Finish(count);
+        return count + CullRangeScalar(objects, frustum, i, end, out + count);
+    }
+
+#if defined(_MSC_VER)
+    CULLING_TARGET("xsave")
+    std::uint64_t ReadXcr0()
+    {
+        return _xgetbv(0);
+    }
+#endif
+
+    CullingIsa DetectCullingIsa()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] < 7)
+            return CullingIsa::Sse;
+
+        // 除了 CPU 支持, 还要操作系统在切换线程时保存对应的寄存器
+        // XCR0 的第 1, 2 位为 XMM/YMM, 第 5, 6, 7 位为 AVX-512 的掩码寄存器和 ZMM
+        __cpuid(info, 1);
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if(!fma || !osxsave || !avx)
+            return CullingIsa::Sse;
+        const std::uint64_t xcr0 = ReadXcr0();
+        if((xcr0 & 6) != 6)
+            return CullingIsa::Sse;
+
+        __cpuidex(info, 7, 0);
+        if((info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6)
+            return CullingIsa::Avx512;
+        return (info[1] & (1 << 5)) != 0 ? CullingIsa::Avx2 : CullingIsa::Sse;
+#else
+        if(__builtin_cpu_supports("avx512f"))
+            return CullingIsa::Avx512;
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return CullingIsa::Avx2;
+        return CullingIsa::Sse;
+#endif
+    }
+#endif
+
+    using CullRangeFn = std::uint32_t (*)(const CullingObjects&, const CullingFrustum&, std::uint32_t, std::uint32_t, std::uint32_t*);
+
+    CullRangeFn SelectCullRange(CullingIsa isa)
+    {
+#if defined(CULLING_X86)
+        switch(isa)
+        {
+            case CullingIsa::Avx512: return CullRangeAvx512;
+            case CullingIsa::Avx2: return CullRangeAvx2;
+            case CullingIsa::Sse: return CullRangeSse;
+            default: break;
+        }
+#endif
+        return CullRangeScalar;
+    }
+}
+
+CullingFrustum ExtractFrustum(const XMFLOAT4X4& view_proj)
+{
+    // 行向量: clip = v * M, clip 的第 j 个分量是 v 和第 j 列的点积
+    // 裁剪条件 -w <= x <= w, -w <= y <= w, 0 <= z <= w, 每个不等式就是一个平面
+    const auto column = [&view_proj](int j, float* plane){
+        for(int i = 0; i < 4; ++i)
+            plane[i] = view_proj.m[i][j];
+    };
+    float x[4], y[4], z[4], w[4];
+    column(0, x);
+    column(1, y);
+    column(2, z);
+    column(3, w);
+
+    float planes[6][4];
+    for(int i = 0; i < 4; ++i)
+    {
+        planes[0][i] = w[i] + x[i];
+        planes[1][i] = w[i] - x[i];
+        planes[2][i] = w[i] + y[i];
+        planes[3][i] = w[i] - y[i];
+        planes[4][i] = z[i];
+        planes[5][i] = w[i] - z[i];
+    }
+
+    CullingFrustum frustum;
+    for(int p = 0; p < 6; ++p)
+    {
+        const float length = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        frustum.normal_x[p] = planes[p][0] * scale;
+        frustum.normal_y[p] = planes[p][1] * scale;
+        frustum.normal_z[p] = planes[p][2] * scale;
+        frustum.distance[p] = planes[p][3] * scale;
+    }
+    return frustum;
+}
+
+std::uint32_t CullingObjects::Add(const BoundingSphere& sphere, const BoundingBox& box)
+{
+    const std::uint32_t object = (std::uint32_t)Size();
+    sphere_x.push_back(0.0f);
+    sphere_y.push_back(0.0f);
+    sphere_z.push_back(0.0f);
+    sphere_radius.push_back(0.0f);
+    boxes.push_back({});
+    Set(object, sphere, box);
+    return object;
+}
+
+void CullingObjects::Set(std::uint32_t object, const BoundingSphere& sphere, const BoundingBox& box)
+{
+    sphere_x[object] = sphere.Center.x;
+    sphere_y[object] = sphere.Center.y;
+    sphere_z[object] = sphere.Center.z;
+    sphere_radius[object] = sphere.Radius;
+    boxes[object].center = box.Center;
+    boxes[object].extents = box.Extents;
+}
+
+CullingIsa BestCullingIsa()
+{
+#if defined(CULLING_X86)
+    static const CullingIsa isa = DetectCullingIsa();
+    return isa;
+#else
+    return CullingIsa::Scalar;
+#endif
+}
+
+const char* CullingIsaName(CullingIsa isa)
+{
+    switch(isa)
+    {
+        case CullingIsa::Avx512: return "AVX-512";
+        case CullingIsa::Avx2: return "AVX2";
+        case CullingIsa::Sse: return "SSE";
+        default: return "Scalar";
+    }
+}
+
+std::uint32_t CullObjects(const CullingObjects& objects, const CullingFrustum& frustum, std::uint32_t* visible,
+                          JobSystem* jobs, CullingIsa isa)
+{
+    const CullRangeFn cull_range = SelectCullRange(isa);
+    const std::uint32_t count = (std::uint32_t)objects.Size();
+    if(jobs == nullptr || count <= culling_chunk_size)
+        return cull_range(objects, frustum, 0, count, visible);
+
+    // 每块写到 visible 中和对象范围相同的位置, 互不重叠
+    const std::uint32_t chunk_count = (count + culling_chunk_size - 1) / culling_chunk_size;
+    std::vector<std::uint32_t> chunk_visible(chunk_count);
+    jobs->ParallelFor(chunk_count, 1, [&](std::uint32_t begin, std::uint32_t end){
+        for(std::uint32_t c = begin; c < end; ++c)
+        {
+            const std::uint32_t first = c * culling_chunk_size;
+            chunk_visible[c] = cull_range(objects, frustum, first, std::min(first + culling_chunk_size, count), visible + first);
+        }
+    });
+
+    // 按块的顺序往前挪, 目标位置不会超过源位置
+    std::uint32_t visible_count = chunk_visible[0];
+    for(std::uint32_t c = 1; c < chunk_count; ++c)
+    {
+        std::memmove(visible + visible_count, visible + c * culling_chunk_size, chunk_visible[c] * sizeof(std::uint32_t));
+        visible_count += chunk_visible[c];
+    }
+    return visible_count;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+class JobSystem;
+
+//-----------------------------FrustumCulling--------------------------------
+// 对象的包围球按 SoA 存放, 每次用 SSE, AVX2 或 AVX-512 对 4 / 8 / 16 个包围球同时测试 6 个平面
+// 包围球完全在视锥内的直接可见, 和某个平面相交的再用 AABB 精确测试一次, 所以主循环每个对象只读 16 字节
+// 需要 AABB 测试的对象先当作可见写出, 攒够一批预取之后再测, 不可见的最后从结果中删掉
+// 结果是紧凑的可见对象编号列表, 按编号递增
+struct CullingFrustum
+{
+    // 6 个平面 (左右下上近远) 按分量分开存放, 法线朝向视锥内部并且已归一化
+    float normal_x[6];
+    float normal_y[6];
+    float normal_z[6];
+    float distance[6];
+};
+
+// view_proj 为 DirectXMath 的行向量矩阵 (view * proj), 深度范围 [0, 1]
+CullingFrustum ExtractFrustum(const DirectX::XMFLOAT4X4& view_proj);
+
+// 世界空间 AABB, 对齐到 32 字节, 一个对象的 AABB 总在同一条缓存行里
+struct alignas(32) CullingBox
+{
+    DirectX::XMFLOAT3 center;
+    DirectX::XMFLOAT3 extents;
+};
+
+struct CullingObjects
+{
+    // 世界空间包围球
+    std::vector<float> sphere_x;
+    std::vector<float> sphere_y;
+    std::vector<float> sphere_z;
+    std::vector<float> sphere_radius;
+    // 只在包围球和平面相交时按编号读取, 分开存放时每个对象要访问 6 条缓存行
+    std::vector<CullingBox> boxes;
+
+    std::size_t Size() const { return sphere_radius.size(); }
+
+    // 返回对象编号
+    std::uint32_t Add(const DirectX::BoundingSphere& sphere, const DirectX::BoundingBox& box);
+    void Set(std::uint32_t object, const DirectX::BoundingSphere& sphere, const DirectX::BoundingBox& box);
+};
+
+enum class CullingIsa
+{
+    Scalar,
+    Sse,
+    Avx2,
+    Avx512
+};
+
+// 运行时检测 CPU 和操作系统是否支持 AVX-512F 或 AVX2 (和 FMA), 都不支持时用 SSE; 非 x86 平台为 Scalar
+CullingIsa BestCullingIsa();
+const char* CullingIsaName(CullingIsa isa);
+
+// 可见对象的编号写进 visible (至少 objects.Size() 个, 每帧复用同一块内存) 并返回数量
+// 给了 jobs 并且对象较多时按块并行, 每块先写到自己的范围, 最后按顺序拼接
+std::uint32_t CullObjects(const CullingObjects& objects, const CullingFrustum& frustum, std::uint32_t* visible,
+                          JobSystem* jobs = nullptr, CullingIsa isa = BestCullingIsa());
@@ -0,0 +1,484 @@
+#include <algorithm>
+#include <cmath>
+
+#include "GeometryGenerator.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // 把顶点属性写到调用者给的地址, 属性指针为空时跳过
+    class VertexWriter
+    {
+        public:
+            explicit VertexWriter(const GeometryGenerator::VertexStreams& streams): streams(streams) {}
+
+            void XM_CALLCONV Write(std::uint32_t index, FXMVECTOR position, FXMVECTOR normal, FXMVECTOR tangent, GXMVECTOR uv) const
+            {
+                if(streams.position != nullptr)
+                    XMStoreFloat3(At<XMFLOAT3>(streams.position, streams.position_stride, index), position);
+                if(streams.normal != nullptr)
+                    XMStoreFloat3(At<XMFLOAT3>(streams.normal, streams.normal_stride, index), normal);
+                if(streams.tangent != nullptr)
+                    XMStoreFloat3(At<XMFLOAT3>(streams.tangent, streams.tangent_stride, index), tangent);
+                if(streams.uv != nullptr)
+                    XMStoreFloat2(At<XMFLOAT2>(streams.uv, streams.uv_stride, index), uv);
+            }
+
+        private:
+            template<typename T>
+            static T* At(void* base, std::uint32_t stride, std::uint32_t index)
+            {
+                return reinterpret_cast<T*>(static_cast<std::uint8_t*>(base) + (std::size_t)index * stride);
+            }
+
+            const GeometryGenerator::VertexStreams& streams;
+    };
+
+    class IndexWriter
+    {
+        public:
+            explicit IndexWriter(const GeometryGenerator::IndexStream& stream)
+            :data(static_cast<std::uint8_t*>(stream.data)), is_32bit(stream.index_bytesize == 4), base_vertex(stream.base_vertex)
+            {
+            }
+
+            void Triangle(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+            {
+                if(data == nullptr)
+                {
+                    cursor += 3;
+                    return;
+                }
+
+                if(is_32bit)
+                {
+                    std::uint32_t* dst = reinterpret_cast<std::uint32_t*>(data) + cursor;
+                    dst[0] = base_vertex + a;
+                    dst[1] = base_vertex + b;
+                    dst[2] = base_vertex + c;
+                }
+                else
+                {
+                    std::uint16_t* dst = reinterpret_cast<std::uint16_t*>(data) + cursor;
+                    dst[0] = (std::uint16_t)(base_vertex + a);
+                    dst[1] = (std::uint16_t)(base_vertex + b);
+                    dst[2] = (std::uint16_t)(base_vertex + c);
+                }
+                cursor += 3;
+            }
+
+            std::uint32_t Count() const { return cursor; }
+
+        private:
+            std::uint8_t* data = nullptr;
+            bool is_32bit = false;
+            std::uint32_t base_vertex = 0;
+            std::uint32_t cursor = 0;
+    };
+
+    // 平面网格: 从 origin 出发沿 u_axis 分 u_segments 段, 沿 v_axis 分 v_segments 段
+    // v_axis = u_axis x normal 时三角形朝向 normal 一侧
+    std::uint32_t XM_CALLCONV WritePlane(FXMVECTOR origin, FXMVECTOR u_axis, FXMVECTOR v_axis, GXMVECTOR normal,
+                                         std::uint32_t u_segments, std::uint32_t v_segments,
+                                         std::uint32_t first_vertex, const VertexWriter& vertices, IndexWriter& indices)
+    {
+        const XMVECTOR tangent = XMVector3Normalize(u_axis);
+        const float inv_u = 1.0f / (float)u_segments;
+        const float inv_v = 1.0f / (float)v_segments;
+        const XMVECTOR u_step = XMVectorScale(u_axis, inv_u);
+        const XMVECTOR v_step = XMVectorScale(v_axis, inv_v);
+        const XMVECTOR uv_step = XMVectorSet(inv_u, -inv_v, 0.0f, 0.0f);
+
+        std::uint32_t vertex = first_vertex;
+        for(std::uint32_t i = 0; i <= v_segments; ++i)
+        {
+            const XMVECTOR fi = XMVectorReplicate((float)i);
+            const XMVECTOR row_start = XMVectorMultiplyAdd(v_step, fi, origin);
+            const XMVECTOR row_uv = XMVectorSet(0.0f, 1.0f - (float)i * inv_v, 0.0f, 0.0f);
+            for(std::uint32_t j = 0; j <= u_segments; ++j)
+            {
+                const XMVECTOR fj = XMVectorReplicate((float)j);
+                const XMVECTOR position = XMVectorMultiplyAdd(u_step, fj, row_start);
+                const XMVECTOR uv = XMVectorMultiplyAdd(XMVectorSelect(XMVectorZero(), uv_step, g_XMSelect1000), fj, row_uv);
+                vertices.Write(vertex++, position, normal, tangent, uv);
+            }
+        }
+
+        const std::uint32_t row = u_segments + 1;
+        for(std::uint32_t i = 0; i < v_segments; ++i)
+        {
+            for(std::uint32_t j = 0; j < u_segments; ++j)
+            {
+                const std::uint32_t a = first_vertex + i * row + j;
+                const std::uint32_t b = a + 1;
+                const std::uint32_t c = a + row;
+                const std::uint32_t d = c + 1;
+                indices.Triangle(a, c, d);
+                indices.Triangle(a, d, b);
+            }
+        }
+
+        return vertex;
+    }
+
+    // 经纬度转换到 uv 和切线, 用于 sphere / geosphere
+    XMVECTOR XM_CALLCONV SphericalUV(FXMVECTOR unit_position, XMVECTOR& tangent)
+    {
+        XMFLOAT3 p;
+        XMStoreFloat3(&p, unit_position);
+
+        float theta = atan2f(p.z, p.x);
+        if(theta < 0.0f)
+            theta += XM_2PI;
+        const float phi = acosf(std::clamp(p.y, -1.0f, 1.0f));
+
+        tangent = XMVectorSet(-sinf(theta), 0.0f, cosf(theta), 0.0f);
+        return XMVectorSet(theta / XM_2PI, phi / XM_PI, 0.0f, 0.0f);
+    }
+}
+
+//-------------------------------------size-----------------------------------
+GeometryGenerator::MeshSize GeometryGenerator::BoxSize(std::uint32_t subdivisions)
+{
+    subdivisions = std::max(subdivisions, 1u);
+    MeshSize size;
+    size.vertex_count = 6 * (subdivisions + 1) * (subdivisions + 1);
+    size.index_count = 6 * subdivisions * subdivisions * 6;
+    return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GridSize(std::uint32_t rows, std::uint32_t columns)
+{
+    rows = std::max(rows, 2u);
+    columns = std::max(columns, 2u);
+    MeshSize size;
+    size.vertex_count = rows * columns;
+    size.index_count = (rows - 1) * (columns - 1) * 6;
+    return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::SphereSize(std::uint32_t slice_count, std::uint32_t stack_count)
+{
+    slice_count = std::max(slice_count, 3u);
+    stack_count = std::max(stack_count, 2u);
+    MeshSize size;
+    // 经线首尾各一列用于 uv 接缝, 极点每个经度一个顶点
+    size.vertex_count = (stack_count + 1) * (slice_count + 1);
+    // 靠近两极的一圈只有一个三角形
+    size.index_count = slice_count * (stack_count - 1) * 6;
+    return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GeosphereSize(std::uint32_t edge_segments)
+{
+    edge_segments = std::max(edge_segments, 1u);
+    MeshSize size;
+    size.vertex_count = 20 * (edge_segments + 1) * (edge_segments + 2) / 2;
+    size.index_count = 20 * edge_segments * edge_segments * 3;
+    return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::CylinderSize(std::uint32_t slice_count, std::uint32_t stack_count)
+{
+    slice_count = std::max(slice_count, 3u);
+    stack_count = std::max(stack_count, 1u);
+    MeshSize size;
+    size.vertex_count = (stack_count + 1) * (slice_count + 1) + 2 * (slice_count + 2);
+    size.index_count = slice_count * stack_count * 6 + 2 * slice_count * 3;
+    return size;
+}
+
+//-------------------------------------box-----------------------------------
+GeometryGenerator::MeshSize GeometryGenerator::CreateBox(float width, float height, float depth, std::uint32_t subdivisions,
+                                                         const VertexStreams& vertices, const IndexStream& indices)
+{
+    subdivisions = std::max(subdivisions, 1u);
+
+    // 每个面的法线和 u 方向, v = u x n
+    static const XMFLOAT3 face_normals[6] = {
+        {+1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f},
+        {0.0f, +1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+        {0.0f, 0.0f, +1.0f}, {0.0f, 0.0f, -1.0f}
+    };
+    static const XMFLOAT3 face_tangents[6] = {
+        {0.0f, 0.0f, +1.0f}, {0.0f, 0.0f, -1.0f},
+        {+1.0f, 0.0f, 0.0f}, {+1.0f, 0.0f, 0.0f},
+        {-1.0f, 0.0f, 0.0f}, {+1.0f, 0.0f, 0.0f}
+    };
+
+    const XMVECTOR extents = XMVectorSet(width, height, depth, 0.0f);
+    const XMVECTOR half_extents = XMVectorScale(extents, 0.5f);
+
+    VertexWriter vertex_writer(vertices);
+    IndexWriter index_writer(indices);
+
+    std::uint32_t vertex = 0;
+    for(int face = 0; face < 6; ++face)
+    {
+        const XMVECTOR n = XMLoadFloat3(&face_normals[face]);
+        const XMVECTOR u = XMLoadFloat3(&face_tangents[face]);
+        const XMVECTOR v = XMVector3Cross(u, n);
+
+        // 轴都是单位向量, 和尺寸逐分量相乘后就是这个面在该方向的边长
+        const XMVECTOR u_axis = XMVectorMultiply(u, extents);
+        const XMVECTOR v_axis = XMVectorMultiply(v, extents);
+        const XMVECTOR center = XMVectorMultiply(n, half_extents);
+        const XMVECTOR origin = XMVectorSubtract(center, XMVectorScale(XMVectorAdd(u_axis, v_axis), 0.5f));
+
+        vertex = WritePlane(origin, u_axis, v_axis, n, subdivisions, subdivisions, vertex, vertex_writer, index_writer);
+    }
+
+    return BoxSize(subdivisions);
+}
+
+//-------------------------------------grid-----------------------------------
+GeometryGenerator::MeshSize GeometryGenerator::CreateGrid(float width, float depth, std::uint32_t rows, std::uint32_t columns,
+                                                          const VertexStreams& vertices, const IndexStream& indices)
+{
+    rows = std::max(rows, 2u);
+    columns = std::max(columns, 2u);
+
+    VertexWriter vertex_writer(vertices);
+    IndexWriter index_writer(indices);
+
+    const XMVECTOR n = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    const XMVECTOR u_axis = XMVectorSet(width, 0.0f, 0.0f, 0.0f);
+    const XMVECTOR v_axis = XMVectorSet(0.0f, 0.0f, depth, 0.0f);
+    const XMVECTOR origin = XMVectorSet(-0.5f * width, 0.0f, -0.5f * depth, 0.0f);
+
+    WritePlane(origin, u_axis, v_axis, n, columns - 1, rows - 1, 0, vertex_writer, index_writer);
+
+    return GridSize(rows, columns);
+}
+
+//-------------------------------------sphere-----------------------------------
+GeometryGenerator::MeshSize GeometryGenerator::CreateSphere(float radius, std::uint32_t slice_count, std::uint32_t stack_count,
+                                                            const VertexStreams& vertices, const IndexStream& indices)
+{
+    slice_count = std::max(slice_count, 3u);
+    stack_count = std::max(stack_count, 2u);
+
+    VertexWriter vertex_writer(vertices);
+    IndexWriter index_writer(indices);
+
+    const float theta_step = XM_2PI / (float)slice_count;
+    const float phi_step = XM_PI / (float)stack_count;
+    const XMVECTOR lane_offsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+
+    std::uint32_t vertex = 0;
+    for(std::uint32_t i = 0; i <= stack_count; ++i)
+    {
+        const float phi = (float)i * phi_step;
+        const float sin_phi = sinf(phi);
+        const float cos_phi = cosf(phi);
+        const float v = phi / XM_PI;
+
+        // 一次计算4个经度的 sin/cos
+        for(std::uint32_t j = 0; j <= slice_count; j += 4)
+        {
+            XMVECTOR theta = XMVectorScale(XMVectorAdd(XMVectorReplicate((float)j), lane_offsets), theta_step);
+            XMVECTOR sin_theta, cos_theta;
+            XMVectorSinCos(&sin_theta, &cos_theta, theta);
+
+            XMFLOAT4 s, c, t;
+            XMStoreFloat4(&s, sin_theta);
+            XMStoreFloat4(&c, cos_theta);
+            XMStoreFloat4(&t, theta);
+            const float sin_lanes[4] = {s.x, s.y, s.z, s.w};
+            const float cos_lanes[4] = {c.x, c.y, c.z, c.w};
+            const float theta_lanes[4] = {t.x, t.y, t.z, t.w};
+
+            const std::uint32_t lane_count = std::min(4u, slice_count + 1 - j);
+            for(std::uint32_t k = 0; k < lane_count; ++k)
+            {
+                const XMVECTOR normal = XMVectorSet(sin_phi * cos_lanes[k], cos_phi, sin_phi * sin_lanes[k], 0.0f);
+                const XMVECTOR position = XMVectorScale(normal, radius);
+                const XMVECTOR tangent = XMVectorSet(-sin_lanes[k], 0.0f, cos_lanes[k], 0.0f);
+                const XMVECTOR uv = XMVectorSet(theta_lanes[k] / XM_2PI, v, 0.0f, 0.0f);
+                vertex_writer.Write(vertex++, position, normal, tangent, uv);
+            }
+        }
+    }
+
+    const std::uint32_t ring = slice_count + 1;
+    for(std::uint32_t i = 0; i < stack_count; ++i)
+    {
+        for(std::uint32_t j = 0; j < slice_count; ++j)
+        {
+            const std::uint32_t a = i * ring + j;
+            const std::uint32_t b = a + 1;
+            const std::uint32_t c = a + ring;
+            const std::uint32_t d = c + 1;
+
+            // 极点处的三角形退化, 不输出
+            if(i != 0)
+                index_writer.Triangle(a, b, c);
+            if(i != stack_count - 1)
+                index_writer.Triangle(c, b, d);
+        }
+    }
+
+    return SphereSize(slice_count, stack_count);
+}
+
+//-------------------------------------geosphere-----------------------------------
+GeometryGenerator::MeshSize GeometryGenerator::CreateGeosphere(float radius, std::uint32_t edge_segments,
+                                                               const VertexStreams& vertices, const IndexStream& indices)
+{
+    edge_segments = std::max(edge_segments, 1u);
+
+    const float x = 0.525731f;
+    const float z = 0.850651f;
+    static const XMFLOAT3 icosahedron[12] = {
+        {-x, 0.0f, z}, {x, 0.0f, z}, {-x, 0.0f, -z}, {x, 0.0f, -z},
+        {0.0f, z, x}, {0.0f, z, -x}, {0.0f, -z, x}, {0.0f, -z, -x},
+        {z, x, 0.0f}, {-z, x, 0.0f}, {z, -x, 0.0f}, {-z, -x, 0.0f}
+    };
+    static const std::uint32_t faces[60] = {
+        1,4,0, 4,9,0, 4,5,9, 8,5,4, 1,8,4,
+        1,10,8, 10,3,8, 8,3,5, 3,2,5, 3,7,2,
+        3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+        10,1,6, 11,0,9, 2,11,9, 5,2,9, 11,2,7
+    };
+
+    VertexWriter vertex_writer(vertices);
+    IndexWriter index_writer(indices);
+
+    const std::uint32_t n = edge_segments;
+    const float inv_n = 1.0f / (float)n;
+    const std::uint32_t face_vertex_count = (n + 1) * (n + 2) / 2;
+    // 第 i 行的第一个顶点在面内的编号
+    auto row_start = [n](std::uint32_t i){ return i * (n + 1) - i * (i - 1) / 2; };
+
+    std::uint32_t vertex = 0;
+    for(std::uint32_t face = 0; face < 20; ++face)
+    {
+        const XMVECTOR a = XMLoadFloat3(&icosahedron[faces[face * 3 + 0]]);
+        const XMVECTOR b = XMLoadFloat3(&icosahedron[faces[face * 3 + 1]]);
+        const XMVECTOR c = XMLoadFloat3(&icosahedron[faces[face * 3 + 2]]);
+        const XMVECTOR ab_step = XMVectorScale(XMVectorSubtract(b, a), inv_n);
+        const XMVECTOR ac_step = XMVectorScale(XMVectorSubtract(c, a), inv_n);
+
+        // 面内按三角形网格细分, 再投影到球面
+        const std::uint32_t first = vertex;
+        for(std::uint32_t i = 0; i <= n; ++i)
+        {
+            const XMVECTOR row = XMVectorMultiplyAdd(ac_step, XMVectorReplicate((float)i), a);
+            for(std::uint32_t j = 0; j <= n - i; ++j)
+            {
+                const XMVECTOR normal = XMVector3Normalize(XMVectorMultiplyAdd(ab_step, XMVectorReplicate((float)j), row));
+                XMVECTOR tangent;
+                const XMVECTOR uv = SphericalUV(normal, tangent);
+                vertex_writer.Write(vertex++, XMVectorScale(normal, radius), normal, tangent, uv);
+            }
+        }
+
+        for(std::uint32_t i = 0; i < n; ++i)
+        {
+            for(std::uint32_t j = 0; j < n - i; ++j)
+            {
+                const std::uint32_t p0 = first + row_start(i) + j;
+                const std::uint32_t p1 = p0 + 1;
+                const std::uint32_t p2 = first + row_start(i + 1) + j;
+                index_writer.Triangle(p0, p1, p2);
+                if(j + 1 < n - i)
+                    index_writer.Triangle(p1, p2 + 1, p2);
+            }
+        }
+
+        vertex = first + face_vertex_count;
+    }
+
+    return GeosphereSize(edge_segments);
+}
+
+//-------------------------------------cylinder-----------------------------------
+GeometryGenerator::MeshSize GeometryGenerator::CreateCylinder(float bottom_radius, float top_radius, float height,
+                                                              std::uint32_t slice_count, std::uint32_t stack_count,
+                                                              const VertexStreams& vertices, const IndexStream& indices)
+{
+    slice_count = std::max(slice_count, 3u);
+    stack_count = std::max(stack_count, 1u);
+
+    VertexWriter vertex_writer(vertices);
+    IndexWriter index_writer(indices);
+
+    const float stack_height = height / (float)stack_count;
+    const float radius_step = (top_radius - bottom_radius) / (float)stack_count;
+    const float theta_step = XM_2PI / (float)slice_count;
+    const XMVECTOR lane_offsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+    const XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    const XMVECTOR down = XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f);
+
+    std::uint32_t vertex = 0;
+
+    // 侧面: 一次计算4个经度
+    for(std::uint32_t j = 0; j <= slice_count; j += 4)
+    {
+        XMVECTOR sin_theta, cos_theta;
+        XMVectorSinCos(&sin_theta, &cos_theta, XMVectorScale(XMVectorAdd(XMVectorReplicate((float)j), lane_offsets), theta_step));
+
+        XMFLOAT4 s, c;
+        XMStoreFloat4(&s, sin_theta);
+        XMStoreFloat4(&c, cos_theta);
+        const float sin_lanes[4] = {s.x, s.y, s.z, s.w};
+        const float cos_lanes[4] = {c.x, c.y, c.z, c.w};
+
+        const std::uint32_t lane_count = std::min(4u, slice_count + 1 - j);
+        for(std::uint32_t k = 0; k < lane_count; ++k)
+        {
+            const XMVECTOR tangent = XMVectorSet(-sin_lanes[k], 0.0f, cos_lanes[k], 0.0f);
+            const XMVECTOR bitangent = XMVectorSet(-radius_step * cos_lanes[k], -stack_height, -radius_step * sin_lanes[k], 0.0f);
+            const XMVECTOR normal = XMVector3Normalize(XMVector3Cross(tangent, bitangent));
+
+            for(std::uint32_t i = 0; i <= stack_count; ++i)
+            {
+                const float y = -0.5f * height + (float)i * stack_height;
+                const float r = bottom_radius + (float)i * radius_step;
+                const XMVECTOR position = XMVectorSet(r * cos_lanes[k], y, r * sin_lanes[k], 0.0f);
+                const XMVECTOR uv = XMVectorSet((float)(j + k) / (float)slice_count, 1.0f - (float)i / (float)stack_count, 0.0f, 0.0f);
+                vertex_writer.Write(i * (slice_count + 1) + j + k, position, normal, tangent, uv);
+            }
+        }
+    }
+    vertex = (stack_count + 1) * (slice_count + 1);
+
+    const std::uint32_t ring = slice_count + 1;
+    for(std::uint32_t i = 0; i < stack_count; ++i)
+    {
+        for(std::uint32_t j = 0; j < slice_count; ++j)
+        {
+            index_writer.Triangle(i * ring + j, (i + 1) * ring + j, (i + 1) * ring + j + 1);
+            index_writer.Triangle(i * ring + j, (i + 1) * ring + j + 1, i * ring + j + 1);
+        }
+    }
+
+    // 上下两个盖子, 一圈顶点 + 中心
+    auto write_cap = [&](float y, float r, FXMVECTOR normal, bool top){
+        const std::uint32_t base = vertex;
+        const XMVECTOR tangent = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+        for(std::uint32_t j = 0; j <= slice_count; ++j)
+        {
+            const float theta = (float)j * theta_step;
+            const float px = r * cosf(theta);
+            const float pz = r * sinf(theta);
+            const XMVECTOR uv = XMVectorSet(px / height + 0.5f, pz / height + 0.5f, 0.0f, 0.0f);
+            vertex_writer.Write(vertex++, XMVectorSet(px, y, pz, 0.0f), normal, tangent, uv);
+        }
+        const std::uint32_t center = vertex;
+        vertex_writer.Write(vertex++, XMVectorSet(0.0f, y, 0.0f, 0.0f), normal, tangent, XMVectorSet(0.5f, 0.5f, 0.0f, 0.0f));
+
+        for(std::uint32_t j = 0; j < slice_count; ++j)
+        {
+            if(top)
+                index_writer.Triangle(center, base + j + 1, base + j);
+            else
+                index_writer.Triangle(center, base + j, base + j + 1);
+        }
+    };
+    write_cap(0.5f * height, top_radius, up, true);
+    write_cap(-0.5f * height, bottom_radius, down, false);
+
+    return CylinderSize(slice_count, stack_count);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include <DirectXMath.h>
+
+//-----------------------------GeometryGenerator--------------------------------
+// 程序化生成 box / sphere / geosphere / cylinder / grid
+// 顶点和索引直接写进调用者提供的内存 (通常是 map 出来的 upload buffer), 中间不分配任何容器
+// 每个属性单独给出地址和步长: 步长等于属性大小就是 SoA, 指向同一块内存的不同偏移就是交错格式
+class GeometryGenerator
+{
+    public:
+        struct VertexStreams
+        {
+            // XMFLOAT3, 为 nullptr 的属性不写
+            void* position = nullptr;
+            std::uint32_t position_stride = sizeof(DirectX::XMFLOAT3);
+            // XMFLOAT3
+            void* normal = nullptr;
+            std::uint32_t normal_stride = sizeof(DirectX::XMFLOAT3);
+            // XMFLOAT3, u 方向
+            void* tangent = nullptr;
+            std::uint32_t tangent_stride = sizeof(DirectX::XMFLOAT3);
+            // XMFLOAT2
+            void* uv = nullptr;
+            std::uint32_t uv_stride = sizeof(DirectX::XMFLOAT2);
+        };
+
+        struct IndexStream
+        {
+            void* data = nullptr;
+            // 2 或 4, 使用 16 位索引时调用者需要保证顶点数不超过 65536
+            std::uint32_t index_bytesize = sizeof(std::uint16_t);
+            // 写入每个索引时加上的值, 多个网格写进同一个缓冲时使用
+            std::uint32_t base_vertex = 0;
+        };
+
+        struct MeshSize
+        {
+            std::uint32_t vertex_count = 0;
+            std::uint32_t index_count = 0;
+        };
+
+        // 先用 XxxSize 算出需要的内存, 再调用 CreateXxx 写入
+        static MeshSize BoxSize(std::uint32_t subdivisions);
+        static MeshSize GridSize(std::uint32_t rows, std::uint32_t columns);
+        static MeshSize SphereSize(std::uint32_t slice_count, std::uint32_t stack_count);
+        static MeshSize GeosphereSize(std::uint32_t edge_segments);
+        static MeshSize CylinderSize(std::uint32_t slice_count, std::uint32_t stack_count);
+
+        // 每个面细分成 subdivisions x subdivisions 个格子
+        static MeshSize CreateBox(float width, float height, float depth, std::uint32_t subdivisions,
+                                  const VertexStreams& vertices, const IndexStream& indices);
+
+        // rows x columns 个顶点, 位于 xz 平面, 中心在原点
+        static MeshSize CreateGrid(float width, float depth, std::uint32_t rows, std::uint32_t columns,
+                                   const VertexStreams& vertices, const IndexStream& indices);
+
+        static MeshSize CreateSphere(float radius, std::uint32_t slice_count, std::uint32_t stack_count,
+                                     const VertexStreams& vertices, const IndexStream& indices);
+
+        // 二十面体每条边分成 edge_segments 段后投影到球面, 顶点分布比 sphere 均匀
+        static MeshSize CreateGeosphere(float radius, std::uint32_t edge_segments,
+                                        const VertexStreams& vertices, const IndexStream& indices);
+
+        // 沿 y 轴, 中心在原点, 带上下两个盖子
+        static MeshSize CreateCylinder(float bottom_radius, float top_radius, float height,
+                                       std::uint32_t slice_count, std::uint32_t stack_count,
+                                       const VertexStreams& vertices, const IndexStream& indices);
+};
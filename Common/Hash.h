@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+//-----------------------------Hash--------------------------------
+// 64位 MurmurHash64A, 同一字节序的平台上结果稳定, 可以作为磁盘缓存的key
+inline std::uint64_t HashBytes(const void* data, std::size_t bytesize, std::uint64_t seed = 0)
+{
+    const std::uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+
+    std::uint64_t h = seed ^ (bytesize * m);
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const std::size_t block_count = bytesize / 8;
+    for(std::size_t i = 0; i < block_count; ++i)
+    {
+        std::uint64_t k;
+        std::memcpy(&k, bytes + i * 8, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    const unsigned char* tail = bytes + block_count * 8;
+    switch(bytesize & 7)
+    {
+        case 7: h ^= std::uint64_t(tail[6]) << 48; [[fallthrough]];
+        case 6: h ^= std::uint64_t(tail[5]) << 40; [[fallthrough]];
+        case 5: h ^= std::uint64_t(tail[4]) << 32; [[fallthrough]];
+        case 4: h ^= std::uint64_t(tail[3]) << 24; [[fallthrough]];
+        case 3: h ^= std::uint64_t(tail[2]) << 16; [[fallthrough]];
+        case 2: h ^= std::uint64_t(tail[1]) << 8; [[fallthrough]];
+        case 1: h ^= std::uint64_t(tail[0]);
+                h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+inline std::uint64_t HashCombine(std::uint64_t seed, std::uint64_t value)
+{
+    return HashBytes(&value, sizeof(value), seed);
+}
+
+inline std::uint64_t HashString(const std::string& str, std::uint64_t seed = 0)
+{
+    return HashBytes(str.data(), str.size(), seed);
+}
+
+// 按字段顺序累加哈希, 避免直接哈希带padding的结构体
+class Hasher
+{
+    public:
+        explicit Hasher(std::uint64_t seed = 0): value(seed) {}
+
+        template<typename T>
+        Hasher& Add(const T& v)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Hasher::Add needs a trivially copyable type");
+            value = HashBytes(&v, sizeof(T), value);
+            return *this;
+        }
+
+        Hasher& AddBytes(const void* data, std::size_t bytesize)
+        {
+            value = HashBytes(data, bytesize, value);
+            return *this;
+        }
+
+        Hasher& AddString(const char* str)
+        {
+            return AddBytes(str, str != nullptr ? std::strlen(str) : 0);
+        }
+
+        std::uint64_t Value() const { return value; }
+
+    private:
+        std::uint64_t value = 0;
+};
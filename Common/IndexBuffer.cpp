@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <limits>
+
+#include "IndexBuffer.h"
+
+//-----------------------------index width--------------------------------
+namespace
+{
+    constexpr std::size_t max_segment_vertices = 0x10000;
+
+    // 按三角形顺序分段, 每段最多 max_segment_vertices 个不同顶点
+    // on_vertex(段内编号, 原始编号) 在顶点第一次出现在某一段时调用, on_index(索引位置, 段内编号) 对每个索引调用
+    template<typename OnSegment, typename OnVertex, typename OnIndex>
+    void SplitSegments(const std::uint32_t* indices, std::size_t index_count, std::size_t vertex_count,
+                       OnSegment on_segment, OnVertex on_vertex, OnIndex on_index)
+    {
+        // stamp[v] == segment + 1 表示 v 已经在当前段里, local[v] 是段内编号
+        std::vector<std::uint32_t> stamp(vertex_count, 0);
+        std::vector<std::uint32_t> local(vertex_count, 0);
+        std::uint32_t segment = 0;
+        std::uint32_t segment_start = 0;
+        std::uint32_t unique = 0;
+
+        for(std::size_t i = 0; i < index_count; i += 3)
+        {
+            std::uint32_t added = 0;
+            for(std::size_t k = 0; k < 3; ++k)
+                added += stamp[indices[i + k]] != segment + 1 ? 1 : 0;
+
+            if(unique + added > max_segment_vertices)
+            {
+                on_segment(segment_start, (std::uint32_t)i - segment_start, unique);
+                ++segment;
+                segment_start = (std::uint32_t)i;
+                unique = 0;
+            }
+
+            for(std::size_t k = 0; k < 3; ++k)
+            {
+                const std::uint32_t v = indices[i + k];
+                if(stamp[v] != segment + 1)
+                {
+                    stamp[v] = segment + 1;
+                    local[v] = unique++;
+                    on_vertex(local[v], v);
+                }
+                on_index(i + k, local[v]);
+            }
+        }
+        on_segment(segment_start, (std::uint32_t)index_count - segment_start, unique);
+    }
+}
+
+std::size_t IndexBufferPlan::Bytesize() const
+{
+    std::size_t index_count = 0;
+    for(const IndexSegment& segment : segments)
+        index_count += segment.index_count;
+    return index_count * index_bytesize;
+}
+
+IndexBufferPlan PlanIndexBuffer(const std::uint32_t* indices, std::size_t index_count,
+                                std::size_t vertex_count, std::uint32_t vertex_bytesize)
+{
+    index_count -= index_count % 3;
+
+    IndexBufferPlan plan;
+    if(vertex_count <= max_segment_vertices)
+    {
+        plan.segments.push_back(IndexSegment{0, (std::uint32_t)index_count, 0});
+        return plan;
+    }
+
+    std::uint32_t base_vertex = 0;
+    SplitSegments(indices, index_count, vertex_count,
+        [&](std::uint32_t start, std::uint32_t count, std::uint32_t unique){
+            plan.segments.push_back(IndexSegment{start, count, base_vertex});
+            base_vertex += unique;
+        },
+        [&](std::uint32_t, std::uint32_t v){ plan.vertex_sources.push_back(v); },
+        [](std::size_t, std::uint32_t){});
+
+    // 16 位节省的索引字节要多于复制顶点多出来的字节
+    const std::size_t saved = index_count * (sizeof(std::uint32_t) - sizeof(std::uint16_t));
+    const std::size_t duplicated = (plan.vertex_sources.size() - vertex_count) * vertex_bytesize;
+    if(saved > duplicated)
+        return plan;
+
+    plan.index_bytesize = sizeof(std::uint32_t);
+    plan.segments.assign(1, IndexSegment{0, (std::uint32_t)index_count, 0});
+    plan.vertex_sources.clear();
+    return plan;
+}
+
+void WriteIndexBuffer(void* destination, const std::uint32_t* indices, std::size_t index_count, const IndexBufferPlan& plan)
+{
+    index_count -= index_count % 3;
+
+    if(plan.index_bytesize == sizeof(std::uint32_t))
+    {
+        std::copy(indices, indices + index_count, static_cast<std::uint32_t*>(destination));
+        return;
+    }
+
+    std::uint16_t* dst = static_cast<std::uint16_t*>(destination);
+    if(plan.vertex_sources.empty())
+    {
+        for(std::size_t i = 0; i < index_count; ++i)
+            dst[i] = (std::uint16_t)indices[i];
+        return;
+    }
+
+    // 和 PlanIndexBuffer 用同样的方式分段, 写入段内编号
+    std::size_t vertex_count = 0;
+    for(std::uint32_t v : plan.vertex_sources)
+        vertex_count = std::max<std::size_t>(vertex_count, v + 1);
+
+    SplitSegments(indices, index_count, vertex_count,
+        [](std::uint32_t, std::uint32_t, std::uint32_t){},
+        [](std::uint32_t, std::uint32_t){},
+        [&](std::size_t i, std::uint32_t local){ dst[i] = (std::uint16_t)local; });
+}
+
+std::vector<IndexSegment> SegmentsInRange(const IndexBufferPlan& plan, std::uint32_t start_index, std::uint32_t index_count)
+{
+    std::vector<IndexSegment> result;
+    const std::uint32_t end_index = start_index + index_count;
+    for(const IndexSegment& segment : plan.segments)
+    {
+        const std::uint32_t begin = std::max(segment.start_index, start_index);
+        const std::uint32_t end = std::min(segment.start_index + segment.index_count, end_index);
+        if(begin < end)
+            result.push_back({begin, end - begin, segment.base_vertex});
+    }
+    return result;
+}
+
+void GatherVertexBuffer(void* destination, const void* vertices, std::uint32_t vertex_bytesize, const IndexBufferPlan& plan)
+{
+    const std::uint8_t* src = static_cast<const std::uint8_t*>(vertices);
+    std::uint8_t* dst = static_cast<std::uint8_t*>(destination);
+    for(std::uint32_t source : plan.vertex_sources)
+    {
+        std::copy(src + (std::size_t)source * vertex_bytesize, src + (std::size_t)source * vertex_bytesize + vertex_bytesize, dst);
+        dst += vertex_bytesize;
+    }
+}
+
+//-----------------------------index compression--------------------------------
+namespace
+{
+    constexpr std::uint8_t codec_header = 0xE0;
+
+    // 三角形编码的一个字节: 高 4 位为边缓存的位置, 15 表示没有命中边缓存
+    // 命中时低 4 位是第三个顶点: 0 下一个新顶点, 1..14 顶点缓存的位置, 15 后面跟 varint
+    constexpr std::uint32_t edge_lookup = 15;
+    constexpr std::uint8_t edge_miss = 15;
+    constexpr std::uint32_t vertex_lookup_in_edge = 14;
+    constexpr std::uint8_t vertex_explicit_in_edge = 15;
+
+    // 没有命中边缓存时三个顶点各占一个字节: 0 下一个新顶点, 1..16 顶点缓存的位置, 17 后面跟 varint
+    constexpr std::uint32_t vertex_lookup = 16;
+    constexpr std::uint8_t vertex_explicit = 17;
+
+    struct Edge
+    {
+        std::uint32_t a;
+        std::uint32_t b;
+    };
+
+    // 16 项的环形缓冲, 位置 0 是最近放进去的
+    template<typename T>
+    class RecentCache
+    {
+        public:
+            void Push(const T& value)
+            {
+                items[head & 15] = value;
+                ++head;
+            }
+
+            void Push(const T& first, const T& second, const T& third)
+            {
+                items[head & 15] = first;
+                items[(head + 1) & 15] = second;
+                items[(head + 2) & 15] = third;
+                head += 3;
+            }
+
+            const T& operator[](std::uint32_t slot) const { return items[(head - 1 - slot) & 15]; }
+
+        private:
+            T items[16] = {};
+            std::uint32_t head = 0;
+    };
+
+    std::uint32_t ZigZag(std::int32_t value) { return ((std::uint32_t)value << 1) ^ (std::uint32_t)(value >> 31); }
+    std::int32_t UnZigZag(std::uint32_t value) { return (std::int32_t)(value >> 1) ^ -(std::int32_t)(value & 1); }
+
+    std::uint8_t* WriteVarint(std::uint8_t* out, std::uint32_t value)
+    {
+        while(value >= 0x80)
+        {
+            *out++ = (std::uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = (std::uint8_t)value;
+        return out;
+    }
+
+    bool ReadVarint(const std::uint8_t*& in, const std::uint8_t* end, std::uint32_t& value)
+    {
+        value = 0;
+        for(int shift = 0; shift < 35; shift += 7)
+        {
+            if(in == end)
+                return false;
+            const std::uint8_t byte = *in++;
+            value |= (std::uint32_t)(byte & 0x7F) << shift;
+            if(byte < 0x80)
+                return true;
+        }
+        return false;
+    }
+
+    // 编码器和解码器共享的状态, 两边必须按同样的顺序更新
+    struct CodecState
+    {
+        RecentCache<Edge> edges;
+        RecentCache<std::uint32_t> vertices;
+        std::uint32_t next = 0;
+
+        void PushTriangle(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+        {
+            // 相邻三角形以相反方向经过共享边
+            edges.Push(Edge{b, a}, Edge{c, b}, Edge{a, c});
+        }
+    };
+}
+
+std::size_t EncodeIndexBufferBound(std::size_t index_count)
+{
+    // 最坏情况: 每个三角形 1 字节 + 三个顶点各 1 字节 + 5 字节 varint
+    return 1 + (index_count / 3) * (1 + 3 * 6);
+}
+
+template<typename T>
+std::size_t EncodeIndexBuffer(std::uint8_t* destination, std::size_t capacity, const T* indices, std::size_t index_count)
+{
+    index_count -= index_count % 3;
+    if(capacity < EncodeIndexBufferBound(index_count))
+        return 0;
+
+    CodecState state;
+    std::uint8_t* out = destination;
+    *out++ = codec_header;
+
+    // 返回顶点缓存中的位置, 不在缓存里时返回 limit
+    auto find_vertex = [&](std::uint32_t v, std::uint32_t limit){
+        std::uint32_t slot = 0;
+        while(slot < limit && state.vertices[slot] != v)
+            ++slot;
+        return slot;
+    };
+
+    for(std::size_t i = 0; i < index_count; i += 3)
+    {
+        const std::uint32_t triangle[3] = {indices[i], indices[i + 1], indices[i + 2]};
+
+        // 三种轮换中找一条在边缓存里的边
+        std::uint32_t edge_slot = edge_lookup;
+        std::uint32_t rotation = 0;
+        for(std::uint32_t r = 0; r < 3 && edge_slot == edge_lookup; ++r)
+        {
+            for(std::uint32_t slot = 0; slot < edge_lookup; ++slot)
+            {
+                const Edge& edge = state.edges[slot];
+                if(edge.a == triangle[r] && edge.b == triangle[(r + 1) % 3])
+                {
+                    edge_slot = slot;
+                    rotation = r;
+                    break;
+                }
+            }
+        }
+
+        if(edge_slot != edge_lookup)
+        {
+            const std::uint32_t a = triangle[rotation];
+            const std::uint32_t b = triangle[(rotation + 1) % 3];
+            const std::uint32_t c = triangle[(rotation + 2) % 3];
+
+            std::uint8_t* code = out++;
+            if(c == state.next)
+            {
+                *code = (std::uint8_t)(edge_slot << 4);
+                state.vertices.Push(state.next++);
+            }
+            else
+            {
+                const std::uint32_t slot = find_vertex(c, vertex_lookup_in_edge);
+                if(slot < vertex_lookup_in_edge)
+                {
+                    *code = (std::uint8_t)((edge_slot << 4) | (slot + 1));
+                }
+                else
+                {
+                    *code = (std::uint8_t)((edge_slot << 4) | vertex_explicit_in_edge);
+                    out = WriteVarint(out, ZigZag((std::int32_t)(c - state.next)));
+                    state.vertices.Push(c);
+                }
+            }
+            state.PushTriangle(a, b, c);
+            continue;
+        }
+
+        *out++ = (std::uint8_t)(edge_miss << 4);
+        for(std::uint32_t v : triangle)
+        {
+            if(v == state.next)
+            {
+                *out++ = 0;
+                state.vertices.Push(state.next++);
+                continue;
+            }
+
+            const std::uint32_t slot = find_vertex(v, vertex_lookup);
+            if(slot < vertex_lookup)
+            {
+                *out++ = (std::uint8_t)(slot + 1);
+            }
+            else
+            {
+                *out++ = vertex_explicit;
+                out = WriteVarint(out, ZigZag((std::int32_t)(v - state.next)));
+                state.vertices.Push(v);
+            }
+        }
+        state.PushTriangle(triangle[0], triangle[1], triangle[2]);
+    }
+
+    return (std::size_t)(out - destination);
+}
+
+template<typename T>
+bool DecodeIndexBuffer(T* destination, std::size_t index_count, const std::uint8_t* data, std::size_t size)
+{
+    if(index_count % 3 != 0 || size == 0 || data[0] != codec_header)
+        return false;
+
+    const std::uint8_t* in = data + 1;
+    const std::uint8_t* end = data + size;
+    CodecState state;
+
+    auto read_explicit = [&](std::uint32_t& v){
+        std::uint32_t zigzag;
+        if(!ReadVarint(in, end, zigzag))
+            return false;
+        v = state.next + (std::uint32_t)UnZigZag(zigzag);
+        state.vertices.Push(v);
+        return true;
+    };
+
+    for(std::size_t i = 0; i < index_count; i += 3)
+    {
+        if(in == end)
+            return false;
+
+        const std::uint8_t code = *in++;
+        const std::uint32_t edge_slot = code >> 4;
+        std::uint32_t a, b, c;
+
+        if(edge_slot != edge_miss) [[likely]]
+        {
+            const Edge& edge = state.edges[edge_slot];
+            a = edge.a;
+            b = edge.b;
+
+            const std::uint32_t vertex_code = code & 15;
+            if(vertex_code == 0)
+            {
+                c = state.next++;
+                state.vertices.Push(c);
+            }
+            else if(vertex_code != vertex_explicit_in_edge)
+            {
+                c = state.vertices[vertex_code - 1];
+            }
+            else if(!read_explicit(c))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            std::uint32_t triangle[3];
+            for(std::uint32_t& v : triangle)
+            {
+                if(in == end)
+                    return false;
+
+                const std::uint8_t vertex_code = *in++;
+                if(vertex_code == 0)
+                {
+                    v = state.next++;
+                    state.vertices.Push(v);
+                }
+                else if(vertex_code <= vertex_lookup)
+                {
+                    v = state.vertices[vertex_code - 1];
+                }
+                else if(vertex_code != vertex_explicit || !read_explicit(v))
+                {
+                    return false;
+                }
+            }
+            a = triangle[0];
+            b = triangle[1];
+            c = triangle[2];
+        }
+
+        // 损坏的数据可能给出超出 16 位的编号
+        if(std::max({a, b, c}) > std::numeric_limits<T>::max())
+            return false;
+
+        destination[i + 0] = (T)a;
+        destination[i + 1] = (T)b;
+        destination[i + 2] = (T)c;
+        state.PushTriangle(a, b, c);
+    }
+
+    return in == end;
+}
+
+template std::size_t EncodeIndexBuffer<std::uint16_t>(std::uint8_t*, std::size_t, const std::uint16_t*, std::size_t);
+template std::size_t EncodeIndexBuffer<std::uint32_t>(std::uint8_t*, std::size_t, const std::uint32_t*, std::size_t);
+template bool DecodeIndexBuffer<std::uint16_t>(std::uint16_t*, std::size_t, const std::uint8_t*, std::size_t);
+template bool DecodeIndexBuffer<std::uint32_t>(std::uint32_t*, std::size_t, const std::uint8_t*, std::size_t);
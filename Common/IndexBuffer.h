@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-----------------------------IndexBuffer--------------------------------
+// 1. 为每个 submesh 选择最小的索引宽度, 顶点超过 16 位范围时按 base_vertex_location 拆段
+// 2. 离线存储用的紧凑索引编码
+
+//-----------------------------index width--------------------------------
+// 一段 16 位索引, 绘制时 BaseVertexLocation = base_vertex
+struct IndexSegment
+{
+    std::uint32_t start_index = 0;
+    std::uint32_t index_count = 0;
+    std::uint32_t base_vertex = 0;
+};
+
+struct IndexBufferPlan
+{
+    // 2 或 4
+    std::uint32_t index_bytesize = sizeof(std::uint16_t);
+    // 32 位时只有一段, base_vertex 为 0
+    std::vector<IndexSegment> segments;
+    // 拆段后每段的顶点连续存放, 段之间共享的顶点会复制一份
+    // 新顶点缓冲的第 i 个顶点来自原来的 vertex_sources[i], 为空时顶点缓冲不变
+    std::vector<std::uint32_t> vertex_sources;
+
+    std::size_t Bytesize() const;
+};
+
+// 顶点不超过 65536 个时直接用 16 位索引
+// 否则按三角形顺序拆成每段不超过 65536 个不同顶点的几段, 只有节省的索引字节多于复制的顶点字节时才拆, 否则用 32 位
+// 输入最好已经做过 vertex cache 和 vertex fetch 优化, 这样段之间共享的顶点最少
+IndexBufferPlan PlanIndexBuffer(const std::uint32_t* indices, std::size_t index_count,
+                                std::size_t vertex_count, std::uint32_t vertex_bytesize);
+
+// 按 plan 写入 16 位 (每段内的编号) 或 32 位索引, destination 至少 plan.Bytesize() 字节
+void WriteIndexBuffer(void* destination, const std::uint32_t* indices, std::size_t index_count, const IndexBufferPlan& plan);
+
+// 索引范围 [start_index, start_index + index_count) 和 plan 各段的交集, 一个 submesh 跨段时要分几次绘制
+std::vector<IndexSegment> SegmentsInRange(const IndexBufferPlan& plan, std::uint32_t start_index, std::uint32_t index_count);
+
+// plan.vertex_sources 不为空时, 每个顶点流都要按它重新生成, destination 至少 vertex_sources.size() 个顶点
+void GatherVertexBuffer(void* destination, const void* vertices, std::uint32_t vertex_bytesize, const IndexBufferPlan& plan);
+
+//-----------------------------index compression--------------------------------
+// 每个三角形优先用最近 16 条边中的一条加一个顶点表示, 顶点优先表示为 "下一个新顶点" 或最近 16 个顶点之一,
+// 都不命中时才写 zigzag varint 差值. 做过 vertex cache 和 vertex fetch 优化的网格通常每个三角形 1~2 字节
+// 编码时三角形的顶点可能被轮换, 但绕序不变
+std::size_t EncodeIndexBufferBound(std::size_t index_count);
+
+// 返回写入的字节数, capacity 不够时返回 0
+template<typename T>
+std::size_t EncodeIndexBuffer(std::uint8_t* destination, std::size_t capacity, const T* indices, std::size_t index_count);
+
+// 数据损坏或者长度不对时返回 false
+template<typename T>
+bool DecodeIndexBuffer(T* destination, std::size_t index_count, const std::uint8_t* data, std::size_t size);
@@ -0,0 +1,63 @@
+#include "Instancing.h"
+#include "JobSystem.h"
+
+namespace
+{
+    constexpr std::uint32_t instance_chunk_size = 4096;
+}
+
+void InstanceBatcher::Clear()
+{
+    groups.clear();
+    group_lookup.clear();
+    instance_groups.clear();
+    sources.clear();
+    last_key = 0;
+}
+
+void InstanceBatcher::Add(std::uint64_t key, std::uint32_t instance)
+{
+    if(key != last_key || groups.empty())
+    {
+        auto it = group_lookup.try_emplace(key, (std::uint32_t)groups.size()).first;
+        if(it->second == groups.size())
+        {
+            InstanceGroup group;
+            group.key = key;
+            groups.push_back(group);
+        }
+        last_key = key;
+        last_group = it->second;
+    }
+
+    ++groups[last_group].instance_count;
+    instance_groups.push_back(last_group);
+    sources.push_back(instance);
+}
+
+void InstanceBatcher::Build(const InstanceData* instances, InstanceData* destination, JobSystem* jobs)
+{
+    // 计数排序: 组的起始位置是前面所有组的实例数之和
+    std::vector<std::uint32_t> cursors(groups.size());
+    std::uint32_t first_instance = 0;
+    for(std::size_t i = 0; i < groups.size(); ++i)
+    {
+        groups[i].first_instance = first_instance;
+        cursors[i] = first_instance;
+        first_instance += groups[i].instance_count;
+    }
+
+    order.resize(sources.size());
+    for(std::size_t i = 0; i < sources.size(); ++i)
+        order[cursors[instance_groups[i]]++] = sources[i];
+
+    auto gather = [&](std::uint32_t begin, std::uint32_t end){
+        for(std::uint32_t i = begin; i < end; ++i)
+            destination[i] = instances[order[i]];
+    };
+    const std::uint32_t count = (std::uint32_t)order.size();
+    if(jobs != nullptr && count > instance_chunk_size)
+        jobs->ParallelFor(count, instance_chunk_size, gather);
+    else
+        gather(0, count);
+}
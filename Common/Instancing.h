@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <DirectXMath.h>
+
+class JobSystem;
+
+//-----------------------------Instancing--------------------------------
+// 每帧把要绘制的对象按几何分组, 同一组的实例数据连续写进上传堆里的 StructuredBuffer, 每组一次 DrawIndexedInstanced
+// shader 用 起始编号 + SV_InstanceID 读实例数据 (SV_InstanceID 不包括 StartInstanceLocation), 起始编号用根常量传入
+
+// 对应 HLSL 的 struct InstanceData, 64 字节
+struct InstanceData
+{
+    // 世界矩阵的转置去掉最后一行 (XMStoreFloat3x4), shader 中每行和 float4(pos, 1) 点乘
+    DirectX::XMFLOAT3X4 world;
+    // 和顶点颜色相乘
+    DirectX::XMFLOAT4 color = {1.0f, 1.0f, 1.0f, 1.0f};
+};
+static_assert(sizeof(InstanceData) == 64, "InstanceData must match the HLSL struct");
+
+struct InstanceGroup
+{
+    // Add 时传入的 key, 一般是绘制键中去掉深度的部分 (见 RenderQueue.h)
+    std::uint64_t key = 0;
+    std::uint32_t first_instance = 0;
+    std::uint32_t instance_count = 0;
+};
+
+class InstanceBatcher
+{
+    public:
+        // 每帧开始时清空, 保留已分配的内存
+        void Clear();
+
+        // instance 是 Build 时 instances 数组中的下标
+        void Add(std::uint64_t key, std::uint32_t instance);
+
+        // 组按 key 第一次出现的顺序排列, 组内保持 Add 的顺序
+        // 先算出每个实例的位置, 再按位置顺序从 instances 收集到 destination (至少 Size() 个),
+        // 对上传堆这样的 write-combined 内存只有顺序写; 给了 jobs 并且实例较多时分块并行
+        void Build(const InstanceData* instances, InstanceData* destination, JobSystem* jobs = nullptr);
+
+        std::size_t Size() const { return sources.size(); }
+        const std::vector<InstanceGroup>& Groups() const { return groups; }
+
+    private:
+        std::vector<InstanceGroup> groups;
+        std::unordered_map<std::uint64_t, std::uint32_t> group_lookup;
+
+        // 每个实例所在的组和它在 instances 中的下标
+        std::vector<std::uint32_t> instance_groups;
+        std::vector<std::uint32_t> sources;
+        // Build 后按组排好的 instances 下标
+        std::vector<std::uint32_t> order;
+
+        // 相邻的实例通常属于同一组, 不用每次查表
+        std::uint64_t last_key = 0;
+        std::uint32_t last_group = 0;
+};
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "JobSystem.h"
+
+JobSystem::JobSystem(std::uint32_t worker_count)
+:base_time(std::chrono::steady_clock::now())
+{
+    if(worker_count == 0)
+    {
+        std::uint32_t hw = std::thread::hardware_concurrency();
+        worker_count = hw > 1 ? hw - 1 : 1;
+    }
+
+    workers.reserve(worker_count);
+    for(std::uint32_t i = 0; i < worker_count; ++i)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+JobSystem& JobSystem::Get()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+JobSystem::JobHandle JobSystem::Schedule(const std::string& name,
+                                         std::function<void()> fn,
+                                         const std::vector<JobHandle>& dependencies)
+{
+    JobHandle job = std::make_shared<Job>();
+    job->name = name;
+    job->fn = std::move(fn);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++unfinished_count;
+
+        for(const auto& dep : dependencies)
+        {
+            if(dep == nullptr)
+                continue;
+
+            if(dep->done)
+            {
+                if(dep->error != nullptr && job->error == nullptr)
+                    job->error = dep->error;
+                continue;
+            }
+
+            dep->dependents.push_back(job);
+            ++job->remaining_dependencies;
+        }
+
+        if(job->remaining_dependencies == 0)
+        {
+            ready_queue.push_back(job);
+        }
+    }
+    work_cv.notify_one();
+
+    return job;
+}
+
+void JobSystem::WorkerLoop(std::uint32_t thread_index)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        work_cv.wait(lock, [this]{ return stopping || !ready_queue.empty(); });
+        if(stopping && ready_queue.empty())
+            return;
+
+        RunOne(lock, thread_index);
+    }
+}
+
+bool JobSystem::RunOne(std::unique_lock<std::mutex>& lock, std::uint32_t thread_index)
+{
+    if(ready_queue.empty())
+        return false;
+
+    JobHandle job = ready_queue.front();
+    ready_queue.pop_front();
+
+    // 依赖失败时直接跳过, 异常传递给 Wait
+    if(job->error == nullptr)
+    {
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        std::exception_ptr error = nullptr;
+        try
+        {
+            job->fn();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        lock.lock();
+        job->error = error;
+
+        // 没有名字的job (例如 ParallelFor 的分块) 不记录耗时
+        if(profiling && !job->name.empty())
+        {
+            JobTiming timing;
+            timing.name = job->name;
+            timing.start_ms = std::chrono::duration<double, std::milli>(start - base_time).count();
+            timing.duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+            timing.thread_index = thread_index;
+            timings.push_back(timing);
+        }
+    }
+
+    Finish(job);
+    return true;
+}
+
+void JobSystem::Finish(const JobHandle& job)
+{
+    job->done = true;
+    job->fn = nullptr;
+    --unfinished_count;
+
+    bool has_ready = false;
+    for(auto& dependent : job->dependents)
+    {
+        if(job->error != nullptr && dependent->error == nullptr)
+            dependent->error = job->error;
+
+        if(--dependent->remaining_dependencies == 0)
+        {
+            ready_queue.push_back(dependent);
+            has_ready = true;
+        }
+    }
+    job->dependents.clear();
+
+    if(has_ready)
+        work_cv.notify_all();
+    done_cv.notify_all();
+}
+
+void JobSystem::Wait(const JobHandle& job)
+{
+    if(job == nullptr)
+        return;
+
+    // 调用线程用 WorkerCount() 作为自己的线程编号
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!job->done)
+    {
+        if(!RunOne(lock, WorkerCount()))
+            done_cv.wait(lock);
+    }
+
+    if(job->error != nullptr)
+        std::rethrow_exception(job->error);
+}
+
+bool JobSystem::IsDone(const JobHandle& job) const
+{
+    if(job == nullptr)
+        return true;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    return job->done;
+}
+
+void JobSystem::WaitAll()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(unfinished_count > 0)
+    {
+        if(!RunOne(lock, WorkerCount()))
+            done_cv.wait(lock);
+    }
+}
+
+void JobSystem::ParallelFor(std::uint32_t count,
+                            std::uint32_t chunk_size,
+                            const std::function<void(std::uint32_t begin, std::uint32_t end)>& fn)
+{
+    if(count == 0)
+        return;
+
+    chunk_size = std::max<std::uint32_t>(chunk_size, 1);
+    if(count <= chunk_size)
+    {
+        fn(0, count);
+        return;
+    }
+
+    std::vector<JobHandle> chunks;
+    chunks.reserve((count + chunk_size - 1) / chunk_size);
+    for(std::uint32_t begin = 0; begin < count; begin += chunk_size)
+    {
+        std::uint32_t end = std::min(begin + chunk_size, count);
+        chunks.push_back(Schedule("", [&fn, begin, end]{ fn(begin, end); }));
+    }
+
+    // 所有块都要等完, 再抛出第一个异常
+    std::exception_ptr first_error = nullptr;
+    for(auto& chunk : chunks)
+    {
+        try
+        {
+            Wait(chunk);
+        }
+        catch(...)
+        {
+            if(first_error == nullptr)
+                first_error = std::current_exception();
+        }
+    }
+
+    if(first_error != nullptr)
+        std::rethrow_exception(first_error);
+}
+
+void JobSystem::SetProfiling(bool enabled)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    profiling = enabled;
+}
+
+std::vector<JobSystem::JobTiming> JobSystem::Timings() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return timings;
+}
+
+void JobSystem::ClearTimings()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    timings.clear();
+}
+
+std::string JobSystem::ProfileReport() const
+{
+    std::vector<JobTiming> sorted = Timings();
+    std::sort(sorted.begin(), sorted.end(), [](const JobTiming& a, const JobTiming& b){
+        return a.start_ms < b.start_ms;
+    });
+
+    std::string report = "---- job profile ----\n";
+    char line[256];
+    double total_end = 0.0;
+    for(const auto& timing : sorted)
+    {
+        std::snprintf(line, sizeof(line), "[thread %2u] %-40s start %9.3f ms  cost %9.3f ms\n",
+            timing.thread_index, timing.name.c_str(), timing.start_ms, timing.duration_ms);
+        report += line;
+        total_end = std::max(total_end, timing.start_ms + timing.duration_ms);
+    }
+    std::snprintf(line, sizeof(line), "%zu jobs, finished at %.3f ms\n", sorted.size(), total_end);
+    report += line;
+
+    return report;
+}
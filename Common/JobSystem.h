@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-----------------------------JobSystem--------------------------------
+// 工作线程池, job 可以声明依赖, 所有依赖完成后才会进入就绪队列
+// 用于启动时并行编译shader/创建PSO, 以及各种CPU端的并行处理
+class JobSystem
+{
+    public:
+        struct Job;
+        using JobHandle = std::shared_ptr<Job>;
+
+        struct JobTiming
+        {
+            std::string name;
+            double start_ms = 0.0;
+            double duration_ms = 0.0;
+            std::uint32_t thread_index = 0;
+        };
+
+        // worker_count 为0时使用 hardware_concurrency - 1 (至少1个)
+        explicit JobSystem(std::uint32_t worker_count = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem& rhs) = delete;
+        JobSystem& operator=(const JobSystem& rhs) = delete;
+
+        JobHandle Schedule(const std::string& name,
+                           std::function<void()> fn,
+                           const std::vector<JobHandle>& dependencies = {});
+
+        // 等待job完成, 等待期间当前线程会帮忙执行就绪的job
+        // job内抛出的异常会在这里重新抛出, 依赖失败的job不会执行并继承同一个异常
+        void Wait(const JobHandle& job);
+        void WaitAll();
+        // 不阻塞, nullptr 视为已完成
+        bool IsDone(const JobHandle& job) const;
+
+        // 把 [0, count) 切成 chunk_size 大小的块并行执行, 返回前全部完成
+        void ParallelFor(std::uint32_t count,
+                         std::uint32_t chunk_size,
+                         const std::function<void(std::uint32_t begin, std::uint32_t end)>& fn);
+
+        std::uint32_t WorkerCount() const { return (std::uint32_t)workers.size(); }
+
+        // 默认不记录, 否则长时间运行时 timings 一直增长; 打开后记录有名字的 job 的耗时
+        void SetProfiling(bool enabled);
+        std::vector<JobTiming> Timings() const;
+        void ClearTimings();
+        // 按开始时间排序的每个job耗时报告
+        std::string ProfileReport() const;
+
+        // 全局共享的线程池
+        static JobSystem& Get();
+
+    private:
+        void WorkerLoop(std::uint32_t thread_index);
+        // 调用时必须持有 lock, 执行job期间会临时释放
+        bool RunOne(std::unique_lock<std::mutex>& lock, std::uint32_t thread_index);
+        // 调用时必须持有 mutex
+        void Finish(const JobHandle& job);
+
+    private:
+        std::vector<std::thread> workers;
+        std::deque<JobHandle> ready_queue;
+        std::vector<JobTiming> timings;
+        bool profiling = false;
+
+        mutable std::mutex mutex;
+        std::condition_variable work_cv;
+        std::condition_variable done_cv;
+
+        std::chrono::steady_clock::time_point base_time;
+        std::uint32_t unfinished_count = 0;
+        bool stopping = false;
+};
+
+struct JobSystem::Job
+{
+    std::string name;
+    std::function<void()> fn;
+    std::vector<JobHandle> dependents;
+    std::uint32_t remaining_dependencies = 0;
+    bool done = false;
+    std::exception_ptr error = nullptr;
+};
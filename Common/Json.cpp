@@ -0,0 +1,280 @@
+#include <charconv>
+#include <cstdio>
+
+#include "Json.h"
+
+namespace
+{
+    // 嵌套超过这个深度时认为文件有问题, 避免递归耗尽栈
+    constexpr std::uint32_t max_json_depth = 256;
+
+    const JsonValue& NullValue()
+    {
+        static const JsonValue null_value;
+        return null_value;
+    }
+
+    void AppendUtf8(std::string& out, std::uint32_t code_point)
+    {
+        if(code_point < 0x80)
+        {
+            out.push_back((char)code_point);
+        }
+        else if(code_point < 0x800)
+        {
+            out.push_back((char)(0xC0 | (code_point >> 6)));
+            out.push_back((char)(0x80 | (code_point & 0x3F)));
+        }
+        else if(code_point < 0x10000)
+        {
+            out.push_back((char)(0xE0 | (code_point >> 12)));
+            out.push_back((char)(0x80 | ((code_point >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (code_point & 0x3F)));
+        }
+        else
+        {
+            out.push_back((char)(0xF0 | (code_point >> 18)));
+            out.push_back((char)(0x80 | ((code_point >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((code_point >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (code_point & 0x3F)));
+        }
+    }
+}
+
+// 递归下降, 出错时记录第一个错误的位置
+class JsonParser
+{
+    public:
+        explicit JsonParser(std::string_view text)
+        :text(text)
+        {
+        }
+
+        bool ParseDocument(JsonValue& value)
+        {
+            if(!ParseValue(value, 0))
+                return false;
+            SkipWhitespace();
+            return position == text.size() || Fail("trailing characters");
+        }
+
+        std::string Error() const
+        {
+            char buffer[128];
+            std::snprintf(buffer, sizeof(buffer), "json error at byte %zu: %s", error_position, error);
+            return buffer;
+        }
+
+    private:
+        bool Fail(const char* message)
+        {
+            if(error == nullptr)
+            {
+                error = message;
+                error_position = position;
+            }
+            return false;
+        }
+
+        void SkipWhitespace()
+        {
+            while(position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+                ++position;
+        }
+
+        bool Consume(char c)
+        {
+            SkipWhitespace();
+            if(position < text.size() && text[position] == c)
+            {
+                ++position;
+                return true;
+            }
+            return false;
+        }
+
+        bool ConsumeLiteral(std::string_view literal)
+        {
+            if(text.substr(position, literal.size()) != literal)
+                return Fail("invalid literal");
+            position += literal.size();
+            return true;
+        }
+
+        bool ParseValue(JsonValue& value, std::uint32_t depth)
+        {
+            if(depth > max_json_depth)
+                return Fail("nesting too deep");
+
+            SkipWhitespace();
+            if(position >= text.size())
+                return Fail("unexpected end");
+
+            switch(text[position])
+            {
+                case '{': return ParseObject(value, depth);
+                case '[': return ParseArray(value, depth);
+                case '"':
+                    value.type = JsonValue::Type::String;
+                    return ParseString(value.string);
+                case 't':
+                    value.type = JsonValue::Type::Bool;
+                    value.boolean = true;
+                    return ConsumeLiteral("true");
+                case 'f':
+                    value.type = JsonValue::Type::Bool;
+                    value.boolean = false;
+                    return ConsumeLiteral("false");
+                case 'n':
+                    value.type = JsonValue::Type::Null;
+                    return ConsumeLiteral("null");
+                default:
+                    return ParseNumber(value);
+            }
+        }
+
+        bool ParseObject(JsonValue& value, std::uint32_t depth)
+        {
+            value.type = JsonValue::Type::Object;
+            ++position;
+            if(Consume('}'))
+                return true;
+            do
+            {
+                SkipWhitespace();
+                value.members.emplace_back();
+                if(position >= text.size() || text[position] != '"' || !ParseString(value.members.back().first))
+                    return Fail("expected a key");
+                if(!Consume(':'))
+                    return Fail("expected ':'");
+                if(!ParseValue(value.members.back().second, depth + 1))
+                    return false;
+            }
+            while(Consume(','));
+            return Consume('}') || Fail("expected ',' or '}'");
+        }
+
+        bool ParseArray(JsonValue& value, std::uint32_t depth)
+        {
+            value.type = JsonValue::Type::Array;
+            ++position;
+            if(Consume(']'))
+                return true;
+            do
+            {
+                value.elements.emplace_back();
+                if(!ParseValue(value.elements.back(), depth + 1))
+                    return false;
+            }
+            while(Consume(','));
+            return Consume(']') || Fail("expected ',' or ']'");
+        }
+
+        bool ParseHex4(std::uint32_t& code)
+        {
+            if(position + 4 > text.size())
+                return Fail("truncated \\u escape");
+            const char* begin = text.data() + position;
+            if(std::from_chars(begin, begin + 4, code, 16).ptr != begin + 4)
+                return Fail("invalid \\u escape");
+            position += 4;
+            return true;
+        }
+
+        bool ParseString(std::string& out)
+        {
+            ++position;
+            out.clear();
+            while(position < text.size())
+            {
+                const char c = text[position++];
+                if(c == '"')
+                    return true;
+                if(c != '\\')
+                {
+                    out.push_back(c);
+                    continue;
+                }
+                if(position >= text.size())
+                    break;
+                const char escape = text[position++];
+                switch(escape)
+                {
+                    case '"': out.push_back('"'); break;
+                    case '\\': out.push_back('\\'); break;
+                    case '/': out.push_back('/'); break;
+                    case 'b': out.push_back('\b'); break;
+                    case 'f': out.push_back('\f'); break;
+                    case 'n': out.push_back('\n'); break;
+                    case 'r': out.push_back('\r'); break;
+                    case 't': out.push_back('\t'); break;
+                    case 'u':
+                    {
+                        std::uint32_t code = 0;
+                        if(!ParseHex4(code))
+                            return false;
+                        // 代理对
+                        if(code >= 0xD800 && code < 0xDC00 && text.substr(position, 2) == "\\u")
+                        {
+                            position += 2;
+                            std::uint32_t low = 0;
+                            if(!ParseHex4(low))
+                                return false;
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        AppendUtf8(out, code);
+                        break;
+                    }
+                    default:
+                        return Fail("invalid escape");
+                }
+            }
+            return Fail("unterminated string");
+        }
+
+        bool ParseNumber(JsonValue& value)
+        {
+            value.type = JsonValue::Type::Number;
+            const char* begin = text.data() + position;
+            const char* end = text.data() + text.size();
+            const std::from_chars_result result = std::from_chars(begin, end, value.number);
+            if(result.ec != std::errc())
+                return Fail("invalid number");
+            position += result.ptr - begin;
+            return true;
+        }
+
+    private:
+        std::string_view text;
+        std::size_t position = 0;
+        const char* error = nullptr;
+        std::size_t error_position = 0;
+};
+
+const JsonValue& JsonValue::operator[](std::size_t index) const
+{
+    return type == Type::Array && index < elements.size() ? elements[index] : NullValue();
+}
+
+const JsonValue& JsonValue::operator[](std::string_view key) const
+{
+    if(type != Type::Object)
+        return NullValue();
+    for(const auto& member : members)
+    {
+        if(member.first == key)
+            return member.second;
+    }
+    return NullValue();
+}
+
+bool JsonValue::Parse(std::string_view text, JsonValue& value, std::string* error)
+{
+    value = JsonValue();
+    JsonParser parser(text);
+    if(parser.ParseDocument(value))
+        return true;
+    if(error != nullptr)
+        *error = parser.Error();
+    return false;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//-----------------------------Json--------------------------------
+// 只用于读取 glTF 这类小的描述文件: 一次解析成树, 不支持写出
+// 数字统一存为 double, 字符串处理 \uXXXX 转义 (包括代理对), 输出 UTF-8
+constexpr std::uint64_t json_max_exact_integer = std::uint64_t(1) << 53;
+
+class JsonValue
+{
+    public:
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object
+        };
+
+        Type GetType() const { return type; }
+        bool IsNull() const { return type == Type::Null; }
+        bool IsNumber() const { return type == Type::Number; }
+        bool IsString() const { return type == Type::String; }
+        bool IsArray() const { return type == Type::Array; }
+        bool IsObject() const { return type == Type::Object; }
+
+        // 类型不符时返回 fallback
+        bool AsBool(bool fallback = false) const { return type == Type::Bool ? boolean : fallback; }
+        double AsNumber(double fallback = 0.0) const { return type == Type::Number ? number : fallback; }
+        std::uint32_t AsUint(std::uint32_t fallback = 0) const
+        {
+            std::uint64_t value = 0;
+            return GetUint(value, UINT32_MAX) ? (std::uint32_t)value : fallback;
+        }
+        // 是不超过 max 的非负整数时写进 value 并返回 true; 负数, 小数, 超出范围或者类型不符时返回 false
+        // double 只能精确表示 2^53 以内的整数, max 不能更大
+        bool GetUint(std::uint64_t& value, std::uint64_t max = json_max_exact_integer) const
+        {
+            if(type != Type::Number || !(number >= 0.0) || number > (double)max || number != std::floor(number))
+                return false;
+            value = (std::uint64_t)number;
+            return true;
+        }
+        const std::string& AsString() const { return string; }
+
+        // 数组元素个数, 不是数组时为 0
+        std::size_t Size() const { return type == Type::Array ? elements.size() : 0; }
+        // 越界或者不是数组时返回一个 Null
+        const JsonValue& operator[](std::size_t index) const;
+        // 找不到或者不是对象时返回一个 Null
+        const JsonValue& operator[](std::string_view key) const;
+        bool Has(std::string_view key) const { return !(*this)[key].IsNull(); }
+
+        // 出错时返回 false, error 为出错的字节位置和原因
+        static bool Parse(std::string_view text, JsonValue& value, std::string* error = nullptr);
+
+    private:
+        friend class JsonParser;
+
+        Type type = Type::Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> elements;
+        std::vector<std::pair<std::string, JsonValue>> members;
+};
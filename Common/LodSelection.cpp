@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "JobSystem.h"
+#include "LodSelection.h"
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr std::uint32_t lod_chunk_size = 4096;
+
+    // [begin, end) 范围内的对象, 每个循环只读写连续数组
+    void SelectRange(LodObjects& objects, const LodSelectionParams& params, std::uint32_t begin, std::uint32_t end)
+    {
+        const std::uint32_t count = end - begin;
+        const float* cx = objects.center_x.data() + begin;
+        const float* cy = objects.center_y.data() + begin;
+        const float* cz = objects.center_z.data() + begin;
+        const float* r = objects.radius.data() + begin;
+        std::uint32_t* selected = objects.selected_lod.data() + begin;
+
+        // 包围球上离相机最近的点的距离, 换算成每单位误差的像素数
+        float pixels_per_unit[lod_chunk_size];
+        for(std::uint32_t i = 0; i < count; ++i)
+        {
+            const float dx = cx[i] - params.camera_position.x;
+            const float dy = cy[i] - params.camera_position.y;
+            const float dz = cz[i] - params.camera_position.z;
+            const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - r[i], params.min_distance);
+            pixels_per_unit[i] = params.projection_scale / distance;
+        }
+
+        // 误差随 LOD 单调递增, 满足预算的级数就是可用的最粗 LOD
+        std::uint32_t finest[lod_chunk_size];
+        std::uint32_t coarsest[lod_chunk_size];
+        std::fill(finest, finest + count, 0u);
+        std::fill(coarsest, coarsest + count, 0u);
+        const float coarsen_budget = params.pixel_error * (1.0f - params.hysteresis);
+        for(std::uint32_t lod = 1; lod < max_lod_levels; ++lod)
+        {
+            const float* error = objects.lod_error[lod].data() + begin;
+            for(std::uint32_t i = 0; i < count; ++i)
+            {
+                const float pixels = error[i] * pixels_per_unit[i];
+                coarsest[i] += pixels <= params.pixel_error ? 1u : 0u;
+                finest[i] += pixels <= coarsen_budget ? 1u : 0u;
+            }
+        }
+
+        // 不超过预算时不变细, 没有低于更严的预算时不变粗
+        for(std::uint32_t i = 0; i < count; ++i)
+            selected[i] = std::min(std::max(selected[i], finest[i]), coarsest[i]);
+    }
+}
+
+float LodProjectionScale(const XMFLOAT4X4& proj, float viewport_height)
+{
+    // _22 = 1 / tan(fov_y / 2)
+    return proj._22 * viewport_height * 0.5f;
+}
+
+std::uint32_t LodObjects::Add(const BoundingSphere& sphere, const float* errors, std::uint32_t lod_count)
+{
+    const std::uint32_t object = (std::uint32_t)Size();
+    center_x.push_back(sphere.Center.x);
+    center_y.push_back(sphere.Center.y);
+    center_z.push_back(sphere.Center.z);
+    radius.push_back(sphere.Radius);
+    for(std::uint32_t lod = 0; lod < max_lod_levels; ++lod)
+        lod_error[lod].push_back(lod == 0 ? 0.0f : (lod < lod_count ? errors[lod] : FLT_MAX));
+    selected_lod.push_back(0);
+    return object;
+}
+
+void LodObjects::SetSphere(std::uint32_t object, const BoundingSphere& sphere)
+{
+    center_x[object] = sphere.Center.x;
+    center_y[object] = sphere.Center.y;
+    center_z[object] = sphere.Center.z;
+    radius[object] = sphere.Radius;
+}
+
+void SelectLods(LodObjects& objects, const LodSelectionParams& params, JobSystem* jobs)
+{
+    const std::uint32_t count = (std::uint32_t)objects.Size();
+    if(jobs == nullptr)
+    {
+        for(std::uint32_t begin = 0; begin < count; begin += lod_chunk_size)
+            SelectRange(objects, params, begin, std::min(begin + lod_chunk_size, count));
+        return;
+    }
+
+    jobs->ParallelFor(count, lod_chunk_size, [&](std::uint32_t begin, std::uint32_t end){
+        SelectRange(objects, params, begin, end);
+    });
+}
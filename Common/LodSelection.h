@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+class JobSystem;
+
+//-----------------------------LodSelection--------------------------------
+// 按屏幕空间误差为每个对象选择 LOD: 误差投影到屏幕上不超过 pixel_error 像素的最粗的一级
+// 对象数据按 SoA 存放, 每一步都是对连续 float 数组的无分支循环, 编译器可以直接向量化
+constexpr std::uint32_t max_lod_levels = 8;
+
+struct LodSelectionParams
+{
+    DirectX::XMFLOAT3 camera_position = {0.0f, 0.0f, 0.0f};
+    // 世界空间中距离相机 1 的长度 1 在屏幕上的像素数, 见 LodProjectionScale
+    float projection_scale = 1.0f;
+    float pixel_error = 1.0f;
+    // 变粗时误差要低于 pixel_error * (1 - hysteresis), 变细时超过 pixel_error, 中间的范围保持上一帧的 LOD
+    float hysteresis = 0.25f;
+    // 相机在包围球内时用这个距离
+    float min_distance = 0.01f;
+};
+
+// proj 为 XMMatrixPerspectiveFovLH 生成的矩阵, viewport_height 为像素
+float LodProjectionScale(const DirectX::XMFLOAT4X4& proj, float viewport_height);
+
+struct LodObjects
+{
+    // 世界空间包围球
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+    // lod_error[lod][object], 世界空间距离, 对象没有的级别为 FLT_MAX, LOD0 为 0
+    std::array<std::vector<float>, max_lod_levels> lod_error;
+    // 当前选中的 LOD, 作为下一帧滞后判断的依据
+    std::vector<std::uint32_t> selected_lod;
+
+    std::size_t Size() const { return radius.size(); }
+
+    // errors[0 .. lod_count) 按 LOD 顺序递增, 返回对象编号
+    std::uint32_t Add(const DirectX::BoundingSphere& sphere, const float* errors, std::uint32_t lod_count);
+    void SetSphere(std::uint32_t object, const DirectX::BoundingSphere& sphere);
+};
+
+// 对象数超过一个分块并且给了 jobs 时按块并行
+void SelectLods(LodObjects& objects, const LodSelectionParams& params, JobSystem* jobs = nullptr);
@@ -0,0 +1,402 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <dxgiformat.h>
+
+#include "Hash.h"
+#include "IndexBuffer.h"
+#include "MeshFile.h"
+
+namespace
+{
+    std::uint64_t AlignUp(std::uint64_t offset)
+    {
+        return (offset + mesh_file_alignment - 1) & ~(std::uint64_t)(mesh_file_alignment - 1);
+    }
+
+    // 依次给每一块分配对齐的位置
+    class LayoutCursor
+    {
+        public:
+            MeshFileRange Place(std::uint64_t bytesize)
+            {
+                MeshFileRange range;
+                if(bytesize == 0)
+                    return range;
+                range.offset = AlignUp(end);
+                range.bytesize = bytesize;
+                end = range.offset + bytesize;
+                return range;
+            }
+
+            std::uint64_t End() const { return end; }
+
+        private:
+            std::uint64_t end = sizeof(MeshFileHeader);
+    };
+
+    void CopyRange(std::vector<std::uint8_t>& image, const MeshFileRange& range, const void* source)
+    {
+        if(range.bytesize != 0)
+            std::memcpy(image.data() + range.offset, source, (std::size_t)range.bytesize);
+    }
+
+    std::uint64_t HashContent(const std::uint8_t* data, std::size_t bytesize)
+    {
+        return HashBytes(data + sizeof(MeshFileHeader), bytesize - sizeof(MeshFileHeader));
+    }
+
+    bool RangeInside(const MeshFileRange& range, std::size_t bytesize, std::uint64_t expected_bytesize)
+    {
+        if(range.bytesize != expected_bytesize)
+            return false;
+        if(range.bytesize == 0)
+            return true;
+        return range.offset % mesh_file_alignment == 0
+            && range.offset >= sizeof(MeshFileHeader)
+            && range.offset <= bytesize && range.bytesize <= bytesize - range.offset;
+    }
+
+    // 只检查文件头和各块的范围, 不读数据本身, 通过时返回文件头
+    const MeshFileHeader* ValidateImage(const std::uint8_t* data, std::size_t bytesize)
+    {
+        if(data == nullptr || bytesize < sizeof(MeshFileHeader))
+            return nullptr;
+
+        const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(data);
+        if(header->magic != mesh_file_magic || header->version != mesh_file_version || header->file_bytesize != bytesize)
+            return nullptr;
+        if(header->stream_count > mesh_file_max_streams)
+            return nullptr;
+
+        for(std::uint32_t s = 0; s < header->stream_count; ++s)
+        {
+            const MeshFileStream& stream = header->streams[s];
+            if(!RangeInside(stream.data, bytesize, (std::uint64_t)stream.stride * header->vertex_count))
+                return nullptr;
+        }
+
+        // 压缩的索引只能检查长度的上限, 内容在解压时检查
+        std::uint64_t index_data_bytesize = 0;
+        if(header->index_encoding == mesh_index_encoding_none)
+        {
+            // 每个索引的字节数由长度推出, 必须和 index_format 一致, 否则上传后 GPU 按错误的宽度读索引
+            const std::uint64_t index_bytesize = header->index_count == 0 ? 0 : header->indices.bytesize / header->index_count;
+            if(index_bytesize != 0 && index_bytesize != MeshFileIndexBytesize(header->index_format))
+                return nullptr;
+            index_data_bytesize = index_bytesize * header->index_count;
+        }
+        else if(header->index_encoding == mesh_index_encoding_compact)
+        {
+            if(MeshFileIndexBytesize(header->index_format) == 0 || header->index_count % 3 != 0
+                || header->indices.bytesize > EncodeIndexBufferBound(header->index_count))
+                return nullptr;
+            index_data_bytesize = header->indices.bytesize;
+        }
+        else
+        {
+            return nullptr;
+        }
+        if(!RangeInside(header->indices, bytesize, index_data_bytesize)
+            || !RangeInside(header->submeshes, bytesize, (std::uint64_t)header->submesh_count * sizeof(MeshFileSubmesh))
+            || !RangeInside(header->segments, bytesize, (std::uint64_t)header->segment_count * sizeof(MeshFileSegment))
+            || header->vertex_remap.bytesize % sizeof(std::uint32_t) != 0
+            || !RangeInside(header->vertex_remap, bytesize, header->vertex_remap.bytesize)
+            || !RangeInside(header->meshlets, bytesize, (std::uint64_t)header->meshlet_count * sizeof(MeshFileMeshlet))
+            || !RangeInside(header->meshlet_bounds, bytesize, (std::uint64_t)header->meshlet_count * sizeof(MeshFileMeshletBounds))
+            || header->meshlet_vertices.bytesize % sizeof(std::uint32_t) != 0
+            || !RangeInside(header->meshlet_vertices, bytesize, header->meshlet_vertices.bytesize)
+            || !RangeInside(header->meshlet_primitives, bytesize, (std::uint64_t)header->meshlet_triangle_count * sizeof(std::uint32_t)))
+            return nullptr;
+
+        // submesh 引用的拆段不能越界, 绘制范围在上传之后由 GPU 端检查
+        const MeshFileSubmesh* submeshes = reinterpret_cast<const MeshFileSubmesh*>(data + header->submeshes.offset);
+        for(std::uint32_t i = 0; i < header->submesh_count; ++i)
+        {
+            if(submeshes[i].name[mesh_file_name_size - 1] != '\0')
+                return nullptr;
+            if((std::uint64_t)submeshes[i].segment_offset + submeshes[i].segment_count > header->segment_count)
+                return nullptr;
+            if((std::uint64_t)submeshes[i].meshlet_offset + submeshes[i].meshlet_count > header->meshlet_count)
+                return nullptr;
+        }
+
+        // meshlet 引用的顶点编号和三角形不能越界, 编号本身的范围在 GPU 端检查
+        const MeshFileMeshlet* meshlets = reinterpret_cast<const MeshFileMeshlet*>(data + header->meshlets.offset);
+        const std::uint64_t meshlet_vertex_count = header->meshlet_vertices.bytesize / sizeof(std::uint32_t);
+        for(std::uint32_t i = 0; i < header->meshlet_count; ++i)
+        {
+            if((std::uint64_t)meshlets[i].vertex_offset + meshlets[i].vertex_count > meshlet_vertex_count
+                || (std::uint64_t)meshlets[i].primitive_offset + meshlets[i].primitive_count > header->meshlet_triangle_count)
+                return nullptr;
+        }
+        return header;
+    }
+}
+
+std::uint32_t MeshFileIndexBytesize(std::uint32_t index_format)
+{
+    if(index_format == DXGI_FORMAT_R16_UINT)
+        return sizeof(std::uint16_t);
+    if(index_format == DXGI_FORMAT_R32_UINT)
+        return sizeof(std::uint32_t);
+    return 0;
+}
+
+bool DecodeMeshFileIndices(void* destination, std::uint32_t index_format, std::uint32_t index_count,
+                           std::uint32_t index_encoding, const void* data, std::size_t bytesize)
+{
+    const std::uint32_t index_bytesize = MeshFileIndexBytesize(index_format);
+    if(index_encoding == mesh_index_encoding_none)
+    {
+        if(bytesize != (std::size_t)index_count * index_bytesize)
+            return false;
+        if(bytesize != 0)
+            std::memcpy(destination, data, bytesize);
+        return true;
+    }
+    if(index_encoding != mesh_index_encoding_compact)
+        return false;
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    if(index_bytesize == sizeof(std::uint16_t))
+        return DecodeIndexBuffer(static_cast<std::uint16_t*>(destination), index_count, bytes, bytesize);
+    if(index_bytesize == sizeof(std::uint32_t))
+        return DecodeIndexBuffer(static_cast<std::uint32_t*>(destination), index_count, bytes, bytesize);
+    return false;
+}
+
+void SetMeshFileName(MeshFileSubmesh& submesh, const std::string& name)
+{
+    std::memset(submesh.name, 0, sizeof(submesh.name));
+    std::memcpy(submesh.name, name.data(), name.size() < mesh_file_name_size ? name.size() : mesh_file_name_size - 1);
+}
+
+std::vector<std::uint8_t> SerializeMeshFile(const MeshFileContent& content)
+{
+    MeshFileHeader header;
+    header.vertex_count = content.vertex_count;
+    header.stream_count = (std::uint32_t)content.streams.size();
+    header.index_count = content.index_count;
+    header.index_format = content.index_format;
+    header.index_encoding = content.index_encoding;
+    header.submesh_count = (std::uint32_t)content.submeshes.size();
+    header.segment_count = (std::uint32_t)content.segments.size();
+    header.meshlet_count = (std::uint32_t)content.meshlets.size();
+    header.meshlet_triangle_count = (std::uint32_t)content.meshlet_primitives.size();
+    std::memcpy(header.position_scale, content.position_scale, sizeof(header.position_scale));
+    std::memcpy(header.position_offset, content.position_offset, sizeof(header.position_offset));
+
+    // 小的表放在前面, 打开文件时检查它们只会碰到开头的几页
+    LayoutCursor cursor;
+    header.submeshes = cursor.Place(content.submeshes.size() * sizeof(MeshFileSubmesh));
+    header.segments = cursor.Place(content.segments.size() * sizeof(MeshFileSegment));
+    header.meshlets = cursor.Place(content.meshlets.size() * sizeof(MeshFileMeshlet));
+    for(std::uint32_t s = 0; s < header.stream_count && s < mesh_file_max_streams; ++s)
+    {
+        header.streams[s].data = cursor.Place(content.streams[s].data.size());
+        header.streams[s].stride = content.streams[s].stride;
+        header.streams[s].format = content.streams[s].format;
+    }
+    header.indices = cursor.Place(content.indices.size());
+    header.vertex_remap = cursor.Place(content.vertex_remap.size() * sizeof(std::uint32_t));
+    header.meshlet_bounds = cursor.Place(content.meshlet_bounds.size() * sizeof(MeshFileMeshletBounds));
+    header.meshlet_vertices = cursor.Place(content.meshlet_vertices.size() * sizeof(std::uint32_t));
+    header.meshlet_primitives = cursor.Place(content.meshlet_primitives.size() * sizeof(std::uint32_t));
+    header.file_bytesize = cursor.End();
+
+    std::vector<std::uint8_t> image((std::size_t)header.file_bytesize, 0);
+    CopyRange(image, header.submeshes, content.submeshes.data());
+    CopyRange(image, header.segments, content.segments.data());
+    for(std::uint32_t s = 0; s < header.stream_count && s < mesh_file_max_streams; ++s)
+        CopyRange(image, header.streams[s].data, content.streams[s].data.data());
+    CopyRange(image, header.indices, content.indices.data());
+    CopyRange(image, header.vertex_remap, content.vertex_remap.data());
+    CopyRange(image, header.meshlets, content.meshlets.data());
+    CopyRange(image, header.meshlet_bounds, content.meshlet_bounds.data());
+    CopyRange(image, header.meshlet_vertices, content.meshlet_vertices.data());
+    CopyRange(image, header.meshlet_primitives, content.meshlet_primitives.data());
+
+    header.content_hash = HashContent(image.data(), image.size());
+    std::memcpy(image.data(), &header, sizeof(header));
+    return image;
+}
+
+bool WriteMeshFile(const std::wstring& filename, const std::vector<std::uint8_t>& image)
+{
+    const std::filesystem::path path(filename);
+    std::filesystem::path temp_path(path);
+    temp_path += L".tmp";
+    {
+        std::ofstream fout(temp_path, std::ios::binary | std::ios::trunc);
+        fout.write((const char*)image.data(), (std::streamsize)image.size());
+        if(!fout)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    return !error;
+}
+
+bool ReadMeshFile(const std::wstring& filename, MeshFileContent& content)
+{
+    std::ifstream fin(std::filesystem::path(filename), std::ios::binary | std::ios::ate);
+    if(!fin)
+        return false;
+    std::vector<std::uint8_t> image((std::size_t)fin.tellg());
+    fin.seekg(0);
+    fin.read((char*)image.data(), (std::streamsize)image.size());
+    if(!fin)
+        return false;
+
+    const MeshFileHeader* header = ValidateImage(image.data(), image.size());
+    if(header == nullptr)
+        return false;
+
+    auto copy_out = [&](const MeshFileRange& range, auto& destination){
+        using Element = typename std::decay_t<decltype(destination)>::value_type;
+        destination.resize((std::size_t)range.bytesize / sizeof(Element));
+        if(range.bytesize != 0)
+            std::memcpy(destination.data(), image.data() + range.offset, (std::size_t)range.bytesize);
+    };
+
+    content.vertex_count = header->vertex_count;
+    content.streams.resize(header->stream_count);
+    for(std::uint32_t s = 0; s < header->stream_count; ++s)
+    {
+        copy_out(header->streams[s].data, content.streams[s].data);
+        content.streams[s].stride = header->streams[s].stride;
+        content.streams[s].format = header->streams[s].format;
+    }
+    content.index_count = header->index_count;
+    content.index_format = header->index_format;
+    content.index_encoding = header->index_encoding;
+    copy_out(header->indices, content.indices);
+    copy_out(header->submeshes, content.submeshes);
+    copy_out(header->segments, content.segments);
+    copy_out(header->vertex_remap, content.vertex_remap);
+    copy_out(header->meshlets, content.meshlets);
+    copy_out(header->meshlet_bounds, content.meshlet_bounds);
+    copy_out(header->meshlet_vertices, content.meshlet_vertices);
+    copy_out(header->meshlet_primitives, content.meshlet_primitives);
+    std::memcpy(content.position_scale, header->position_scale, sizeof(content.position_scale));
+    std::memcpy(content.position_offset, header->position_offset, sizeof(content.position_offset));
+    return true;
+}
+
+//-----------------------------MappedMeshFile--------------------------------
+MappedMeshFile::~MappedMeshFile()
+{
+    Close();
+}
+
+bool MappedMeshFile::Open(const std::wstring& filename)
+{
+    Close();
+
+#ifdef _WIN32
+    // 映射的视图不依赖文件和映射对象的句柄, 映射之后就可以关闭
+    HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size = {};
+    HANDLE file_mapping = nullptr;
+    if(GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG)sizeof(MeshFileHeader))
+        file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if(file_mapping == nullptr)
+        return false;
+
+    data = static_cast<const std::uint8_t*>(MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(file_mapping);
+    if(data == nullptr)
+        return false;
+    bytesize = (std::size_t)size.QuadPart;
+#else
+    const int file = open(std::filesystem::path(filename).c_str(), O_RDONLY);
+    if(file < 0)
+        return false;
+
+    struct stat status = {};
+    void* view = MAP_FAILED;
+    if(fstat(file, &status) == 0 && status.st_size >= (off_t)sizeof(MeshFileHeader))
+        view = mmap(nullptr, (std::size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(view == MAP_FAILED)
+        return false;
+
+    data = static_cast<const std::uint8_t*>(view);
+    bytesize = (std::size_t)status.st_size;
+#endif
+    mapped = true;
+
+    if(!Validate())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedMeshFile::Adopt(std::vector<std::uint8_t> image)
+{
+    Close();
+
+    owned = std::move(image);
+    data = owned.data();
+    bytesize = owned.size();
+    if(!Validate())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedMeshFile::Close()
+{
+    if(mapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<std::uint8_t*>(data), bytesize);
+#endif
+        mapped = false;
+    }
+    owned.clear();
+    owned.shrink_to_fit();
+    data = nullptr;
+    bytesize = 0;
+    header = nullptr;
+}
+
+bool MappedMeshFile::Verify() const
+{
+    return header != nullptr && HashContent(data, bytesize) == header->content_hash;
+}
+
+bool MappedMeshFile::DecodeIndices(void* destination) const
+{
+    return header != nullptr && DecodeMeshFileIndices(destination, header->index_format, header->index_count, header->index_encoding,
+                                                      IndexData(), (std::size_t)header->indices.bytesize);
+}
+
+bool MappedMeshFile::Validate()
+{
+    header = ValidateImage(data, bytesize);
+    return header != nullptr;
+}
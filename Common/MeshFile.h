@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//-----------------------------MeshFile--------------------------------
+// 二进制网格文件 (.mesh): 文件头, submesh 表, 拆段表, 顶点流, 索引, 顶点 remap, meshlet
+// 所有偏移相对文件开头, 每一块数据都按 mesh_file_alignment 对齐
+// 加载时把整个文件映射到内存, 只检查文件头和各块的范围, 顶点直接作为上传的源数据, 没有解析和拷贝
+// 索引可以原样存放 (同样直接上传), 也可以用 IndexBuffer.h 的编码压缩存放, 加载时解压
+// 文件按小端存放, 结构体只用定长字段并且没有隐式填充, 改动布局时必须增加 mesh_file_version
+constexpr std::uint32_t mesh_file_magic = 0x4853454D; // "MESH"
+constexpr std::uint32_t mesh_file_version = 3;
+constexpr std::uint32_t mesh_file_alignment = 64;
+constexpr std::uint32_t mesh_file_max_streams = 4;
+constexpr std::uint32_t mesh_file_name_size = 32;
+
+// MeshFileHeader::index_encoding
+constexpr std::uint32_t mesh_index_encoding_none = 0;
+// EncodeIndexBuffer 的输出, 解压后是 index_format 的索引
+constexpr std::uint32_t mesh_index_encoding_compact = 1;
+
+struct MeshFileRange
+{
+    std::uint64_t offset = 0;
+    std::uint64_t bytesize = 0;
+};
+
+struct MeshFileStream
+{
+    MeshFileRange data;
+    std::uint32_t stride = 0;
+    // DXGI_FORMAT 的值, 只记录不解释
+    std::uint32_t format = 0;
+};
+
+struct MeshFileHeader
+{
+    std::uint32_t magic = mesh_file_magic;
+    std::uint32_t version = mesh_file_version;
+    std::uint64_t file_bytesize = 0;
+
+    std::uint32_t vertex_count = 0;
+    std::uint32_t stream_count = 0;
+    MeshFileStream streams[mesh_file_max_streams];
+
+    std::uint32_t index_count = 0;
+    // DXGI_FORMAT_R16_UINT 或 DXGI_FORMAT_R32_UINT
+    std::uint32_t index_format = 0;
+    std::uint32_t index_encoding = mesh_index_encoding_none;
+    // 保持后面的字段 8 字节对齐, 写 0
+    std::uint32_t reserved = 0;
+    // 压缩时是编码后的字节
+    MeshFileRange indices;
+
+    std::uint32_t submesh_count = 0;
+    std::uint32_t segment_count = 0;
+    MeshFileRange submeshes;
+    MeshFileRange segments;
+
+    // 原始顶点编号 -> 文件中的编号, 可以为空
+    MeshFileRange vertex_remap;
+
+    // 各 submesh LOD0 的 meshlet 依次存放, 布局见 Meshlet.h, 可以直接作为 StructuredBuffer 上传
+    // meshlet_vertices 中是整个顶点缓冲中的编号, meshlet_primitives 每个三角形一个 uint
+    std::uint32_t meshlet_count = 0;
+    std::uint32_t meshlet_triangle_count = 0;
+    MeshFileRange meshlets;
+    MeshFileRange meshlet_bounds;
+    MeshFileRange meshlet_vertices;
+    MeshFileRange meshlet_primitives;
+
+    // 位置的解压常量, 见 VertexCompression.h 的 PositionQuantization
+    float position_scale[3] = {1.0f, 1.0f, 1.0f};
+    float position_offset[3] = {0.0f, 0.0f, 0.0f};
+
+    // 文件头之后所有字节的哈希, 只在 MappedMeshFile::Verify 中检查
+    std::uint64_t content_hash = 0;
+};
+
+// 对应 SubmeshGeometry, 每级 LOD 各占一项, name 相同, 加载时以 LodDrawargName(name, lod) 的 StringId 为键放进 drawargs
+struct MeshFileSubmesh
+{
+    char name[mesh_file_name_size] = {};
+    std::uint32_t lod = 0;
+    std::uint32_t index_count = 0;
+    std::uint32_t start_index_location = 0;
+    std::int32_t base_vertex_location = 0;
+    std::uint32_t lod_count = 1;
+    float lod_error = 0.0f;
+    // 在拆段表中的范围, segment_count 为 0 时整个 submesh 一次绘制
+    std::uint32_t segment_offset = 0;
+    std::uint32_t segment_count = 0;
+    float box_center[3] = {};
+    float box_extents[3] = {};
+    float sphere_center[3] = {};
+    float sphere_radius = 0.0f;
+    // 在 meshlet 表中的范围, 只有 LOD0 有 meshlet
+    std::uint32_t meshlet_offset = 0;
+    std::uint32_t meshlet_count = 0;
+};
+
+struct MeshFileSegment
+{
+    std::uint32_t index_count = 0;
+    std::uint32_t start_index_location = 0;
+    std::int32_t base_vertex_location = 0;
+};
+
+// 对应 Meshlet.h 的 Meshlet, 偏移是在整个文件的 meshlet_vertices / meshlet_primitives 中的位置
+struct MeshFileMeshlet
+{
+    std::uint32_t vertex_count = 0;
+    std::uint32_t vertex_offset = 0;
+    std::uint32_t primitive_count = 0;
+    std::uint32_t primitive_offset = 0;
+};
+
+// 对应 Meshlet.h 的 MeshletBounds
+struct MeshFileMeshletBounds
+{
+    float center[3] = {};
+    float radius = 0.0f;
+    float cone_axis[3] = {0.0f, 0.0f, 1.0f};
+    float cone_cutoff = 1.0f;
+    float cone_apex[3] = {};
+    float padding = 0.0f;
+};
+
+static_assert(sizeof(MeshFileHeader) == 312, "MeshFileHeader layout changed, bump mesh_file_version");
+static_assert(sizeof(MeshFileSubmesh) == 112, "MeshFileSubmesh layout changed, bump mesh_file_version");
+static_assert(sizeof(MeshFileSegment) == 12, "MeshFileSegment layout changed, bump mesh_file_version");
+static_assert(sizeof(MeshFileMeshlet) == 16, "MeshFileMeshlet layout changed, bump mesh_file_version");
+static_assert(sizeof(MeshFileMeshletBounds) == 48, "MeshFileMeshletBounds layout changed, bump mesh_file_version");
+static_assert(std::is_trivially_copyable_v<MeshFileHeader> && std::is_trivially_copyable_v<MeshFileSubmesh>);
+
+//-----------------------------writing--------------------------------
+// 写文件之前在内存中的网格数据, 由离线转换工具或者 MeshPipeline 生成
+struct MeshFileContent
+{
+    struct Stream
+    {
+        std::vector<std::uint8_t> data;
+        std::uint32_t stride = 0;
+        std::uint32_t format = 0;
+    };
+
+    std::uint32_t vertex_count = 0;
+    std::vector<Stream> streams;
+
+    std::uint32_t index_count = 0;
+    std::uint32_t index_format = 0;
+    std::uint32_t index_encoding = mesh_index_encoding_none;
+    // 压缩时是编码后的字节
+    std::vector<std::uint8_t> indices;
+
+    std::vector<MeshFileSubmesh> submeshes;
+    std::vector<MeshFileSegment> segments;
+    std::vector<std::uint32_t> vertex_remap;
+
+    std::vector<MeshFileMeshlet> meshlets;
+    std::vector<MeshFileMeshletBounds> meshlet_bounds;
+    std::vector<std::uint32_t> meshlet_vertices;
+    std::vector<std::uint32_t> meshlet_primitives;
+
+    float position_scale[3] = {1.0f, 1.0f, 1.0f};
+    float position_offset[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// name 超过 mesh_file_name_size - 1 个字符时截断
+void SetMeshFileName(MeshFileSubmesh& submesh, const std::string& name);
+
+// index_format 对应的每个索引的字节数, 不是 R16_UINT/R32_UINT 时返回 0
+std::uint32_t MeshFileIndexBytesize(std::uint32_t index_format);
+
+// 把 .mesh 中的索引还原成 index_format 的格式, destination 至少 index_count * MeshFileIndexBytesize(index_format) 字节
+// 没有压缩时直接拷贝, 数据损坏时返回 false
+bool DecodeMeshFileIndices(void* destination, std::uint32_t index_format, std::uint32_t index_count,
+                           std::uint32_t index_encoding, const void* data, std::size_t bytesize);
+
+// 按文件布局排好的完整字节, 可以直接写盘, 也可以交给 MappedMeshFile::Adopt
+std::vector<std::uint8_t> SerializeMeshFile(const MeshFileContent& content);
+
+// 先写临时文件再替换, 失败时返回 false
+bool WriteMeshFile(const std::wstring& filename, const std::vector<std::uint8_t>& image);
+
+// 把文件读进内存再逐块拷贝出来, 是映射加载要替代的做法, 用于对比加载时间
+// 文件不存在或格式不对时返回 false
+bool ReadMeshFile(const std::wstring& filename, MeshFileContent& content);
+
+//-----------------------------MappedMeshFile--------------------------------
+// 只读映射 .mesh 文件, 返回的指针在 Close 或析构之前一直有效
+class MappedMeshFile
+{
+    public:
+        MappedMeshFile() = default;
+        ~MappedMeshFile();
+
+        MappedMeshFile(const MappedMeshFile& rhs) = delete;
+        MappedMeshFile& operator=(const MappedMeshFile& rhs) = delete;
+
+        // 文件不存在, 版本不同或者范围越界时返回 false, 不会抛异常
+        bool Open(const std::wstring& filename);
+        // 使用内存中按文件布局排好的数据, 用于还没有转换好的网格
+        bool Adopt(std::vector<std::uint8_t> image);
+        void Close();
+
+        // 重新计算 content_hash, 要读一遍整个文件, 只用于检查损坏
+        bool Verify() const;
+
+        bool IsOpen() const { return header != nullptr; }
+        const MeshFileHeader& Header() const { return *header; }
+        std::size_t Bytesize() const { return bytesize; }
+
+        const void* StreamData(std::uint32_t stream) const { return At(header->streams[stream].data); }
+        // 索引压缩时是编码后的字节, 要用 DecodeIndices 解压后才能上传
+        const void* IndexData() const { return At(header->indices); }
+        bool IndicesEncoded() const { return header->index_encoding != mesh_index_encoding_none; }
+        // 解压后的索引字节数
+        std::size_t DecodedIndexBytesize() const { return (std::size_t)header->index_count * MeshFileIndexBytesize(header->index_format); }
+        // destination 至少 DecodedIndexBytesize() 字节, 数据损坏时返回 false
+        bool DecodeIndices(void* destination) const;
+        const MeshFileSubmesh* Submeshes() const { return static_cast<const MeshFileSubmesh*>(At(header->submeshes)); }
+        const MeshFileSegment* Segments() const { return static_cast<const MeshFileSegment*>(At(header->segments)); }
+        const std::uint32_t* VertexRemap() const { return static_cast<const std::uint32_t*>(At(header->vertex_remap)); }
+        const MeshFileMeshlet* Meshlets() const { return static_cast<const MeshFileMeshlet*>(At(header->meshlets)); }
+        const MeshFileMeshletBounds* MeshletBounds() const { return static_cast<const MeshFileMeshletBounds*>(At(header->meshlet_bounds)); }
+        const std::uint32_t* MeshletVertices() const { return static_cast<const std::uint32_t*>(At(header->meshlet_vertices)); }
+        const std::uint32_t* MeshletPrimitives() const { return static_cast<const std::uint32_t*>(At(header->meshlet_primitives)); }
+
+    private:
+        bool Validate();
+        const void* At(const MeshFileRange& range) const
+        {
+            return range.bytesize != 0 ? data + range.offset : nullptr;
+        }
+
+    private:
+        const std::uint8_t* data = nullptr;
+        std::size_t bytesize = 0;
+        const MeshFileHeader* header = nullptr;
+
+        // Open 映射的视图, 文件句柄在映射之后就关闭了
+        bool mapped = false;
+        // Adopt 时使用
+        std::vector<std::uint8_t> owned;
+};
@@ -0,0 +1,949 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+#include "JobSystem.h"
+#include "Json.h"
+#include "MeshImport.h"
+
+using namespace DirectX;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const XMFLOAT4 white_color = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    // 同名的组加上 _2, _3 ... 区分, 否则加载时 drawargs 会互相覆盖
+    void MakeSubmeshNamesUnique(std::vector<MeshPipelineSubmesh>& submeshes)
+    {
+        std::unordered_map<std::string, std::uint32_t> counts;
+        for(MeshPipelineSubmesh& submesh : submeshes)
+        {
+            const std::uint32_t count = ++counts[submesh.name];
+            if(count > 1)
+                submesh.name += "_" + std::to_string(count);
+        }
+    }
+
+    bool ValidateIndices(const ImportedMesh& mesh, std::string* error)
+    {
+        const std::size_t vertex_count = mesh.positions.size();
+        for(std::uint32_t index : mesh.indices)
+        {
+            if(index >= vertex_count)
+            {
+                if(error != nullptr)
+                    *error = "vertex index " + std::to_string(index) + " out of range";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Fail(std::string* error, const std::string& message)
+    {
+        if(error != nullptr)
+            *error = message;
+        return false;
+    }
+
+    //-----------------------------OBJ--------------------------------
+    struct ObjCorner
+    {
+        // 正数为从 0 开始的绝对编号, relative 时为相对块开头的编号, 可能为负
+        std::int64_t index = 0;
+        bool relative = false;
+    };
+
+    struct ObjGroup
+    {
+        // 块内 indices 的位置
+        std::uint32_t first_index = 0;
+        std::string name;
+    };
+
+    // 一个块的解析结果, 相对索引要等前面的块合并之后才知道绝对编号
+    struct ObjChunk
+    {
+        std::vector<XMFLOAT3> positions;
+        // 块中出现带颜色的顶点之后和 positions 一样长
+        std::vector<XMFLOAT4> colors;
+        std::vector<std::uint32_t> indices;
+        // (indices 中的位置, 相对块开头的顶点编号)
+        std::vector<std::pair<std::uint32_t, std::int64_t>> relative;
+        std::vector<ObjGroup> groups;
+        std::uint32_t line_count = 0;
+
+        // 出错的行, 从块开头算起, 从 1 开始
+        std::uint32_t error_line = 0;
+        const char* error = nullptr;
+    };
+
+    const char* SkipSpaces(const char* p, const char* end)
+    {
+        while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        return p;
+    }
+
+    const char* SkipToken(const char* p, const char* end)
+    {
+        while(p < end && *p != ' ' && *p != '\t' && *p != '\r')
+            ++p;
+        return p;
+    }
+
+    bool ParseFloat(const char*& p, const char* end, float& value)
+    {
+        p = SkipSpaces(p, end);
+        if(p < end && *p == '+')
+            ++p;
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if(result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    bool ParseObjVertex(ObjChunk& chunk, const char* p, const char* end)
+    {
+        float values[7];
+        std::uint32_t value_count = 0;
+        while(value_count < 7 && ParseFloat(p, end, values[value_count]))
+            ++value_count;
+        if(value_count < 3)
+            return false;
+
+        chunk.positions.push_back(XMFLOAT3(values[0], values[1], -values[2]));
+        // x y z r g b 或 x y z w r g b; 只有 4 个值时第 4 个是 w, 忽略
+        if(value_count >= 6)
+        {
+            const float* rgb = value_count == 7 ? values + 4 : values + 3;
+            chunk.colors.resize(chunk.positions.size() - 1, white_color);
+            chunk.colors.push_back(XMFLOAT4(rgb[0], rgb[1], rgb[2], 1.0f));
+        }
+        else if(!chunk.colors.empty())
+        {
+            chunk.colors.push_back(white_color);
+        }
+        return true;
+    }
+
+    void EmitObjCorner(ObjChunk& chunk, const ObjCorner& corner)
+    {
+        if(corner.relative)
+        {
+            chunk.relative.push_back({(std::uint32_t)chunk.indices.size(), corner.index});
+            chunk.indices.push_back(0);
+            return;
+        }
+        chunk.indices.push_back((std::uint32_t)corner.index);
+    }
+
+    // v/vt/vn 只取 v, 多边形按扇形拆成三角形
+    bool ParseObjFace(ObjChunk& chunk, std::vector<ObjCorner>& polygon, const char* p, const char* end)
+    {
+        polygon.clear();
+        for(;;)
+        {
+            p = SkipSpaces(p, end);
+            if(p >= end)
+                break;
+
+            std::int64_t value = 0;
+            const std::from_chars_result result = std::from_chars(p, end, value);
+            if(result.ec != std::errc() || value == 0 || value > 0xFFFFFFFFll)
+                return false;
+
+            ObjCorner corner;
+            if(value > 0)
+            {
+                corner.index = value - 1;
+            }
+            else
+            {
+                corner.index = (std::int64_t)chunk.positions.size() + value;
+                corner.relative = true;
+            }
+            polygon.push_back(corner);
+            p = SkipToken(result.ptr, end);
+        }
+        if(polygon.size() < 3)
+            return false;
+
+        for(std::size_t i = 1; i + 1 < polygon.size(); ++i)
+        {
+            EmitObjCorner(chunk, polygon[0]);
+            EmitObjCorner(chunk, polygon[i]);
+            EmitObjCorner(chunk, polygon[i + 1]);
+        }
+        return true;
+    }
+
+    void ParseObjChunk(ObjChunk& chunk, const char* begin, const char* end)
+    {
+        std::vector<ObjCorner> polygon;
+        for(const char* line = begin; line < end;)
+        {
+            const char* line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+            if(line_end == nullptr)
+                line_end = end;
+            ++chunk.line_count;
+
+            const char* p = SkipSpaces(line, line_end);
+            const bool keyword_end = p + 1 >= line_end || p[1] == ' ' || p[1] == '\t';
+            if(p < line_end && keyword_end)
+            {
+                bool ok = true;
+                if(*p == 'v')
+                {
+                    ok = ParseObjVertex(chunk, p + 1, line_end);
+                }
+                else if(*p == 'f')
+                {
+                    ok = ParseObjFace(chunk, polygon, p + 1, line_end);
+                }
+                else if(*p == 'o' || *p == 'g')
+                {
+                    const char* name_begin = SkipSpaces(p + 1, line_end);
+                    const char* name_end = line_end;
+                    while(name_end > name_begin && (name_end[-1] == ' ' || name_end[-1] == '\t' || name_end[-1] == '\r'))
+                        --name_end;
+                    if(name_end > name_begin)
+                        chunk.groups.push_back({(std::uint32_t)chunk.indices.size(), std::string(name_begin, name_end)});
+                }
+
+                if(!ok)
+                {
+                    chunk.error = *p == 'v' ? "invalid vertex" : "invalid face";
+                    chunk.error_line = chunk.line_count;
+                    return;
+                }
+            }
+            line = line_end + 1;
+        }
+    }
+
+    // 按顺序把块接到结果后面, 同时把相对索引换成绝对编号
+    class ObjMerger
+    {
+        public:
+            ObjMerger(ImportedMesh& mesh, std::string default_name)
+            :mesh(mesh), group_name(std::move(default_name))
+            {
+            }
+
+            bool Merge(const ObjChunk& chunk, std::string* error)
+            {
+                if(chunk.error != nullptr)
+                    return Fail(error, std::string(chunk.error) + " at line " + std::to_string(line_count + chunk.error_line));
+
+                const std::size_t vertex_base = mesh.positions.size();
+                const std::size_t index_base = mesh.indices.size();
+                for(const ObjGroup& group : chunk.groups)
+                    StartGroup(index_base + group.first_index, group.name);
+
+                mesh.positions.insert(mesh.positions.end(), chunk.positions.begin(), chunk.positions.end());
+                if(!chunk.colors.empty() || !mesh.colors.empty())
+                {
+                    mesh.colors.resize(vertex_base, white_color);
+                    if(chunk.colors.empty())
+                        mesh.colors.resize(mesh.positions.size(), white_color);
+                    else
+                        mesh.colors.insert(mesh.colors.end(), chunk.colors.begin(), chunk.colors.end());
+                }
+
+                mesh.indices.insert(mesh.indices.end(), chunk.indices.begin(), chunk.indices.end());
+                for(const auto& fixup : chunk.relative)
+                {
+                    const std::int64_t index = (std::int64_t)vertex_base + fixup.second;
+                    if(index < 0)
+                        return Fail(error, "relative vertex index before the first vertex");
+                    mesh.indices[index_base + fixup.first] = (std::uint32_t)index;
+                }
+
+                line_count += chunk.line_count;
+                return true;
+            }
+
+            void Finish()
+            {
+                StartGroup(mesh.indices.size(), std::string());
+            }
+
+        private:
+            void StartGroup(std::size_t first_index, std::string name)
+            {
+                if(first_index > group_start)
+                    mesh.submeshes.push_back({group_name, (std::uint32_t)group_start, (std::uint32_t)(first_index - group_start)});
+                group_start = first_index;
+                group_name = std::move(name);
+            }
+
+        private:
+            ImportedMesh& mesh;
+            std::string group_name;
+            std::size_t group_start = 0;
+            std::uint64_t line_count = 0;
+    };
+
+    // 把 [0, bytesize) 在行边界切成大约 obj_chunk_bytesize 的块
+    std::vector<std::pair<std::size_t, std::size_t>> SplitLines(const char* text, std::size_t bytesize)
+    {
+        std::vector<std::pair<std::size_t, std::size_t>> chunks;
+        std::size_t begin = 0;
+        while(begin < bytesize)
+        {
+            std::size_t end = std::min(begin + obj_chunk_bytesize, bytesize);
+            const char* newline = static_cast<const char*>(std::memchr(text + end - 1, '\n', bytesize - end + 1));
+            end = newline != nullptr ? (std::size_t)(newline - text) + 1 : bytesize;
+            chunks.push_back({begin, end});
+            begin = end;
+        }
+        return chunks;
+    }
+
+    //-----------------------------glTF--------------------------------
+    constexpr std::uint32_t glb_magic = 0x46546C67;       // "glTF"
+    constexpr std::uint32_t glb_chunk_json = 0x4E4F534A;  // "JSON"
+    constexpr std::uint32_t glb_chunk_bin = 0x004E4942;   // "BIN\0"
+    constexpr std::uint32_t gltf_mode_triangles = 4;
+
+    enum GltfComponentType : std::uint32_t
+    {
+        gltf_byte = 5120,
+        gltf_unsigned_byte = 5121,
+        gltf_short = 5122,
+        gltf_unsigned_short = 5123,
+        gltf_unsigned_int = 5125,
+        gltf_float = 5126
+    };
+
+    struct GltfDocument
+    {
+        JsonValue json;
+        std::vector<std::vector<std::uint8_t>> buffers;
+    };
+
+    struct GltfAccessor
+    {
+        const std::uint8_t* data = nullptr;
+        std::uint32_t count = 0;
+        std::uint32_t stride = 0;
+        std::uint32_t component_type = 0;
+        std::uint32_t component_count = 0;
+        bool normalized = false;
+    };
+
+    // 一个 primitive 转换后在结果中的位置
+    struct GltfPrimitiveJob
+    {
+        GltfAccessor positions;
+        GltfAccessor colors;
+        GltfAccessor indices;
+        XMFLOAT4X4 world;
+        std::uint32_t vertex_base = 0;
+        std::uint32_t index_base = 0;
+        std::uint32_t index_count = 0;
+    };
+
+    bool ReadFile(const std::filesystem::path& path, std::vector<std::uint8_t>& data)
+    {
+        std::ifstream fin(path, std::ios::binary | std::ios::ate);
+        if(!fin)
+            return false;
+        data.resize((std::size_t)fin.tellg());
+        fin.seekg(0);
+        fin.read((char*)data.data(), (std::streamsize)data.size());
+        return (bool)fin;
+    }
+
+    bool DecodeBase64(std::string_view text, std::vector<std::uint8_t>& data)
+    {
+        auto decode = [](char c) -> int {
+            if(c >= 'A' && c <= 'Z') return c - 'A';
+            if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if(c >= '0' && c <= '9') return c - '0' + 52;
+            if(c == '+' || c == '-') return 62;
+            if(c == '/' || c == '_') return 63;
+            return -1;
+        };
+
+        data.clear();
+        data.reserve(text.size() / 4 * 3);
+        std::uint32_t bits = 0;
+        std::uint32_t bit_count = 0;
+        for(char c : text)
+        {
+            if(c == '=')
+                break;
+            const int value = decode(c);
+            if(value < 0)
+                return false;
+            bits = (bits << 6) | (std::uint32_t)value;
+            bit_count += 6;
+            if(bit_count >= 8)
+            {
+                bit_count -= 8;
+                data.push_back((std::uint8_t)(bits >> bit_count));
+            }
+        }
+        return true;
+    }
+
+    bool LoadGltfDocument(const std::filesystem::path& path, GltfDocument& document, std::uint64_t& bytesize, std::string* error)
+    {
+        std::vector<std::uint8_t> file;
+        if(!ReadFile(path, file))
+            return Fail(error, "cannot read " + path.string());
+        bytesize = file.size();
+
+        // .glb: 12 字节文件头, 然后是 JSON 块和可选的 BIN 块, 每块 8 字节块头
+        std::string_view json_text((const char*)file.data(), file.size());
+        std::vector<std::uint8_t> glb_bin;
+        std::uint32_t magic = 0;
+        if(file.size() >= 12)
+            std::memcpy(&magic, file.data(), sizeof(magic));
+        if(magic == glb_magic)
+        {
+            json_text = {};
+            for(std::size_t offset = 12; offset + 8 <= file.size();)
+            {
+                std::uint32_t chunk_bytesize = 0;
+                std::uint32_t chunk_type = 0;
+                std::memcpy(&chunk_bytesize, file.data() + offset, sizeof(chunk_bytesize));
+                std::memcpy(&chunk_type, file.data() + offset + 4, sizeof(chunk_type));
+                offset += 8;
+                if(chunk_bytesize > file.size() - offset)
+                    return Fail(error, "truncated glb chunk");
+                if(chunk_type == glb_chunk_json)
+                    json_text = std::string_view((const char*)file.data() + offset, chunk_bytesize);
+                else if(chunk_type == glb_chunk_bin && glb_bin.empty())
+                    glb_bin.assign(file.data() + offset, file.data() + offset + chunk_bytesize);
+                offset += (chunk_bytesize + 3) & ~3u;
+            }
+        }
+
+        std::string json_error;
+        if(!JsonValue::Parse(json_text, document.json, &json_error))
+            return Fail(error, json_error);
+
+        const JsonValue& buffers = document.json["buffers"];
+        document.buffers.resize(buffers.Size());
+        for(std::size_t i = 0; i < buffers.Size(); ++i)
+        {
+            std::vector<std::uint8_t>& data = document.buffers[i];
+            const JsonValue& uri = buffers[i]["uri"];
+            if(!uri.IsString())
+            {
+                // 没有 uri 的第一个 buffer 指向 glb 的 BIN 块
+                data = std::move(glb_bin);
+            }
+            else if(uri.AsString().rfind("data:", 0) == 0)
+            {
+                const std::size_t comma = uri.AsString().find(',');
+                if(comma == std::string::npos || uri.AsString().find(";base64") > comma
+                    || !DecodeBase64(std::string_view(uri.AsString()).substr(comma + 1), data))
+                    return Fail(error, "unsupported data uri in buffer " + std::to_string(i));
+            }
+            else
+            {
+                if(!ReadFile(path.parent_path() / std::filesystem::u8path(uri.AsString()), data))
+                    return Fail(error, "cannot read buffer " + uri.AsString());
+                bytesize += data.size();
+            }
+
+            if(data.size() < buffers[i]["byteLength"].AsUint())
+                return Fail(error, "buffer " + std::to_string(i) + " is shorter than byteLength");
+        }
+        return true;
+    }
+
+    std::uint32_t ComponentBytesize(std::uint32_t component_type)
+    {
+        switch(component_type)
+        {
+            case gltf_byte:
+            case gltf_unsigned_byte: return 1;
+            case gltf_short:
+            case gltf_unsigned_short: return 2;
+            case gltf_unsigned_int:
+            case gltf_float: return 4;
+            default: return 0;
+        }
+    }
+
+    std::uint32_t ComponentCount(const std::string& type)
+    {
+        if(type == "SCALAR") return 1;
+        if(type == "VEC2") return 2;
+        if(type == "VEC3") return 3;
+        if(type == "VEC4") return 4;
+        return 0;
+    }
+
+    // 检查 accessor 引用的范围都在 buffer 里, 之后读取时不再检查
+    bool ResolveAccessor(const GltfDocument& document, const JsonValue& index, GltfAccessor& accessor, std::string* error)
+    {
+        const JsonValue& json = document.json["accessors"][index.AsUint(0xFFFFFFFF)];
+        if(!json.IsObject())
+            return Fail(error, "invalid accessor index");
+        if(json.Has("sparse"))
+            return Fail(error, "sparse accessors are not supported");
+
+        const JsonValue& view = document.json["bufferViews"][json["bufferView"].AsUint(0xFFFFFFFF)];
+        if(!view.IsObject())
+            return Fail(error, "accessor without a bufferView");
+        const std::uint32_t buffer = view["buffer"].AsUint(0xFFFFFFFF);
+        if(buffer >= document.buffers.size())
+            return Fail(error, "invalid buffer index");
+
+        accessor.count = json["count"].AsUint();
+        accessor.component_type = json["componentType"].AsUint();
+        accessor.component_count = ComponentCount(json["type"].AsString());
+        accessor.normalized = json["normalized"].AsBool();
+        const std::uint32_t element_bytesize = ComponentBytesize(accessor.component_type) * accessor.component_count;
+        if(element_bytesize == 0)
+            return Fail(error, "unsupported accessor type");
+        accessor.stride = view["byteStride"].AsUint(element_bytesize);
+
+        // byteOffset 可以省略, byteLength 必须有; 负数或者小数转成无符号数是未定义行为, 必须先检查
+        std::uint64_t view_offset = 0;
+        std::uint64_t view_bytesize = 0;
+        std::uint64_t offset = 0;
+        if((view.Has("byteOffset") && !view["byteOffset"].GetUint(view_offset)) ||
+           !view["byteLength"].GetUint(view_bytesize) ||
+           (json.Has("byteOffset") && !json["byteOffset"].GetUint(offset)))
+            return Fail(error, "invalid byteOffset or byteLength");
+
+        // 每一步都和剩下的大小比较, 不做可能溢出的加法; stride 和 count 都是 32 位, 乘积不会溢出
+        const std::uint64_t size = document.buffers[buffer].size();
+        const std::uint64_t needed = accessor.count == 0 ? 0 : (std::uint64_t)accessor.stride * (accessor.count - 1) + element_bytesize;
+        if(view_offset > size || view_bytesize > size - view_offset || offset > view_bytesize || needed > view_bytesize - offset)
+            return Fail(error, "accessor out of buffer range");
+
+        const std::vector<std::uint8_t>& data = document.buffers[buffer];
+
+        accessor.data = data.data() + view_offset + offset;
+        return true;
+    }
+
+    float ReadComponent(const std::uint8_t* p, std::uint32_t component_type, bool normalized)
+    {
+        switch(component_type)
+        {
+            case gltf_float:
+            {
+                float value;
+                std::memcpy(&value, p, sizeof(value));
+                return value;
+            }
+            case gltf_unsigned_byte:
+                return normalized ? *p / 255.0f : (float)*p;
+            case gltf_byte:
+                return normalized ? std::max(*(const std::int8_t*)p / 127.0f, -1.0f) : (float)*(const std::int8_t*)p;
+            case gltf_unsigned_short:
+            {
+                std::uint16_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return normalized ? value / 65535.0f : (float)value;
+            }
+            case gltf_short:
+            {
+                std::int16_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return normalized ? std::max(value / 32767.0f, -1.0f) : (float)value;
+            }
+            default:
+            {
+                std::uint32_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return (float)value;
+            }
+        }
+    }
+
+    std::uint32_t ReadIndex(const GltfAccessor& accessor, std::uint32_t i)
+    {
+        const std::uint8_t* p = accessor.data + (std::size_t)i * accessor.stride;
+        if(accessor.component_type == gltf_unsigned_byte)
+            return *p;
+        if(accessor.component_type == gltf_unsigned_short)
+        {
+            std::uint16_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        std::uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // glTF 的矩阵按列存放, 原样读进按行存放的 XMFLOAT4X4 正好是 DirectXMath 行向量约定下的矩阵
+    XMMATRIX NodeTransform(const JsonValue& node)
+    {
+        const JsonValue& matrix = node["matrix"];
+        if(matrix.Size() == 16)
+        {
+            XMFLOAT4X4 m;
+            for(std::uint32_t i = 0; i < 16; ++i)
+                m.m[i / 4][i % 4] = (float)matrix[i].AsNumber();
+            return XMLoadFloat4x4(&m);
+        }
+
+        const JsonValue& t = node["translation"];
+        const JsonValue& r = node["rotation"];
+        const JsonValue& s = node["scale"];
+        const XMMATRIX scaling = XMMatrixScaling((float)s[0].AsNumber(1.0), (float)s[1].AsNumber(1.0), (float)s[2].AsNumber(1.0));
+        const XMMATRIX rotation = XMMatrixRotationQuaternion(XMVectorSet((float)r[0].AsNumber(), (float)r[1].AsNumber(),
+                                                                         (float)r[2].AsNumber(), (float)r[3].AsNumber(1.0)));
+        const XMMATRIX translation = XMMatrixTranslation((float)t[0].AsNumber(), (float)t[1].AsNumber(), (float)t[2].AsNumber());
+        return XMMatrixMultiply(XMMatrixMultiply(scaling, rotation), translation);
+    }
+
+    struct GltfInstance
+    {
+        std::uint32_t mesh = 0;
+        XMFLOAT4X4 world;
+        std::string name;
+    };
+
+    // 展开默认场景的节点树, 没有场景时每个 mesh 用单位矩阵导入一次
+    // 节点图必须是森林: 一个节点被访问第二次说明有环或者有多个父节点, 返回 false
+    bool CollectInstances(const JsonValue& json, std::vector<GltfInstance>& instances, std::string* error)
+    {
+        const JsonValue& nodes = json["nodes"];
+        const JsonValue& scenes = json["scenes"];
+        if(scenes.Size() == 0)
+        {
+            for(std::uint32_t mesh = 0; mesh < json["meshes"].Size(); ++mesh)
+            {
+                GltfInstance instance;
+                instance.mesh = mesh;
+                XMStoreFloat4x4(&instance.world, XMMatrixIdentity());
+                instances.push_back(instance);
+            }
+            return true;
+        }
+
+        struct Pending
+        {
+            std::uint32_t node;
+            XMFLOAT4X4 parent;
+        };
+        std::vector<std::uint8_t> visited(nodes.Size(), 0);
+        std::vector<Pending> stack;
+        const JsonValue& roots = scenes[json["scene"].AsUint(0)]["nodes"];
+        for(std::size_t i = roots.Size(); i-- > 0;)
+        {
+            Pending root = {roots[i].AsUint(0xFFFFFFFF), {}};
+            XMStoreFloat4x4(&root.parent, XMMatrixIdentity());
+            stack.push_back(root);
+        }
+
+        while(!stack.empty())
+        {
+            const Pending pending = stack.back();
+            stack.pop_back();
+            const JsonValue& node = nodes[pending.node];
+            if(!node.IsObject())
+                continue;
+            if(visited[pending.node])
+                return Fail(error, "node " + std::to_string(pending.node) + " is reached twice, the node graph is not a tree");
+            visited[pending.node] = 1;
+
+            XMFLOAT4X4 world;
+            XMStoreFloat4x4(&world, XMMatrixMultiply(NodeTransform(node), XMLoadFloat4x4(&pending.parent)));
+            if(node["mesh"].IsNumber())
+            {
+                GltfInstance instance;
+                instance.mesh = node["mesh"].AsUint();
+                instance.world = world;
+                instance.name = node["name"].AsString();
+                instances.push_back(instance);
+            }
+
+            const JsonValue& children = node["children"];
+            for(std::size_t i = children.Size(); i-- > 0;)
+                stack.push_back({children[i].AsUint(0xFFFFFFFF), world});
+        }
+        return true;
+    }
+
+    void ConvertPrimitive(const GltfPrimitiveJob& job, ImportedMesh& mesh, std::atomic<bool>& index_error)
+    {
+        const XMMATRIX world = XMLoadFloat4x4(&job.world);
+        const GltfAccessor& positions = job.positions;
+        for(std::uint32_t i = 0; i < positions.count; ++i)
+        {
+            const std::uint8_t* p = positions.data + (std::size_t)i * positions.stride;
+            const std::uint32_t component = ComponentBytesize(positions.component_type);
+            XMVECTOR position = XMVectorSet(ReadComponent(p, positions.component_type, positions.normalized),
+                                            ReadComponent(p + component, positions.component_type, positions.normalized),
+                                            ReadComponent(p + 2 * component, positions.component_type, positions.normalized), 1.0f);
+            position = XMVector3TransformCoord(position, world);
+            XMFLOAT3& destination = mesh.positions[job.vertex_base + i];
+            XMStoreFloat3(&destination, position);
+            destination.z = -destination.z;
+        }
+
+        if(!mesh.colors.empty())
+        {
+            const GltfAccessor& colors = job.colors;
+            for(std::uint32_t i = 0; i < positions.count; ++i)
+            {
+                XMFLOAT4 color = white_color;
+                if(colors.data != nullptr && i < colors.count)
+                {
+                    const std::uint8_t* p = colors.data + (std::size_t)i * colors.stride;
+                    const std::uint32_t component = ComponentBytesize(colors.component_type);
+                    float* channels = &color.x;
+                    for(std::uint32_t c = 0; c < colors.component_count && c < 4; ++c)
+                        channels[c] = ReadComponent(p + c * component, colors.component_type, colors.normalized);
+                }
+                mesh.colors[job.vertex_base + i] = color;
+            }
+        }
+
+        std::uint32_t* indices = mesh.indices.data() + job.index_base;
+        for(std::uint32_t i = 0; i < job.index_count; ++i)
+        {
+            const std::uint32_t index = job.indices.data != nullptr ? ReadIndex(job.indices, i) : i;
+            if(index >= positions.count)
+                index_error = true;
+            indices[i] = job.vertex_base + std::min(index, positions.count - 1);
+        }
+    }
+}
+
+MeshPipelineInput ImportedMesh::PipelineInput() const
+{
+    MeshPipelineInput input;
+    input.positions = positions.data();
+    input.colors = colors.empty() ? nullptr : colors.data();
+    input.vertex_count = positions.size();
+    input.indices = indices.data();
+    input.index_count = indices.size();
+    input.submeshes = submeshes;
+    return input;
+}
+
+double ImportStats::MegabytesPerSecond() const
+{
+    return milliseconds > 0.0 ? (double)bytesize / (1024.0 * 1024.0) / (milliseconds / 1000.0) : 0.0;
+}
+
+bool ImportObj(const std::wstring& filename, JobSystem& jobs, ImportedMesh& mesh, ImportStats* stats, std::string* error)
+{
+    const Clock::time_point start = Clock::now();
+    const std::filesystem::path path(filename);
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return Fail(error, "cannot open " + path.string());
+
+    mesh = ImportedMesh();
+    ObjMerger merger(mesh, path.stem().string());
+    std::uint64_t bytes_read = 0;
+
+    // 两个缓冲轮流使用, 每批的最后一行可能不完整, 留到另一个缓冲的开头
+    // 缓冲不初始化, 只在一行超过一批的长度时才变大
+    struct ObjBatch
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t capacity = 0;
+        std::size_t bytesize = 0;
+    };
+    const std::size_t batch_bytesize = obj_chunk_bytesize * obj_chunks_per_batch;
+    auto read_batch = [&](ObjBatch& batch){
+        if(batch.capacity < batch.bytesize + batch_bytesize)
+        {
+            std::unique_ptr<char[]> data(new char[batch.bytesize + batch_bytesize]);
+            // 第一批时 batch.data 还是空指针
+            if(batch.bytesize != 0)
+                std::memcpy(data.get(), batch.data.get(), batch.bytesize);
+            batch.data = std::move(data);
+            batch.capacity = batch.bytesize + batch_bytesize;
+        }
+        file.read(batch.data.get() + batch.bytesize, (std::streamsize)batch_bytesize);
+        batch.bytesize += (std::size_t)file.gcount();
+        bytes_read += (std::uint64_t)file.gcount();
+    };
+
+    ObjBatch batches[2];
+    read_batch(batches[0]);
+    for(std::uint32_t current = 0; batches[current].bytesize != 0; current ^= 1)
+    {
+        ObjBatch& batch = batches[current];
+        ObjBatch& next = batches[current ^ 1];
+        const char* text = batch.data.get();
+        const bool last = file.eof();
+        std::size_t complete = batch.bytesize;
+        if(!last)
+        {
+            while(complete > 0 && text[complete - 1] != '\n')
+                --complete;
+        }
+
+        // 读下一批和解析, 合并这一批同时进行
+        next.bytesize = 0;
+        if(next.capacity < batch.bytesize - complete)
+        {
+            next.data.reset(new char[batch.bytesize - complete]);
+            next.capacity = batch.bytesize - complete;
+        }
+        if(batch.bytesize != complete)
+            std::memcpy(next.data.get(), text + complete, batch.bytesize - complete);
+        next.bytesize = batch.bytesize - complete;
+        JobSystem::JobHandle read_job = nullptr;
+        if(!last)
+            read_job = jobs.Schedule("obj read", [&]{ read_batch(next); });
+
+        const std::vector<std::pair<std::size_t, std::size_t>> ranges = SplitLines(text, complete);
+        std::vector<ObjChunk> chunks(ranges.size());
+        jobs.ParallelFor((std::uint32_t)ranges.size(), 1, [&](std::uint32_t begin, std::uint32_t end){
+            for(std::uint32_t i = begin; i < end; ++i)
+                ParseObjChunk(chunks[i], text + ranges[i].first, text + ranges[i].second);
+        });
+
+        bool merged = true;
+        for(const ObjChunk& chunk : chunks)
+        {
+            merged = merged && merger.Merge(chunk, error);
+        }
+        if(read_job != nullptr)
+            jobs.Wait(read_job);
+        if(!merged)
+            return false;
+        batch.bytesize = 0;
+    }
+    merger.Finish();
+    MakeSubmeshNamesUnique(mesh.submeshes);
+
+    if(mesh.positions.empty())
+        return Fail(error, "no vertices");
+    if(mesh.indices.empty())
+        return Fail(error, "no faces");
+    if(!ValidateIndices(mesh, error))
+        return false;
+
+    if(stats != nullptr)
+    {
+        stats->bytesize = bytes_read;
+        stats->milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    return true;
+}
+
+bool ImportGltf(const std::wstring& filename, JobSystem& jobs, ImportedMesh& mesh, ImportStats* stats, std::string* error)
+{
+    const Clock::time_point start = Clock::now();
+    GltfDocument document;
+    std::uint64_t bytesize = 0;
+    if(!LoadGltfDocument(std::filesystem::path(filename), document, bytesize, error))
+        return false;
+
+    // 先确定每个 primitive 在结果中的位置, 再并行转换
+    mesh = ImportedMesh();
+    std::vector<GltfPrimitiveJob> primitive_jobs;
+    std::uint64_t vertex_total = 0;
+    std::uint64_t index_total = 0;
+    bool has_colors = false;
+    const JsonValue& meshes = document.json["meshes"];
+    std::vector<GltfInstance> instances;
+    if(!CollectInstances(document.json, instances, error))
+        return false;
+    for(const GltfInstance& instance : instances)
+    {
+        const JsonValue& gltf_mesh = meshes[instance.mesh];
+        const std::uint64_t first_index = index_total;
+        const JsonValue& primitives = gltf_mesh["primitives"];
+        for(std::size_t p = 0; p < primitives.Size(); ++p)
+        {
+            const JsonValue& primitive = primitives[p];
+            const JsonValue& attributes = primitive["attributes"];
+            if(primitive["mode"].AsUint(gltf_mode_triangles) != gltf_mode_triangles || !attributes.Has("POSITION"))
+                continue;
+
+            GltfPrimitiveJob job;
+            job.world = instance.world;
+            if(!ResolveAccessor(document, attributes["POSITION"], job.positions, error))
+                return false;
+            if(job.positions.component_count != 3)
+                return Fail(error, "POSITION must be VEC3");
+            if(attributes.Has("COLOR_0"))
+            {
+                if(!ResolveAccessor(document, attributes["COLOR_0"], job.colors, error))
+                    return false;
+                has_colors = true;
+            }
+            if(primitive.Has("indices"))
+            {
+                if(!ResolveAccessor(document, primitive["indices"], job.indices, error))
+                    return false;
+                if(job.indices.component_count != 1 || job.indices.component_type == gltf_float
+                    || job.indices.component_type == gltf_byte || job.indices.component_type == gltf_short)
+                    return Fail(error, "invalid index accessor");
+            }
+            job.index_count = job.indices.data != nullptr ? job.indices.count : job.positions.count;
+            job.index_count -= job.index_count % 3;
+            if(job.positions.count == 0 || job.index_count == 0)
+                continue;
+
+            job.vertex_base = (std::uint32_t)vertex_total;
+            job.index_base = (std::uint32_t)index_total;
+            vertex_total += job.positions.count;
+            index_total += job.index_count;
+            if(vertex_total > 0xFFFFFFFFull || index_total > 0xFFFFFFFFull)
+                return Fail(error, "mesh too large");
+            primitive_jobs.push_back(job);
+        }
+
+        if(index_total > first_index)
+        {
+            std::string name = gltf_mesh["name"].AsString();
+            if(name.empty())
+                name = instance.name.empty() ? "mesh" + std::to_string(instance.mesh) : instance.name;
+            mesh.submeshes.push_back({name, (std::uint32_t)first_index, (std::uint32_t)(index_total - first_index)});
+        }
+    }
+    MakeSubmeshNamesUnique(mesh.submeshes);
+    if(index_total == 0)
+        return Fail(error, "no triangles");
+
+    mesh.positions.resize((std::size_t)vertex_total);
+    mesh.colors.resize(has_colors ? (std::size_t)vertex_total : 0);
+    mesh.indices.resize((std::size_t)index_total);
+    std::atomic<bool> index_error = false;
+    jobs.ParallelFor((std::uint32_t)primitive_jobs.size(), 1, [&](std::uint32_t begin, std::uint32_t end){
+        for(std::uint32_t i = begin; i < end; ++i)
+            ConvertPrimitive(primitive_jobs[i], mesh, index_error);
+    });
+    if(index_error)
+        return Fail(error, "vertex index out of range");
+
+    if(stats != nullptr)
+    {
+        stats->bytesize = bytesize;
+        stats->milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    return true;
+}
+
+bool ImportMesh(const std::wstring& filename, JobSystem& jobs, ImportedMesh& mesh, ImportStats* stats, std::string* error)
+{
+    std::wstring extension = std::filesystem::path(filename).extension().wstring();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](wchar_t c){ return (wchar_t)std::towlower(c); });
+    if(extension == L".obj")
+        return ImportObj(filename, jobs, mesh, stats, error);
+    if(extension == L".gltf" || extension == L".glb")
+        return ImportGltf(filename, jobs, mesh, stats, error);
+    return Fail(error, "unsupported file type");
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "MeshPipeline.h"
+
+class JobSystem;
+
+//-----------------------------MeshImport--------------------------------
+// 读取 OBJ 和 glTF 2.0 (.gltf / .glb) 中的三角形网格, 结果直接交给 ProcessMesh
+// 只导入位置和顶点颜色 (MeshGeometry 只有这两个流), 法线/uv 不同而位置相同的角在这里就合成一个顶点,
+// 其余重复的顶点由 ProcessMesh 合并
+// 两种格式都是右手系, 逆时针为正面; 导入时 z 取反, 正好变成 D3D 默认的左手系顺时针, 索引顺序不变
+struct ImportedMesh
+{
+    std::vector<DirectX::XMFLOAT3> positions;
+    // 和 positions 一样长, 文件中没有顶点颜色时为空
+    std::vector<DirectX::XMFLOAT4> colors;
+    std::vector<std::uint32_t> indices;
+    // OBJ 按 o/g 分组, glTF 按节点引用的 mesh, 每个都不为空
+    std::vector<MeshPipelineSubmesh> submeshes;
+
+    MeshPipelineInput PipelineInput() const;
+};
+
+struct ImportStats
+{
+    // 读取的文件字节数, glTF 包括外部的 buffer 文件
+    std::uint64_t bytesize = 0;
+    double milliseconds = 0.0;
+
+    double MegabytesPerSecond() const;
+};
+
+// OBJ 按块流式读取, 每块在行边界切开后并行解析, 读下一批块和解析当前这批同时进行
+// 文本占用的内存不超过 2 * obj_chunk_bytesize * obj_chunks_per_batch, 和文件大小无关
+constexpr std::size_t obj_chunk_bytesize = 4 << 20;
+constexpr std::uint32_t obj_chunks_per_batch = 16;
+
+// 出错时返回 false, error 为原因 (OBJ 包括行号); 没有三角形的文件也算出错
+// 支持 v (可以带 rgb 顶点颜色), f (多边形按扇形三角化, 支持负数的相对索引), o, g; 其余的行忽略
+bool ImportObj(const std::wstring& filename, JobSystem& jobs, ImportedMesh& mesh,
+               ImportStats* stats = nullptr, std::string* error = nullptr);
+
+// 支持 data: URI 内嵌的 buffer, .glb 的 BIN 块和外部 .bin 文件
+// 从默认场景的节点树展开, 位置经过节点变换, 节点图有环或者一个节点有多个父节点时出错; 只导入 mode 为 TRIANGLES 的 primitive, 不支持 sparse accessor
+// 各 primitive 的数据在 jobs 上并行转换, 直接写进结果中预先分好的位置
+bool ImportGltf(const std::wstring& filename, JobSystem& jobs, ImportedMesh& mesh,
+                ImportStats* stats = nullptr, std::string* error = nullptr);
+
+// 按扩展名 (.obj / .gltf / .glb, 不区分大小写) 选择导入函数
+bool ImportMesh(const std::wstring& filename, JobSystem& jobs, ImportedMesh& mesh,
+                ImportStats* stats = nullptr, std::string* error = nullptr);
@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "MeshOptimizer.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // 每个顶点用到的三角形列表, 紧凑存储: triangles[offsets[v] .. offsets[v + 1])
+    struct TriangleAdjacency
+    {
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> triangles;
+        std::vector<std::uint32_t> counts;
+    };
+
+    template<typename T>
+    void BuildAdjacency(TriangleAdjacency& adjacency, const T* indices, std::size_t index_count, std::size_t vertex_count)
+    {
+        adjacency.counts.assign(vertex_count, 0);
+        for(std::size_t i = 0; i < index_count; ++i)
+            ++adjacency.counts[indices[i]];
+
+        adjacency.offsets.resize(vertex_count + 1);
+        std::uint32_t offset = 0;
+        for(std::size_t v = 0; v < vertex_count; ++v)
+        {
+            adjacency.offsets[v] = offset;
+            offset += adjacency.counts[v];
+        }
+        adjacency.offsets[vertex_count] = offset;
+
+        adjacency.triangles.resize(index_count);
+        std::vector<std::uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for(std::size_t i = 0; i < index_count; ++i)
+            adjacency.triangles[cursor[indices[i]]++] = (std::uint32_t)(i / 3);
+    }
+
+    // 每次 miss 时间戳加一, 顶点进入缓存后经过 cache_size 次 miss 被挤出
+    class FifoCache
+    {
+        public:
+            FifoCache(std::size_t vertex_count, std::uint32_t cache_size)
+            :cache_time(vertex_count, 0), timestamp(cache_size + 1), cache_size(cache_size)
+            {
+            }
+
+            // miss 时返回 1
+            std::uint32_t Access(std::uint32_t v)
+            {
+                if(timestamp - cache_time[v] <= cache_size)
+                    return 0;
+                cache_time[v] = timestamp++;
+                return 1;
+            }
+
+            void Flush() { timestamp += cache_size + 1; }
+
+        private:
+            std::vector<std::uint32_t> cache_time;
+            std::uint32_t timestamp;
+            std::uint32_t cache_size;
+    };
+
+    XMVECTOR LoadPosition(const void* positions, std::uint32_t stride, std::size_t index)
+    {
+        return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(static_cast<const std::uint8_t*>(positions) + index * stride));
+    }
+}
+
+//-----------------------------analyze--------------------------------
+template<typename T>
+VertexCacheStats AnalyzeVertexCache(const T* indices, std::size_t index_count, std::size_t vertex_count,
+                                    std::uint32_t cache_size, VertexCacheModel model)
+{
+    VertexCacheStats stats;
+    stats.triangle_count = (std::uint32_t)(index_count / 3);
+
+    std::vector<std::uint8_t> used(vertex_count, 0);
+    std::uint32_t misses = 0;
+
+    if(model == VertexCacheModel::FIFO)
+    {
+        FifoCache cache(vertex_count, cache_size);
+        for(std::size_t i = 0; i < index_count; ++i)
+        {
+            used[indices[i]] = 1;
+            misses += cache.Access(indices[i]);
+        }
+    }
+    else
+    {
+        // 最近使用的在前面
+        std::vector<std::uint32_t> cache;
+        cache.reserve(cache_size + 1);
+        for(std::size_t i = 0; i < index_count; ++i)
+        {
+            const std::uint32_t v = indices[i];
+            used[v] = 1;
+            auto it = std::find(cache.begin(), cache.end(), v);
+            if(it == cache.end())
+            {
+                ++misses;
+                cache.insert(cache.begin(), v);
+                if(cache.size() > cache_size)
+                    cache.pop_back();
+            }
+            else
+            {
+                std::rotate(cache.begin(), it, it + 1);
+            }
+        }
+    }
+
+    const std::size_t used_count = std::count(used.begin(), used.end(), (std::uint8_t)1);
+
+    stats.vertices_transformed = misses;
+    stats.acmr = stats.triangle_count == 0 ? 0.0f : (float)misses / (float)stats.triangle_count;
+    stats.atvr = used_count == 0 ? 0.0f : (float)misses / (float)used_count;
+    return stats;
+}
+
+//-----------------------------tipsify--------------------------------
+template<typename T>
+void OptimizeVertexCache(T* destination, const T* indices, std::size_t index_count, std::size_t vertex_count,
+                         std::uint32_t cache_size)
+{
+    index_count -= index_count % 3;
+    if(index_count == 0 || vertex_count == 0)
+        return;
+
+    // 原地优化时先保存一份输入
+    std::vector<T> source;
+    if(destination == indices)
+    {
+        source.assign(indices, indices + index_count);
+        indices = source.data();
+    }
+
+    TriangleAdjacency adjacency;
+    BuildAdjacency(adjacency, indices, index_count, vertex_count);
+
+    // live: 每个顶点还没有输出的三角形数
+    std::vector<std::uint32_t>& live = adjacency.counts;
+    std::vector<std::uint32_t> cache_time(vertex_count, 0);
+    std::vector<std::uint8_t> emitted(index_count / 3, 0);
+    std::vector<std::uint32_t> dead_end;
+    std::vector<std::uint32_t> candidates;
+    dead_end.reserve(index_count);
+    candidates.reserve(64);
+
+    std::uint32_t timestamp = cache_size + 1;
+    std::size_t next_vertex = 0;
+    std::size_t output = 0;
+
+    auto skip_dead_end = [&]() -> std::int64_t {
+        while(!dead_end.empty())
+        {
+            std::uint32_t v = dead_end.back();
+            dead_end.pop_back();
+            if(live[v] > 0)
+                return v;
+        }
+        while(next_vertex < vertex_count)
+        {
+            if(live[next_vertex] > 0)
+                return (std::int64_t)next_vertex;
+            ++next_vertex;
+        }
+        return -1;
+    };
+
+    std::int64_t fanning = skip_dead_end();
+    while(fanning >= 0)
+    {
+        candidates.clear();
+
+        const std::uint32_t begin = adjacency.offsets[fanning];
+        const std::uint32_t end = adjacency.offsets[fanning + 1];
+        for(std::uint32_t k = begin; k < end; ++k)
+        {
+            const std::uint32_t triangle = adjacency.triangles[k];
+            if(emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+
+            for(int corner = 0; corner < 3; ++corner)
+            {
+                const T v = indices[triangle * 3 + corner];
+                destination[output++] = v;
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if(timestamp - cache_time[v] > cache_size)
+                    cache_time[v] = timestamp++;
+            }
+        }
+
+        // 下一个扇形中心: 输出它剩下的三角形之后仍在缓存里, 并且在缓存里待得最久的顶点
+        std::int64_t best = -1;
+        std::int64_t best_priority = -1;
+        for(std::uint32_t v : candidates)
+        {
+            if(live[v] == 0)
+                continue;
+
+            std::int64_t priority = 0;
+            const std::uint32_t age = timestamp - cache_time[v];
+            if(age + 2 * live[v] <= cache_size)
+                priority = age;
+
+            if(priority > best_priority)
+            {
+                best = v;
+                best_priority = priority;
+            }
+        }
+
+        fanning = best >= 0 ? best : skip_dead_end();
+    }
+}
+
+//-----------------------------overdraw analyze--------------------------------
+namespace
+{
+    constexpr int overdraw_viewport = 256;
+
+    struct ScreenVertex
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+    float Edge(const ScreenVertex& a, const ScreenVertex& b, float x, float y)
+    {
+        return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+    }
+
+    // top-left 规则: 两个三角形共享的边只归其中一个, 不会重复计数
+    bool OwnsEdge(const ScreenVertex& a, const ScreenVertex& b)
+    {
+        return b.y > a.y || (b.y == a.y && b.x < a.x);
+    }
+
+    void RasterizeTriangle(ScreenVertex a, ScreenVertex b, ScreenVertex c, std::vector<float>& depth, std::uint32_t& shaded)
+    {
+        float area = Edge(a, b, c.x, c.y);
+        if(area == 0.0f)
+            return;
+        if(area < 0.0f)
+        {
+            std::swap(b, c);
+            area = -area;
+        }
+
+        const int min_x = std::max(0, (int)std::floor(std::min({a.x, b.x, c.x})));
+        const int max_x = std::min(overdraw_viewport - 1, (int)std::ceil(std::max({a.x, b.x, c.x})));
+        const int min_y = std::max(0, (int)std::floor(std::min({a.y, b.y, c.y})));
+        const int max_y = std::min(overdraw_viewport - 1, (int)std::ceil(std::max({a.y, b.y, c.y})));
+
+        const bool owns_bc = OwnsEdge(b, c);
+        const bool owns_ca = OwnsEdge(c, a);
+        const bool owns_ab = OwnsEdge(a, b);
+        const float inv_area = 1.0f / area;
+
+        for(int y = min_y; y <= max_y; ++y)
+        {
+            const float py = (float)y + 0.5f;
+            for(int x = min_x; x <= max_x; ++x)
+            {
+                const float px = (float)x + 0.5f;
+                const float w0 = Edge(b, c, px, py);
+                const float w1 = Edge(c, a, px, py);
+                const float w2 = Edge(a, b, px, py);
+                if(w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+                if((w0 == 0.0f && !owns_bc) || (w1 == 0.0f && !owns_ca) || (w2 == 0.0f && !owns_ab))
+                    continue;
+
+                const float z = (w0 * a.z + w1 * b.z + w2 * c.z) * inv_area;
+                float& stored = depth[y * overdraw_viewport + x];
+                if(z < stored)
+                {
+                    stored = z;
+                    ++shaded;
+                }
+            }
+        }
+    }
+}
+
+template<typename T>
+OverdrawStats AnalyzeOverdraw(const T* indices, std::size_t index_count,
+                              const void* positions, std::size_t vertex_count, std::uint32_t position_stride)
+{
+    OverdrawStats stats;
+    if(index_count < 3 || vertex_count == 0)
+        return stats;
+
+    XMVECTOR box_min = LoadPosition(positions, position_stride, 0);
+    XMVECTOR box_max = box_min;
+    for(std::size_t v = 1; v < vertex_count; ++v)
+    {
+        XMVECTOR p = LoadPosition(positions, position_stride, v);
+        box_min = XMVectorMin(box_min, p);
+        box_max = XMVectorMax(box_max, p);
+    }
+    const XMVECTOR center = XMVectorScale(XMVectorAdd(box_min, box_max), 0.5f);
+    const float radius = std::max(XMVectorGetX(XMVector3Length(XMVectorSubtract(box_max, center))), 1e-6f);
+    const float to_screen = 0.5f * (float)overdraw_viewport / radius;
+
+    static const XMFLOAT3 directions[14] = {
+        {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+        {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1}, {-1, 1, 1}, {-1, 1, -1}, {-1, -1, 1}, {-1, -1, -1}
+    };
+
+    std::vector<float> depth(overdraw_viewport * overdraw_viewport);
+    std::vector<ScreenVertex> screen(vertex_count);
+    for(const XMFLOAT3& direction : directions)
+    {
+        // 相机沿 forward 方向看向包围球中心, 正交投影到 viewport
+        const XMVECTOR forward = XMVector3Normalize(XMLoadFloat3(&direction));
+        const XMVECTOR world_up = direction.x == 0.0f && direction.z == 0.0f ?
+                                  XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+        const XMVECTOR right = XMVector3Normalize(XMVector3Cross(world_up, forward));
+        const XMVECTOR up = XMVector3Cross(forward, right);
+
+        for(std::size_t v = 0; v < vertex_count; ++v)
+        {
+            const XMVECTOR p = XMVectorSubtract(LoadPosition(positions, position_stride, v), center);
+            screen[v].x = (XMVectorGetX(XMVector3Dot(p, right)) + radius) * to_screen;
+            screen[v].y = (XMVectorGetX(XMVector3Dot(p, up)) + radius) * to_screen;
+            screen[v].z = XMVectorGetX(XMVector3Dot(p, forward));
+        }
+
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+        for(std::size_t i = 0; i + 2 < index_count; i += 3)
+        {
+            const XMVECTOR a = LoadPosition(positions, position_stride, indices[i + 0]);
+            const XMVECTOR b = LoadPosition(positions, position_stride, indices[i + 1]);
+            const XMVECTOR c = LoadPosition(positions, position_stride, indices[i + 2]);
+            const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+
+            // 背面剔除, 和 D3D12_CULL_MODE_BACK 一致
+            if(XMVectorGetX(XMVector3Dot(normal, forward)) >= 0.0f)
+                continue;
+
+            RasterizeTriangle(screen[indices[i + 0]], screen[indices[i + 1]], screen[indices[i + 2]], depth, stats.pixels_shaded);
+        }
+
+        stats.pixels_covered += (std::uint32_t)std::count_if(depth.begin(), depth.end(), [](float z){
+            return z != std::numeric_limits<float>::max();
+        });
+    }
+
+    stats.overdraw = stats.pixels_covered == 0 ? 0.0f : (float)stats.pixels_shaded / (float)stats.pixels_covered;
+    return stats;
+}
+
+//-----------------------------overdraw optimize--------------------------------
+namespace
+{
+    template<typename T>
+    std::uint64_t CountCacheMisses(const T* indices, std::size_t index_count, std::size_t vertex_count, std::uint32_t cache_size)
+    {
+        FifoCache cache(vertex_count, cache_size);
+        std::uint64_t misses = 0;
+        for(std::size_t i = 0; i < index_count; ++i)
+            misses += cache.Access(indices[i]);
+        return misses;
+    }
+
+    // 在硬边界之间按 soft_threshold 切出 cluster, 返回每个 cluster 的起始三角形, 末尾追加 triangle_count
+    // 软边界: 前缀的 ACMR 不超过所在硬 cluster 整体 ACMR 的 soft_threshold 倍时切一刀, soft_threshold 为 0 时只保留硬边界
+    template<typename T>
+    std::vector<std::uint32_t> BuildClusters(const T* indices, std::size_t vertex_count, std::uint32_t cache_size,
+                                             const std::vector<std::uint32_t>& hard_boundaries, float soft_threshold)
+    {
+        auto triangle_misses = [&](FifoCache& cache, std::size_t triangle){
+            return cache.Access(indices[triangle * 3 + 0]) + cache.Access(indices[triangle * 3 + 1]) + cache.Access(indices[triangle * 3 + 2]);
+        };
+
+        std::vector<std::uint32_t> clusters;
+        FifoCache cache(vertex_count, cache_size);
+        for(std::size_t h = 0; h + 1 < hard_boundaries.size(); ++h)
+        {
+            const std::uint32_t begin = hard_boundaries[h];
+            const std::uint32_t end = hard_boundaries[h + 1];
+
+            cache.Flush();
+            std::uint32_t cluster_misses = 0;
+            for(std::uint32_t t = begin; t < end; ++t)
+                cluster_misses += triangle_misses(cache, t);
+            const float cluster_threshold = soft_threshold * (float)cluster_misses / (float)(end - begin);
+
+            cache.Flush();
+            std::uint32_t start = begin;
+            std::uint32_t misses = 0;
+            clusters.push_back(begin);
+            for(std::uint32_t t = begin; t < end; ++t)
+            {
+                misses += triangle_misses(cache, t);
+                if(t + 1 < end && (float)misses / (float)(t - start + 1) <= cluster_threshold)
+                {
+                    start = t + 1;
+                    misses = 0;
+                    cache.Flush();
+                    clusters.push_back(start);
+                }
+            }
+        }
+        clusters.push_back(hard_boundaries.back());
+        return clusters;
+    }
+
+    // 遮挡潜力: cluster 中心相对网格中心的偏移在 cluster 平均法线上的投影, 越大越朝外, 朝外的排在前面
+    template<typename T>
+    void SortClusters(T* destination, const T* indices, const std::vector<std::uint32_t>& clusters,
+                      const void* positions, std::uint32_t position_stride)
+    {
+        const std::size_t cluster_count = clusters.size() - 1;
+        std::vector<XMFLOAT3> cluster_centroids(cluster_count);
+        std::vector<XMFLOAT3> cluster_normals(cluster_count);
+        XMVECTOR mesh_centroid = XMVectorZero();
+        float mesh_area = 0.0f;
+        for(std::size_t k = 0; k < cluster_count; ++k)
+        {
+            XMVECTOR centroid = XMVectorZero();
+            XMVECTOR normal = XMVectorZero();
+            float area = 0.0f;
+            for(std::uint32_t t = clusters[k]; t < clusters[k + 1]; ++t)
+            {
+                const XMVECTOR a = LoadPosition(positions, position_stride, indices[t * 3 + 0]);
+                const XMVECTOR b = LoadPosition(positions, position_stride, indices[t * 3 + 1]);
+                const XMVECTOR c = LoadPosition(positions, position_stride, indices[t * 3 + 2]);
+                const XMVECTOR cross = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+                const float triangle_area = XMVectorGetX(XMVector3Length(cross));
+
+                centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), triangle_area / 3.0f));
+                normal = XMVectorAdd(normal, cross);
+                area += triangle_area;
+            }
+
+            mesh_centroid = XMVectorAdd(mesh_centroid, centroid);
+            mesh_area += area;
+            XMStoreFloat3(&cluster_centroids[k], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+            XMStoreFloat3(&cluster_normals[k], XMVector3Normalize(normal));
+        }
+        if(mesh_area > 0.0f)
+            mesh_centroid = XMVectorScale(mesh_centroid, 1.0f / mesh_area);
+
+        std::vector<float> sort_keys(cluster_count);
+        for(std::size_t k = 0; k < cluster_count; ++k)
+        {
+            const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&cluster_centroids[k]), mesh_centroid);
+            sort_keys[k] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&cluster_normals[k])));
+        }
+
+        std::vector<std::uint32_t> order(cluster_count);
+        for(std::size_t k = 0; k < cluster_count; ++k)
+            order[k] = (std::uint32_t)k;
+        std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b){
+            return sort_keys[a] > sort_keys[b];
+        });
+
+        std::size_t output = 0;
+        for(std::uint32_t k : order)
+        {
+            const std::size_t begin = (std::size_t)clusters[k] * 3;
+            const std::size_t end = (std::size_t)clusters[k + 1] * 3;
+            std::copy(indices + begin, indices + end, destination + output);
+            output += end - begin;
+        }
+    }
+}
+
+template<typename T>
+void OptimizeOverdraw(T* destination, const T* indices, std::size_t index_count,
+                      const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                      float threshold, std::uint32_t cache_size)
+{
+    index_count -= index_count % 3;
+    const std::size_t triangle_count = index_count / 3;
+    if(triangle_count == 0 || vertex_count == 0)
+        return;
+
+    std::vector<T> source;
+    if(destination == indices)
+    {
+        source.assign(indices, indices + index_count);
+        indices = source.data();
+    }
+
+    // 硬边界: 三个顶点都 miss, 说明缓存已经完全换过一遍, 在这里切开基本不增加 ACMR
+    std::vector<std::uint32_t> hard_boundaries;
+    {
+        FifoCache cache(vertex_count, cache_size);
+        for(std::size_t t = 0; t < triangle_count; ++t)
+        {
+            const std::uint32_t misses = cache.Access(indices[t * 3 + 0]) + cache.Access(indices[t * 3 + 1]) + cache.Access(indices[t * 3 + 2]);
+            if(misses == 3 || t == 0)
+                hard_boundaries.push_back((std::uint32_t)t);
+        }
+        hard_boundaries.push_back((std::uint32_t)triangle_count);
+    }
+
+    // 排序后 cluster 之间不再共享缓存, 每个 cluster 的 ACMR 受 threshold 限制不代表整体也受限,
+    // 所以排完之后模拟一遍整体的 miss 数, 超出就减少软边界重来: threshold, 超出部分减半两次, 只用硬边界
+    // 都不满足时保持输入顺序
+    const std::uint64_t input_misses = CountCacheMisses(indices, index_count, vertex_count, cache_size);
+    const std::uint64_t max_misses = (std::uint64_t)std::floor((double)input_misses * std::max(threshold, 1.0f));
+    const float soft_thresholds[] = {threshold, 1.0f + (threshold - 1.0f) * 0.5f, 1.0f + (threshold - 1.0f) * 0.25f, 0.0f};
+    for(float soft_threshold : soft_thresholds)
+    {
+        const std::vector<std::uint32_t> clusters = BuildClusters(indices, vertex_count, cache_size, hard_boundaries, soft_threshold);
+        if(clusters.size() <= 2)
+            break;
+        SortClusters(destination, indices, clusters, positions, position_stride);
+        if(CountCacheMisses(destination, index_count, vertex_count, cache_size) <= max_misses)
+            return;
+    }
+    std::copy(indices, indices + index_count, destination);
+}
+
+//-----------------------------vertex fetch--------------------------------
+namespace
+{
+    constexpr std::uint32_t fetch_line_bytesize = 64;
+    // 16KB, 直接映射
+    constexpr std::uint32_t fetch_line_count = 256;
+}
+
+template<typename T>
+VertexFetchStats AnalyzeVertexFetch(const T* indices, std::size_t index_count, std::size_t vertex_count, std::uint32_t vertex_bytesize,
+                                    std::uint32_t cache_size)
+{
+    VertexFetchStats stats;
+    if(index_count == 0 || vertex_count == 0 || vertex_bytesize == 0)
+        return stats;
+
+    FifoCache vertex_cache(vertex_count, cache_size);
+    std::vector<std::uint64_t> lines(fetch_line_count, ~0ull);
+    std::vector<std::uint8_t> used(vertex_count, 0);
+    std::uint64_t line_reads = 0;
+    std::uint64_t line_misses = 0;
+
+    for(std::size_t i = 0; i < index_count; ++i)
+    {
+        const std::uint32_t v = indices[i];
+        used[v] = 1;
+        if(vertex_cache.Access(v) == 0)
+            continue;
+
+        const std::uint64_t first_line = (std::uint64_t)v * vertex_bytesize / fetch_line_bytesize;
+        const std::uint64_t last_line = ((std::uint64_t)v * vertex_bytesize + vertex_bytesize - 1) / fetch_line_bytesize;
+        for(std::uint64_t line = first_line; line <= last_line; ++line)
+        {
+            ++line_reads;
+            std::uint64_t& slot = lines[line % fetch_line_count];
+            if(slot != line)
+            {
+                slot = line;
+                ++line_misses;
+            }
+        }
+    }
+
+    const std::size_t used_count = std::count(used.begin(), used.end(), (std::uint8_t)1);
+
+    stats.bytes_fetched = line_misses * fetch_line_bytesize;
+    stats.overfetch = (float)stats.bytes_fetched / (float)(used_count * vertex_bytesize);
+    stats.hit_rate = line_reads == 0 ? 0.0f : 1.0f - (float)line_misses / (float)line_reads;
+    return stats;
+}
+
+template<typename T>
+std::uint32_t GenerateVertexFetchRemap(std::uint32_t* remap, const T* indices, std::size_t index_count, std::size_t vertex_count)
+{
+    std::fill(remap, remap + vertex_count, invalid_vertex);
+
+    std::uint32_t next = 0;
+    for(std::size_t i = 0; i < index_count; ++i)
+    {
+        std::uint32_t& target = remap[indices[i]];
+        if(target == invalid_vertex)
+            target = next++;
+    }
+    return next;
+}
+
+template<typename T>
+void RemapIndexBuffer(T* destination, const T* indices, std::size_t index_count, const std::uint32_t* remap)
+{
+    for(std::size_t i = 0; i < index_count; ++i)
+        destination[i] = (T)remap[indices[i]];
+}
+
+void RemapVertexBuffer(void* destination, const void* vertices, std::size_t vertex_count, std::uint32_t vertex_bytesize,
+                       const std::uint32_t* remap)
+{
+    // 原地重排时先保存一份输入
+    std::vector<std::uint8_t> source;
+    if(destination == vertices)
+    {
+        source.assign(static_cast<const std::uint8_t*>(vertices), static_cast<const std::uint8_t*>(vertices) + vertex_count * vertex_bytesize);
+        vertices = source.data();
+    }
+
+    const std::uint8_t* src = static_cast<const std::uint8_t*>(vertices);
+    std::uint8_t* dst = static_cast<std::uint8_t*>(destination);
+    for(std::size_t v = 0; v < vertex_count; ++v)
+    {
+        if(remap[v] != invalid_vertex)
+            std::memcpy(dst + (std::size_t)remap[v] * vertex_bytesize, src + v * vertex_bytesize, vertex_bytesize);
+    }
+}
+
+template VertexCacheStats AnalyzeVertexCache<std::uint16_t>(const std::uint16_t*, std::size_t, std::size_t, std::uint32_t, VertexCacheModel);
+template VertexCacheStats AnalyzeVertexCache<std::uint32_t>(const std::uint32_t*, std::size_t, std::size_t, std::uint32_t, VertexCacheModel);
+template void OptimizeVertexCache<std::uint16_t>(std::uint16_t*, const std::uint16_t*, std::size_t, std::size_t, std::uint32_t);
+template void OptimizeVertexCache<std::uint32_t>(std::uint32_t*, const std::uint32_t*, std::size_t, std::size_t, std::uint32_t);
+template OverdrawStats AnalyzeOverdraw<std::uint16_t>(const std::uint16_t*, std::size_t, const void*, std::size_t, std::uint32_t);
+template OverdrawStats AnalyzeOverdraw<std::uint32_t>(const std::uint32_t*, std::size_t, const void*, std::size_t, std::uint32_t);
+template void OptimizeOverdraw<std::uint16_t>(std::uint16_t*, const std::uint16_t*, std::size_t, const void*, std::size_t, std::uint32_t, float, std::uint32_t);
+template void OptimizeOverdraw<std::uint32_t>(std::uint32_t*, const std::uint32_t*, std::size_t, const void*, std::size_t, std::uint32_t, float, std::uint32_t);
+template VertexFetchStats AnalyzeVertexFetch<std::uint16_t>(const std::uint16_t*, std::size_t, std::size_t, std::uint32_t, std::uint32_t);
+template VertexFetchStats AnalyzeVertexFetch<std::uint32_t>(const std::uint32_t*, std::size_t, std::size_t, std::uint32_t, std::uint32_t);
+template std::uint32_t GenerateVertexFetchRemap<std::uint16_t>(std::uint32_t*, const std::uint16_t*, std::size_t, std::size_t);
+template std::uint32_t GenerateVertexFetchRemap<std::uint32_t>(std::uint32_t*, const std::uint32_t*, std::size_t, std::size_t);
+template void RemapIndexBuffer<std::uint16_t>(std::uint16_t*, const std::uint16_t*, std::size_t, const std::uint32_t*);
+template void RemapIndexBuffer<std::uint32_t>(std::uint32_t*, const std::uint32_t*, std::size_t, const std::uint32_t*);
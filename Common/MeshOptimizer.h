@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------MeshOptimizer--------------------------------
+// 离线/加载时对索引和顶点缓冲重新排序, 不改变网格的形状
+// 所有函数同时支持 16 位和 32 位索引, destination 可以和 indices 是同一块内存
+
+//-----------------------------vertex cache--------------------------------
+// 大多数 GPU 的 post-transform cache 大小在 16~32 之间
+constexpr std::uint32_t default_vertex_cache_size = 16;
+
+enum class VertexCacheModel
+{
+    FIFO,
+    LRU
+};
+
+struct VertexCacheStats
+{
+    std::uint32_t triangle_count = 0;
+    // 模拟的 vertex shader 调用次数
+    std::uint32_t vertices_transformed = 0;
+    // average cache miss ratio: 每个三角形的 vs 调用次数, 理想值 0.5, 最差 3
+    float acmr = 0.0f;
+    // average transform to vertex ratio: vs 调用次数 / 实际用到的顶点数, 理想值 1
+    float atvr = 0.0f;
+};
+
+// 模拟给定大小的 FIFO 或 LRU 缓存, O(index_count * (LRU 时的 cache_size))
+template<typename T>
+VertexCacheStats AnalyzeVertexCache(const T* indices, std::size_t index_count, std::size_t vertex_count,
+                                    std::uint32_t cache_size = default_vertex_cache_size,
+                                    VertexCacheModel model = VertexCacheModel::FIFO);
+
+// Tipsify (Sander et al. 2007): 线性时间, 从当前顶点出发优先输出仍在缓存中的相邻三角形
+template<typename T>
+void OptimizeVertexCache(T* destination, const T* indices, std::size_t index_count, std::size_t vertex_count,
+                         std::uint32_t cache_size = default_vertex_cache_size);
+
+//-----------------------------overdraw--------------------------------
+// 位置是 XMFLOAT3, position_stride 为相邻顶点的字节间隔
+struct OverdrawStats
+{
+    // 深度测试之后最终可见的像素
+    std::uint32_t pixels_covered = 0;
+    // 按绘制顺序通过 early-z 的像素, 也就是 pixel shader 的调用次数
+    std::uint32_t pixels_shaded = 0;
+    // shaded / covered, 理想值 1
+    float overdraw = 0.0f;
+};
+
+// CPU 软光栅估计 overdraw: 从包围盒周围 14 个方向 (6 个轴向 + 8 个对角) 正交投影,
+// 剔除背面后统计, 不需要 GPU
+template<typename T>
+OverdrawStats AnalyzeOverdraw(const T* indices, std::size_t index_count,
+                              const void* positions, std::size_t vertex_count, std::uint32_t position_stride);
+
+// Sander et al. 2007: 输入应当已经做过 OptimizeVertexCache
+// 先在缓存完全失效处切出 cluster, 再在局部 ACMR 不超过 threshold 倍的地方细分,
+// 然后把朝外的 cluster (更可能遮挡别人) 排到前面
+// threshold = 1.05 表示输出的整体 ACMR (FIFO, cache_size) 最多比输入差 5%, 超出时减少 cluster 数量重排
+template<typename T>
+void OptimizeOverdraw(T* destination, const T* indices, std::size_t index_count,
+                      const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                      float threshold = 1.05f, std::uint32_t cache_size = default_vertex_cache_size);
+
+//-----------------------------vertex fetch--------------------------------
+constexpr std::uint32_t invalid_vertex = 0xFFFFFFFF;
+
+// 模拟显存读取: 顶点先经过 post-transform cache, miss 的顶点再按 64 字节的缓存行读取
+struct VertexFetchStats
+{
+    std::uint64_t bytes_fetched = 0;
+    // 实际读取的字节 / 用到的顶点字节数, 理想值 1
+    float overfetch = 0.0f;
+    // 缓存行命中率
+    float hit_rate = 0.0f;
+};
+
+// vertex_bytesize 是一个顶点在这个流里的大小, 多个流时分别统计
+template<typename T>
+VertexFetchStats AnalyzeVertexFetch(const T* indices, std::size_t index_count, std::size_t vertex_count, std::uint32_t vertex_bytesize,
+                                    std::uint32_t cache_size = default_vertex_cache_size);
+
+// 按索引中第一次出现的顺序给顶点重新编号, remap[旧编号] = 新编号, 没有用到的顶点为 invalid_vertex
+// 返回用到的顶点数, 也就是重排后顶点缓冲的长度
+// remap 需要保存下来, 蒙皮权重/morph target 等后加载的顶点数据也要按它重排
+template<typename T>
+std::uint32_t GenerateVertexFetchRemap(std::uint32_t* remap, const T* indices, std::size_t index_count, std::size_t vertex_count);
+
+template<typename T>
+void RemapIndexBuffer(T* destination, const T* indices, std::size_t index_count, const std::uint32_t* remap);
+
+// 每个顶点流各调用一次, 所有流使用同一个 remap
+void RemapVertexBuffer(void* destination, const void* vertices, std::size_t vertex_count, std::uint32_t vertex_bytesize,
+                       const std::uint32_t* remap);
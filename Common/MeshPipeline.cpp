@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "Bounds.h"
+#include "IndexBuffer.h"
+#include "JobSystem.h"
+#include "MeshOptimizer.h"
+#include "MeshPipeline.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+#include "VertexCompression.h"
+#include "VertexWeld.h"
+
+using namespace DirectX;
+
+namespace
+{
+    void StoreBounds(MeshFileSubmesh& submesh, const MeshBounds& bounds)
+    {
+        submesh.box_center[0] = bounds.box.Center.x;
+        submesh.box_center[1] = bounds.box.Center.y;
+        submesh.box_center[2] = bounds.box.Center.z;
+        submesh.box_extents[0] = bounds.box.Extents.x;
+        submesh.box_extents[1] = bounds.box.Extents.y;
+        submesh.box_extents[2] = bounds.box.Extents.z;
+        submesh.sphere_center[0] = bounds.sphere.Center.x;
+        submesh.sphere_center[1] = bounds.sphere.Center.y;
+        submesh.sphere_center[2] = bounds.sphere.Center.z;
+        submesh.sphere_radius = bounds.sphere.Radius;
+    }
+
+    // 偏移改成在整个文件的 meshlet 数组中的位置, 追加到 content 后面
+    void AppendMeshlets(MeshFileContent& content, const MeshletBuffers& buffers)
+    {
+        const std::uint32_t vertex_base = (std::uint32_t)content.meshlet_vertices.size();
+        const std::uint32_t primitive_base = (std::uint32_t)content.meshlet_primitives.size();
+        for(std::size_t i = 0; i < buffers.meshlets.size(); ++i)
+        {
+            const Meshlet& meshlet = buffers.meshlets[i];
+            MeshFileMeshlet record;
+            record.vertex_count = meshlet.vertex_count;
+            record.vertex_offset = vertex_base + meshlet.vertex_offset;
+            record.primitive_count = meshlet.primitive_count;
+            record.primitive_offset = primitive_base + meshlet.primitive_offset;
+            content.meshlets.push_back(record);
+
+            const MeshletBounds& bounds = buffers.bounds[i];
+            MeshFileMeshletBounds bounds_record;
+            std::memcpy(bounds_record.center, &bounds.center, sizeof(bounds_record.center));
+            bounds_record.radius = bounds.radius;
+            std::memcpy(bounds_record.cone_axis, &bounds.cone_axis, sizeof(bounds_record.cone_axis));
+            bounds_record.cone_cutoff = bounds.cone_cutoff;
+            std::memcpy(bounds_record.cone_apex, &bounds.cone_apex, sizeof(bounds_record.cone_apex));
+            content.meshlet_bounds.push_back(bounds_record);
+        }
+        content.meshlet_vertices.insert(content.meshlet_vertices.end(), buffers.vertex_indices.begin(), buffers.vertex_indices.end());
+        content.meshlet_primitives.insert(content.meshlet_primitives.end(), buffers.primitive_indices.begin(), buffers.primitive_indices.end());
+    }
+}
+
+MeshFileContent ProcessMesh(const MeshPipelineInput& input, JobSystem& jobs, std::string* report)
+{
+    const std::size_t input_vertex_count = input.vertex_count;
+    std::vector<XMFLOAT3> positions(input.positions, input.positions + input_vertex_count);
+    std::vector<XMFLOAT4> colors(input_vertex_count, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+    if(input.colors != nullptr)
+        colors.assign(input.colors, input.colors + input_vertex_count);
+    std::vector<std::uint32_t> indices(input.indices, input.indices + input.index_count);
+    std::uint32_t* indices32 = indices.data();
+    const std::size_t index_count = indices.size();
+
+    std::vector<MeshPipelineSubmesh> submeshes = input.submeshes;
+    if(submeshes.empty())
+        submeshes.push_back({"mesh", 0, (std::uint32_t)index_count});
+
+    // 合并位置和颜色都相同的顶点, 生成器每个面单独生成的角顶点在这里合成一个
+    WeldStream weld_streams[2];
+    weld_streams[0].data = positions.data();
+    weld_streams[0].stride = sizeof(XMFLOAT3);
+    weld_streams[0].bytesize = sizeof(XMFLOAT3);
+    weld_streams[0].epsilon = 1e-5f;
+    weld_streams[1].data = colors.data();
+    weld_streams[1].stride = sizeof(XMFLOAT4);
+    weld_streams[1].bytesize = sizeof(XMFLOAT4);
+    weld_streams[1].epsilon = 0.5f / 255.0f;
+    std::vector<std::uint32_t> weld_remap(input_vertex_count);
+    WeldStats weld_stats;
+    const std::uint32_t welded_count = GenerateWeldRemap(weld_remap.data(), weld_streams, 2, input_vertex_count, &weld_stats);
+    RemapIndexBuffer(indices32, indices32, index_count, weld_remap.data());
+    RemapVertexBuffer(positions.data(), positions.data(), input_vertex_count, sizeof(XMFLOAT3), weld_remap.data());
+    RemapVertexBuffer(colors.data(), colors.data(), input_vertex_count, sizeof(XMFLOAT4), weld_remap.data());
+
+    // 每个 submesh 单独绘制, 三角形只在自己的范围内重排
+    const VertexCacheStats before = AnalyzeVertexCache(indices32, index_count, welded_count);
+    const OverdrawStats overdraw_before = AnalyzeOverdraw(indices32, index_count, positions.data(), welded_count, sizeof(XMFLOAT3));
+    for(const MeshPipelineSubmesh& submesh : submeshes)
+    {
+        std::uint32_t* range = indices32 + submesh.start_index;
+        OptimizeVertexCache(range, range, submesh.index_count, welded_count);
+        OptimizeOverdraw(range, range, submesh.index_count, positions.data(), welded_count, sizeof(XMFLOAT3));
+    }
+    const VertexCacheStats after = AnalyzeVertexCache(indices32, index_count, welded_count);
+    const OverdrawStats overdraw_after = AnalyzeOverdraw(indices32, index_count, positions.data(), welded_count, sizeof(XMFLOAT3));
+
+    // 按索引第一次使用的顺序重排顶点, 两个顶点流使用同一个 remap, 没有被用到的顶点丢掉
+    const std::uint32_t packed_vertex_bytesize = PackedBytesize(PackedAttribute::Position) + PackedBytesize(PackedAttribute::Color);
+    const VertexFetchStats fetch_before = AnalyzeVertexFetch(indices32, index_count, welded_count, PackedBytesize(PackedAttribute::Position));
+    std::vector<std::uint32_t> fetch_remap(welded_count);
+    std::uint32_t vertex_count = GenerateVertexFetchRemap(fetch_remap.data(), indices32, index_count, welded_count);
+    RemapIndexBuffer(indices32, indices32, index_count, fetch_remap.data());
+    RemapVertexBuffer(positions.data(), positions.data(), welded_count, sizeof(XMFLOAT3), fetch_remap.data());
+    RemapVertexBuffer(colors.data(), colors.data(), welded_count, sizeof(XMFLOAT4), fetch_remap.data());
+    const VertexFetchStats fetch_after = AnalyzeVertexFetch(indices32, index_count, vertex_count, PackedBytesize(PackedAttribute::Position));
+
+    MeshFileContent content;
+    content.vertex_remap.resize(input_vertex_count);
+    for(std::size_t i = 0; i < input_vertex_count; ++i)
+        content.vertex_remap[i] = fetch_remap[weld_remap[i]];
+
+    // 整个网格的包围盒用于位置压缩, submesh 的包围体用于剔除和 LOD 选择
+    const MeshBounds mesh_bounds = ComputeBounds(positions.data(), vertex_count, sizeof(XMFLOAT3), &jobs);
+
+    // cluster 剔除用的 meshlet, 只为 LOD0 生成, 顶点编号是整个顶点缓冲中的编号
+    std::uint32_t cone_count = 0;
+    std::vector<std::uint32_t> meshlet_offsets(submeshes.size());
+    std::vector<LodSource> lod_sources(submeshes.size());
+    std::vector<MeshBounds> submesh_bounds(submeshes.size());
+    for(std::size_t i = 0; i < submeshes.size(); ++i)
+    {
+        const std::uint32_t* range = indices32 + submeshes[i].start_index;
+        submesh_bounds[i] = submeshes.size() == 1 ? mesh_bounds
+                          : ComputeBounds(range, submeshes[i].index_count, positions.data(), sizeof(XMFLOAT3));
+
+        const MeshletBuffers meshlets = BuildMeshlets(range, submeshes[i].index_count, positions.data(), vertex_count, sizeof(XMFLOAT3));
+        meshlet_offsets[i] = (std::uint32_t)content.meshlets.size();
+        AppendMeshlets(content, meshlets);
+        cone_count += (std::uint32_t)std::count_if(meshlets.bounds.begin(), meshlets.bounds.end(),
+                                                   [](const MeshletBounds& bounds){ return bounds.cone_cutoff < 1.0f; });
+
+        lod_sources[i].indices = range;
+        lod_sources[i].index_count = submeshes[i].index_count;
+        lod_sources[i].positions = positions.data();
+        lod_sources[i].vertex_count = vertex_count;
+        lod_sources[i].position_stride = sizeof(XMFLOAT3);
+    }
+
+    // LOD 共用顶点缓冲, 各级的索引依次接在所有 LOD0 后面
+    const std::vector<std::vector<LodLevel>> lod_chains = GenerateLodChains(jobs, lod_sources);
+    std::uint32_t lod_total = 0;
+    for(std::size_t i = 0; i < submeshes.size(); ++i)
+    {
+        const std::vector<LodLevel>& lods = lod_chains[i];
+        for(std::size_t lod = 0; lod < lods.size(); ++lod)
+        {
+            MeshFileSubmesh record;
+            SetMeshFileName(record, submeshes[i].name);
+            record.lod = (std::uint32_t)lod;
+            record.lod_count = lod == 0 ? (std::uint32_t)lods.size() : 1;
+            record.lod_error = lods[lod].error;
+            record.index_count = lod == 0 ? submeshes[i].index_count : (std::uint32_t)lods[lod].indices.size();
+            record.start_index_location = lod == 0 ? submeshes[i].start_index : (std::uint32_t)indices.size();
+            StoreBounds(record, submesh_bounds[i]);
+            if(lod == 0)
+            {
+                record.meshlet_offset = meshlet_offsets[i];
+                record.meshlet_count = (i + 1 < submeshes.size() ? meshlet_offsets[i + 1] : (std::uint32_t)content.meshlets.size()) - meshlet_offsets[i];
+            }
+            content.submeshes.push_back(record);
+            if(lod != 0)
+                indices.insert(indices.end(), lods[lod].indices.begin(), lods[lod].indices.end());
+        }
+        lod_total += (std::uint32_t)lods.size();
+    }
+    indices32 = indices.data();
+    const std::uint32_t total_index_count = (std::uint32_t)indices.size();
+
+    // 选择索引宽度, 顶点超过 65536 个时可能拆段并复制段之间共享的顶点
+    const IndexBufferPlan index_plan = PlanIndexBuffer(indices32, total_index_count, vertex_count, packed_vertex_bytesize);
+    if(!index_plan.vertex_sources.empty())
+    {
+        std::vector<XMFLOAT3> split_positions(index_plan.vertex_sources.size());
+        std::vector<XMFLOAT4> split_colors(index_plan.vertex_sources.size());
+        GatherVertexBuffer(split_positions.data(), positions.data(), sizeof(XMFLOAT3), index_plan);
+        GatherVertexBuffer(split_colors.data(), colors.data(), sizeof(XMFLOAT4), index_plan);
+        positions.swap(split_positions);
+        colors.swap(split_colors);
+        vertex_count = (std::uint32_t)positions.size();
+        // 复制出来的顶点不在 remap 中, 原始顶点指向它第一次出现的位置
+        std::vector<std::uint32_t> first_copy(index_plan.vertex_sources.size(), invalid_vertex);
+        for(std::uint32_t v = (std::uint32_t)index_plan.vertex_sources.size(); v-- > 0;)
+            first_copy[index_plan.vertex_sources[v]] = v;
+        for(std::uint32_t& v : content.vertex_remap)
+            v = v == invalid_vertex ? invalid_vertex : first_copy[v];
+        // meshlet 用 32 位编号直接读顶点缓冲, 不受拆段影响, 指向任意一份复制都可以
+        for(std::uint32_t& v : content.meshlet_vertices)
+            v = first_copy[v];
+    }
+    for(MeshFileSubmesh& record : content.submeshes)
+    {
+        if(index_plan.segments.size() <= 1)
+            break;
+        record.segment_offset = (std::uint32_t)content.segments.size();
+        for(const IndexSegment& segment : SegmentsInRange(index_plan, record.start_index_location, record.index_count))
+        {
+            MeshFileSegment draw;
+            draw.index_count = segment.index_count;
+            draw.start_index_location = segment.start_index;
+            draw.base_vertex_location = (std::int32_t)segment.base_vertex;
+            content.segments.push_back(draw);
+        }
+        record.segment_count = (std::uint32_t)content.segments.size() - record.segment_offset;
+    }
+
+    content.index_count = total_index_count;
+    content.index_format = index_plan.index_bytesize == sizeof(std::uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    content.indices.resize(index_plan.Bytesize());
+    WriteIndexBuffer(content.indices.data(), indices32, total_index_count, index_plan);
+
+    // 编码写好的 16/32 位索引 (拆段时是段内编号), 解压后直接就是要上传的数据
+    // 编码可能轮换三角形的顶点, 绕序不变, 对 vertex cache 的影响可以忽略
+    std::vector<std::uint8_t> encoded_indices(EncodeIndexBufferBound(total_index_count));
+    const std::size_t encoded_bytesize = index_plan.index_bytesize == sizeof(std::uint16_t)
+        ? EncodeIndexBuffer(encoded_indices.data(), encoded_indices.size(), reinterpret_cast<const std::uint16_t*>(content.indices.data()), total_index_count)
+        : EncodeIndexBuffer(encoded_indices.data(), encoded_indices.size(), reinterpret_cast<const std::uint32_t*>(content.indices.data()), total_index_count);
+    if(input.encode_indices)
+    {
+        encoded_indices.resize(encoded_bytesize);
+        content.indices.swap(encoded_indices);
+        content.index_encoding = mesh_index_encoding_compact;
+    }
+
+    // 位置相对整个网格的包围盒压缩成 16 位, 颜色压缩成 8 位
+    // 不按 submesh 分别压缩: 所有 submesh 和各级 LOD 共用一个顶点缓冲, 合并后的顶点可能被几个 submesh 同时引用,
+    // 按 submesh 压缩就要把这些顶点复制一份并且每次绘制换一组解压常量; 整个网格一组常量放在 cbPerPass 里即可,
+    // 代价是精度按整个网格的尺寸计算, 每个轴的最大误差为包围盒在该轴的边长 / 65535 / 2, report 中的 position error 即为实测值
+    const PositionQuantization quantization = MakePositionQuantization(mesh_bounds.box);
+    content.position_scale[0] = quantization.scale.x;
+    content.position_scale[1] = quantization.scale.y;
+    content.position_scale[2] = quantization.scale.z;
+    content.position_offset[0] = quantization.offset.x;
+    content.position_offset[1] = quantization.offset.y;
+    content.position_offset[2] = quantization.offset.z;
+
+    content.vertex_count = vertex_count;
+    content.streams.resize(2);
+    MeshFileContent::Stream& position_stream = content.streams[0];
+    position_stream.stride = PackedBytesize(PackedAttribute::Position);
+    position_stream.format = PackedFormat(PackedAttribute::Position);
+    position_stream.data.resize((std::size_t)vertex_count * position_stream.stride);
+    EncodePositions(position_stream.data.data(), position_stream.stride, positions.data(), sizeof(XMFLOAT3), vertex_count, quantization);
+    MeshFileContent::Stream& color_stream = content.streams[1];
+    color_stream.stride = PackedBytesize(PackedAttribute::Color);
+    color_stream.format = PackedFormat(PackedAttribute::Color);
+    color_stream.data.resize((std::size_t)vertex_count * color_stream.stride);
+    EncodeColors(color_stream.data.data(), color_stream.stride, colors.data(), sizeof(XMFLOAT4), vertex_count);
+
+    if(report != nullptr)
+    {
+        const QuantizationError position_error = PositionError(position_stream.data.data(), position_stream.stride,
+                                                               positions.data(), sizeof(XMFLOAT3), vertex_count, quantization);
+        const QuantizationError color_error = ColorError(color_stream.data.data(), color_stream.stride,
+                                                         colors.data(), sizeof(XMFLOAT4), vertex_count);
+        const MeshFileSubmesh& lowest = content.submeshes[lod_chains[0].size() - 1];
+
+        char buffer[768];
+        const char* name = submeshes[0].name.c_str();
+        std::snprintf(buffer, sizeof(buffer),
+                      "%s vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overdraw %.3f -> %.3f, fetch hit rate %.3f -> %.3f\n"
+                      "%s vertex compression: %u -> %u bytes/vertex, position error max %g, color error max %g\n"
+                      "%s index buffer: %u bit, %u segments, %u bytes, encoded %u bytes (%s)\n"
+                      "%s meshlets: %u, %u with a normal cone\n"
+                      "%s lods: %u in %u submeshes, lowest %u triangles, error %g\n"
+                      "%s weld: %u -> %u vertices, %llu bytes saved\n",
+                      name, before.acmr, after.acmr, before.atvr, after.atvr, overdraw_before.overdraw, overdraw_after.overdraw,
+                      fetch_before.hit_rate, fetch_after.hit_rate,
+                      name, (std::uint32_t)(sizeof(XMFLOAT3) + sizeof(XMFLOAT4)), packed_vertex_bytesize,
+                      position_error.max_error, color_error.max_error,
+                      name, index_plan.index_bytesize * 8, (std::uint32_t)index_plan.segments.size(),
+                      (std::uint32_t)index_plan.Bytesize(), (std::uint32_t)encoded_bytesize, input.encode_indices ? "stored" : "not stored",
+                      name, (std::uint32_t)content.meshlets.size(), cone_count,
+                      name, lod_total, (std::uint32_t)submeshes.size(), lowest.index_count / 3, lowest.lod_error,
+                      name, weld_stats.vertex_count, weld_stats.unique_count,
+                      (unsigned long long)(weld_stats.bytes_before - weld_stats.bytes_after));
+        report->append(buffer);
+    }
+    return content;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "MeshFile.h"
+
+class JobSystem;
+
+//-----------------------------MeshPipeline--------------------------------
+// 生成器或导入器输出的 float 顶点和 32 位索引 -> 可以直接上传的 .mesh 数据:
+// 合并顶点, 每个 submesh 做 vertex cache 和 overdraw 优化, 顶点按读取顺序重排,
+// 生成 LOD 链, 选择索引宽度 (必要时拆段), 最后压缩顶点
+// 离线转换工具和运行时 (没有转换好的文件时) 走同一条路径, 除了索引是否压缩存放 (encode_indices) 以外两边的结果完全相同
+struct MeshPipelineSubmesh
+{
+    std::string name;
+    std::uint32_t start_index = 0;
+    std::uint32_t index_count = 0;
+};
+
+struct MeshPipelineInput
+{
+    const DirectX::XMFLOAT3* positions = nullptr;
+    // 为空时用白色
+    const DirectX::XMFLOAT4* colors = nullptr;
+    std::size_t vertex_count = 0;
+    const std::uint32_t* indices = nullptr;
+    std::size_t index_count = 0;
+    // 各自的索引范围, 不能重叠
+    std::vector<MeshPipelineSubmesh> submeshes;
+    // 索引压缩存放, 文件更小但加载时要解压; 离线转换时打开, 运行时生成的网格直接上传不压缩
+    bool encode_indices = false;
+};
+
+// 顶点流 0 为 R16G16B16A16_UNORM 的位置 (相对整个网格的包围盒, 解压常量在文件头中, 所有 submesh 共用), 1 为 R8G8B8A8_UNORM 的颜色
+// 每个 submesh 的各级 LOD 依次加在 submesh 表中
+// report 不为空时追加各步骤的统计
+MeshFileContent ProcessMesh(const MeshPipelineInput& input, JobSystem& jobs, std::string* report = nullptr);
@@ -0,0 +1,164 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Hash.h"
+#include "MeshRegistry.h"
+#include "VertexWeld.h"
+
+namespace
+{
+    bool SameData(const void* a, const void* b, std::size_t bytesize)
+    {
+        return bytesize == 0 || std::memcmp(a, b, bytesize) == 0;
+    }
+
+    std::uint64_t GeometryBytesize(const MeshGeometry& geometry)
+    {
+        return (std::uint64_t)geometry.vertex_buffer_bytesize + geometry.vertex_color_buffer_bytesize + geometry.index_buffer_bytesize;
+    }
+
+    bool SameFloat3(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    // 绘制范围以及调用者会读到的包围体, LOD 和 meshlet 信息
+    void HashSubmesh(Hasher& hasher, const SubmeshGeometry& submesh)
+    {
+        hasher.Add(submesh.index_count).Add(submesh.start_index_location).Add(submesh.base_vertex_location);
+        hasher.Add(submesh.bounds.Center).Add(submesh.bounds.Extents);
+        hasher.Add(submesh.bounding_sphere.Center).Add(submesh.bounding_sphere.Radius);
+        hasher.Add(submesh.lod_count).Add(submesh.lod_error);
+        hasher.Add(submesh.meshlet_offset).Add(submesh.meshlet_count);
+        hasher.Add((std::uint32_t)submesh.segments.size());
+        for(const SubmeshGeometry& segment : submesh.segments)
+            HashSubmesh(hasher, segment);
+    }
+
+    bool SameSubmesh(const SubmeshGeometry& a, const SubmeshGeometry& b)
+    {
+        if(a.index_count != b.index_count || a.start_index_location != b.start_index_location
+            || a.base_vertex_location != b.base_vertex_location
+            || !SameFloat3(a.bounds.Center, b.bounds.Center) || !SameFloat3(a.bounds.Extents, b.bounds.Extents)
+            || !SameFloat3(a.bounding_sphere.Center, b.bounding_sphere.Center) || a.bounding_sphere.Radius != b.bounding_sphere.Radius
+            || a.lod_count != b.lod_count || a.lod_error != b.lod_error
+            || a.meshlet_offset != b.meshlet_offset || a.meshlet_count != b.meshlet_count
+            || a.segments.size() != b.segments.size())
+            return false;
+        for(std::size_t i = 0; i < a.segments.size(); ++i)
+        {
+            if(!SameSubmesh(a.segments[i], b.segments[i]))
+                return false;
+        }
+        return true;
+    }
+}
+
+std::uint64_t MeshRegistry::ContentHash(const MeshGeometry& geometry)
+{
+    // CPU 端数据可能在 blob 中, 也可能在映射的 .mesh 文件中
+    const void* blobs[3] = {geometry.VertexData(), geometry.VertexColorData(), geometry.IndexData()};
+    const std::size_t bytesizes[3] = {geometry.vertex_buffer_bytesize, geometry.vertex_color_buffer_bytesize, geometry.index_buffer_bytesize};
+
+    Hasher hasher(HashMeshContent(blobs, bytesizes, 3));
+    hasher.Add(geometry.vertex_byte_stride);
+    hasher.Add(geometry.vertex_color_byte_stride);
+    hasher.Add(geometry.index_format);
+
+    // 共用的网格按 Find 返回给所有同 id 的调用者, drawargs 不同时不能共用
+    hasher.Add((std::uint32_t)geometry.drawargs.Size());
+    for(std::size_t i = 0; i < geometry.drawargs.Size(); ++i)
+    {
+        hasher.Add(geometry.drawargs.Keys()[i].value);
+        HashSubmesh(hasher, geometry.drawargs.Values()[i]);
+    }
+    return hasher.Value();
+}
+
+bool MeshRegistry::SameContent(const MeshGeometry& a, const MeshGeometry& b)
+{
+    return a.vertex_byte_stride == b.vertex_byte_stride
+        && a.vertex_color_byte_stride == b.vertex_color_byte_stride
+        && a.index_format == b.index_format
+        && a.vertex_buffer_bytesize == b.vertex_buffer_bytesize
+        && a.vertex_color_buffer_bytesize == b.vertex_color_buffer_bytesize
+        && a.index_buffer_bytesize == b.index_buffer_bytesize
+        && SameData(a.VertexData(), b.VertexData(), a.vertex_buffer_bytesize)
+        && SameData(a.VertexColorData(), b.VertexColorData(), a.vertex_color_buffer_bytesize)
+        && SameData(a.IndexData(), b.IndexData(), a.index_buffer_bytesize)
+        && SameDrawargs(a, b);
+}
+
+bool MeshRegistry::SameDrawargs(const MeshGeometry& a, const MeshGeometry& b)
+{
+    if(a.drawargs.Keys() != b.drawargs.Keys())
+        return false;
+    for(std::size_t i = 0; i < a.drawargs.Size(); ++i)
+    {
+        if(!SameSubmesh(a.drawargs.Values()[i], b.drawargs.Values()[i]))
+            return false;
+    }
+    return true;
+}
+
+std::shared_ptr<MeshGeometry> MeshRegistry::Intern(std::shared_ptr<MeshGeometry> geometry, bool& is_new)
+{
+    // 哈希在锁外计算
+    const std::uint64_t hash = ContentHash(*geometry);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::shared_ptr<MeshGeometry>>& bucket = meshes[hash];
+    for(const auto& existing : bucket)
+    {
+        if(SameContent(*existing, *geometry))
+        {
+            ++duplicate_count;
+            saved_bytes += GeometryBytesize(*geometry);
+            if(geometry->id.IsValid())
+                meshes_by_id.Insert(geometry->id, existing);
+            is_new = false;
+            return existing;
+        }
+    }
+
+    bucket.push_back(geometry);
+    if(geometry->id.IsValid())
+        meshes_by_id.Insert(geometry->id, geometry);
+    ++mesh_count;
+    is_new = true;
+    return geometry;
+}
+
+std::shared_ptr<MeshGeometry> MeshRegistry::Find(StringId id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::shared_ptr<MeshGeometry>* geometry = meshes_by_id.Find(id);
+    return geometry != nullptr ? *geometry : nullptr;
+}
+
+UINT MeshRegistry::MeshCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return mesh_count;
+}
+
+UINT MeshRegistry::DuplicateCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return duplicate_count;
+}
+
+std::uint64_t MeshRegistry::SavedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return saved_bytes;
+}
+
+std::string MeshRegistry::Report() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer), "mesh registry: %u unique meshes, %u duplicates shared, %llu bytes saved\n",
+                  mesh_count, duplicate_count, (unsigned long long)saved_bytes);
+    return buffer;
+}
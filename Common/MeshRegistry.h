@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Util.h"
+
+//-----------------------------MeshRegistry--------------------------------
+// 按 CPU 端数据 (blob 或映射的 .mesh 文件) 和 submesh 表的内容去重, 内容相同的 MeshGeometry 共用同一份 GPU 缓冲
+// 缓冲相同但 drawargs 不同的网格不共用, 否则后登记的网格会拿到别人的 submesh 表
+// 在创建 GPU 缓冲之前调用 Intern, 重复的网格就不会再上传
+class MeshRegistry
+{
+    public:
+        MeshRegistry() = default;
+
+        MeshRegistry(const MeshRegistry& rhs) = delete;
+        MeshRegistry& operator=(const MeshRegistry& rhs) = delete;
+
+        // 返回已登记的相同网格, 没有时登记 geometry 并返回它
+        // is_new 为 true 时调用者还需要为它创建 GPU 缓冲; 可以在多个线程同时调用
+        std::shared_ptr<MeshGeometry> Intern(std::shared_ptr<MeshGeometry> geometry, bool& is_new);
+
+        // 按 Intern 时的 MeshGeometry::id 查找, 返回的是 Intern 返回的那一个 (内容重复时是共用的网格); 找不到时返回 nullptr
+        std::shared_ptr<MeshGeometry> Find(StringId id) const;
+
+        UINT MeshCount() const;
+        UINT DuplicateCount() const;
+        // 因为共享而没有上传的字节数
+        std::uint64_t SavedBytes() const;
+        std::string Report() const;
+
+        // 哈希 CPU 端数据, 解释它们的字段 (步长, 索引格式) 和 drawargs, 名字不参与
+        static std::uint64_t ContentHash(const MeshGeometry& geometry);
+
+    private:
+        static bool SameContent(const MeshGeometry& a, const MeshGeometry& b);
+        static bool SameDrawargs(const MeshGeometry& a, const MeshGeometry& b);
+
+    private:
+        // 哈希冲突时同一个桶里有多个网格, 逐字节比较区分
+        std::unordered_map<std::uint64_t, std::vector<std::shared_ptr<MeshGeometry>>> meshes;
+        FlatIdMap<std::shared_ptr<MeshGeometry>> meshes_by_id;
+        UINT mesh_count = 0;
+        UINT duplicate_count = 0;
+        std::uint64_t saved_bytes = 0;
+
+        mutable std::mutex mutex;
+};
@@ -0,0 +1,607 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <DirectXMath.h>
+
+#include "JobSystem.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // Manifold: 内部顶点, 可以折叠到任意相邻顶点
+    // Border:   开放边界上的顶点, 只能沿边界折叠到另一个边界顶点
+    // Seam:     同一位置有两个编号的接缝顶点, 两个编号沿接缝同时折叠
+    // Locked:   其它情况 (角点, 多条接缝/边界交汇), 不移动
+    enum class VertexKind : std::uint8_t
+    {
+        Manifold,
+        Border,
+        Seam,
+        Locked
+    };
+
+    constexpr std::uint32_t no_vertex = 0xFFFFFFFF;
+    // 一个顶点有多条开放边
+    constexpr std::uint32_t many_vertices = 0xFFFFFFFE;
+    // 边界/接缝边的约束平面相对三角形平面的权重
+    constexpr float border_weight = 10.0f;
+    // 折叠后三角形法线变化超过约 75 度视为翻转
+    constexpr float min_normal_cos = 0.25f;
+
+    // 平面距离平方的二次型, 除以 weight 后是加权平均的距离平方
+    struct Quadric
+    {
+        float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f, a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+        float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+        float c = 0.0f;
+        float weight = 0.0f;
+
+        // 平面 dot(n, p) + d = 0, n 是单位向量
+        static Quadric FromPlane(const XMFLOAT3& n, float d, float w)
+        {
+            Quadric q;
+            q.a00 = w * n.x * n.x;
+            q.a11 = w * n.y * n.y;
+            q.a22 = w * n.z * n.z;
+            q.a01 = w * n.x * n.y;
+            q.a02 = w * n.x * n.z;
+            q.a12 = w * n.y * n.z;
+            q.b0 = w * n.x * d;
+            q.b1 = w * n.y * d;
+            q.b2 = w * n.z * d;
+            q.c = w * d * d;
+            q.weight = w;
+            return q;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22;
+            a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        float Error(const XMFLOAT3& p) const
+        {
+            const float rx = a00 * p.x + a01 * p.y + a02 * p.z + 2.0f * b0;
+            const float ry = a01 * p.x + a11 * p.y + a12 * p.z + 2.0f * b1;
+            const float rz = a02 * p.x + a12 * p.y + a22 * p.z + 2.0f * b2;
+            const float error = p.x * rx + p.y * ry + p.z * rz + c;
+            return weight > 0.0f ? std::fabs(error) / weight : 0.0f;
+        }
+    };
+
+    struct PositionKey
+    {
+        std::uint32_t bits[3];
+
+        bool operator==(const PositionKey& rhs) const
+        {
+            return bits[0] == rhs.bits[0] && bits[1] == rhs.bits[1] && bits[2] == rhs.bits[2];
+        }
+    };
+
+    struct PositionKeyHash
+    {
+        std::size_t operator()(const PositionKey& key) const
+        {
+            std::uint64_t h = 0xcbf29ce484222325ull;
+            for(std::uint32_t b : key.bits)
+                h = (h ^ b) * 0x100000001b3ull;
+            return (std::size_t)h;
+        }
+    };
+
+    struct Collapse
+    {
+        std::uint32_t v0;
+        std::uint32_t v1;
+        float cost;
+    };
+
+    std::uint64_t EdgeKey(std::uint32_t a, std::uint32_t b)
+    {
+        return ((std::uint64_t)a << 32) | b;
+    }
+
+    XMVECTOR XM_CALLCONV TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+    {
+        const XMVECTOR a = XMLoadFloat3(&p0);
+        return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), a), XMVectorSubtract(XMLoadFloat3(&p2), a));
+    }
+
+    class Simplifier
+    {
+        public:
+            Simplifier(std::vector<std::uint32_t>& indices, const void* positions, std::size_t vertex_count, std::uint32_t stride)
+            :indices(indices), vertex_count(vertex_count)
+            {
+                LoadPositions(positions, stride);
+                BuildWedges();
+                ClassifyVertices();
+                BuildQuadrics();
+            }
+
+            // 返回模型空间的最大误差
+            float Run(std::size_t target_index_count, float target_error)
+            {
+                const float max_error = target_error / scale;
+                const float max_error_sq = max_error * max_error;
+                float result_error_sq = 0.0f;
+
+                std::vector<Collapse> collapses;
+                std::vector<std::uint8_t> locked(quadrics.size());
+                collapse_remap.resize(vertex_count);
+
+                while(indices.size() > target_index_count)
+                {
+                    BuildAdjacency();
+                    CollectCollapses(collapses);
+                    if(collapses.empty())
+                        break;
+                    std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){ return a.cost < b.cost; });
+
+                    const std::size_t removable = (indices.size() - target_index_count) / 3;
+                    std::size_t removed = 0;
+                    std::size_t collapse_count = 0;
+                    std::fill(locked.begin(), locked.end(), 0);
+                    for(std::uint32_t v = 0; v < vertex_count; ++v)
+                        collapse_remap[v] = v;
+
+                    // 同一轮中折叠过的顶点周围的三角形不再变化, 翻转检查用的位置才是准确的
+                    for(const Collapse& collapse : collapses)
+                    {
+                        if(collapse.cost > max_error_sq || removed >= removable)
+                            break;
+
+                        const std::uint32_t p0 = position_ids[collapse.v0];
+                        const std::uint32_t p1 = position_ids[collapse.v1];
+                        if(locked[p0] || locked[p1] || Flips(collapse))
+                            continue;
+
+                        Apply(collapse);
+                        LockNeighbors(locked, collapse.v0);
+                        if(kinds[collapse.v0] == VertexKind::Seam)
+                            LockNeighbors(locked, wedges[collapse.v0]);
+                        removed += kinds[collapse.v0] == VertexKind::Border ? 1 : 2;
+                        result_error_sq = std::max(result_error_sq, collapse.cost);
+                        ++collapse_count;
+                    }
+                    if(collapse_count == 0)
+                        break;
+
+                    RemapIndices();
+                }
+                return std::sqrt(result_error_sq) * scale;
+            }
+
+        private:
+            // 缩放到单位立方体内, 二次型用 float 时精度更稳定
+            void LoadPositions(const void* source, std::uint32_t stride)
+            {
+                positions.resize(vertex_count);
+                const std::uint8_t* base = static_cast<const std::uint8_t*>(source);
+                for(std::size_t v = 0; v < vertex_count; ++v)
+                    std::memcpy(&positions[v], base + v * stride, sizeof(XMFLOAT3));
+
+                XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+                XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+                for(std::uint32_t index : indices)
+                {
+                    const XMVECTOR p = XMLoadFloat3(&positions[index]);
+                    lo = XMVectorMin(lo, p);
+                    hi = XMVectorMax(hi, p);
+                }
+                if(indices.empty())
+                    lo = hi = XMVectorZero();
+
+                XMFLOAT3 extent;
+                XMStoreFloat3(&extent, XMVectorSubtract(hi, lo));
+                scale = std::max(std::max(extent.x, extent.y), extent.z);
+                if(scale <= 0.0f)
+                    scale = 1.0f;
+
+                const XMVECTOR inv_scale = XMVectorReplicate(1.0f / scale);
+                for(XMFLOAT3& p : positions)
+                    XMStoreFloat3(&p, XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&p), lo), inv_scale));
+            }
+
+            // 位置完全相同的顶点共用一个 position id, 并串成环形链表 wedges
+            void BuildWedges()
+            {
+                std::vector<std::uint8_t> used(vertex_count, 0);
+                for(std::uint32_t index : indices)
+                    used[index] = 1;
+
+                position_ids.assign(vertex_count, no_vertex);
+                wedges.resize(vertex_count);
+                std::unordered_map<PositionKey, std::uint32_t, PositionKeyHash> first_vertex;
+                first_vertex.reserve(vertex_count);
+
+                std::uint32_t position_count = 0;
+                for(std::uint32_t v = 0; v < vertex_count; ++v)
+                {
+                    wedges[v] = v;
+                    if(!used[v])
+                        continue;
+
+                    PositionKey key;
+                    std::memcpy(key.bits, &positions[v], sizeof(key.bits));
+                    auto [it, inserted] = first_vertex.try_emplace(key, v);
+                    if(inserted)
+                    {
+                        position_ids[v] = position_count++;
+                    }
+                    else
+                    {
+                        const std::uint32_t first = it->second;
+                        position_ids[v] = position_ids[first];
+                        wedges[v] = wedges[first];
+                        wedges[first] = v;
+                    }
+                }
+                quadrics.resize(position_count);
+            }
+
+            // 开放边: 有 a->b 没有 b->a, 记录每个顶点唯一的开放出边和入边
+            void ClassifyVertices()
+            {
+                std::unordered_set<std::uint64_t> edges;
+                edges.reserve(indices.size());
+                for(std::size_t i = 0; i < indices.size(); i += 3)
+                {
+                    for(int k = 0; k < 3; ++k)
+                        edges.insert(EdgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+                }
+
+                open_out.assign(vertex_count, no_vertex);
+                open_in.assign(vertex_count, no_vertex);
+                open_edges.assign(indices.size(), 0);
+                for(std::size_t i = 0; i < indices.size(); i += 3)
+                {
+                    for(int k = 0; k < 3; ++k)
+                    {
+                        const std::uint32_t a = indices[i + k];
+                        const std::uint32_t b = indices[i + (k + 1) % 3];
+                        if(edges.count(EdgeKey(b, a)))
+                            continue;
+                        open_edges[i + k] = 1;
+                        open_out[a] = open_out[a] == no_vertex ? b : many_vertices;
+                        open_in[b] = open_in[b] == no_vertex ? a : many_vertices;
+                    }
+                }
+
+                kinds.assign(vertex_count, VertexKind::Locked);
+                for(std::uint32_t v = 0; v < vertex_count; ++v)
+                {
+                    if(position_ids[v] == no_vertex)
+                        continue;
+
+                    const std::uint32_t w = wedges[v];
+                    if(w == v)
+                    {
+                        if(open_out[v] == no_vertex && open_in[v] == no_vertex)
+                            kinds[v] = VertexKind::Manifold;
+                        else if(HasSingleLoop(v))
+                            kinds[v] = VertexKind::Border;
+                    }
+                    else if(wedges[w] == v && HasSingleLoop(v) && HasSingleLoop(w)
+                            && position_ids[open_out[v]] == position_ids[open_in[w]]
+                            && position_ids[open_in[v]] == position_ids[open_out[w]])
+                    {
+                        // 两侧的开放边方向相反地重合在一起
+                        kinds[v] = VertexKind::Seam;
+                    }
+                }
+            }
+
+            bool HasSingleLoop(std::uint32_t v) const
+            {
+                return open_out[v] < many_vertices && open_in[v] < many_vertices;
+            }
+
+            // 每个三角形的平面按面积加权, 开放边再加一个过这条边且垂直于三角形的平面
+            void BuildQuadrics()
+            {
+                for(std::size_t i = 0; i < indices.size(); i += 3)
+                {
+                    const std::uint32_t tri[3] = {indices[i], indices[i + 1], indices[i + 2]};
+                    const XMVECTOR cross = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+                    const float length = XMVectorGetX(XMVector3Length(cross));
+                    if(length <= 0.0f)
+                        continue;
+
+                    const XMVECTOR n = XMVectorScale(cross, 1.0f / length);
+                    XMFLOAT3 normal;
+                    XMStoreFloat3(&normal, n);
+                    const float d = -XMVectorGetX(XMVector3Dot(n, XMLoadFloat3(&positions[tri[0]])));
+                    const Quadric plane = Quadric::FromPlane(normal, d, 0.5f * length);
+                    for(std::uint32_t v : tri)
+                        quadrics[position_ids[v]].Add(plane);
+
+                    for(int k = 0; k < 3; ++k)
+                    {
+                        if(!open_edges[i + k])
+                            continue;
+                        const std::uint32_t a = tri[k];
+                        const std::uint32_t b = tri[(k + 1) % 3];
+
+                        const XMVECTOR pa = XMLoadFloat3(&positions[a]);
+                        const XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&positions[b]), pa);
+                        const float edge_length_sq = XMVectorGetX(XMVector3LengthSq(edge));
+                        if(edge_length_sq <= 0.0f)
+                            continue;
+
+                        const XMVECTOR edge_normal = XMVector3Normalize(XMVector3Cross(edge, n));
+                        XMFLOAT3 en;
+                        XMStoreFloat3(&en, edge_normal);
+                        const float ed = -XMVectorGetX(XMVector3Dot(edge_normal, pa));
+                        const Quadric constraint = Quadric::FromPlane(en, ed, edge_length_sq * border_weight);
+                        quadrics[position_ids[a]].Add(constraint);
+                        quadrics[position_ids[b]].Add(constraint);
+                    }
+                }
+            }
+
+            // 每个顶点用到的三角形, 每一轮开始时重建
+            void BuildAdjacency()
+            {
+                adjacency_offsets.assign(vertex_count + 1, 0);
+                for(std::uint32_t index : indices)
+                    ++adjacency_offsets[index + 1];
+                for(std::size_t v = 0; v < vertex_count; ++v)
+                    adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+                adjacency.resize(indices.size());
+                std::vector<std::uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+                for(std::size_t i = 0; i < indices.size(); ++i)
+                    adjacency[cursor[indices[i]]++] = (std::uint32_t)(i / 3);
+            }
+
+            void LockNeighbors(std::vector<std::uint8_t>& locked, std::uint32_t v) const
+            {
+                for(std::uint32_t i = adjacency_offsets[v]; i < adjacency_offsets[v + 1]; ++i)
+                {
+                    const std::uint32_t* tri = &indices[adjacency[i] * 3];
+                    for(int k = 0; k < 3; ++k)
+                        locked[position_ids[tri[k]]] = 1;
+                }
+            }
+
+            bool IsLoopEdge(std::uint32_t a, std::uint32_t b) const
+            {
+                return open_out[a] == b || open_in[a] == b;
+            }
+
+            bool CanCollapse(std::uint32_t v0, std::uint32_t v1) const
+            {
+                if(position_ids[v0] == position_ids[v1])
+                    return false;
+
+                switch(kinds[v0])
+                {
+                    case VertexKind::Manifold:
+                        return true;
+                    case VertexKind::Border:
+                        return kinds[v1] == VertexKind::Border && IsLoopEdge(v0, v1);
+                    case VertexKind::Seam:
+                        return kinds[v1] == VertexKind::Seam && IsLoopEdge(v0, v1) && IsLoopEdge(wedges[v0], wedges[v1]);
+                    default:
+                        return false;
+                }
+            }
+
+            void CollectCollapses(std::vector<Collapse>& collapses) const
+            {
+                collapses.clear();
+                for(std::size_t i = 0; i < indices.size(); i += 3)
+                {
+                    for(int k = 0; k < 3; ++k)
+                    {
+                        const std::uint32_t a = indices[i + k];
+                        const std::uint32_t b = indices[i + (k + 1) % 3];
+                        // 内部边在两个三角形中各出现一次, 只从一侧收集
+                        if(a > b && !IsLoopEdge(a, b))
+                            continue;
+
+                        const bool ab = CanCollapse(a, b);
+                        const bool ba = CanCollapse(b, a);
+                        if(!ab && !ba)
+                            continue;
+
+                        const float cost_ab = ab ? quadrics[position_ids[a]].Error(positions[b]) : FLT_MAX;
+                        const float cost_ba = ba ? quadrics[position_ids[b]].Error(positions[a]) : FLT_MAX;
+                        collapses.push_back(cost_ab <= cost_ba ? Collapse{a, b, cost_ab} : Collapse{b, a, cost_ba});
+                    }
+                }
+            }
+
+            bool FlipsAround(std::uint32_t v0, std::uint32_t v1) const
+            {
+                const std::uint32_t p1 = position_ids[v1];
+                for(std::uint32_t i = adjacency_offsets[v0]; i < adjacency_offsets[v0 + 1]; ++i)
+                {
+                    const std::uint32_t* tri = &indices[adjacency[i] * 3];
+                    if(position_ids[tri[0]] == p1 || position_ids[tri[1]] == p1 || position_ids[tri[2]] == p1)
+                        continue;
+
+                    XMFLOAT3 moved[3];
+                    for(int k = 0; k < 3; ++k)
+                        moved[k] = positions[tri[k] == v0 ? v1 : tri[k]];
+
+                    const XMVECTOR before = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+                    const XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+                    const float dot = XMVectorGetX(XMVector3Dot(before, after));
+                    const float lengths = XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+                    if(dot < min_normal_cos * lengths)
+                        return true;
+                }
+                return false;
+            }
+
+            bool Flips(const Collapse& collapse) const
+            {
+                if(FlipsAround(collapse.v0, collapse.v1))
+                    return true;
+                return kinds[collapse.v0] == VertexKind::Seam && FlipsAround(wedges[collapse.v0], wedges[collapse.v1]);
+            }
+
+            // 被折叠的开放边两端接起来
+            void RemapLoop(std::uint32_t v0, std::uint32_t v1)
+            {
+                const std::uint32_t next = open_out[v0];
+                const std::uint32_t prev = open_in[v0];
+                if(next == v1 && prev < many_vertices)
+                {
+                    open_out[prev] = v1;
+                    open_in[v1] = prev;
+                }
+                else if(prev == v1 && next < many_vertices)
+                {
+                    open_out[v1] = next;
+                    open_in[next] = v1;
+                }
+            }
+
+            void Apply(const Collapse& collapse)
+            {
+                const std::uint32_t v0 = collapse.v0;
+                const std::uint32_t v1 = collapse.v1;
+                collapse_remap[v0] = v1;
+                if(kinds[v0] == VertexKind::Border)
+                {
+                    RemapLoop(v0, v1);
+                }
+                else if(kinds[v0] == VertexKind::Seam)
+                {
+                    collapse_remap[wedges[v0]] = wedges[v1];
+                    RemapLoop(v0, v1);
+                    RemapLoop(wedges[v0], wedges[v1]);
+                }
+                quadrics[position_ids[v1]].Add(quadrics[position_ids[v0]]);
+            }
+
+            // 同一轮的折叠互不相连, remap 不会形成链
+            void RemapIndices()
+            {
+                std::size_t write = 0;
+                for(std::size_t i = 0; i < indices.size(); i += 3)
+                {
+                    const std::uint32_t a = collapse_remap[indices[i]];
+                    const std::uint32_t b = collapse_remap[indices[i + 1]];
+                    const std::uint32_t c = collapse_remap[indices[i + 2]];
+                    if(a == b || b == c || c == a)
+                        continue;
+                    indices[write++] = a;
+                    indices[write++] = b;
+                    indices[write++] = c;
+                }
+                indices.resize(write);
+            }
+
+        private:
+            std::vector<std::uint32_t>& indices;
+            std::size_t vertex_count;
+
+            std::vector<XMFLOAT3> positions;
+            float scale = 1.0f;
+
+            std::vector<std::uint32_t> position_ids;
+            std::vector<std::uint32_t> wedges;
+            std::vector<std::uint32_t> open_out;
+            std::vector<std::uint32_t> open_in;
+            // 初始索引中 i -> i 所在三角形的下一个顶点 这条边是否开放, 只在建二次型时使用
+            std::vector<std::uint8_t> open_edges;
+            std::vector<VertexKind> kinds;
+            std::vector<Quadric> quadrics;
+
+            std::vector<std::uint32_t> adjacency_offsets;
+            std::vector<std::uint32_t> adjacency;
+            std::vector<std::uint32_t> collapse_remap;
+    };
+
+    float BoundsDiagonal(const LodSource& source)
+    {
+        XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+        XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+        const std::uint8_t* base = static_cast<const std::uint8_t*>(source.positions);
+        for(std::size_t i = 0; i < source.index_count; ++i)
+        {
+            const XMVECTOR p = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(base + (std::size_t)source.indices[i] * source.position_stride));
+            lo = XMVectorMin(lo, p);
+            hi = XMVectorMax(hi, p);
+        }
+        return source.index_count > 0 ? XMVectorGetX(XMVector3Length(XMVectorSubtract(hi, lo))) : 0.0f;
+    }
+}
+
+template<typename T>
+std::size_t SimplifyMesh(T* destination, const T* indices, std::size_t index_count,
+                         const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                         std::size_t target_index_count, float target_error, float* result_error)
+{
+    std::vector<std::uint32_t> working(indices, indices + index_count - index_count % 3);
+    Simplifier simplifier(working, positions, vertex_count, position_stride);
+    const float error = simplifier.Run(target_index_count, target_error);
+
+    for(std::size_t i = 0; i < working.size(); ++i)
+        destination[i] = (T)working[i];
+    if(result_error != nullptr)
+        *result_error = error;
+    return working.size();
+}
+
+std::vector<LodLevel> GenerateLodChain(const LodSource& source, const LodSettings& settings)
+{
+    std::vector<LodLevel> chain(1);
+    chain[0].indices.assign(source.indices, source.indices + source.index_count);
+
+    const float max_error = settings.max_relative_error * BoundsDiagonal(source);
+    while(chain.size() < settings.max_lod_count)
+    {
+        const LodLevel& previous = chain.back();
+        const std::size_t previous_count = previous.indices.size();
+        const std::size_t target = (std::size_t)((float)(previous_count / 3) * settings.reduction) * 3;
+        if(previous.error >= max_error || target == 0)
+            break;
+
+        LodLevel level;
+        level.indices.resize(previous_count);
+        float error = 0.0f;
+        const std::size_t count = SimplifyMesh(level.indices.data(), previous.indices.data(), previous_count,
+                                               source.positions, source.vertex_count, source.position_stride,
+                                               target, max_error - previous.error, &error);
+        if(count == 0 || count * 20 > previous_count * 19)
+            break;
+
+        level.indices.resize(count);
+        OptimizeVertexCache(level.indices.data(), level.indices.data(), count, source.vertex_count);
+        // 从上一级简化, 误差累加作为相对 LOD0 的上界
+        level.error = previous.error + error;
+        chain.push_back(std::move(level));
+    }
+    return chain;
+}
+
+std::vector<std::vector<LodLevel>> GenerateLodChains(JobSystem& jobs, const std::vector<LodSource>& sources,
+                                                     const LodSettings& settings)
+{
+    std::vector<std::vector<LodLevel>> chains(sources.size());
+    jobs.ParallelFor((std::uint32_t)sources.size(), 1, [&](std::uint32_t begin, std::uint32_t end){
+        for(std::uint32_t i = begin; i < end; ++i)
+            chains[i] = GenerateLodChain(sources[i], settings);
+    });
+    return chains;
+}
+
+template std::size_t SimplifyMesh<std::uint16_t>(std::uint16_t*, const std::uint16_t*, std::size_t, const void*, std::size_t, std::uint32_t, std::size_t, float, float*);
+template std::size_t SimplifyMesh<std::uint32_t>(std::uint32_t*, const std::uint32_t*, std::size_t, const void*, std::size_t, std::uint32_t, std::size_t, float, float*);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+//-----------------------------MeshSimplifier--------------------------------
+// Garland-Heckbert 二次误差 (QEM) 边折叠, 顶点只合并到已有的顶点上, 简化后的索引仍然引用原来的顶点缓冲,
+// 所以各级 LOD 可以共用一份顶点缓冲, 只是 drawargs 中不同的索引范围
+// 位置相同但编号不同的顶点 (法线/uv/颜色不连续的接缝) 只能沿接缝成对折叠, 开放边界只能沿边界折叠
+
+// 返回简化后的索引数, destination 至少 index_count 个, 可以和 indices 是同一块内存
+// 三角形数降到 target_index_count 或者下一次折叠的误差超过 target_error (模型空间距离) 时停止
+// result_error 不为 nullptr 时返回实际的最大误差
+template<typename T>
+std::size_t SimplifyMesh(T* destination, const T* indices, std::size_t index_count,
+                         const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                         std::size_t target_index_count, float target_error, float* result_error = nullptr);
+
+//-----------------------------LOD chain--------------------------------
+struct LodLevel
+{
+    std::vector<std::uint32_t> indices;
+    // 相对 LOD0 的几何误差上界, 模型空间距离
+    float error = 0.0f;
+};
+
+struct LodSettings
+{
+    // 包括 LOD0
+    std::uint32_t max_lod_count = 5;
+    // 每一级的目标三角形数相对上一级的比例
+    float reduction = 0.5f;
+    // 误差上限, 相对于网格包围盒对角线的长度
+    float max_relative_error = 0.05f;
+};
+
+struct LodSource
+{
+    const std::uint32_t* indices = nullptr;
+    std::size_t index_count = 0;
+    // XMFLOAT3
+    const void* positions = nullptr;
+    std::size_t vertex_count = 0;
+    std::uint32_t position_stride = 0;
+};
+
+// LOD0 是原始索引, 之后每一级从上一级简化再做 vertex cache 优化, 三角形减少不到 5% 时停止
+std::vector<LodLevel> GenerateLodChain(const LodSource& source, const LodSettings& settings = {});
+
+// 每个 submesh 一个 job, 返回前全部完成
+std::vector<std::vector<LodLevel>> GenerateLodChains(JobSystem& jobs, const std::vector<LodSource>& sources,
+                                                     const LodSettings& settings = {});
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Bounds.h"
+#include "Meshlet.h"
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr std::uint32_t no_local_vertex = 0xFFFFFFFF;
+    // 法线锥半角超过约 84 度时剔除率很低, 不值得在 GPU 上测试
+    constexpr float min_cone_dot = 0.1f;
+
+    XMVECTOR XM_CALLCONV LoadPosition(const void* positions, std::uint32_t stride, std::size_t index)
+    {
+        return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(static_cast<const std::uint8_t*>(positions) + index * stride));
+    }
+
+    template<typename T>
+    class MeshletBuilder
+    {
+        public:
+            MeshletBuilder(const T* indices, std::size_t index_count,
+                           const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                           std::uint32_t max_vertices, std::uint32_t max_triangles)
+            :indices(indices), positions(positions), position_stride(position_stride),
+             max_vertices(max_vertices), max_triangles(max_triangles)
+            {
+                const std::size_t triangle_count = index_count / 3;
+                emitted.assign(triangle_count, 0);
+                local_vertex.assign(vertex_count, no_local_vertex);
+
+                // 面积为 0 的三角形法线为 0, 不参与法线锥
+                normals.resize(triangle_count);
+                for(std::size_t t = 0; t < triangle_count; ++t)
+                {
+                    const XMVECTOR p0 = LoadPosition(positions, position_stride, indices[t * 3 + 0]);
+                    const XMVECTOR p1 = LoadPosition(positions, position_stride, indices[t * 3 + 1]);
+                    const XMVECTOR p2 = LoadPosition(positions, position_stride, indices[t * 3 + 2]);
+                    XMStoreFloat3(&normals[t], XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0))));
+                }
+
+                // 每个顶点用到的三角形: adjacency[offsets[v] .. offsets[v + 1])
+                offsets.assign(vertex_count + 1, 0);
+                for(std::size_t i = 0; i < triangle_count * 3; ++i)
+                    ++offsets[indices[i] + 1];
+                for(std::size_t v = 0; v < vertex_count; ++v)
+                    offsets[v + 1] += offsets[v];
+                adjacency.resize(triangle_count * 3);
+                std::vector<std::uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for(std::size_t i = 0; i < triangle_count * 3; ++i)
+                    adjacency[cursor[indices[i]]++] = (std::uint32_t)(i / 3);
+            }
+
+            MeshletBuffers Build()
+            {
+                const std::size_t triangle_count = emitted.size();
+                std::size_t seed = 0;
+                for(std::size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+                {
+                    std::uint32_t next = PickCandidate();
+                    if(next == no_local_vertex)
+                    {
+                        Flush();
+                        while(emitted[seed])
+                            ++seed;
+                        next = (std::uint32_t)seed;
+                    }
+
+                    AddTriangle(next);
+                    if(current_triangles.size() == max_triangles)
+                        Flush();
+                }
+                Flush();
+                return std::move(buffers);
+            }
+
+        private:
+            std::uint32_t NewVertexCount(std::uint32_t triangle) const
+            {
+                std::uint32_t count = 0;
+                for(int k = 0; k < 3; ++k)
+                    count += local_vertex[indices[triangle * 3 + k]] == no_local_vertex ? 1 : 0;
+                return count;
+            }
+
+            // 没有能放进当前 meshlet 的相邻三角形时返回 no_local_vertex
+            std::uint32_t PickCandidate()
+            {
+                if(current_triangles.empty())
+                    return no_local_vertex;
+
+                const XMVECTOR axis = XMVector3Normalize(XMLoadFloat3(&normal_sum));
+                std::uint32_t best = no_local_vertex;
+                float best_score = 0.0f;
+
+                std::size_t live = 0;
+                for(std::size_t i = 0; i < candidates.size(); ++i)
+                {
+                    const std::uint32_t triangle = candidates[i];
+                    if(emitted[triangle])
+                        continue;
+                    candidates[live++] = triangle;
+
+                    const std::uint32_t new_vertices = NewVertexCount(triangle);
+                    if(current_vertices.size() + new_vertices > max_vertices)
+                        continue;
+
+                    // 新增顶点数优先, 法线偏离程度在 [0, 2] 之间只用来区分顶点数相同的情况
+                    const float deviation = 1.0f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[triangle]), axis));
+                    const float score = (float)new_vertices * 4.0f + deviation;
+                    if(best == no_local_vertex || score < best_score)
+                    {
+                        best = triangle;
+                        best_score = score;
+                    }
+                }
+                candidates.resize(live);
+                return best;
+            }
+
+            void AddTriangle(std::uint32_t triangle)
+            {
+                emitted[triangle] = 1;
+                for(int k = 0; k < 3; ++k)
+                {
+                    const std::uint32_t v = indices[triangle * 3 + k];
+                    if(local_vertex[v] != no_local_vertex)
+                        continue;
+
+                    local_vertex[v] = (std::uint32_t)current_vertices.size();
+                    current_vertices.push_back(v);
+                    for(std::uint32_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                    {
+                        if(!emitted[adjacency[i]])
+                            candidates.push_back(adjacency[i]);
+                    }
+                }
+                current_triangles.push_back(triangle);
+                XMStoreFloat3(&normal_sum, XMVectorAdd(XMLoadFloat3(&normal_sum), XMLoadFloat3(&normals[triangle])));
+            }
+
+            void Flush()
+            {
+                if(current_triangles.empty())
+                    return;
+
+                Meshlet meshlet;
+                meshlet.vertex_count = (std::uint32_t)current_vertices.size();
+                meshlet.vertex_offset = (std::uint32_t)buffers.vertex_indices.size();
+                meshlet.primitive_count = (std::uint32_t)current_triangles.size();
+                meshlet.primitive_offset = (std::uint32_t)buffers.primitive_indices.size();
+                buffers.meshlets.push_back(meshlet);
+
+                buffers.vertex_indices.insert(buffers.vertex_indices.end(), current_vertices.begin(), current_vertices.end());
+                for(std::uint32_t triangle : current_triangles)
+                {
+                    buffers.primitive_indices.push_back(PackMeshletTriangle(local_vertex[indices[triangle * 3 + 0]],
+                                                                            local_vertex[indices[triangle * 3 + 1]],
+                                                                            local_vertex[indices[triangle * 3 + 2]]));
+                }
+                buffers.bounds.push_back(ComputeMeshletBounds());
+
+                for(std::uint32_t v : current_vertices)
+                    local_vertex[v] = no_local_vertex;
+                current_vertices.clear();
+                current_triangles.clear();
+                candidates.clear();
+                normal_sum = {0.0f, 0.0f, 0.0f};
+            }
+
+            // Ritter 包围球, 法线锥的顶点放在所有三角形平面的背面, 这样从锥外看过去所有三角形都是背面
+            MeshletBounds ComputeMeshletBounds() const
+            {
+                MeshletBounds bounds;
+                const MeshBounds sphere = ComputeBounds(current_vertices.data(), current_vertices.size(), positions, position_stride);
+                bounds.center = sphere.sphere.Center;
+                bounds.radius = sphere.sphere.Radius;
+                bounds.cone_apex = bounds.center;
+
+                const XMVECTOR sum = XMLoadFloat3(&normal_sum);
+                if(XMVectorGetX(XMVector3LengthSq(sum)) < 1e-12f)
+                    return bounds;
+                const XMVECTOR axis = XMVector3Normalize(sum);
+
+                float min_dot = 1.0f;
+                for(std::uint32_t triangle : current_triangles)
+                {
+                    const XMVECTOR n = XMLoadFloat3(&normals[triangle]);
+                    if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+                        min_dot = std::min(min_dot, XMVectorGetX(XMVector3Dot(n, axis)));
+                }
+                XMStoreFloat3(&bounds.cone_axis, axis);
+                if(min_dot <= min_cone_dot)
+                    return bounds;
+
+                // 沿 -axis 从球心移到所有三角形平面之后
+                const XMVECTOR center = XMLoadFloat3(&bounds.center);
+                float max_t = 0.0f;
+                for(std::uint32_t triangle : current_triangles)
+                {
+                    const XMVECTOR n = XMLoadFloat3(&normals[triangle]);
+                    const float dn = XMVectorGetX(XMVector3Dot(n, axis));
+                    if(dn <= 0.0f)
+                        continue;
+                    const XMVECTOR p0 = LoadPosition(positions, position_stride, indices[triangle * 3]);
+                    const float t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), n)) / dn;
+                    max_t = std::max(max_t, t);
+                }
+                XMStoreFloat3(&bounds.cone_apex, XMVectorNegativeMultiplySubtract(axis, XMVectorReplicate(max_t), center));
+                bounds.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+                return bounds;
+            }
+
+        private:
+            const T* indices;
+            const void* positions;
+            std::uint32_t position_stride;
+            std::uint32_t max_vertices;
+            std::uint32_t max_triangles;
+
+            std::vector<XMFLOAT3> normals;
+            std::vector<std::uint32_t> offsets;
+            std::vector<std::uint32_t> adjacency;
+            std::vector<std::uint8_t> emitted;
+            // 顶点在当前 meshlet 中的局部编号
+            std::vector<std::uint32_t> local_vertex;
+
+            std::vector<std::uint32_t> current_vertices;
+            std::vector<std::uint32_t> current_triangles;
+            // 和当前 meshlet 共享顶点的三角形, 可能有重复和已经输出的, 在 PickCandidate 中清理
+            std::vector<std::uint32_t> candidates;
+            XMFLOAT3 normal_sum = {0.0f, 0.0f, 0.0f};
+
+            MeshletBuffers buffers;
+    };
+}
+
+template<typename T>
+MeshletBuffers BuildMeshlets(const T* indices, std::size_t index_count,
+                             const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                             std::uint32_t max_vertices, std::uint32_t max_triangles)
+{
+    max_vertices = std::clamp<std::uint32_t>(max_vertices, 3, 1024);
+    max_triangles = std::clamp<std::uint32_t>(max_triangles, 1, 512);
+
+    MeshletBuilder<T> builder(indices, index_count, positions, vertex_count, position_stride, max_vertices, max_triangles);
+    return builder.Build();
+}
+
+MeshletCullStats CullMeshlets(const MeshletBuffers& buffers,
+                              FXMMATRIX world_view_proj,
+                              const XMFLOAT3& camera_position,
+                              std::vector<std::uint32_t>* visible)
+{
+    // 从裁剪矩阵的列提取模型空间中的 6 个平面, 法线朝向视锥内部
+    const XMMATRIX m = XMMatrixTranspose(world_view_proj);
+    XMVECTOR planes[6] = {
+        XMVectorAdd(m.r[3], m.r[0]),
+        XMVectorSubtract(m.r[3], m.r[0]),
+        XMVectorAdd(m.r[3], m.r[1]),
+        XMVectorSubtract(m.r[3], m.r[1]),
+        m.r[2],
+        XMVectorSubtract(m.r[3], m.r[2]),
+    };
+    for(XMVECTOR& plane : planes)
+        plane = XMPlaneNormalize(plane);
+
+    const XMVECTOR camera = XMLoadFloat3(&camera_position);
+
+    MeshletCullStats stats;
+    stats.meshlet_count = (std::uint32_t)buffers.meshlets.size();
+    if(visible != nullptr)
+        visible->clear();
+
+    for(std::uint32_t i = 0; i < stats.meshlet_count; ++i)
+    {
+        const MeshletBounds& bounds = buffers.bounds[i];
+        const std::uint32_t primitive_count = buffers.meshlets[i].primitive_count;
+        stats.triangle_count += primitive_count;
+
+        const XMVECTOR center = XMVectorSetW(XMLoadFloat3(&bounds.center), 1.0f);
+        bool outside = false;
+        for(const XMVECTOR& plane : planes)
+            outside = outside || XMVectorGetX(XMVector4Dot(plane, center)) < -bounds.radius;
+        if(outside)
+        {
+            ++stats.frustum_culled;
+            continue;
+        }
+
+        const XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&bounds.cone_apex), camera));
+        if(XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&bounds.cone_axis))) > bounds.cone_cutoff)
+        {
+            ++stats.cone_culled;
+            continue;
+        }
+
+        stats.visible_triangles += primitive_count;
+        if(visible != nullptr)
+            visible->push_back(i);
+    }
+    return stats;
+}
+
+template MeshletBuffers BuildMeshlets<std::uint16_t>(const std::uint16_t*, std::size_t, const void*, std::size_t, std::uint32_t, std::uint32_t, std::uint32_t);
+template MeshletBuffers BuildMeshlets<std::uint32_t>(const std::uint32_t*, std::size_t, const void*, std::size_t, std::uint32_t, std::uint32_t, std::uint32_t);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+//-----------------------------Meshlet--------------------------------
+// 把 submesh 切成顶点数和三角形数有上限的 meshlet, 每个 meshlet 带包围球和法线锥, 用于 cluster 级别的剔除
+// 布局和 D3D12 mesh shader 示例一致, 可以直接作为 StructuredBuffer 上传:
+// vertex_indices:    每个 meshlet 用到的顶点 (submesh 内的编号), 连续存放
+// primitive_indices: 每个三角形一个 uint, 3 个 meshlet 内的局部顶点编号各占 10 位
+
+// NVIDIA 建议 64 个顶点 / 126 个三角形, 取 124 让三角形数据按 4 对齐
+constexpr std::uint32_t max_meshlet_vertices = 64;
+constexpr std::uint32_t max_meshlet_triangles = 124;
+
+struct Meshlet
+{
+    std::uint32_t vertex_count = 0;
+    std::uint32_t vertex_offset = 0;
+    std::uint32_t primitive_count = 0;
+    std::uint32_t primitive_offset = 0;
+};
+
+// 48 字节, 和 hlsl 中的 float3 + float 排列对应
+struct MeshletBounds
+{
+    DirectX::XMFLOAT3 center = {0.0f, 0.0f, 0.0f};
+    float radius = 0.0f;
+    // 所有三角形的法线都在以 cone_axis 为轴的锥内
+    DirectX::XMFLOAT3 cone_axis = {0.0f, 0.0f, 1.0f};
+    // 相机满足 dot(normalize(cone_apex - camera), cone_axis) > cone_cutoff 时整个 meshlet 背向相机
+    // 法线分布太散时为 1, 永远不会被剔除
+    float cone_cutoff = 1.0f;
+    DirectX::XMFLOAT3 cone_apex = {0.0f, 0.0f, 0.0f};
+    float padding = 0.0f;
+};
+
+struct MeshletBuffers
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+    std::vector<std::uint32_t> vertex_indices;
+    std::vector<std::uint32_t> primitive_indices;
+};
+
+// 从种子三角形开始贪心生长: 每次在和当前 meshlet 共享顶点的三角形中选新增顶点最少的,
+// 相同时选法线和 meshlet 平均法线最接近的, 让法线锥尽量窄
+// 输入最好已经做过 OptimizeVertexCache, 种子按输入顺序选取
+// max_vertices 不超过 1024 (10 位局部编号), max_triangles 不超过 512
+template<typename T>
+MeshletBuffers BuildMeshlets(const T* indices, std::size_t index_count,
+                             const void* positions, std::size_t vertex_count, std::uint32_t position_stride,
+                             std::uint32_t max_vertices = max_meshlet_vertices,
+                             std::uint32_t max_triangles = max_meshlet_triangles);
+
+inline std::uint32_t PackMeshletTriangle(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+{
+    return a | (b << 10) | (c << 20);
+}
+
+//-----------------------------culling--------------------------------
+struct MeshletCullStats
+{
+    std::uint32_t meshlet_count = 0;
+    std::uint32_t frustum_culled = 0;
+    std::uint32_t cone_culled = 0;
+    std::uint32_t triangle_count = 0;
+    std::uint32_t visible_triangles = 0;
+};
+
+// CPU 端的参考实现, 和 GPU 上 amplification shader 中的剔除一致
+// world_view_proj 为 D3D 约定 (行向量, z 在 [0, 1]), camera_position 在模型空间
+// visible 不为 nullptr 时写入可见 meshlet 的编号
+MeshletCullStats CullMeshlets(const MeshletBuffers& buffers,
+                              DirectX::FXMMATRIX world_view_proj,
+                              const DirectX::XMFLOAT3& camera_position,
+                              std::vector<std::uint32_t>* visible = nullptr);
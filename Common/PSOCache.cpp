@@ -0,0 +1,192 @@
+#include "PSOCache.h"
+
+namespace
+{
+    std::wstring PipelineName(std::uint64_t key)
+    {
+        wchar_t name[32];
+        swprintf_s(name, L"pso_%016llx", (unsigned long long)key);
+        return name;
+    }
+}
+
+//-------------------------------------PSOCache-----------------------------------
+PSOCache::PSOCache(ID3D12Device* device, const std::wstring& filename)
+:device(device), filename(filename)
+{
+    // 旧驱动/系统不支持 ID3D12Device1 时退化成直接创建PSO
+    if(FAILED(this->device.As(&device1)))
+        return;
+
+    MapFile();
+    CreateLibrary(mapped_data, mapped_bytesize);
+
+    // 缓存来自其他驱动版本或者已经损坏, 丢弃后重新建一个空的
+    if(library == nullptr && mapped_data != nullptr)
+    {
+        UnmapFile();
+        CreateLibrary(nullptr, 0);
+    }
+}
+
+PSOCache::~PSOCache()
+{
+    try
+    {
+        Save();
+    }
+    catch(DxException&)
+    {
+        // 写缓存失败不影响退出, 下次启动重新编译即可
+    }
+
+    library = nullptr;
+    UnmapFile();
+}
+
+void PSOCache::MapFile()
+{
+    file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER size = {};
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        UnmapFile();
+        return;
+    }
+
+    file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(file_mapping == nullptr)
+    {
+        UnmapFile();
+        return;
+    }
+
+    mapped_data = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+    if(mapped_data == nullptr)
+    {
+        UnmapFile();
+        return;
+    }
+    mapped_bytesize = (SIZE_T)size.QuadPart;
+}
+
+void PSOCache::UnmapFile()
+{
+    if(mapped_data != nullptr)
+    {
+        UnmapViewOfFile(mapped_data);
+        mapped_data = nullptr;
+    }
+    mapped_bytesize = 0;
+
+    if(file_mapping != nullptr)
+    {
+        CloseHandle(file_mapping);
+        file_mapping = nullptr;
+    }
+
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+}
+
+void PSOCache::CreateLibrary(const void* data, SIZE_T bytesize)
+{
+    library = nullptr;
+
+    HRESULT hr = device1->CreatePipelineLibrary(data, bytesize, IID_PPV_ARGS(library.GetAddressOf()));
+    if(FAILED(hr))
+    {
+        // D3D12_ERROR_DRIVER_VERSION_MISMATCH / D3D12_ERROR_ADAPTER_NOT_FOUND / DXGI_ERROR_UNSUPPORTED
+        library = nullptr;
+    }
+}
+
+ComPtr<ID3D12PipelineState> PSOCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                                  std::uint64_t root_signature_hash)
+{
+    const std::uint64_t key = HashGraphicsPipelineDesc(desc, root_signature_hash);
+    const std::wstring name = PipelineName(key);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = pipelines.find(key);
+        if(it != pipelines.end())
+        {
+            ++hit_count;
+            return it->second;
+        }
+
+        if(library != nullptr)
+        {
+            ComPtr<ID3D12PipelineState> pso;
+            if(SUCCEEDED(library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf()))))
+            {
+                ++hit_count;
+                pipelines[key] = pso;
+                return pso;
+            }
+        }
+    }
+
+    // 驱动编译是最耗时的部分, 不持有锁
+    ComPtr<ID3D12PipelineState> pso;
+    ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    ++miss_count;
+
+    // 其他线程可能同时编译了同一个PSO, 以先存入的为准
+    auto result = pipelines.emplace(key, pso);
+    if(!result.second)
+        return result.first->second;
+
+    if(library != nullptr && SUCCEEDED(library->StorePipeline(name.c_str(), pso.Get())))
+    {
+        ++dirty_count;
+    }
+
+    return pso;
+}
+
+void PSOCache::Save()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if(library == nullptr || dirty_count == 0)
+        return;
+
+    std::vector<BYTE> data(library->GetSerializedSize());
+    ThrowIfFailed(library->Serialize(data.data(), data.size()));
+
+    // library 引用着映射的文件, 先换成引用内存里的新数据, 才能解除映射并覆盖文件
+    ComPtr<ID3D12PipelineLibrary> new_library;
+    ThrowIfFailed(device1->CreatePipelineLibrary(data.data(), data.size(), IID_PPV_ARGS(new_library.GetAddressOf())));
+    library = new_library;
+    library_data.swap(data);
+    UnmapFile();
+
+    // 写盘或替换失败时保持脏标记, 下次 Save 重试, 新编译的PSO不会丢失
+    const std::wstring temp_filename = filename + L".tmp";
+    {
+        std::ofstream fout(temp_filename, std::ios::binary | std::ios::trunc);
+        fout.write((const char*)library_data.data(), library_data.size());
+        fout.close();
+        if(!fout)
+        {
+            DeleteFileW(temp_filename.c_str());
+            return;
+        }
+    }
+    if(!MoveFileExW(temp_filename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileW(temp_filename.c_str());
+        return;
+    }
+    dirty_count = 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Util.h"
+#include "PSOHash.h"
+
+//-----------------------------PSOCache--------------------------------
+// 基于 ID3D12PipelineLibrary 的持久化PSO缓存
+// 启动时把缓存文件 map 到内存直接交给 pipeline library, 不做额外的拷贝
+// 新编译的PSO加入library后标记为脏, Save 只在有新PSO时才写盘
+// ID3D12PipelineLibrary 只能整体序列化, 所以 Save 每次重写整个文件, 不是增量追加
+class PSOCache
+{
+    public:
+        PSOCache(ID3D12Device* device, const std::wstring& filename);
+        ~PSOCache();
+
+        PSOCache(const PSOCache& rhs) = delete;
+        PSOCache& operator=(const PSOCache& rhs) = delete;
+
+        // 可以在多个线程同时调用, 编译PSO时不持有锁
+        ComPtr<ID3D12PipelineState> GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                                std::uint64_t root_signature_hash);
+
+        // 有新PSO时序列化整个 library, 写到临时文件后替换原文件
+        void Save();
+
+        UINT HitCount() const { return hit_count; }
+        UINT MissCount() const { return miss_count; }
+
+    private:
+        void MapFile();
+        void UnmapFile();
+        void CreateLibrary(const void* data, SIZE_T bytesize);
+
+    private:
+        ComPtr<ID3D12Device> device;
+        ComPtr<ID3D12Device1> device1;
+        ComPtr<ID3D12PipelineLibrary> library;
+
+        std::wstring filename;
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE file_mapping = nullptr;
+        const void* mapped_data = nullptr;
+        SIZE_T mapped_bytesize = 0;
+
+        // Save 之后 library 改为引用这块内存, 原文件才能被覆盖
+        std::vector<BYTE> library_data;
+
+        std::unordered_map<std::uint64_t, ComPtr<ID3D12PipelineState>> pipelines;
+        std::mutex mutex;
+
+        // 只在持有锁时修改, HitCount / MissCount 不加锁读取
+        UINT dirty_count = 0;
+        std::atomic<UINT> hit_count = 0;
+        std::atomic<UINT> miss_count = 0;
+};
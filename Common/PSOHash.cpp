@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstring>
+
+#include "PSOHash.h"
+#include "Hash.h"
+
+namespace
+{
+    // 修改规范化规则时递增, 旧缓存里的key自然失效
+    const std::uint64_t pso_hash_version = 1;
+
+    void HashShader(Hasher& hasher, const D3D12_SHADER_BYTECODE& bytecode)
+    {
+        hasher.Add((std::uint64_t)bytecode.BytecodeLength);
+        if(bytecode.pShaderBytecode != nullptr && bytecode.BytecodeLength > 0)
+        {
+            hasher.AddBytes(bytecode.pShaderBytecode, bytecode.BytecodeLength);
+        }
+    }
+
+    void HashBlend(Hasher& hasher, const D3D12_BLEND_DESC& blend, UINT render_target_count)
+    {
+        hasher.Add(blend.AlphaToCoverageEnable);
+        hasher.Add(blend.IndependentBlendEnable);
+
+        // 没有开启 IndependentBlend 时只有 RenderTarget[0] 生效
+        UINT count = blend.IndependentBlendEnable ? std::max(render_target_count, 1u) : 1u;
+        for(UINT i = 0; i < count; ++i)
+        {
+            const D3D12_RENDER_TARGET_BLEND_DESC& src = blend.RenderTarget[i];
+            D3D12_RENDER_TARGET_BLEND_DESC rt;
+            std::memset(&rt, 0, sizeof(rt));
+            rt.BlendEnable = src.BlendEnable;
+            rt.LogicOpEnable = src.LogicOpEnable;
+            if(src.BlendEnable)
+            {
+                rt.SrcBlend = src.SrcBlend;
+                rt.DestBlend = src.DestBlend;
+                rt.BlendOp = src.BlendOp;
+                rt.SrcBlendAlpha = src.SrcBlendAlpha;
+                rt.DestBlendAlpha = src.DestBlendAlpha;
+                rt.BlendOpAlpha = src.BlendOpAlpha;
+            }
+            if(src.LogicOpEnable)
+            {
+                rt.LogicOp = src.LogicOp;
+            }
+            rt.RenderTargetWriteMask = src.RenderTargetWriteMask;
+            hasher.Add(rt);
+        }
+    }
+
+    void HashDepthStencil(Hasher& hasher, const D3D12_DEPTH_STENCIL_DESC& src)
+    {
+        // 先清零再逐个赋值, 保证padding也是0
+        D3D12_DEPTH_STENCIL_DESC ds;
+        std::memset(&ds, 0, sizeof(ds));
+        ds.DepthEnable = src.DepthEnable;
+        ds.StencilEnable = src.StencilEnable;
+        if(src.DepthEnable)
+        {
+            ds.DepthWriteMask = src.DepthWriteMask;
+            ds.DepthFunc = src.DepthFunc;
+        }
+        if(src.StencilEnable)
+        {
+            ds.StencilReadMask = src.StencilReadMask;
+            ds.StencilWriteMask = src.StencilWriteMask;
+            ds.FrontFace = src.FrontFace;
+            ds.BackFace = src.BackFace;
+        }
+        hasher.Add(ds);
+    }
+
+    void HashInputLayout(Hasher& hasher, const D3D12_INPUT_LAYOUT_DESC& layout)
+    {
+        hasher.Add(layout.NumElements);
+        for(UINT i = 0; i < layout.NumElements; ++i)
+        {
+            const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[i];
+            hasher.AddString(element.SemanticName);
+            hasher.Add(element.SemanticIndex);
+            hasher.Add(element.Format);
+            hasher.Add(element.InputSlot);
+            hasher.Add(element.AlignedByteOffset);
+            hasher.Add(element.InputSlotClass);
+            hasher.Add(element.InputSlotClass == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA ? element.InstanceDataStepRate : 0u);
+        }
+    }
+
+    void HashStreamOutput(Hasher& hasher, const D3D12_STREAM_OUTPUT_DESC& so)
+    {
+        hasher.Add(so.NumEntries);
+        for(UINT i = 0; i < so.NumEntries; ++i)
+        {
+            const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+            hasher.Add(entry.Stream);
+            hasher.AddString(entry.SemanticName);
+            hasher.Add(entry.SemanticIndex);
+            hasher.Add(entry.StartComponent);
+            hasher.Add(entry.ComponentCount);
+            hasher.Add(entry.OutputSlot);
+        }
+        hasher.Add(so.NumStrides);
+        if(so.NumStrides > 0)
+        {
+            hasher.AddBytes(so.pBufferStrides, so.NumStrides * sizeof(UINT));
+        }
+        hasher.Add(so.NumEntries > 0 ? so.RasterizedStream : 0u);
+    }
+}
+
+std::uint64_t HashRootSignatureBlob(ID3DBlob* serialized_root_signature)
+{
+    return HashBytes(serialized_root_signature->GetBufferPointer(), serialized_root_signature->GetBufferSize());
+}
+
+std::uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                       std::uint64_t root_signature_hash)
+{
+    Hasher hasher(pso_hash_version);
+    hasher.Add(root_signature_hash);
+
+    HashShader(hasher, desc.VS);
+    HashShader(hasher, desc.PS);
+    HashShader(hasher, desc.DS);
+    HashShader(hasher, desc.HS);
+    HashShader(hasher, desc.GS);
+    HashStreamOutput(hasher, desc.StreamOutput);
+
+    HashBlend(hasher, desc.BlendState, desc.NumRenderTargets);
+    hasher.Add(desc.SampleMask);
+    hasher.Add(desc.RasterizerState);
+    HashDepthStencil(hasher, desc.DepthStencilState);
+    HashInputLayout(hasher, desc.InputLayout);
+
+    hasher.Add(desc.IBStripCutValue);
+    hasher.Add(desc.PrimitiveTopologyType);
+    hasher.Add(desc.NumRenderTargets);
+    for(UINT i = 0; i < desc.NumRenderTargets && i < 8; ++i)
+    {
+        hasher.Add(desc.RTVFormats[i]);
+    }
+    hasher.Add(desc.DSVFormat);
+    hasher.Add(desc.SampleDesc.Count);
+    hasher.Add(desc.SampleDesc.Count > 1 ? desc.SampleDesc.Quality : 0u);
+    hasher.Add(desc.NodeMask);
+    hasher.Add(desc.Flags);
+
+    return hasher.Value();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+#include <d3d12.h>
+
+//-----------------------------PSO canonical hash--------------------------------
+// 把 PSO 描述规范化后计算稳定的64位key:
+// 指针字段换成内容哈希 (shader字节码, input layout的语义名, stream output),
+// 不影响结果的字段清零 (关闭blend/depth/stencil时的参数, 超出 NumRenderTargets 的格式, CachedPSO)
+// 只依赖 d3d12.h 中的类型, 不调用 Win32 API, 在 Linux 上用 DirectX-Headers 也可以编译和测试
+std::uint64_t HashRootSignatureBlob(ID3DBlob* serialized_root_signature);
+
+std::uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+                                       std::uint64_t root_signature_hash);
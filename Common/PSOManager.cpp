@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "PSOManager.h"
+
+PSOManager::PSOManager(PSOCache& cache, JobSystem& jobs)
+:cache(cache), jobs(jobs)
+{
+}
+
+PSOManager::~PSOManager()
+{
+    // 工作线程还引用着 Entry, 析构前等所有编译结束
+    for(auto& entry : entries)
+    {
+        try
+        {
+            jobs.Wait(entry.job);
+        }
+        catch(...)
+        {
+        }
+    }
+}
+
+PSOManager::PSOHandle PSOManager::Request(const std::string& name,
+                                          DescBuilder build_desc,
+                                          PSOHandle fallback,
+                                          const std::vector<JobSystem::JobHandle>& dependencies)
+{
+    PSOHandle handle = (PSOHandle)entries.size();
+    Entry& entry = entries.emplace_back();
+    entry.name = name;
+    entry.fallback = fallback;
+    entry.build_desc = build_desc;
+    entry.request_time = std::chrono::steady_clock::now();
+
+    Entry* target = &entry;
+    PSOCache* pso_cache = &cache;
+    PSOManager* manager = this;
+    entry.job = jobs.Schedule("PSO " + name, [target, pso_cache, manager, build_desc]{
+        try
+        {
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+            ZeroMemory(&desc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+            std::shared_ptr<const PipelineLayout> layout = build_desc(desc);
+
+            auto start = std::chrono::steady_clock::now();
+            target->pso = pso_cache->GetOrCreate(desc, layout->root_signature_hash);
+            target->layout = layout;
+            auto end = std::chrono::steady_clock::now();
+
+            {
+                std::unique_lock<std::mutex> lock(manager->mutex);
+                target->compile_ms = std::chrono::duration<double, std::milli>(end - start).count();
+                target->latency_ms = std::chrono::duration<double, std::milli>(end - target->request_time).count();
+            }
+            target->state.store(State::Ready, std::memory_order_release);
+        }
+        catch(...)
+        {
+            target->state.store(State::Failed, std::memory_order_release);
+            throw;
+        }
+    }, dependencies);
+
+    return handle;
+}
+
+void PSOManager::Wait(PSOHandle handle)
+{
+    if(handle >= entries.size())
+        return;
+
+    jobs.Wait(entries[handle].job);
+
+    // 依赖的job失败时这个job不会执行, 状态在这里补上
+    CurrentState(entries[handle]);
+}
+
+void PSOManager::Rebuild(PSOHandle handle, const std::vector<JobSystem::JobHandle>& dependencies)
+{
+    if(handle >= entries.size())
+        return;
+
+    Entry& entry = entries[handle];
+    Entry* target = &entry;
+    PSOCache* pso_cache = &cache;
+    PSOManager* manager = this;
+
+    // 还要等上一次编译结束, 否则两次结果的先后顺序不确定
+    std::vector<JobSystem::JobHandle> deps = dependencies;
+    if(!jobs.IsDone(entry.job))
+        deps.push_back(entry.job);
+
+    entry.job = jobs.Schedule("PSO rebuild " + entry.name, [target, pso_cache, manager]{
+        try
+        {
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+            ZeroMemory(&desc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+            std::shared_ptr<const PipelineLayout> layout = target->build_desc(desc);
+
+            auto start = std::chrono::steady_clock::now();
+            ComPtr<ID3D12PipelineState> pso = pso_cache->GetOrCreate(desc, layout->root_signature_hash);
+            auto end = std::chrono::steady_clock::now();
+
+            std::unique_lock<std::mutex> lock(manager->mutex);
+            target->pending_pso = pso;
+            target->pending_layout = layout;
+            target->compile_ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if(!target->has_pending.exchange(true, std::memory_order_release))
+                manager->pending_count.fetch_add(1, std::memory_order_release);
+        }
+        catch(DxException& e)
+        {
+            // 重建失败不抛出, 继续使用旧PSO
+            OutputDebugString((L"PSO rebuild failed: " + e.ToString() + L"\n").c_str());
+        }
+        catch(...)
+        {
+            OutputDebugStringA(("PSO rebuild failed: " + target->name + "\n").c_str());
+        }
+    }, deps);
+}
+
+void PSOManager::ApplyPendingSwaps()
+{
+    if(pending_count.load(std::memory_order_acquire) == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for(auto& entry : entries)
+    {
+        if(!entry.has_pending.load(std::memory_order_acquire))
+            continue;
+
+        // 旧PSO和它的 layout 在这里释放
+        entry.pso = entry.pending_pso;
+        entry.layout = entry.pending_layout;
+        entry.pending_pso = nullptr;
+        entry.pending_layout = nullptr;
+        entry.has_pending.store(false, std::memory_order_release);
+        entry.state.store(State::Ready, std::memory_order_release);
+        pending_count.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+PSOManager::State PSOManager::CurrentState(const Entry& entry) const
+{
+    State state = entry.state.load(std::memory_order_acquire);
+    if(state != State::Pending || !jobs.IsDone(entry.job))
+        return state;
+
+    // job 结束后工作线程不会再修改状态; 检查期间 job 刚好完成并变为 Ready 时交换失败, 保留 Ready
+    State expected = State::Pending;
+    if(entry.state.compare_exchange_strong(expected, State::Failed, std::memory_order_acq_rel))
+        return State::Failed;
+    return expected;
+}
+
+bool PSOManager::IsReady(PSOHandle handle) const
+{
+    return handle < entries.size() && CurrentState(entries[handle]) == State::Ready;
+}
+
+bool PSOManager::IsBuilding(PSOHandle handle) const
+{
+    return handle < entries.size() && !jobs.IsDone(entries[handle].job);
+}
+
+ID3D12PipelineState* PSOManager::Resolve(PSOHandle handle, const PipelineLayout** layout) const
+{
+    // fallback 只能指向更早注册的PSO, 所以链一定会结束
+    while(handle < entries.size())
+    {
+        const Entry& entry = entries[handle];
+        if(CurrentState(entry) == State::Ready)
+        {
+            if(layout != nullptr)
+                *layout = entry.layout.get();
+            return entry.pso.Get();
+        }
+
+        if(entry.fallback >= handle)
+            break;
+        handle = entry.fallback;
+    }
+
+    if(layout != nullptr)
+        *layout = nullptr;
+    return nullptr;
+}
+
+std::vector<PSOManager::PSOStats> PSOManager::Stats() const
+{
+    std::vector<PSOStats> stats;
+    stats.reserve(entries.size());
+    for(const auto& entry : entries)
+    {
+        PSOStats s;
+        s.name = entry.name;
+        s.state = CurrentState(entry);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if(s.state == State::Ready)
+        {
+            s.latency_ms = entry.latency_ms;
+            s.compile_ms = entry.compile_ms;
+        }
+        stats.push_back(s);
+    }
+
+    return stats;
+}
+
+std::string PSOManager::LatencyReport() const
+{
+    std::vector<PSOStats> stats = Stats();
+    std::sort(stats.begin(), stats.end(), [](const PSOStats& a, const PSOStats& b){
+        return a.compile_ms > b.compile_ms;
+    });
+
+    static const char* state_names[] = { "pending", "ready", "failed" };
+
+    std::string report = "---- pso latency ----\n";
+    char line[256];
+    for(const auto& s : stats)
+    {
+        std::snprintf(line, sizeof(line), "%-40s %-8s compile %9.3f ms  latency %9.3f ms\n",
+            s.name.c_str(), state_names[(std::uint32_t)s.state], s.compile_ms, s.latency_ms);
+        report += line;
+    }
+    std::snprintf(line, sizeof(line), "cache hit %u, miss %u\n", cache.HitCount(), cache.MissCount());
+    report += line;
+
+    return report;
+}
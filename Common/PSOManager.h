@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Util.h"
+#include "JobSystem.h"
+#include "PSOCache.h"
+#include "ShaderReflection.h"
+
+//-----------------------------PSOManager--------------------------------
+// 异步创建PSO: Request 立刻返回句柄, PSO 在工作线程上通过 PSOCache 编译
+// 还没编译好时 Resolve 返回指定的 fallback PSO, 没有 fallback 时返回 nullptr, 由调用者跳过这次绘制
+// Request/Resolve 只能在渲染线程调用
+class PSOManager
+{
+    public:
+        using PSOHandle = std::uint32_t;
+        static constexpr PSOHandle invalid_pso = UINT32_MAX;
+
+        // 在工作线程上填写PSO描述, 返回描述引用的 root signature 和 input layout
+        // layout 和PSO一起保存并一起替换, 描述里的其他指针在PSO编译完成之前必须有效
+        using DescBuilder = std::function<std::shared_ptr<const PipelineLayout>(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)>;
+
+        enum class State : std::uint32_t
+        {
+            Pending,
+            Ready,
+            Failed
+        };
+
+        struct PSOStats
+        {
+            std::string name;
+            State state = State::Pending;
+            // 从 Request 到可用的总延迟, 包括排队和等待依赖
+            double latency_ms = 0.0;
+            // 只包括 PSOCache::GetOrCreate 的时间
+            double compile_ms = 0.0;
+        };
+
+        PSOManager(PSOCache& cache, JobSystem& jobs);
+        ~PSOManager();
+
+        PSOManager(const PSOManager& rhs) = delete;
+        PSOManager& operator=(const PSOManager& rhs) = delete;
+
+        // fallback 需要能绘制同样的顶点数据, 它自己的 root signature 由 Resolve 返回的 layout 给出
+        PSOHandle Request(const std::string& name,
+                          DescBuilder build_desc,
+                          PSOHandle fallback = invalid_pso,
+                          const std::vector<JobSystem::JobHandle>& dependencies = {});
+
+        // 阻塞直到PSO编译完成, 编译失败时抛出异常
+        void Wait(PSOHandle handle);
+
+        // 用同一个 DescBuilder 在后台重新编译 (例如shader热更新之后)
+        // 新PSO在 ApplyPendingSwaps 时才替换旧的, 编译失败则继续使用旧的
+        void Rebuild(PSOHandle handle, const std::vector<JobSystem::JobHandle>& dependencies = {});
+        // 在帧边界调用, 必须保证GPU已经不再使用旧PSO
+        void ApplyPendingSwaps();
+
+        // 自身没准备好时沿 fallback 链查找, 都没准备好返回 nullptr
+        // 依赖失败导致编译没有执行的PSO在这里变为 Failed, 之后直接使用 fallback
+        // layout 不为空时返回找到的PSO创建时使用的 layout, 在下一次 ApplyPendingSwaps 之前有效
+        ID3D12PipelineState* Resolve(PSOHandle handle, const PipelineLayout** layout = nullptr) const;
+        bool IsReady(PSOHandle handle) const;
+        // 还有编译或者重建的 job 没有结束
+        bool IsBuilding(PSOHandle handle) const;
+
+        std::vector<PSOStats> Stats() const;
+        // 按编译耗时从大到小排列, 用来查找卡顿来源
+        std::string LatencyReport() const;
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            PSOHandle fallback = invalid_pso;
+            DescBuilder build_desc;
+            // CurrentState 在 const 函数里也可能把 Pending 改为 Failed
+            mutable std::atomic<State> state = State::Pending;
+            ComPtr<ID3D12PipelineState> pso;
+            std::shared_ptr<const PipelineLayout> layout;
+            JobSystem::JobHandle job;
+
+            // Rebuild 的结果, has_pending 为 true 时才可以读取
+            ComPtr<ID3D12PipelineState> pending_pso;
+            std::shared_ptr<const PipelineLayout> pending_layout;
+            std::atomic<bool> has_pending = false;
+
+            std::chrono::steady_clock::time_point request_time;
+            // 由工作线程写入, 读写都要持有 mutex
+            double latency_ms = 0.0;
+            double compile_ms = 0.0;
+        };
+
+        // job 已经结束但状态还是 Pending, 说明依赖失败, job 没有执行, 此时改为 Failed
+        State CurrentState(const Entry& entry) const;
+
+        PSOCache& cache;
+        JobSystem& jobs;
+
+        // deque 保证工作线程持有的 Entry 地址不会因为扩容失效
+        std::deque<Entry> entries;
+        std::atomic<std::uint32_t> pending_count = 0;
+        // 保护 pending_pso/pending_layout 和耗时统计, 工作线程可能和 ApplyPendingSwaps/Stats 同时访问
+        mutable std::mutex mutex;
+};
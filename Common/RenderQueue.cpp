@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "JobSystem.h"
+#include "RenderQueue.h"
+
+namespace
+{
+    constexpr std::uint32_t radix_bits = 8;
+    constexpr std::uint32_t radix_size = 1u << radix_bits;
+    constexpr std::uint32_t radix_passes = 64 / radix_bits;
+    // 每个块一个直方图, 块太小时统计和合并直方图的开销比排序本身还大
+    constexpr std::uint32_t radix_chunk_size = 1u << 16;
+
+    constexpr std::uint32_t FieldMask(std::uint32_t bits)
+    {
+        return (std::uint32_t)((std::uint64_t(1) << bits) - 1);
+    }
+
+    std::uint32_t Field(std::uint64_t key, std::uint32_t shift, std::uint32_t bits)
+    {
+        return (std::uint32_t)(key >> shift) & FieldMask(bits);
+    }
+}
+
+std::uint64_t EncodeDrawKey(const DrawKeyFields& fields)
+{
+    return (std::uint64_t)(fields.layer & FieldMask(draw_key_layer_bits)) << draw_key_layer_shift |
+           (std::uint64_t)(fields.pso & FieldMask(draw_key_pso_bits)) << draw_key_pso_shift |
+           (std::uint64_t)(fields.material & FieldMask(draw_key_material_bits)) << draw_key_material_shift |
+           (std::uint64_t)(fields.mesh & FieldMask(draw_key_mesh_bits)) << draw_key_mesh_shift |
+           (std::uint64_t)(fields.depth & FieldMask(draw_key_depth_bits)) << draw_key_depth_shift;
+}
+
+DrawKeyFields DecodeDrawKey(std::uint64_t key)
+{
+    DrawKeyFields fields;
+    fields.layer = Field(key, draw_key_layer_shift, draw_key_layer_bits);
+    fields.pso = Field(key, draw_key_pso_shift, draw_key_pso_bits);
+    fields.material = Field(key, draw_key_material_shift, draw_key_material_bits);
+    fields.mesh = Field(key, draw_key_mesh_shift, draw_key_mesh_bits);
+    fields.depth = Field(key, draw_key_depth_shift, draw_key_depth_bits);
+    return fields;
+}
+
+std::uint32_t QuantizeDrawDepth(float depth, float far_z, bool back_to_front)
+{
+    const std::uint32_t max_depth = FieldMask(draw_key_depth_bits);
+    const float t = std::clamp(depth / far_z, 0.0f, 1.0f);
+    const std::uint32_t quantized = (std::uint32_t)(t * (float)max_depth + 0.5f);
+    return back_to_front ? max_depth - quantized : quantized;
+}
+
+void RadixSortDrawItems(DrawItem* items, DrawItem* scratch, std::uint32_t count, JobSystem* jobs)
+{
+    if(count < 2)
+        return;
+
+    const std::uint32_t chunk_count = jobs != nullptr ? (count + radix_chunk_size - 1) / radix_chunk_size : 1;
+    const std::uint32_t chunk_size = (count + chunk_count - 1) / chunk_count;
+    auto for_each_chunk = [&](const auto& fn){
+        auto run = [&](std::uint32_t begin, std::uint32_t end){
+            for(std::uint32_t c = begin; c < end; ++c)
+                fn(c, c * chunk_size, std::min(c * chunk_size + chunk_size, count));
+        };
+        if(chunk_count == 1)
+            run(0, 1);
+        else
+            jobs->ParallelFor(chunk_count, 1, run);
+    };
+
+    // 第一遍统计所有趟的直方图; 只有一个块时后面的趟只是换了顺序, 直方图不变, 不需要再读一遍
+    using Histogram = std::array<std::uint32_t, radix_size>;
+    std::vector<std::array<Histogram, radix_passes>> histograms(chunk_count);
+    for_each_chunk([&](std::uint32_t c, std::uint32_t begin, std::uint32_t end){
+        std::array<Histogram, radix_passes>& chunk_histograms = histograms[c];
+        for(Histogram& histogram : chunk_histograms)
+            histogram.fill(0);
+        for(std::uint32_t i = begin; i < end; ++i)
+        {
+            const std::uint64_t key = items[i].key;
+            for(std::uint32_t pass = 0; pass < radix_passes; ++pass)
+                ++chunk_histograms[pass][(key >> (pass * radix_bits)) & (radix_size - 1)];
+        }
+    });
+
+    DrawItem* source = items;
+    DrawItem* destination = scratch;
+    bool first_pass = true;
+    for(std::uint32_t pass = 0; pass < radix_passes; ++pass)
+    {
+        // 所有键的这 8 位都相同时这一趟不改变顺序, 例如只用到一个 layer 时的最高位
+        std::uint32_t bucket_total[radix_size] = {};
+        for(std::uint32_t c = 0; c < chunk_count; ++c)
+        {
+            for(std::uint32_t bucket = 0; bucket < radix_size; ++bucket)
+                bucket_total[bucket] += histograms[c][pass][bucket];
+        }
+        if(std::find(bucket_total, bucket_total + radix_size, count) != bucket_total + radix_size)
+            continue;
+
+        const std::uint32_t shift = pass * radix_bits;
+        // 多个块时, 上一趟改变了每个块里有哪些元素, 要重新统计
+        if(chunk_count > 1 && !first_pass)
+        {
+            for_each_chunk([&](std::uint32_t c, std::uint32_t begin, std::uint32_t end){
+                Histogram& histogram = histograms[c][pass];
+                histogram.fill(0);
+                for(std::uint32_t i = begin; i < end; ++i)
+                    ++histogram[(source[i].key >> shift) & (radix_size - 1)];
+            });
+        }
+        first_pass = false;
+
+        // 桶优先, 块其次, 保证稳定
+        std::uint32_t offset = 0;
+        for(std::uint32_t bucket = 0; bucket < radix_size; ++bucket)
+        {
+            for(std::uint32_t c = 0; c < chunk_count; ++c)
+            {
+                const std::uint32_t bucket_count = histograms[c][pass][bucket];
+                histograms[c][pass][bucket] = offset;
+                offset += bucket_count;
+            }
+        }
+
+        for_each_chunk([&](std::uint32_t c, std::uint32_t begin, std::uint32_t end){
+            Histogram& cursors = histograms[c][pass];
+            for(std::uint32_t i = begin; i < end; ++i)
+                destination[cursors[(source[i].key >> shift) & (radix_size - 1)]++] = source[i];
+        });
+
+        std::swap(source, destination);
+    }
+
+    if(source != items)
+        std::memcpy(items, source, sizeof(DrawItem) * count);
+}
+
+RenderQueueStats CountStateChanges(const DrawItem* items, std::uint32_t count)
+{
+    RenderQueueStats stats;
+    stats.draws = count;
+    for(std::uint32_t i = 0; i < count; ++i)
+    {
+        const std::uint64_t changed = i == 0 ? ~std::uint64_t(0) : items[i].key ^ items[i - 1].key;
+        stats.layer_changes += Field(changed, draw_key_layer_shift, draw_key_layer_bits) != 0 ? 1 : 0;
+        stats.pso_changes += Field(changed, draw_key_pso_shift, draw_key_pso_bits) != 0 ? 1 : 0;
+        stats.material_changes += Field(changed, draw_key_material_shift, draw_key_material_bits) != 0 ? 1 : 0;
+        stats.mesh_changes += Field(changed, draw_key_mesh_shift, draw_key_mesh_bits) != 0 ? 1 : 0;
+    }
+    return stats;
+}
+
+DrawItem* RenderQueue::Append(std::uint32_t count)
+{
+    const std::size_t first = items.size();
+    items.resize(first + count);
+    return items.data() + first;
+}
+
+void RenderQueue::Sort(JobSystem* jobs)
+{
+    scratch.resize(items.size());
+    RadixSortDrawItems(items.data(), scratch.data(), (std::uint32_t)items.size(), jobs);
+}
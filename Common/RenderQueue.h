@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+//-----------------------------DrawKey--------------------------------
+// 每个可见的绘制编码成一个 64 位排序键, 从高位到低位:
+// layer(4) | pso(12) | material(12) | mesh(16) | depth(20)
+// 排序后状态相同的绘制相邻, 切换次数最少的状态放在最高位; 同一状态内按深度排列
+constexpr std::uint32_t draw_key_layer_bits = 4;
+constexpr std::uint32_t draw_key_pso_bits = 12;
+constexpr std::uint32_t draw_key_material_bits = 12;
+constexpr std::uint32_t draw_key_mesh_bits = 16;
+constexpr std::uint32_t draw_key_depth_bits = 20;
+
+constexpr std::uint32_t draw_key_depth_shift = 0;
+constexpr std::uint32_t draw_key_mesh_shift = draw_key_depth_shift + draw_key_depth_bits;
+constexpr std::uint32_t draw_key_material_shift = draw_key_mesh_shift + draw_key_mesh_bits;
+constexpr std::uint32_t draw_key_pso_shift = draw_key_material_shift + draw_key_material_bits;
+constexpr std::uint32_t draw_key_layer_shift = draw_key_pso_shift + draw_key_pso_bits;
+static_assert(draw_key_layer_shift + draw_key_layer_bits == 64, "draw key fields must fill 64 bits");
+
+// 去掉深度后剩下的部分, 相等的绘制可以合并成一次实例化绘制
+constexpr std::uint64_t draw_key_state_mask = ~((std::uint64_t(1) << draw_key_mesh_shift) - 1);
+
+struct DrawKeyFields
+{
+    // 例如不透明, 透明, UI, 按层依次绘制
+    std::uint32_t layer = 0;
+    // 下面三个是调用者自己的编号, 超出位数的部分被截掉
+    std::uint32_t pso = 0;
+    std::uint32_t material = 0;
+    std::uint32_t mesh = 0;
+    // QuantizeDrawDepth 的结果
+    std::uint32_t depth = 0;
+};
+
+std::uint64_t EncodeDrawKey(const DrawKeyFields& fields);
+DrawKeyFields DecodeDrawKey(std::uint64_t key);
+
+// 到相机的距离按 [0, far_z] 线性量化, 不透明物体由近到远, back_to_front 用于半透明物体
+std::uint32_t QuantizeDrawDepth(float depth, float far_z, bool back_to_front = false);
+
+//-----------------------------RenderQueue--------------------------------
+struct DrawItem
+{
+    std::uint64_t key = 0;
+    // 调用者的对象编号
+    std::uint32_t payload = 0;
+};
+
+// LSD 基数排序, 每趟 8 位, 稳定; 结果在 items 中, scratch 至少 count 个
+// 先统计所有位的直方图, 所有键都相同的那一趟直接跳过 (例如只用到一个 layer 时的最高位)
+// 给了 jobs 并且数量较多时, 每趟按块并行统计和分发: 块 c 的桶 b 从 所有块的更小的桶 + 前面的块的桶 b 之后开始写
+void RadixSortDrawItems(DrawItem* items, DrawItem* scratch, std::uint32_t count, JobSystem* jobs = nullptr);
+
+struct RenderQueueStats
+{
+    std::uint32_t draws = 0;
+    // 按顺序提交时真正需要设置状态的次数, 第一次绘制也算一次
+    std::uint32_t layer_changes = 0;
+    std::uint32_t pso_changes = 0;
+    std::uint32_t material_changes = 0;
+    std::uint32_t mesh_changes = 0;
+
+    std::uint32_t StateChanges() const { return layer_changes + pso_changes + material_changes + mesh_changes; }
+};
+
+// 统计按 items 的顺序提交时每种状态的切换次数, 每次绘制都设置全部状态时是 4 * draws
+RenderQueueStats CountStateChanges(const DrawItem* items, std::uint32_t count);
+
+class RenderQueue
+{
+    public:
+        // 每帧开始时清空, 保留已分配的内存
+        void Clear() { items.clear(); }
+
+        void Push(std::uint64_t key, std::uint32_t payload) { items.push_back({key, payload}); }
+        // 在末尾添加 count 个, 返回第一个, 可以在多个线程中分段填写
+        DrawItem* Append(std::uint32_t count);
+
+        void Sort(JobSystem* jobs = nullptr);
+
+        std::uint32_t Size() const { return (std::uint32_t)items.size(); }
+        const DrawItem* Items() const { return items.data(); }
+        const DrawItem& operator[](std::uint32_t i) const { return items[i]; }
+
+    private:
+        std::vector<DrawItem> items;
+        std::vector<DrawItem> scratch;
+};
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cwctype>
+#include <fstream>
+#include <sstream>
+
+#include "ShaderHotReload.h"
+#include "Hash.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const auto debounce_time = std::chrono::milliseconds(100);
+
+    // 绝对路径 + 统一分隔符 + 小写 (Windows 文件名不区分大小写)
+    std::wstring NormalizeShaderPath(const fs::path& path)
+    {
+        std::error_code error;
+        std::wstring normalized = fs::absolute(path, error).lexically_normal().generic_wstring();
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](wchar_t c){
+            return (wchar_t)std::towlower(c);
+        });
+        return normalized;
+    }
+
+    bool IsShaderFile(const fs::path& path)
+    {
+        std::wstring ext = path.extension().wstring();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c){ return (wchar_t)std::towlower(c); });
+        return ext == L".hlsl" || ext == L".hlsli" || ext == L".fx" || ext == L".h";
+    }
+
+    bool ReadSource(const fs::path& path, std::string& source)
+    {
+        std::ifstream fin(path, std::ios::binary);
+        if(!fin)
+            return false;
+
+        std::ostringstream ss;
+        ss << fin.rdbuf();
+        source = ss.str();
+        return true;
+    }
+}
+
+ShaderHotReload::ShaderHotReload(JobSystem& jobs, PSOManager& pso_manager)
+:jobs(jobs), pso_manager(pso_manager)
+{
+}
+
+bool ShaderHotReload::WatchDirectory(const std::wstring& directory)
+{
+    if(!watcher.Watch(directory))
+        return false;
+
+    // 先记录所有文件的内容哈希和 include 关系
+    std::error_code error;
+    for(const auto& entry : fs::recursive_directory_iterator(directory, error))
+    {
+        if(entry.is_regular_file() && IsShaderFile(entry.path()))
+            RefreshFile(NormalizeShaderPath(entry.path()));
+    }
+
+    return true;
+}
+
+void ShaderHotReload::Register(ShaderPermutationSet* shader,
+                               const std::string& name,
+                               const std::vector<PSOManager::PSOHandle>& psos)
+{
+    RegisteredShader registered;
+    registered.shader = shader;
+    registered.name = name;
+    registered.file = NormalizeShaderPath(shader->Filename());
+    registered.psos = psos;
+    shaders.push_back(registered);
+
+    if(content_hashes.find(registered.file) == content_hashes.end())
+        RefreshFile(registered.file);
+}
+
+bool ShaderHotReload::RefreshFile(const std::wstring& file)
+{
+    std::string source;
+    if(!ReadSource(file, source))
+        return false;
+
+    const std::uint64_t hash = HashBytes(source.data(), source.size());
+    auto it = content_hashes.find(file);
+    if(it != content_hashes.end() && it->second == hash)
+        return false;
+
+    content_hashes[file] = hash;
+    ScanIncludes(file, source);
+    return true;
+}
+
+void ShaderHotReload::ScanIncludes(const std::wstring& file, const std::string& source)
+{
+    std::vector<std::wstring>& file_includes = includes[file];
+    file_includes.clear();
+
+    const fs::path directory = fs::path(file).parent_path();
+
+    std::istringstream lines(source);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+        std::size_t pos = line.find_first_not_of(" \t");
+        if(pos == std::string::npos || line[pos] != '#')
+            continue;
+
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if(pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+            continue;
+
+        std::size_t open = line.find_first_of("\"<", pos + 7);
+        if(open == std::string::npos)
+            continue;
+
+        std::size_t close = line.find_first_of("\">", open + 1);
+        if(close == std::string::npos)
+            continue;
+
+        // D3D_COMPILE_STANDARD_FILE_INCLUDE 相对于当前文件所在目录查找
+        fs::path included = directory / fs::path(line.substr(open + 1, close - open - 1));
+        file_includes.push_back(NormalizeShaderPath(included));
+    }
+}
+
+void ShaderHotReload::CollectIncluders(const std::wstring& file, std::unordered_set<std::wstring>& affected) const
+{
+    std::vector<std::wstring> stack = {file};
+    while(!stack.empty())
+    {
+        std::wstring current = stack.back();
+        stack.pop_back();
+
+        if(!affected.insert(current).second)
+            continue;
+
+        for(const auto& [includer, included] : includes)
+        {
+            if(std::find(included.begin(), included.end(), current) != included.end())
+                stack.push_back(includer);
+        }
+    }
+}
+
+void ShaderHotReload::ProcessChanges(const std::vector<fs::path>& changes)
+{
+    std::unordered_set<std::wstring> affected;
+    for(const auto& change : changes)
+    {
+        if(!IsShaderFile(change))
+            continue;
+
+        std::wstring file = NormalizeShaderPath(change);
+        if(RefreshFile(file))
+            CollectIncluders(file, affected);
+    }
+
+    for(auto& registered : shaders)
+    {
+        if(affected.count(registered.file) > 0)
+            registered.dirty = true;
+    }
+}
+
+void ShaderHotReload::Update()
+{
+    std::vector<fs::path> changes = watcher.PollChanges();
+    auto now = std::chrono::steady_clock::now();
+    if(!changes.empty())
+    {
+        pending_changes.insert(pending_changes.end(), changes.begin(), changes.end());
+        last_change_time = now;
+    }
+
+    if(!pending_changes.empty() && now - last_change_time >= debounce_time)
+    {
+        ProcessChanges(pending_changes);
+        pending_changes.clear();
+    }
+
+    std::vector<PSOManager::PSOHandle> rebuild_psos;
+    for(auto& registered : shaders)
+    {
+        // 上一次重新编译还没结束时下一帧再来, 同一个 ShaderPermutationSet 不能同时编译两次
+        // 重建PSO的 job 还在读取字节码和反射数据时也不能重新编译
+        if(!registered.dirty || !jobs.IsDone(registered.job))
+            continue;
+        if(std::any_of(registered.psos.begin(), registered.psos.end(), [this](PSOManager::PSOHandle pso){
+            return pso_manager.IsBuilding(pso);
+        }))
+            continue;
+
+        OutputDebugStringA(("shader hot reload: " + registered.name + "\n").c_str());
+
+        registered.dirty = false;
+        registered.job = registered.shader->Compile(jobs, "HotReload " + registered.name);
+        for(PSOManager::PSOHandle pso : registered.psos)
+        {
+            if(std::find(rebuild_psos.begin(), rebuild_psos.end(), pso) == rebuild_psos.end())
+                rebuild_psos.push_back(pso);
+        }
+    }
+
+    // PSO 要等它用到的所有shader都编译完, 否则会和其他阶段的重新编译同时读写字节码
+    // 已经结束的job不加入依赖, 之前编译失败的阶段继续使用旧字节码, 不能让失败传染给这次重建
+    for(PSOManager::PSOHandle pso : rebuild_psos)
+    {
+        std::vector<JobSystem::JobHandle> dependencies;
+        for(const auto& registered : shaders)
+        {
+            if(std::find(registered.psos.begin(), registered.psos.end(), pso) != registered.psos.end() &&
+               !jobs.IsDone(registered.job))
+                dependencies.push_back(registered.job);
+        }
+        pso_manager.Rebuild(pso, dependencies);
+    }
+
+    pso_manager.ApplyPendingSwaps();
+}
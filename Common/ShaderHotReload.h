@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "FileWatcher.h"
+#include "JobSystem.h"
+#include "PSOManager.h"
+#include "ShaderPermutation.h"
+
+//-----------------------------ShaderHotReload--------------------------------
+// 监视shader目录, 文件内容变化时只重新编译受影响的shader (自身或者直接/间接 include 了它),
+// 编译在线程池上进行, 依赖这些shader的PSO重建完成后在帧边界统一替换
+// 编译失败时保留旧的字节码和PSO, 错误信息由 CompileShader 输出
+class ShaderHotReload
+{
+    public:
+        ShaderHotReload(JobSystem& jobs, PSOManager& pso_manager);
+
+        ShaderHotReload(const ShaderHotReload& rhs) = delete;
+        ShaderHotReload& operator=(const ShaderHotReload& rhs) = delete;
+
+        bool WatchDirectory(const std::wstring& directory);
+
+        // psos 是使用这个shader的PSO, shader 重新编译后会被重建
+        void Register(ShaderPermutationSet* shader,
+                      const std::string& name,
+                      const std::vector<PSOManager::PSOHandle>& psos);
+
+        // 在渲染线程的帧边界调用 (GPU已经不再使用上一帧的PSO)
+        void Update();
+
+    private:
+        struct RegisteredShader
+        {
+            ShaderPermutationSet* shader = nullptr;
+            std::string name;
+            std::wstring file;
+            std::vector<PSOManager::PSOHandle> psos;
+            JobSystem::JobHandle job;
+            bool dirty = false;
+        };
+
+        // 内容没变 (只是被touch或者编辑器重复保存) 时返回 false
+        bool RefreshFile(const std::wstring& file);
+        void ScanIncludes(const std::wstring& file, const std::string& source);
+        void CollectIncluders(const std::wstring& file, std::unordered_set<std::wstring>& affected) const;
+        void ProcessChanges(const std::vector<std::filesystem::path>& changes);
+
+    private:
+        JobSystem& jobs;
+        PSOManager& pso_manager;
+        FileWatcher watcher;
+
+        std::vector<RegisteredShader> shaders;
+
+        // 文件 -> 它 include 的文件, key 都是 NormalizeShaderPath 之后的路径
+        std::unordered_map<std::wstring, std::vector<std::wstring>> includes;
+        std::unordered_map<std::wstring, std::uint64_t> content_hashes;
+
+        // 文件写入时会连续触发多个事件, 安静一段时间后再处理
+        std::vector<std::filesystem::path> pending_changes;
+        std::chrono::steady_clock::time_point last_change_time;
+};
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "ShaderPermutation.h"
+#include "Hash.h"
+
+ShaderPermutationSet::ShaderPermutationSet(const std::wstring& filename,
+                                           const std::string& entrypoint,
+                                           const std::string& target,
+                                           const std::vector<std::string>& feature_defines)
+:filename(filename), entrypoint(entrypoint), target(target), feature_defines(feature_defines)
+{
+    if(feature_defines.size() > max_features)
+    {
+        throw DxException(E_INVALIDARG, L"ShaderPermutationSet", AnsiToWString(__FILE__), __LINE__);
+    }
+
+    valid_mask = (1u << (std::uint32_t)feature_defines.size()) - 1;
+    stats.possible_count = valid_mask + 1;
+}
+
+std::uint32_t ShaderPermutationSet::FeatureBit(const std::string& define) const
+{
+    for(std::uint32_t i = 0; i < feature_defines.size(); ++i)
+    {
+        if(feature_defines[i] == define)
+            return 1u << i;
+    }
+    return 0;
+}
+
+void ShaderPermutationSet::AddRequires(std::uint32_t feature_mask, std::uint32_t required_mask)
+{
+    Constraint c;
+    c.feature_mask = feature_mask & valid_mask;
+    c.required_mask = required_mask & valid_mask;
+    constraints.push_back(c);
+}
+
+void ShaderPermutationSet::AddExclusive(std::uint32_t feature_mask)
+{
+    Constraint c;
+    c.feature_mask = feature_mask & valid_mask;
+    c.exclusive = true;
+    constraints.push_back(c);
+}
+
+void ShaderPermutationSet::AddUsed(std::uint32_t mask)
+{
+    mask &= valid_mask;
+    if(std::find(used_masks.begin(), used_masks.end(), mask) == used_masks.end())
+        used_masks.push_back(mask);
+}
+
+bool ShaderPermutationSet::IsReachable(std::uint32_t mask) const
+{
+    for(const auto& c : constraints)
+    {
+        const std::uint32_t enabled = mask & c.feature_mask;
+        if(c.exclusive)
+        {
+            // 超过一位
+            if((enabled & (enabled - 1)) != 0)
+                return false;
+        }
+        else if(enabled != 0 && (mask & c.required_mask) != c.required_mask)
+        {
+            return false;
+        }
+    }
+
+    if(used_masks.empty())
+        return true;
+
+    return std::find(used_masks.begin(), used_masks.end(), mask) != used_masks.end();
+}
+
+std::vector<std::uint32_t> ShaderPermutationSet::ReachableMasks() const
+{
+    std::vector<std::uint32_t> masks;
+    if(!used_masks.empty())
+    {
+        // 只遍历声明过的组合, 不会随 feature 数量指数增长
+        for(std::uint32_t mask : used_masks)
+        {
+            if(IsReachable(mask))
+                masks.push_back(mask);
+        }
+        std::sort(masks.begin(), masks.end());
+        return masks;
+    }
+
+    for(std::uint32_t mask = 0; mask <= valid_mask; ++mask)
+    {
+        if(IsReachable(mask))
+            masks.push_back(mask);
+    }
+    return masks;
+}
+
+std::vector<D3D_SHADER_MACRO> ShaderPermutationSet::BuildMacros(std::uint32_t mask) const
+{
+    std::vector<D3D_SHADER_MACRO> macros;
+    for(std::uint32_t i = 0; i < feature_defines.size(); ++i)
+    {
+        if(mask & (1u << i))
+            macros.push_back({feature_defines[i].c_str(), "1"});
+    }
+    macros.push_back({nullptr, nullptr});
+
+    return macros;
+}
+
+std::uint64_t ShaderPermutationSet::PermutationHash(std::uint32_t mask) const
+{
+    std::vector<std::string> defines;
+    for(std::uint32_t i = 0; i < feature_defines.size(); ++i)
+    {
+        if(mask & (1u << i))
+            defines.push_back(feature_defines[i]);
+    }
+    std::sort(defines.begin(), defines.end());
+
+    Hasher hasher;
+    hasher.AddBytes(filename.data(), filename.size() * sizeof(wchar_t));
+    hasher.AddString(entrypoint.c_str());
+    hasher.AddString(target.c_str());
+    for(const auto& define : defines)
+    {
+        // 带上长度, 避免 "AB"+"C" 与 "A"+"BC" 冲突
+        hasher.Add((std::uint64_t)define.size());
+        hasher.AddString(define.c_str());
+    }
+
+    return hasher.Value();
+}
+
+JobSystem::JobHandle ShaderPermutationSet::Compile(JobSystem& jobs, const std::string& name)
+{
+    compile_masks = ReachableMasks();
+    compiled.assign(compile_masks.size(), nullptr);
+    stats.reachable_count = (std::uint32_t)compile_masks.size();
+
+    std::vector<JobSystem::JobHandle> compile_jobs;
+    compile_jobs.reserve(compile_masks.size());
+    for(std::size_t i = 0; i < compile_masks.size(); ++i)
+    {
+        char job_name[32];
+        std::snprintf(job_name, sizeof(job_name), " [0x%04x]", compile_masks[i]);
+
+        compile_jobs.push_back(jobs.Schedule(name + job_name, [this, i]{
+            std::vector<D3D_SHADER_MACRO> macros = BuildMacros(compile_masks[i]);
+            compiled[i] = CompileShader(filename, macros.data(), entrypoint, target);
+        }));
+    }
+
+    return jobs.Schedule(name + " dedupe", [this]{ Dedupe(); }, compile_jobs);
+}
+
+void ShaderPermutationSet::Dedupe()
+{
+    unique_bytecodes.clear();
+    unique_reflections.clear();
+    variant_table.assign((std::size_t)valid_mask + 1, invalid_variant);
+    stats.unique_bytesize = 0;
+    stats.deduped_bytesize = 0;
+
+    std::unordered_multimap<std::uint64_t, std::uint16_t> bytecode_lookup;
+    for(std::size_t i = 0; i < compiled.size(); ++i)
+    {
+        ID3DBlob* blob = compiled[i].Get();
+        const SIZE_T bytesize = blob->GetBufferSize();
+        const std::uint64_t hash = HashBytes(blob->GetBufferPointer(), bytesize);
+
+        // 哈希相同再逐字节比较
+        std::uint16_t variant = invalid_variant;
+        auto range = bytecode_lookup.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it)
+        {
+            ID3DBlob* other = unique_bytecodes[it->second].Get();
+            if(other->GetBufferSize() == bytesize &&
+               std::memcmp(other->GetBufferPointer(), blob->GetBufferPointer(), bytesize) == 0)
+            {
+                variant = it->second;
+                break;
+            }
+        }
+
+        if(variant == invalid_variant)
+        {
+            variant = (std::uint16_t)unique_bytecodes.size();
+            unique_bytecodes.push_back(compiled[i]);
+            unique_reflections.push_back(ReflectShader(blob));
+            bytecode_lookup.emplace(hash, variant);
+            stats.unique_bytesize += bytesize;
+        }
+        else
+        {
+            stats.deduped_bytesize += bytesize;
+        }
+
+        variant_table[compile_masks[i]] = variant;
+    }
+
+    stats.unique_count = (std::uint32_t)unique_bytecodes.size();
+
+    // 重复的 blob 在这里释放
+    compiled.clear();
+}
+
+ID3DBlob* ShaderPermutationSet::Resolve(std::uint32_t mask) const
+{
+    mask &= valid_mask;
+    if(mask >= variant_table.size())
+        return nullptr;
+
+    std::uint16_t variant = variant_table[mask];
+    return variant == invalid_variant ? nullptr : unique_bytecodes[variant].Get();
+}
+
+const ShaderReflectionData* ShaderPermutationSet::ResolveReflection(std::uint32_t mask) const
+{
+    mask &= valid_mask;
+    if(mask >= variant_table.size())
+        return nullptr;
+
+    std::uint16_t variant = variant_table[mask];
+    return variant == invalid_variant ? nullptr : &unique_reflections[variant];
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Util.h"
+#include "JobSystem.h"
+#include "ShaderReflection.h"
+
+//-----------------------------ShaderPermutation--------------------------------
+// 管理一个 shader 入口的所有变体
+// 每个 feature 对应一个 define 和 mask 里的一位, 只编译可达的组合,
+// 字节码相同的变体共享一份, 运行时用 feature mask 直接查表得到字节码
+class ShaderPermutationSet
+{
+    public:
+        // mask 查表用 2^n 的数组, 限制 feature 数量
+        static constexpr std::uint32_t max_features = 16;
+        static constexpr std::uint16_t invalid_variant = UINT16_MAX;
+
+        struct Stats
+        {
+            std::uint32_t possible_count = 0;
+            std::uint32_t reachable_count = 0;
+            std::uint32_t unique_count = 0;
+            std::uint64_t unique_bytesize = 0;
+            // 去重节省的字节码大小
+            std::uint64_t deduped_bytesize = 0;
+        };
+
+        ShaderPermutationSet(const std::wstring& filename,
+                             const std::string& entrypoint,
+                             const std::string& target,
+                             const std::vector<std::string>& feature_defines);
+
+        ShaderPermutationSet(const ShaderPermutationSet& rhs) = delete;
+        ShaderPermutationSet& operator=(const ShaderPermutationSet& rhs) = delete;
+
+        std::uint32_t FeatureBit(const std::string& define) const;
+        const std::wstring& Filename() const { return filename; }
+
+        // feature 依赖另一个 feature, 单独出现的组合不可达
+        void AddRequires(std::uint32_t feature_mask, std::uint32_t required_mask);
+        // mask 中的 feature 最多同时开启一个
+        void AddExclusive(std::uint32_t feature_mask);
+        // 材质实际用到的组合, 一个都没声明时所有满足约束的组合都可达
+        void AddUsed(std::uint32_t mask);
+
+        // 在线程池上编译所有可达的变体, 返回的job完成时查表可用
+        JobSystem::JobHandle Compile(JobSystem& jobs, const std::string& name);
+
+        // O(1), 不可达的组合返回 nullptr
+        ID3DBlob* Resolve(std::uint32_t mask) const;
+        // 编译时顺带反射的结果, 与 Resolve 返回的字节码对应
+        const ShaderReflectionData* ResolveReflection(std::uint32_t mask) const;
+
+        // 由 文件 + 入口 + target + 排序后的define 计算, 可以作为磁盘缓存的key
+        std::uint64_t PermutationHash(std::uint32_t mask) const;
+        std::vector<std::uint32_t> ReachableMasks() const;
+        Stats GetStats() const { return stats; }
+
+    private:
+        bool IsReachable(std::uint32_t mask) const;
+        std::vector<D3D_SHADER_MACRO> BuildMacros(std::uint32_t mask) const;
+        void Dedupe();
+
+    private:
+        struct Constraint
+        {
+            std::uint32_t feature_mask = 0;
+            std::uint32_t required_mask = 0;
+            bool exclusive = false;
+        };
+
+        std::wstring filename;
+        std::string entrypoint;
+        std::string target;
+        std::vector<std::string> feature_defines;
+        std::uint32_t valid_mask = 0;
+
+        std::vector<Constraint> constraints;
+        std::vector<std::uint32_t> used_masks;
+
+        // 编译结果, 与 compile_masks 一一对应
+        std::vector<std::uint32_t> compile_masks;
+        std::vector<ComPtr<ID3DBlob>> compiled;
+
+        // 去重后的字节码, variant_table[mask] 是其中的下标
+        std::vector<ComPtr<ID3DBlob>> unique_bytecodes;
+        std::vector<ShaderReflectionData> unique_reflections;
+        std::vector<std::uint16_t> variant_table;
+
+        Stats stats;
+};
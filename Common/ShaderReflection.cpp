@@ -0,0 +1,390 @@
+#include <algorithm>
+
+#include "ShaderReflection.h"
+
+namespace
+{
+    DXGI_FORMAT DeduceFormat(D3D_REGISTER_COMPONENT_TYPE component_type, BYTE mask)
+    {
+        UINT count = 0;
+        for(BYTE m = mask; m != 0; m >>= 1)
+            count += m & 1;
+
+        static const DXGI_FORMAT float_formats[] = {
+            DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT };
+        static const DXGI_FORMAT uint_formats[] = {
+            DXGI_FORMAT_R32_UINT, DXGI_FORMAT_R32G32_UINT, DXGI_FORMAT_R32G32B32_UINT, DXGI_FORMAT_R32G32B32A32_UINT };
+        static const DXGI_FORMAT sint_formats[] = {
+            DXGI_FORMAT_R32_SINT, DXGI_FORMAT_R32G32_SINT, DXGI_FORMAT_R32G32B32_SINT, DXGI_FORMAT_R32G32B32A32_SINT };
+
+        if(count == 0 || count > 4)
+            return DXGI_FORMAT_UNKNOWN;
+
+        switch(component_type)
+        {
+            case D3D_REGISTER_COMPONENT_FLOAT32: return float_formats[count - 1];
+            case D3D_REGISTER_COMPONENT_UINT32: return uint_formats[count - 1];
+            case D3D_REGISTER_COMPONENT_SINT32: return sint_formats[count - 1];
+            default: return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    // 排序用: CBV, SRV, UAV, sampler
+    int RangeOrder(D3D_SHADER_INPUT_TYPE type)
+    {
+        switch(type)
+        {
+            case D3D_SIT_CBUFFER: return 0;
+            case D3D_SIT_TBUFFER:
+            case D3D_SIT_TEXTURE:
+            case D3D_SIT_STRUCTURED:
+            case D3D_SIT_BYTEADDRESS:
+                return 1;
+            case D3D_SIT_SAMPLER: return 3;
+            default: return 2;
+        }
+    }
+
+    D3D12_DESCRIPTOR_RANGE_TYPE RangeType(D3D_SHADER_INPUT_TYPE type)
+    {
+        static const D3D12_DESCRIPTOR_RANGE_TYPE range_types[] = {
+            D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
+            D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+            D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+            D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER };
+        return range_types[RangeOrder(type)];
+    }
+}
+
+const ShaderVariable* ShaderConstantBuffer::FindVariable(const std::string& variable_name) const
+{
+    for(const auto& variable : variables)
+    {
+        if(variable.name == variable_name)
+            return &variable;
+    }
+    return nullptr;
+}
+
+const ShaderConstantBuffer* ShaderReflectionData::FindConstantBuffer(const std::string& cb_name) const
+{
+    for(const auto& cb : constant_buffers)
+    {
+        if(cb.name == cb_name)
+            return &cb;
+    }
+    return nullptr;
+}
+
+ShaderReflectionData ReflectShader(ID3DBlob* bytecode)
+{
+    ComPtr<ID3D12ShaderReflection> reflection;
+    ThrowIfFailed(D3DReflect(
+        bytecode->GetBufferPointer(),
+        bytecode->GetBufferSize(),
+        IID_PPV_ARGS(reflection.GetAddressOf())));
+
+    D3D12_SHADER_DESC shader_desc;
+    ThrowIfFailed(reflection->GetDesc(&shader_desc));
+
+    ShaderReflectionData data;
+
+    data.inputs.reserve(shader_desc.InputParameters);
+    for(UINT i = 0; i < shader_desc.InputParameters; ++i)
+    {
+        D3D12_SIGNATURE_PARAMETER_DESC param_desc;
+        ThrowIfFailed(reflection->GetInputParameterDesc(i, &param_desc));
+
+        ShaderInputParameter input;
+        input.semantic_name = param_desc.SemanticName;
+        input.semantic_index = param_desc.SemanticIndex;
+        input.component_type = param_desc.ComponentType;
+        input.mask = param_desc.Mask;
+        input.system_value = param_desc.SystemValueType != D3D_NAME_UNDEFINED;
+        data.inputs.push_back(input);
+    }
+
+    data.bindings.reserve(shader_desc.BoundResources);
+    for(UINT i = 0; i < shader_desc.BoundResources; ++i)
+    {
+        D3D12_SHADER_INPUT_BIND_DESC bind_desc;
+        ThrowIfFailed(reflection->GetResourceBindingDesc(i, &bind_desc));
+
+        ShaderResourceBinding binding;
+        binding.name = bind_desc.Name;
+        binding.type = bind_desc.Type;
+        binding.bind_point = bind_desc.BindPoint;
+        binding.bind_count = bind_desc.BindCount;
+        binding.space = bind_desc.Space;
+        data.bindings.push_back(binding);
+    }
+
+    data.constant_buffers.reserve(shader_desc.ConstantBuffers);
+    for(UINT i = 0; i < shader_desc.ConstantBuffers; ++i)
+    {
+        ID3D12ShaderReflectionConstantBuffer* cb_reflection = reflection->GetConstantBufferByIndex(i);
+        D3D12_SHADER_BUFFER_DESC buffer_desc;
+        ThrowIfFailed(cb_reflection->GetDesc(&buffer_desc));
+
+        ShaderConstantBuffer cb;
+        cb.name = buffer_desc.Name;
+        cb.bytesize = buffer_desc.Size;
+
+        for(const auto& binding : data.bindings)
+        {
+            if(binding.type == D3D_SIT_CBUFFER && binding.name == cb.name)
+            {
+                cb.bind_point = binding.bind_point;
+                cb.space = binding.space;
+                break;
+            }
+        }
+
+        cb.variables.reserve(buffer_desc.Variables);
+        for(UINT j = 0; j < buffer_desc.Variables; ++j)
+        {
+            D3D12_SHADER_VARIABLE_DESC variable_desc;
+            ThrowIfFailed(cb_reflection->GetVariableByIndex(j)->GetDesc(&variable_desc));
+
+            ShaderVariable variable;
+            variable.name = variable_desc.Name;
+            variable.offset = variable_desc.StartOffset;
+            variable.bytesize = variable_desc.Size;
+            cb.variables.push_back(variable);
+        }
+
+        data.constant_buffers.push_back(cb);
+    }
+
+    return data;
+}
+
+//-------------------------------------InputLayout-----------------------------------
+InputLayout::InputLayout(const InputLayout& rhs)
+:semantic_names(rhs.semantic_names), elements(rhs.elements)
+{
+    RepointNames();
+}
+
+InputLayout::InputLayout(InputLayout&& rhs) noexcept
+:semantic_names(std::move(rhs.semantic_names)), elements(std::move(rhs.elements))
+{
+    RepointNames();
+}
+
+InputLayout& InputLayout::operator=(const InputLayout& rhs)
+{
+    semantic_names = rhs.semantic_names;
+    elements = rhs.elements;
+    RepointNames();
+    return *this;
+}
+
+InputLayout& InputLayout::operator=(InputLayout&& rhs) noexcept
+{
+    semantic_names = std::move(rhs.semantic_names);
+    elements = std::move(rhs.elements);
+    RepointNames();
+    return *this;
+}
+
+void InputLayout::Add(const D3D12_INPUT_ELEMENT_DESC& element)
+{
+    semantic_names.emplace_back(element.SemanticName != nullptr ? element.SemanticName : "");
+    elements.push_back(element);
+    RepointNames();
+}
+
+void InputLayout::RepointNames()
+{
+    for(std::size_t i = 0; i < elements.size(); ++i)
+        elements[i].SemanticName = semantic_names[i].c_str();
+}
+
+InputLayout BuildInputLayout(const ShaderReflectionData& vs, const std::vector<VertexStreamBinding>& streams)
+{
+    InputLayout layout;
+    for(const auto& input : vs.inputs)
+    {
+        if(input.system_value)
+            continue;
+
+        auto stream = std::find_if(streams.begin(), streams.end(), [&input](const VertexStreamBinding& s){
+            return _stricmp(s.semantic_name, input.semantic_name.c_str()) == 0 && s.semantic_index == input.semantic_index;
+        });
+
+        // shader 需要的输入没有对应的数据流, 创建PSO时一定会失败, 提前报错
+        if(stream == streams.end())
+        {
+            throw DxException(E_INVALIDARG, L"BuildInputLayout " + AnsiToWString(input.semantic_name),
+                              AnsiToWString(__FILE__), __LINE__);
+        }
+
+        D3D12_INPUT_ELEMENT_DESC element;
+        element.SemanticName = input.semantic_name.c_str();
+        element.SemanticIndex = input.semantic_index;
+        element.Format = stream->format != DXGI_FORMAT_UNKNOWN ? stream->format : DeduceFormat(input.component_type, input.mask);
+        element.InputSlot = stream->input_slot;
+        element.AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+        element.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+        element.InstanceDataStepRate = 0;
+        layout.Add(element);
+    }
+
+    return layout;
+}
+
+//-------------------------------------ReflectedRootSignature-----------------------------------
+ReflectedRootSignature::ReflectedRootSignature(const std::vector<const ShaderReflectionData*>& stages,
+                                               const std::vector<std::string>& root_constants)
+{
+    // 同一个寄存器可能被多个阶段使用, 只保留一份
+    for(const auto* stage : stages)
+    {
+        if(stage == nullptr)
+            continue;
+
+        for(const auto& binding : stage->bindings)
+        {
+            auto it = std::find_if(bindings.begin(), bindings.end(), [&binding](const ShaderResourceBinding& b){
+                return RangeType(b.type) == RangeType(binding.type) &&
+                       b.space == binding.space &&
+                       b.bind_point == binding.bind_point;
+            });
+            if(it == bindings.end())
+                bindings.push_back(binding);
+        }
+    }
+
+    std::sort(bindings.begin(), bindings.end(), [](const ShaderResourceBinding& a, const ShaderResourceBinding& b){
+        if(RangeOrder(a.type) != RangeOrder(b.type))
+            return RangeOrder(a.type) < RangeOrder(b.type);
+        if(a.space != b.space)
+            return a.space < b.space;
+        return a.bind_point < b.bind_point;
+    });
+
+    auto is_root_constant = [&root_constants](const ShaderResourceBinding& binding){
+        return binding.type == D3D_SIT_CBUFFER &&
+               std::find(root_constants.begin(), root_constants.end(), binding.name) != root_constants.end();
+    };
+
+    UINT resource_offset = 0;
+    UINT sampler_offset = 0;
+    for(const auto& binding : bindings)
+    {
+        if(is_root_constant(binding))
+        {
+            table_offsets.push_back(0);
+            continue;
+        }
+
+        // unbounded 数组 (BindCount == 0) 按1个处理
+        const UINT count = std::max(binding.bind_count, 1u);
+        CD3DX12_DESCRIPTOR_RANGE range;
+        if(binding.type == D3D_SIT_SAMPLER)
+        {
+            range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, count, binding.bind_point, binding.space, sampler_offset);
+            sampler_ranges.push_back(range);
+            table_offsets.push_back(sampler_offset);
+            sampler_offset += count;
+        }
+        else
+        {
+            range.Init(RangeType(binding.type), count, binding.bind_point, binding.space, resource_offset);
+            resource_ranges.push_back(range);
+            table_offsets.push_back(resource_offset);
+            resource_offset += count;
+        }
+    }
+
+    // ranges 填完后才能取地址
+    const UINT resource_parameter = 0;
+    const UINT sampler_parameter = resource_ranges.empty() ? 0 : 1;
+    if(!resource_ranges.empty())
+    {
+        CD3DX12_ROOT_PARAMETER parameter;
+        parameter.InitAsDescriptorTable((UINT)resource_ranges.size(), resource_ranges.data());
+        parameters.push_back(parameter);
+    }
+    if(!sampler_ranges.empty())
+    {
+        CD3DX12_ROOT_PARAMETER parameter;
+        parameter.InitAsDescriptorTable((UINT)sampler_ranges.size(), sampler_ranges.data());
+        parameters.push_back(parameter);
+    }
+
+    for(const auto& binding : bindings)
+    {
+        parameter_indices.push_back(binding.type == D3D_SIT_SAMPLER ? sampler_parameter : resource_parameter);
+    }
+
+    // 根常量的大小取自定义这个 cbuffer 的阶段
+    for(const auto& name : root_constants)
+    {
+        auto binding = std::find_if(bindings.begin(), bindings.end(), [&](const ShaderResourceBinding& b){
+            return is_root_constant(b) && b.name == name;
+        });
+        if(binding == bindings.end())
+            continue;
+
+        const ShaderConstantBuffer* cb = nullptr;
+        for(const auto* stage : stages)
+        {
+            if(cb == nullptr && stage != nullptr)
+                cb = stage->FindConstantBuffer(name);
+        }
+
+        // cbuffer 的大小按 16 字节对齐, 根常量只需要覆盖到最后一个变量
+        UINT bytesize = 0;
+        for(const auto& variable : cb->variables)
+            bytesize = std::max(bytesize, variable.offset + variable.bytesize);
+
+        parameter_indices[binding - bindings.begin()] = (UINT)parameters.size();
+        CD3DX12_ROOT_PARAMETER parameter;
+        parameter.InitAsConstants((bytesize + 3) / 4, binding->bind_point, binding->space);
+        parameters.push_back(parameter);
+    }
+}
+
+ComPtr<ID3DBlob> ReflectedRootSignature::Serialize(D3D12_ROOT_SIGNATURE_FLAGS flags) const
+{
+    CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc(
+        (UINT)parameters.size(),
+        parameters.empty() ? nullptr : parameters.data(),
+        0,
+        nullptr,
+        flags);
+
+    ComPtr<ID3DBlob> serialize_root_signature = nullptr;
+    ComPtr<ID3DBlob> error_blob = nullptr;
+
+    HRESULT hr = D3D12SerializeRootSignature(
+        &root_signature_desc,
+        D3D_ROOT_SIGNATURE_VERSION_1,
+        serialize_root_signature.GetAddressOf(),
+        error_blob.GetAddressOf());
+
+    if(error_blob != nullptr)
+    {
+        OutputDebugStringA((char*)error_blob->GetBufferPointer());
+    }
+
+    ThrowIfFailed(hr);
+
+    return serialize_root_signature;
+}
+
+bool ReflectedRootSignature::FindBinding(const std::string& name, UINT& root_parameter_index, UINT& table_offset) const
+{
+    for(std::size_t i = 0; i < bindings.size(); ++i)
+    {
+        if(bindings[i].name == name)
+        {
+            root_parameter_index = parameter_indices[i];
+            table_offset = table_offsets[i];
+            return true;
+        }
+    }
+    return false;
+}
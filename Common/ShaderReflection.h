@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <d3d12shader.h>
+
+#include "Util.h"
+
+//-----------------------------ShaderReflection--------------------------------
+// 编译完成后立刻反射一次, 结果和字节码存在一起
+// input layout / root signature / 常量缓冲的偏移都从这里生成, 运行时不再调用 D3DReflect
+struct ShaderInputParameter
+{
+    std::string semantic_name;
+    UINT semantic_index = 0;
+    D3D_REGISTER_COMPONENT_TYPE component_type = D3D_REGISTER_COMPONENT_UNKNOWN;
+    BYTE mask = 0;
+    // SV_VertexID 之类由硬件生成, 不出现在 input layout 里
+    bool system_value = false;
+};
+
+struct ShaderVariable
+{
+    std::string name;
+    UINT offset = 0;
+    UINT bytesize = 0;
+};
+
+struct ShaderConstantBuffer
+{
+    std::string name;
+    UINT bytesize = 0;
+    UINT bind_point = 0;
+    UINT space = 0;
+    std::vector<ShaderVariable> variables;
+
+    const ShaderVariable* FindVariable(const std::string& variable_name) const;
+};
+
+struct ShaderResourceBinding
+{
+    std::string name;
+    D3D_SHADER_INPUT_TYPE type = D3D_SIT_CBUFFER;
+    UINT bind_point = 0;
+    UINT bind_count = 1;
+    UINT space = 0;
+};
+
+struct ShaderReflectionData
+{
+    std::vector<ShaderInputParameter> inputs;
+    std::vector<ShaderConstantBuffer> constant_buffers;
+    std::vector<ShaderResourceBinding> bindings;
+
+    const ShaderConstantBuffer* FindConstantBuffer(const std::string& cb_name) const;
+};
+
+ShaderReflectionData ReflectShader(ID3DBlob* bytecode);
+
+//-----------------------------InputLayout--------------------------------
+// 顶点数据流的绑定方式, 由网格数据决定, shader 里看不到
+struct VertexStreamBinding
+{
+    const char* semantic_name = nullptr;
+    UINT semantic_index = 0;
+    UINT input_slot = 0;
+    // UNKNOWN 时按 shader 输入的分量类型和数量推导 (例如 float3 -> R32G32B32_FLOAT)
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+};
+
+// 自己保存语义名, 元素的 SemanticName 指向这里的字符串
+// 热更新会替换反射数据, layout 不能引用反射数据里的字符串
+class InputLayout
+{
+    public:
+        InputLayout() = default;
+        InputLayout(const InputLayout& rhs);
+        InputLayout(InputLayout&& rhs) noexcept;
+        InputLayout& operator=(const InputLayout& rhs);
+        InputLayout& operator=(InputLayout&& rhs) noexcept;
+
+        // 复制 element.SemanticName 指向的字符串
+        void Add(const D3D12_INPUT_ELEMENT_DESC& element);
+
+        D3D12_INPUT_LAYOUT_DESC Desc() const { return {elements.data(), (UINT)elements.size()}; }
+        const std::vector<D3D12_INPUT_ELEMENT_DESC>& Elements() const { return elements; }
+
+    private:
+        // 拷贝或者 vector 扩容后短字符串的地址会变, 重新指向
+        void RepointNames();
+
+    private:
+        std::vector<std::string> semantic_names;
+        std::vector<D3D12_INPUT_ELEMENT_DESC> elements;
+};
+
+InputLayout BuildInputLayout(const ShaderReflectionData& vs, const std::vector<VertexStreamBinding>& streams);
+
+//-----------------------------RootSignature--------------------------------
+// 合并所有阶段的绑定:
+// CBV/SRV/UAV 放进第0个 descriptor table, 按 CBV, SRV, UAV 和寄存器顺序排列, sampler 单独一个 table
+// root_constants 中列出的 cbuffer 不进 table, 按名字顺序各自成为一个 32 位根常量参数, 排在 table 后面,
+// 适合每次绘制都要改的几个值 (例如实例的起始编号), 不需要为每次绘制准备一个CBV
+class ReflectedRootSignature
+{
+    public:
+        explicit ReflectedRootSignature(const std::vector<const ShaderReflectionData*>& stages,
+                                        const std::vector<std::string>& root_constants = {});
+
+        ReflectedRootSignature(const ReflectedRootSignature& rhs) = delete;
+        ReflectedRootSignature& operator=(const ReflectedRootSignature& rhs) = delete;
+
+        ComPtr<ID3DBlob> Serialize(D3D12_ROOT_SIGNATURE_FLAGS flags =
+                                   D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT) const;
+
+        // 绑定所在的 root parameter, 以及在 descriptor table 里的偏移 (根常量为 0), 找不到返回 false
+        bool FindBinding(const std::string& name, UINT& root_parameter_index, UINT& table_offset) const;
+
+        const std::vector<ShaderResourceBinding>& Bindings() const { return bindings; }
+
+    private:
+        std::vector<ShaderResourceBinding> bindings;
+        std::vector<UINT> table_offsets;
+        std::vector<UINT> parameter_indices;
+
+        std::vector<CD3DX12_DESCRIPTOR_RANGE> resource_ranges;
+        std::vector<CD3DX12_DESCRIPTOR_RANGE> sampler_ranges;
+        std::vector<CD3DX12_ROOT_PARAMETER> parameters;
+};
+
+//-----------------------------PipelineLayout--------------------------------
+// 同一组反射结果生成的 root signature 和 input layout
+// PSO 和它们一起创建, 热更新时在重建PSO的 job 里重新生成, 和新PSO一起在帧边界生效
+struct PipelineLayout
+{
+    std::unique_ptr<ReflectedRootSignature> reflected_root_signature;
+    ComPtr<ID3D12RootSignature> root_signature;
+    std::uint64_t root_signature_hash = 0;
+    InputLayout input_layout;
+};
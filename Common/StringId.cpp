@@ -0,0 +1,124 @@
+#include <cstring>
+#include <mutex>
+
+#include "Hash.h"
+#include "StringId.h"
+
+namespace
+{
+    constexpr std::size_t string_block_bytesize = 64 * 1024;
+    constexpr std::size_t initial_slot_count = 1024;
+}
+
+StringInterner& StringInterner::Get()
+{
+    static StringInterner interner;
+    return interner;
+}
+
+StringInterner::StringInterner()
+:slots(initial_slot_count, 0)
+{
+    strings.push_back(std::string_view());
+    hashes.push_back(0);
+}
+
+std::uint32_t StringInterner::FindSlot(std::string_view str, std::uint64_t hash) const
+{
+    // 槽数是 2 的幂, 线性探测, 先比较完整的哈希再比较字符串
+    const std::size_t mask = slots.size() - 1;
+    for(std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+        const std::uint32_t id = slots[slot];
+        if(id == 0 || (hashes[id] == hash && strings[id] == str))
+            return (std::uint32_t)slot;
+    }
+}
+
+void StringInterner::Grow()
+{
+    std::vector<std::uint32_t> grown(slots.size() * 2, 0);
+    const std::size_t mask = grown.size() - 1;
+    for(std::uint32_t id = 1; id < strings.size(); ++id)
+    {
+        std::size_t slot = hashes[id] & mask;
+        while(grown[slot] != 0)
+            slot = (slot + 1) & mask;
+        grown[slot] = id;
+    }
+    slots.swap(grown);
+}
+
+std::string_view StringInterner::Store(std::string_view str)
+{
+    char* data = nullptr;
+    if(str.size() > string_block_bytesize / 4)
+    {
+        // 长字符串单独分配, 不浪费当前块剩下的空间
+        blocks.push_back(std::make_unique<char[]>(str.size()));
+        data = blocks.back().get();
+    }
+    else
+    {
+        if(block_used + str.size() > string_block_bytesize || current_block == nullptr)
+        {
+            blocks.push_back(std::make_unique<char[]>(string_block_bytesize));
+            current_block = blocks.back().get();
+            block_used = 0;
+        }
+        data = current_block + block_used;
+        block_used += str.size();
+    }
+    std::memcpy(data, str.data(), str.size());
+    return std::string_view(data, str.size());
+}
+
+StringId StringInterner::Intern(std::string_view str)
+{
+    if(str.empty())
+        return StringId();
+
+    const std::uint64_t hash = HashBytes(str.data(), str.size());
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        const std::uint32_t id = slots[FindSlot(str, hash)];
+        if(id != 0)
+            return StringId{id};
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // 释放读锁之后可能已经被别的线程登记
+    std::uint32_t slot = FindSlot(str, hash);
+    if(slots[slot] != 0)
+        return StringId{slots[slot]};
+
+    const std::uint32_t id = (std::uint32_t)strings.size();
+    strings.push_back(Store(str));
+    hashes.push_back(hash);
+    slots[slot] = id;
+    if(strings.size() * 2 > slots.size())
+        Grow();
+    return StringId{id};
+}
+
+StringId StringInterner::Find(std::string_view str) const
+{
+    if(str.empty())
+        return StringId();
+
+    const std::uint64_t hash = HashBytes(str.data(), str.size());
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return StringId{slots[FindSlot(str, hash)]};
+}
+
+std::string_view StringInterner::View(StringId id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return id.value < strings.size() ? strings[id.value] : std::string_view();
+}
+
+std::size_t StringInterner::Count() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings.size() - 1;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//-----------------------------StringId--------------------------------
+// 名字在加载时换成全局唯一的 32 位编号, 之后的查找只比较整数, 不再哈希字符串也不分配内存
+// 编号从 1 开始按登记顺序递增, 进程内稳定, 不要写进文件; 0 表示空字符串
+struct StringId
+{
+    std::uint32_t value = 0;
+
+    bool IsValid() const { return value != 0; }
+    bool operator==(const StringId& rhs) const { return value == rhs.value; }
+    bool operator!=(const StringId& rhs) const { return value != rhs.value; }
+    bool operator<(const StringId& rhs) const { return value < rhs.value; }
+};
+
+// 字符串存放在只增不减的内存块中, View 返回的 string_view 一直有效
+// 可以在多个线程同时调用, Intern 只在加载时使用
+class StringInterner
+{
+    public:
+        static StringInterner& Get();
+
+        StringInterner();
+        StringInterner(const StringInterner& rhs) = delete;
+        StringInterner& operator=(const StringInterner& rhs) = delete;
+
+        // 已经登记过时返回原来的编号
+        StringId Intern(std::string_view str);
+        // 只查找不登记, 没有登记过时返回无效的编号
+        StringId Find(std::string_view str) const;
+        std::string_view View(StringId id) const;
+
+        std::size_t Count() const;
+
+    private:
+        // 调用时持有锁
+        std::uint32_t FindSlot(std::string_view str, std::uint64_t hash) const;
+        void Grow();
+        std::string_view Store(std::string_view str);
+
+    private:
+        // 开放寻址, 槽中存放编号, 0 为空槽; 负载超过一半时翻倍
+        std::vector<std::uint32_t> slots;
+        // 下标为编号, 第 0 项是空字符串
+        std::vector<std::string_view> strings;
+        std::vector<std::uint64_t> hashes;
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* current_block = nullptr;
+        std::size_t block_used = 0;
+
+        mutable std::shared_mutex mutex;
+};
+
+inline StringId InternString(std::string_view str)
+{
+    return StringInterner::Get().Intern(str);
+}
+
+//-----------------------------FlatIdMap--------------------------------
+// 以 StringId 为键的小表, 键和值分别连续存放, 按键排序后二分查找
+// 一个网格的 submesh 或一类资源通常只有几十项, 比哈希表更省内存, 查找也只访问一两条缓存行
+// Insert 只在加载时调用, 它会移动已有的值, 之前 Find 返回的指针随之失效
+template<typename T>
+class FlatIdMap
+{
+    public:
+        // 已有同样的键时覆盖
+        T& Insert(StringId id, T value)
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), id);
+            const std::size_t index = it - keys.begin();
+            if(it != keys.end() && *it == id)
+            {
+                values[index] = std::move(value);
+                return values[index];
+            }
+            keys.insert(it, id);
+            return *values.insert(values.begin() + index, std::move(value));
+        }
+
+        // 找不到时返回 nullptr
+        const T* Find(StringId id) const
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), id);
+            return it != keys.end() && *it == id ? &values[it - keys.begin()] : nullptr;
+        }
+
+        T* Find(StringId id)
+        {
+            return const_cast<T*>(static_cast<const FlatIdMap&>(*this).Find(id));
+        }
+
+        std::size_t Size() const { return keys.size(); }
+        bool Empty() const { return keys.empty(); }
+
+        // 按键的顺序, 和 Values 一一对应
+        const std::vector<StringId>& Keys() const { return keys; }
+        const std::vector<T>& Values() const { return values; }
+
+    private:
+        std::vector<StringId> keys;
+        std::vector<T> values;
+};
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cassert>
+
 #include "d3dx12.h"
 #include "Util.h"
+#include "ConstantBufferLayout.h"
 
 using namespace Microsoft::WRL;
 
@@ -16,11 +19,11 @@ class UploadBuffer
             element_bytesize = sizeof(T);
             if(is_constant_buffer)
             {
-                element_bytesize = CalcConstantBufferByteSize(sizeof(T));
+                element_bytesize = (UINT)CBLayout::CBVSize<T>;
             }
 
             const auto& heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            const auto& resource_desc = CD3DX12_RESOURCE_DESC::Buffer(element_bytesize);
+            const auto& resource_desc = CD3DX12_RESOURCE_DESC::Buffer((UINT64)element_bytesize * element_count);
             ThrowIfFailed(device->CreateCommittedResource(
                 &heap_properties,
                 D3D12_HEAP_FLAG_NONE,
@@ -59,6 +62,13 @@ class UploadBuffer
         {
             memcpy(&mapped_data[element_index * element_bytesize], &data, sizeof(T));
         }
+
+        // 只用于非常量缓冲, 元素紧密排列, 可以整段写入; 上传堆是 write-combined 内存, 只顺序写, 不要读
+        T* MappedElements()
+        {
+            assert(!is_constant_buffer);
+            return reinterpret_cast<T*>(mapped_data);
+        }
     private:
         ComPtr<ID3D12Resource> upload_buffer;
         BYTE* mapped_data = nullptr;
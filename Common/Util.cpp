@@ -138,4 +138,78 @@ ComPtr<ID3DBlob> CompileShader(const std::wstring& filename,
     ThrowIfFailed(hr);
 
     return byte_code;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<MeshGeometry> CreateMeshGeometry(const std::string& name, std::shared_ptr<const MappedMeshFile> file)
+{
+    const MeshFileHeader& header = file->Header();
+    // MappedMeshFile 已经检查过索引宽度和 index_format 一致, 这里只检查 MeshGeometry 需要的两个流
+    if(header.stream_count < 2 || MeshFileIndexBytesize(header.index_format) == 0)
+        return nullptr;
+
+    auto geometry = std::make_shared<MeshGeometry>();
+    geometry->name = name;
+    geometry->id = InternString(name);
+    geometry->vertex_byte_stride = header.streams[0].stride;
+    geometry->vertex_buffer_bytesize = (UINT)header.streams[0].data.bytesize;
+    geometry->vertex_color_byte_stride = header.streams[1].stride;
+    geometry->vertex_color_buffer_bytesize = (UINT)header.streams[1].data.bytesize;
+    geometry->index_format = (DXGI_FORMAT)header.index_format;
+    geometry->index_buffer_bytesize = (UINT)header.indices.bytesize;
+
+    // 压缩存放的索引解压到 blob 中, 上传时用它代替映射的数据
+    if(file->IndicesEncoded())
+    {
+        geometry->index_buffer_bytesize = (UINT)file->DecodedIndexBytesize();
+        ThrowIfFailed(D3DCreateBlob(geometry->index_buffer_bytesize, geometry->index_buffer_cpu.GetAddressOf()));
+        if(!file->DecodeIndices(geometry->index_buffer_cpu->GetBufferPointer()))
+            return nullptr;
+    }
+
+    const std::uint32_t* remap = file->VertexRemap();
+    if(remap != nullptr)
+        geometry->vertex_remap.assign(remap, remap + header.vertex_remap.bytesize / sizeof(std::uint32_t));
+
+    const MeshFileSubmesh* submeshes = file->Submeshes();
+    const MeshFileSegment* segments = file->Segments();
+    for(std::uint32_t i = 0; i < header.submesh_count; ++i)
+    {
+        const MeshFileSubmesh& record = submeshes[i];
+        SubmeshGeometry submesh;
+        submesh.index_count = record.index_count;
+        submesh.start_index_location = record.start_index_location;
+        submesh.base_vertex_location = record.base_vertex_location;
+        submesh.lod_count = record.lod_count;
+        submesh.lod_error = record.lod_error;
+        submesh.meshlet_offset = record.meshlet_offset;
+        submesh.meshlet_count = record.meshlet_count;
+        submesh.bounds.Center = DirectX::XMFLOAT3(record.box_center);
+        submesh.bounds.Extents = DirectX::XMFLOAT3(record.box_extents);
+        submesh.bounding_sphere.Center = DirectX::XMFLOAT3(record.sphere_center);
+        submesh.bounding_sphere.Radius = record.sphere_radius;
+        for(std::uint32_t s = 0; s < record.segment_count; ++s)
+        {
+            const MeshFileSegment& segment = segments[record.segment_offset + s];
+            SubmeshGeometry draw;
+            draw.index_count = segment.index_count;
+            draw.start_index_location = segment.start_index_location;
+            draw.base_vertex_location = segment.base_vertex_location;
+            submesh.segments.push_back(draw);
+        }
+        geometry->drawargs.Insert(InternString(LodDrawargName(record.name, record.lod)), std::move(submesh));
+    }
+
+    geometry->mapped_file = std::move(file);
+    return geometry;
+}
+
+void UploadMeshGeometry(ID3D12Device* device, ID3D12GraphicsCommandList* command_list, MeshGeometry& geometry)
+{
+    // 映射的文件页直接作为 upload buffer 的源数据, 缺页时才从磁盘读入
+    geometry.vertex_buffer_gpu = CreateDefaultBuffer(device, command_list, geometry.VertexData(),
+                                                     geometry.vertex_buffer_bytesize, geometry.vertex_buffer_uploader);
+    geometry.vertex_color_buffer_gpu = CreateDefaultBuffer(device, command_list, geometry.VertexColorData(),
+                                                           geometry.vertex_color_buffer_bytesize, geometry.vertex_color_buffer_uploader);
+    geometry.index_buffer_gpu = CreateDefaultBuffer(device, command_list, geometry.IndexData(),
+                                                    geometry.index_buffer_bytesize, geometry.index_buffer_uploader);
+}
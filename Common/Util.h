@@ -4,13 +4,17 @@
 #include <Windows.h>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <d3dcompiler.h>
 #include <dxgi1_6.h>
 #include <DirectXCollision.h>
 
 #include "d3dx12.h"
+#include "MeshFile.h"
+#include "StringId.h"
 
 using namespace Microsoft::WRL;
 
@@ -72,12 +76,34 @@ struct SubmeshGeometry
     UINT start_index_location = 0;
     INT base_vertex_location =0;
 
+    // ComputeBounds 计算, 用于剔除
     DirectX::BoundingBox bounds;
+    DirectX::BoundingSphere bounding_sphere;
+
+    // LOD0 记录 LOD 的数量, 第 n 级在 drawargs 中的键为 InternString(LodDrawargName(name, n))
+    UINT lod_count = 1;
+    // 相对 LOD0 的几何误差, 模型空间距离
+    float lod_error = 0.0f;
+
+    // 在 MeshGeometry 的 meshlet 表中的范围, 只有 LOD0 有 meshlet
+    UINT meshlet_offset = 0;
+    UINT meshlet_count = 0;
+
+    // 顶点超过 16 位索引的范围时拆成几段, 每段用自己的 base_vertex_location 绘制, 为空时整个 submesh 一次绘制
+    std::vector<SubmeshGeometry> segments;
 };
 
+// 只在加载时用来生成 drawargs 的键, 绘制时应当使用加载时记下的 StringId 或 SubmeshGeometry 指针
+inline std::string LodDrawargName(const std::string& name, UINT lod)
+{
+    return lod == 0 ? name : name + "_lod" + std::to_string(lod);
+}
+
 struct MeshGeometry
 {
     std::string name;
+    // InternString(name), MeshRegistry 按它查找
+    StringId id;
 
     ComPtr<ID3DBlob> vertex_buffer_cpu = nullptr;
     ComPtr<ID3DBlob> vertex_color_buffer_cpu = nullptr;
@@ -88,6 +114,7 @@ struct MeshGeometry
     ComPtr<ID3D12Resource> index_buffer_gpu = nullptr;
 
     ComPtr<ID3D12Resource> vertex_buffer_uploader = nullptr;
+    ComPtr<ID3D12Resource> vertex_color_buffer_uploader = nullptr;
     ComPtr<ID3D12Resource> index_buffer_uploader = nullptr;
 
     UINT vertex_byte_stride = 0;
@@ -97,7 +124,33 @@ struct MeshGeometry
     DXGI_FORMAT index_format = DXGI_FORMAT_R16_UINT;
     UINT index_buffer_bytesize = 0;
 
-    std::unordered_map<std::string, SubmeshGeometry> drawargs;
+    // 键为 submesh 名字的 StringId, 查找时只做整数的二分查找
+    FlatIdMap<SubmeshGeometry> drawargs;
+
+    // 原始顶点编号 -> 重排后的编号, 之后加载的蒙皮/morph 数据也要按它重排
+    std::vector<std::uint32_t> vertex_remap;
+
+    // 从 .mesh 文件加载时 CPU 端数据直接指向映射的文件, 三个 blob 为空; 只有索引压缩存放时 index_buffer_cpu 是解压后的索引
+    std::shared_ptr<const MappedMeshFile> mapped_file;
+
+    // CPU 端数据, 大小见对应的 bytesize 字段
+    const void* VertexData() const { return CpuData(vertex_buffer_cpu, 0); }
+    const void* VertexColorData() const { return CpuData(vertex_color_buffer_cpu, 1); }
+    const void* IndexData() const
+    {
+        if(index_buffer_cpu != nullptr)
+            return index_buffer_cpu->GetBufferPointer();
+        return mapped_file != nullptr ? mapped_file->IndexData() : nullptr;
+    }
+
+    // meshlet 只来自 .mesh 文件, 布局见 MeshFile.h, 可以直接作为 StructuredBuffer 上传
+    UINT MeshletCount() const { return mapped_file != nullptr ? mapped_file->Header().meshlet_count : 0; }
+    const MeshFileMeshlet* Meshlets() const { return mapped_file != nullptr ? mapped_file->Meshlets() : nullptr; }
+    const MeshFileMeshletBounds* MeshletBounds() const { return mapped_file != nullptr ? mapped_file->MeshletBounds() : nullptr; }
+    // 整个顶点缓冲中的编号
+    const std::uint32_t* MeshletVertices() const { return mapped_file != nullptr ? mapped_file->MeshletVertices() : nullptr; }
+    // 每个三角形一个 uint, 3 个 meshlet 内的局部顶点编号各占 10 位
+    const std::uint32_t* MeshletPrimitives() const { return mapped_file != nullptr ? mapped_file->MeshletPrimitives() : nullptr; }
 
     void VertexBufferView(D3D12_VERTEX_BUFFER_VIEW views[2]) const
     {
@@ -122,6 +175,23 @@ struct MeshGeometry
     void DisposeUploaders()
     {
         vertex_buffer_uploader = nullptr;
+        vertex_color_buffer_uploader = nullptr;
         index_buffer_uploader = nullptr;
     }
-};
\ No newline at end of file
+
+    private:
+        const void* CpuData(const ComPtr<ID3DBlob>& blob, std::uint32_t stream) const
+        {
+            if(blob != nullptr)
+                return blob->GetBufferPointer();
+            return mapped_file != nullptr && stream < mapped_file->Header().stream_count ? mapped_file->StreamData(stream) : nullptr;
+        }
+};
+
+// 按映射的 .mesh 文件填充 MeshGeometry, 不拷贝顶点和索引, 文件在 MeshGeometry 释放之前一直保持映射
+// 流 0 为位置, 流 1 为颜色, submesh 表的每一项以 InternString(LodDrawargName(name, lod)) 为键放进 drawargs
+// 压缩存放的索引在这里解压; 少于两个流, 索引格式不对或者数据损坏时返回 nullptr
+std::shared_ptr<MeshGeometry> CreateMeshGeometry(const std::string& name, std::shared_ptr<const MappedMeshFile> file);
+
+// 用 CPU 端数据创建 GPU 缓冲, 上传命令执行完之后才能 DisposeUploaders
+void UploadMeshGeometry(ID3D12Device* device, ID3D12GraphicsCommandList* command_list, MeshGeometry& geometry);
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+
+#include "VertexCompression.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    template<typename T>
+    T* At(void* base, std::uint32_t stride, std::size_t index)
+    {
+        return reinterpret_cast<T*>(static_cast<std::uint8_t*>(base) + index * stride);
+    }
+
+    template<typename T>
+    const T* At(const void* base, std::uint32_t stride, std::size_t index)
+    {
+        return reinterpret_cast<const T*>(static_cast<const std::uint8_t*>(base) + index * stride);
+    }
+
+    // 单位向量投影到八面体 |x|+|y|+|z|=1 上, 下半球沿对角线折叠到上半球外侧, 结果在 [-1, 1]^2
+    XMVECTOR XM_CALLCONV OctahedralEncode(FXMVECTOR n)
+    {
+        const XMVECTOR one = XMVectorSplatOne();
+        const XMVECTOR l1 = XMVector3Dot(XMVectorAbs(n), one);
+        const XMVECTOR p = XMVectorDivide(n, l1);
+
+        const XMVECTOR sign = XMVectorSelect(XMVectorReplicate(-1.0f), one, XMVectorGreaterOrEqual(p, XMVectorZero()));
+        const XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(p))), sign);
+        return XMVectorGetZ(n) < 0.0f ? folded : p;
+    }
+
+    XMVECTOR XM_CALLCONV OctahedralDecode(FXMVECTOR e)
+    {
+        const float x = XMVectorGetX(e);
+        const float y = XMVectorGetY(e);
+        const float z = 1.0f - std::fabs(x) - std::fabs(y);
+        const float t = std::max(-z, 0.0f);
+        return XMVector3Normalize(XMVectorSet(x >= 0.0f ? x - t : x + t, y >= 0.0f ? y - t : y + t, z, 0.0f));
+    }
+
+    XMVECTOR XM_CALLCONV DecodePosition(const XMUSHORTN4* packed, FXMVECTOR scale, FXMVECTOR offset)
+    {
+        return XMVectorMultiplyAdd(XMLoadUShortN4(packed), scale, offset);
+    }
+
+    template<typename Measure>
+    QuantizationError MeasureError(std::size_t count, Measure measure)
+    {
+        QuantizationError error;
+        if(count == 0)
+            return error;
+
+        double total = 0.0;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            const float e = measure(i);
+            error.max_error = std::max(error.max_error, e);
+            total += e;
+        }
+        error.mean_error = (float)(total / (double)count);
+        return error;
+    }
+
+    float XM_CALLCONV MaxComponent(FXMVECTOR v)
+    {
+        XMFLOAT4 f;
+        XMStoreFloat4(&f, v);
+        return std::max(std::max(f.x, f.y), std::max(f.z, f.w));
+    }
+}
+
+DXGI_FORMAT PackedFormat(PackedAttribute attribute)
+{
+    switch(attribute)
+    {
+        case PackedAttribute::Position: return DXGI_FORMAT_R16G16B16A16_UNORM;
+        case PackedAttribute::Normal: return DXGI_FORMAT_R16G16_SNORM;
+        case PackedAttribute::Color: return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case PackedAttribute::UV: return DXGI_FORMAT_R16G16_FLOAT;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+std::uint32_t PackedBytesize(PackedAttribute attribute)
+{
+    switch(attribute)
+    {
+        case PackedAttribute::Position: return sizeof(XMUSHORTN4);
+        case PackedAttribute::Normal: return sizeof(XMSHORTN2);
+        case PackedAttribute::Color: return sizeof(XMUBYTEN4);
+        case PackedAttribute::UV: return sizeof(XMHALF2);
+    }
+    return 0;
+}
+
+PositionQuantization MakePositionQuantization(const BoundingBox& bounds)
+{
+    const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+    const XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+
+    PositionQuantization quantization;
+    XMStoreFloat3(&quantization.scale, XMVectorAdd(extents, extents));
+    XMStoreFloat3(&quantization.offset, XMVectorSubtract(center, extents));
+    return quantization;
+}
+
+//-----------------------------encode--------------------------------
+void EncodePositions(void* destination, std::uint32_t destination_stride,
+                     const void* positions, std::uint32_t stride, std::size_t count,
+                     const PositionQuantization& quantization)
+{
+    const XMVECTOR scale = XMLoadFloat3(&quantization.scale);
+    const XMVECTOR offset = XMLoadFloat3(&quantization.offset);
+    // 包围盒某个方向厚度为 0 时这个分量固定写 0
+    const XMVECTOR inv_scale = XMVectorSelect(XMVectorReciprocal(scale), XMVectorZero(), XMVectorEqual(scale, XMVectorZero()));
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const XMVECTOR p = XMLoadFloat3(At<XMFLOAT3>(positions, stride, i));
+        XMStoreUShortN4(At<XMUSHORTN4>(destination, destination_stride, i), XMVectorMultiply(XMVectorSubtract(p, offset), inv_scale));
+    }
+}
+
+void EncodeNormals(void* destination, std::uint32_t destination_stride,
+                   const void* normals, std::uint32_t stride, std::size_t count)
+{
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const XMVECTOR n = XMLoadFloat3(At<XMFLOAT3>(normals, stride, i));
+        XMStoreShortN2(At<XMSHORTN2>(destination, destination_stride, i), OctahedralEncode(n));
+    }
+}
+
+void EncodeColors(void* destination, std::uint32_t destination_stride,
+                  const void* colors, std::uint32_t stride, std::size_t count)
+{
+    for(std::size_t i = 0; i < count; ++i)
+        XMStoreUByteN4(At<XMUBYTEN4>(destination, destination_stride, i), XMLoadFloat4(At<XMFLOAT4>(colors, stride, i)));
+}
+
+void EncodeUVs(void* destination, std::uint32_t destination_stride,
+               const void* uvs, std::uint32_t stride, std::size_t count)
+{
+    for(std::size_t i = 0; i < count; ++i)
+        XMStoreHalf2(At<XMHALF2>(destination, destination_stride, i), XMLoadFloat2(At<XMFLOAT2>(uvs, stride, i)));
+}
+
+//-----------------------------error--------------------------------
+QuantizationError PositionError(const void* packed, std::uint32_t packed_stride,
+                                const void* positions, std::uint32_t stride, std::size_t count,
+                                const PositionQuantization& quantization)
+{
+    const XMVECTOR scale = XMLoadFloat3(&quantization.scale);
+    const XMVECTOR offset = XMLoadFloat3(&quantization.offset);
+    return MeasureError(count, [&](std::size_t i){
+        const XMVECTOR decoded = DecodePosition(At<XMUSHORTN4>(packed, packed_stride, i), scale, offset);
+        const XMVECTOR original = XMLoadFloat3(At<XMFLOAT3>(positions, stride, i));
+        return XMVectorGetX(XMVector3Length(XMVectorSubtract(decoded, original)));
+    });
+}
+
+QuantizationError NormalError(const void* packed, std::uint32_t packed_stride,
+                              const void* normals, std::uint32_t stride, std::size_t count)
+{
+    return MeasureError(count, [&](std::size_t i){
+        const XMVECTOR decoded = OctahedralDecode(XMLoadShortN2(At<XMSHORTN2>(packed, packed_stride, i)));
+        const XMVECTOR original = XMVector3Normalize(XMLoadFloat3(At<XMFLOAT3>(normals, stride, i)));
+        return XMConvertToDegrees(XMVectorGetX(XMVector3AngleBetweenNormals(decoded, original)));
+    });
+}
+
+QuantizationError ColorError(const void* packed, std::uint32_t packed_stride,
+                             const void* colors, std::uint32_t stride, std::size_t count)
+{
+    return MeasureError(count, [&](std::size_t i){
+        const XMVECTOR decoded = XMLoadUByteN4(At<XMUBYTEN4>(packed, packed_stride, i));
+        const XMVECTOR original = XMLoadFloat4(At<XMFLOAT4>(colors, stride, i));
+        return MaxComponent(XMVectorAbs(XMVectorSubtract(decoded, original)));
+    });
+}
+
+QuantizationError UVError(const void* packed, std::uint32_t packed_stride,
+                          const void* uvs, std::uint32_t stride, std::size_t count)
+{
+    return MeasureError(count, [&](std::size_t i){
+        const XMVECTOR decoded = XMLoadHalf2(At<XMHALF2>(packed, packed_stride, i));
+        const XMVECTOR original = XMLoadFloat2(At<XMFLOAT2>(uvs, stride, i));
+        return MaxComponent(XMVectorAbs(XMVectorSubtract(decoded, original)));
+    });
+}
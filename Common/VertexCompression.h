@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <dxgiformat.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <DirectXPackedVector.h>
+
+//-----------------------------VertexCompression--------------------------------
+// 上传前把顶点属性压缩成更小的格式, 在 vs 中解压 (c5/Shaders/packing.hlsli):
+// position: R16G16B16A16_UNORM, 相对于传入的包围盒归一化 (MeshPipeline 用整个网格的包围盒), 12 -> 8 字节
+// normal:   R16G16_SNORM, 八面体编码, 12 -> 4 字节
+// color:    R8G8B8A8_UNORM, 16 -> 4 字节
+// uv:       R16G16_FLOAT, 8 -> 4 字节
+// 编码函数的源数据都是 float (XMFLOAT3/XMFLOAT4/XMFLOAT2), 源和目标各自有步长, 可以写进交错格式的顶点缓冲
+// 这里不生成 D3D12_INPUT_ELEMENT_DESC: input layout 由 shader 反射生成 (ShaderReflection.h 的 BuildInputLayout),
+// 压缩过的流在 VertexStreamBinding::format 中填 PackedFormat(attribute) 覆盖按 shader 输入类型推导的格式
+enum class PackedAttribute
+{
+    Position,
+    Normal,
+    Color,
+    UV
+};
+
+DXGI_FORMAT PackedFormat(PackedAttribute attribute);
+std::uint32_t PackedBytesize(PackedAttribute attribute);
+
+// 解压常量, 和 cbuffer 中的 g_position_scale / g_position_offset 对应
+// position = packed.xyz * scale + offset
+struct PositionQuantization
+{
+    DirectX::XMFLOAT3 scale = {1.0f, 1.0f, 1.0f};
+    DirectX::XMFLOAT3 offset = {0.0f, 0.0f, 0.0f};
+};
+
+PositionQuantization MakePositionQuantization(const DirectX::BoundingBox& bounds);
+
+void EncodePositions(void* destination, std::uint32_t destination_stride,
+                     const void* positions, std::uint32_t stride, std::size_t count,
+                     const PositionQuantization& quantization);
+// normals 必须是单位向量
+void EncodeNormals(void* destination, std::uint32_t destination_stride,
+                   const void* normals, std::uint32_t stride, std::size_t count);
+void EncodeColors(void* destination, std::uint32_t destination_stride,
+                  const void* colors, std::uint32_t stride, std::size_t count);
+void EncodeUVs(void* destination, std::uint32_t destination_stride,
+               const void* uvs, std::uint32_t stride, std::size_t count);
+
+// 解压后和原始数据比较, position 为模型空间长度, normal 为角度 (度), color/uv 为分量的绝对误差
+struct QuantizationError
+{
+    float max_error = 0.0f;
+    float mean_error = 0.0f;
+};
+
+QuantizationError PositionError(const void* packed, std::uint32_t packed_stride,
+                                const void* positions, std::uint32_t stride, std::size_t count,
+                                const PositionQuantization& quantization);
+QuantizationError NormalError(const void* packed, std::uint32_t packed_stride,
+                              const void* normals, std::uint32_t stride, std::size_t count);
+QuantizationError ColorError(const void* packed, std::uint32_t packed_stride,
+                             const void* colors, std::uint32_t stride, std::size_t count);
+QuantizationError UVError(const void* packed, std::uint32_t packed_stride,
+                          const void* uvs, std::uint32_t stride, std::size_t count);
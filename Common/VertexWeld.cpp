@@ -0,0 +1,142 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Hash.h"
+#include "VertexWeld.h"
+
+namespace
+{
+    // 顶点编号不会是 0xFFFFFFFF, 低 32 位全 1 的槽就是空的
+    constexpr std::uint64_t empty_slot = 0xFFFFFFFFFFFFFFFFull;
+
+    // 哈希和比较都按 "所有流拼在一起" 的顶点进行
+    class WeldKey
+    {
+        public:
+            WeldKey(const WeldStream* streams, std::size_t stream_count)
+            :streams(streams), stream_count(stream_count)
+            {
+            }
+
+            std::uint64_t Hash(std::uint32_t v) const
+            {
+                Hasher hasher;
+                for(std::size_t s = 0; s < stream_count; ++s)
+                {
+                    const WeldStream& stream = streams[s];
+                    const std::uint8_t* data = Vertex(stream, v);
+                    if(stream.epsilon <= 0.0f)
+                    {
+                        hasher.AddBytes(data, stream.bytesize);
+                        continue;
+                    }
+                    for(std::uint32_t offset = 0; offset + sizeof(float) <= stream.bytesize; offset += sizeof(float))
+                        hasher.Add(Quantize(data + offset, stream.epsilon));
+                }
+                return hasher.Value();
+            }
+
+            bool Equal(std::uint32_t a, std::uint32_t b) const
+            {
+                for(std::size_t s = 0; s < stream_count; ++s)
+                {
+                    const WeldStream& stream = streams[s];
+                    const std::uint8_t* da = Vertex(stream, a);
+                    const std::uint8_t* db = Vertex(stream, b);
+                    if(stream.epsilon <= 0.0f)
+                    {
+                        if(std::memcmp(da, db, stream.bytesize) != 0)
+                            return false;
+                        continue;
+                    }
+                    for(std::uint32_t offset = 0; offset + sizeof(float) <= stream.bytesize; offset += sizeof(float))
+                    {
+                        if(Quantize(da + offset, stream.epsilon) != Quantize(db + offset, stream.epsilon))
+                            return false;
+                    }
+                }
+                return true;
+            }
+
+        private:
+            static const std::uint8_t* Vertex(const WeldStream& stream, std::uint32_t v)
+            {
+                return static_cast<const std::uint8_t*>(stream.data) + (std::size_t)v * stream.stride;
+            }
+
+            // 四舍五入到最近的格点, +0 和 -0 落在同一格
+            static std::int64_t Quantize(const std::uint8_t* data, float epsilon)
+            {
+                float value;
+                std::memcpy(&value, data, sizeof(value));
+                return (std::int64_t)std::floor((double)value / epsilon + 0.5);
+            }
+
+        private:
+            const WeldStream* streams;
+            std::size_t stream_count;
+    };
+}
+
+std::uint32_t GenerateWeldRemap(std::uint32_t* remap, const WeldStream* streams, std::size_t stream_count,
+                                std::size_t vertex_count, WeldStats* stats)
+{
+    const WeldKey key(streams, stream_count);
+
+    // 装载率不超过 50%, 线性探测; 每个槽同时存哈希的高 32 位, 大多数不相等的顶点不用回去读顶点数据
+    std::size_t capacity = 16;
+    while(capacity < vertex_count * 2)
+        capacity *= 2;
+    const std::size_t mask = capacity - 1;
+    std::vector<std::uint64_t> table(capacity, empty_slot);
+
+    std::uint32_t unique_count = 0;
+    for(std::uint32_t v = 0; v < vertex_count; ++v)
+    {
+        const std::uint64_t hash = key.Hash(v);
+        const std::uint64_t tag = hash & 0xFFFFFFFF00000000ull;
+        std::size_t slot = (std::size_t)hash & mask;
+        for(;;)
+        {
+            const std::uint64_t entry = table[slot];
+            if(entry == empty_slot)
+            {
+                table[slot] = tag | v;
+                remap[v] = unique_count++;
+                break;
+            }
+            const std::uint32_t other = (std::uint32_t)entry;
+            if((entry & 0xFFFFFFFF00000000ull) == tag && key.Equal(other, v))
+            {
+                remap[v] = remap[other];
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    if(stats != nullptr)
+    {
+        std::uint64_t vertex_bytesize = 0;
+        for(std::size_t s = 0; s < stream_count; ++s)
+            vertex_bytesize += streams[s].bytesize;
+
+        stats->vertex_count = (std::uint32_t)vertex_count;
+        stats->unique_count = unique_count;
+        stats->bytes_before = vertex_bytesize * vertex_count;
+        stats->bytes_after = vertex_bytesize * unique_count;
+    }
+    return unique_count;
+}
+
+std::uint64_t HashMeshContent(const void* const* blobs, const std::size_t* bytesizes, std::size_t blob_count)
+{
+    Hasher hasher;
+    for(std::size_t i = 0; i < blob_count; ++i)
+    {
+        hasher.Add((std::uint64_t)bytesizes[i]);
+        hasher.AddBytes(blobs[i], bytesizes[i]);
+    }
+    return hasher.Value();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------VertexWeld--------------------------------
+// 合并所有顶点流都相同的顶点, 生成的 remap 和 MeshOptimizer 中的格式一样,
+// 用 RemapIndexBuffer / RemapVertexBuffer 应用到索引和每个顶点流
+struct WeldStream
+{
+    const void* data = nullptr;
+    std::uint32_t stride = 0;
+    std::uint32_t bytesize = 0;
+    // 0: 按字节完全相同比较
+    // > 0: 流中是 float, 每个分量按 epsilon 大小的网格取整后比较; 落在格子边界两侧的两个值即使相差不到 epsilon 也不会合并
+    float epsilon = 0.0f;
+};
+
+struct WeldStats
+{
+    std::uint32_t vertex_count = 0;
+    std::uint32_t unique_count = 0;
+    // 所有流合计的顶点数据字节数
+    std::uint64_t bytes_before = 0;
+    std::uint64_t bytes_after = 0;
+};
+
+// remap[旧编号] = 新编号, 新编号按第一次出现的顺序, 返回合并后的顶点数
+// 开放寻址哈希表, 期望 O(vertex_count)
+std::uint32_t GenerateWeldRemap(std::uint32_t* remap, const WeldStream* streams, std::size_t stream_count,
+                                std::size_t vertex_count, WeldStats* stats = nullptr);
+
+// 网格内容的哈希, 按顺序累加每个 blob 的字节, 用于发现重复加载的网格
+std::uint64_t HashMeshContent(const void* const* blobs, const std::size_t* bytesizes, std::size_t blob_count);
@@ -1,34 +1,70 @@
 #include <DirectXColors.h>
 #include <DirectXPackedVector.h>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
 #include "../Common/D3DApp.h"
 #include "../Common/MathHelper.h"
 #include "../Common/UploadBuffer.h"
+#include "../Common/JobSystem.h"
+#include "../Common/PSOCache.h"
+#include "../Common/PSOManager.h"
+#include "../Common/ShaderPermutation.h"
+#include "../Common/ShaderReflection.h"
+#include "../Common/ShaderHotReload.h"
+#include "../Common/ConstantBufferLayout.h"
+#include "../Common/GeometryGenerator.h"
+#include "../Common/VertexCompression.h"
+#include "../Common/LodSelection.h"
+#include "../Common/MeshRegistry.h"
+#include "../Common/MeshFile.h"
+#include "../Common/MeshPipeline.h"
+#include "../Common/Instancing.h"
+#include "../Common/RenderQueue.h"
+#include "../Common/FrustumCulling.h"
+#include "../Common/Bvh.h"
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 
+// 压缩后的顶点格式, 见 VertexCompression.h
 struct VPositionData
 {
-    XMFLOAT3 pos;
+    XMUSHORTN4 pos;
 };
 
 struct VColorData
 {
-    XMFLOAT4 color;
+    XMUBYTEN4 color;
 };
 
-struct ObjectConstants
+// 对应 color.hlsl 的 cbPerPass, 世界矩阵在每个实例的 InstanceData 里
+struct PassConstants
 {
-    XMFLOAT4X4 world_view_proj = MathHelper::Identity4x4();
+    XMFLOAT4X4 view_proj = MathHelper::Identity4x4();
     float gtime;
+    // 顶点位置的解压常量
+    XMFLOAT3 position_scale = {1.0f, 1.0f, 1.0f};
+    XMFLOAT3 position_offset = {0.0f, 0.0f, 0.0f};
 };
+CB_VALIDATE_LAYOUT(PassConstants,
+    CB_FIELD(PassConstants, view_proj),
+    CB_FIELD(PassConstants, gtime),
+    CB_FIELD(PassConstants, position_scale),
+    CB_FIELD(PassConstants, position_offset));
+
+// --stress 时的 box 数量
+constexpr UINT stress_box_count = 100000;
 
 class Box3D : public D3DApp
 {
     public:
-        Box3D(HINSTANCE instance);
+        // box_count 个 box 排成立方体, use_instancing 为 false 时每个 box 单独绘制, 用来对比
+        // use_bvh 为 false 时逐个测试所有 box 的包围体, 用来和 BVH 的层次剔除对比
+        Box3D(HINSTANCE instance, UINT box_count = 1, bool use_instancing = true, bool use_bvh = true);
         ~Box3D();
 
         Box3D(const Box3D& rhs) = delete;
@@ -37,26 +73,75 @@ class Box3D : public D3DApp
         bool Initialize() override;
 
     private:
-        std::unique_ptr<UploadBuffer<ObjectConstants>> object_upload_buffer;
+        std::unique_ptr<UploadBuffer<PassConstants>> pass_upload_buffer;
         ComPtr<ID3D12DescriptorHeap> cbv_heap = nullptr;
-        ComPtr<ID3D12RootSignature> root_signature = nullptr;
-
-        std::unique_ptr<MeshGeometry> box_geometry = nullptr;
-
-        ComPtr<ID3DBlob> mvs_bytecode = nullptr;
-        ComPtr<ID3DBlob> mps_bytecode = nullptr;
-
-        std::vector<D3D12_INPUT_ELEMENT_DESC> input_layouts;
-
-        ComPtr<ID3D12PipelineState> pso = nullptr;
-
-        XMFLOAT4X4 world = MathHelper::Identity4x4();
+        // 当前PSO的 root signature 和 input layout, 由 PSOManager 持有, 热更新后随PSO一起替换
+        const PipelineLayout* pipeline_layout = nullptr;
+        // 由反射得到: cbPerDraw 的根常量参数, descriptor table 的参数, cbPerPass 和 g_instances 在 table 中的偏移
+        UINT per_draw_parameter = 0;
+        UINT pass_table_parameter = 0;
+        UINT pass_table_offset = 0;
+        UINT instance_table_offset = 0;
+
+        // 每个 box 的世界矩阵和颜色, 场景是静态的, 只在启动时生成
+        UINT box_count = 1;
+        bool use_instancing = true;
+        std::vector<InstanceData> box_instances;
+        // 每帧按组重新排列后写入, 上一帧结尾已经 FlushCommandQueue, 一个缓冲就够了
+        std::unique_ptr<UploadBuffer<InstanceData>> instance_upload_buffer;
+        InstanceBatcher instance_batcher;
+        // 每个可见的 box 一个绘制项, 键中的 mesh 是 box_lods 的下标
+        RenderQueue render_queue;
+        // 每帧用视锥剔除 box, 可见的编号放在 visible_boxes 的前 visible_count 个
+        // 场景是静态的, BVH 只在启动时构建一次; 中键点击时用它拾取 box
+        bool use_bvh = true;
+        Bvh scene_bvh;
+        CullingObjects culling_objects;
+        std::vector<std::uint32_t> visible_boxes;
+        std::uint32_t visible_count = 0;
+        // 录制时已经设置的状态, 和上一次绘制相同时不再设置
+        std::uint32_t bound_pso = UINT32_MAX;
+        const MeshGeometry* bound_geometry = nullptr;
+        UINT state_changes = 0;
+        UINT submit_count = 0;
+
+        std::shared_ptr<MeshGeometry> box_geometry = nullptr;
+        // 内容相同的网格共用 GPU 缓冲
+        MeshRegistry mesh_registry;
+        PositionQuantization box_quantization;
+        // 每帧按屏幕空间误差选择每个 box 的 LOD
+        LodObjects lod_objects;
+        std::array<const SubmeshGeometry*, max_lod_levels> box_lods = {};
+
+        // 每秒在标题栏显示一次平均的绘制次数和分组+录制命令的 CPU 时间
+        UINT draw_count = 0;
+        double cpu_milliseconds = 0.0;
+        UINT stats_frames = 0;
+        float stats_time = 0.0f;
+
+        std::unique_ptr<ShaderPermutationSet> mvs_permutations = nullptr;
+        std::unique_ptr<ShaderPermutationSet> mps_permutations = nullptr;
+        std::uint32_t mvs_features = 0;
+        std::uint32_t mps_features = 0;
+
+        // 启动时shader编译和PSO创建在线程池中并行执行
+        JobSystem::JobHandle mvs_job = nullptr;
+        JobSystem::JobHandle mps_job = nullptr;
+
+        std::unique_ptr<PSOCache> pso_cache = nullptr;
+        std::unique_ptr<PSOManager> pso_manager = nullptr;
+        PSOManager::PSOHandle pso = PSOManager::invalid_pso;
+        std::unique_ptr<ShaderHotReload> shader_hot_reload = nullptr;
+
+        static constexpr float far_z = 1000.0f;
+        XMFLOAT3 eye_position = {0.0f, 0.0f, 0.0f};
         XMFLOAT4X4 view = MathHelper::Identity4x4();
         XMFLOAT4X4 proj = MathHelper::Identity4x4();
 
         float theta = 1.5f * XM_PI;
         float phi = XM_PIDIV4;
         float radius = 5.0f;
+        float max_radius = 15.0f;
 
         POINT last_mouse_pos;
 
@@ -70,17 +155,30 @@ class Box3D : public D3DApp
         void OnMouseMove(WPARAM btn_state, int x, int y) override;
         void OnMouseUp(WPARAM btn_state, int x, int y) override;
         void OnMouseDown(WPARAM btn_state, int x, int y) override;
+        // 用 BVH 找到屏幕坐标 (x, y) 下最近的 box, 结果输出到调试器
+        void PickBox(int x, int y);
     
         void BuildDescriptorHeaps();
         void BuildConstantBuffers();
-        void BuildRootSignature();
+        // 在工作线程上根据当前的反射结果生成, 启动和热更新时都在创建PSO的 job 里调用
+        std::shared_ptr<const PipelineLayout> BuildPipelineLayout();
+        // 在帧边界切换到新的 layout, 把描述符写到反射得到的位置
+        void BindPipelineLayout(const PipelineLayout* layout);
         void BuildShaderAndInputLayout();
         void BuildPSO();
+        std::shared_ptr<const PipelineLayout> FillPSODesc(D3D12_GRAPHICS_PIPELINE_STATE_DESC& pso_desc);
         void BuildBoxGeometry();
+        void BuildScene();
+        void BuildInstanceBuffer();
+        void BuildRenderQueue();
+        void SubmitDraw(std::uint64_t key, UINT instance_count, UINT instance_base);
+        void DrawSubmesh(const SubmeshGeometry& submesh, UINT instance_count, UINT instance_base);
+        void UpdateStats(double milliseconds);
 };
 
 
-Box3D::Box3D(HINSTANCE instance): D3DApp(instance){
+Box3D::Box3D(HINSTANCE instance, UINT box_count, bool use_instancing, bool use_bvh)
+: D3DApp(instance), box_count(std::max(box_count, 1u)), use_instancing(use_instancing), use_bvh(use_bvh){
     caption = L"Box3D";
 }
 
@@ -93,12 +191,40 @@ bool Box3D::Initialize()
     
     ThrowIfFailed(command_list->Reset(command_allocator.Get(), nullptr));
 
+    // 只统计启动阶段的 job, 输出报告后关闭
+    JobSystem::Get().SetProfiling(true);
+
+    // shader编译和PSO创建只是提交job, 几何数据的上传命令在主线程同时录制
+    pso_cache = std::make_unique<PSOCache>(device.Get(), L"c5/Box3D.psocache");
+    pso_manager = std::make_unique<PSOManager>(*pso_cache, JobSystem::Get());
+
     BuildDescriptorHeaps();
     BuildConstantBuffers();
-    BuildRootSignature();
     BuildShaderAndInputLayout();
-    BuildBoxGeometry();
     BuildPSO();
+    BuildBoxGeometry();
+    BuildScene();
+
+    // 启动时的PSO直接等待完成, 编译错误在这里抛出
+    pso_manager->Wait(pso);
+    // root signature 已经生成, 常量缓冲和实例缓冲的描述符放在反射得到的位置
+    BuildInstanceBuffer();
+    const PipelineLayout* layout = nullptr;
+    pso_manager->Resolve(pso, &layout);
+    BindPipelineLayout(layout);
+    OutputDebugStringA(JobSystem::Get().ProfileReport().c_str());
+    JobSystem::Get().SetProfiling(false);
+    JobSystem::Get().ClearTimings();
+    OutputDebugStringA(pso_manager->LatencyReport().c_str());
+
+    // 只有新编译了PSO才会写盘
+    pso_cache->Save();
+
+    // 修改 color.hlsl 后只重新编译它和依赖它的PSO, 不需要重启
+    shader_hot_reload = std::make_unique<ShaderHotReload>(JobSystem::Get(), *pso_manager);
+    shader_hot_reload->WatchDirectory(L"c5/Shaders");
+    shader_hot_reload->Register(mvs_permutations.get(), "color.hlsl VS", {pso});
+    shader_hot_reload->Register(mps_permutations.get(), "color.hlsl PS", {pso});
 
     ThrowIfFailed(command_list->Close());
     ID3D12CommandList* cmds[] = {command_list.Get()};
@@ -113,7 +239,7 @@ void Box3D::OnResize()
 {
     D3DApp::OnResize();
 
-    XMMATRIX p = XMMatrixPerspectiveFovLH(0.25 * MathHelper::PI, AspectRatio(), 1.0f, 1000.0f);
+    XMMATRIX p = XMMatrixPerspectiveFovLH(0.25 * MathHelper::PI, AspectRatio(), 1.0f, far_z);
     XMStoreFloat4x4(&proj, p);
 }
 
@@ -125,25 +251,68 @@ void Box3D::Update()
 
     XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
     XMStoreFloat4x4(&this->view, view);
+    XMStoreFloat3(&eye_position, pos);
 
-    XMMATRIX world = XMLoadFloat4x4(&this->world);
-    XMMATRIX proj = XMLoadFloat4x4(&this->proj);
-    XMMATRIX world_view_proj = world * view * proj;
+    // box 只有平移, 世界空间的 LOD 误差和模型空间相同
+    JobSystem& jobs = JobSystem::Get();
+    LodSelectionParams lod_params;
+    XMStoreFloat3(&lod_params.camera_position, pos);
+    lod_params.projection_scale = LodProjectionScale(this->proj, viewport.Height);
+    SelectLods(lod_objects, lod_params, &jobs);
 
-    ObjectConstants objconstants;
-    XMStoreFloat4x4(&objconstants.world_view_proj, XMMatrixTranspose(world_view_proj));
-    objconstants.gtime = timer.TotalTime();
-    object_upload_buffer->CopyData(0, objconstants);
+    XMMATRIX proj = XMLoadFloat4x4(&this->proj);
+    XMMATRIX view_proj = view * proj;
+
+    XMFLOAT4X4 culling_view_proj;
+    XMStoreFloat4x4(&culling_view_proj, view_proj);
+    const CullingFrustum frustum = ExtractFrustum(culling_view_proj);
+    if(use_bvh)
+        visible_count = scene_bvh.CullFrustum(frustum, visible_boxes.data());
+    else
+        visible_count = CullObjects(culling_objects, frustum, visible_boxes.data(), &jobs);
+
+    PassConstants pass_constants;
+    XMStoreFloat4x4(&pass_constants.view_proj, XMMatrixTranspose(view_proj));
+    pass_constants.gtime = timer.TotalTime();
+    pass_constants.position_scale = box_quantization.scale;
+    pass_constants.position_offset = box_quantization.offset;
+    pass_upload_buffer->CopyData(0, pass_constants);
 }
 
 void Box3D::Draw()
 {
+    // 上一帧结尾已经 FlushCommandQueue, 这里是替换PSO的帧边界
+    shader_hot_reload->Update();
+
+    const auto cpu_start = std::chrono::steady_clock::now();
+
+    // 排序后状态相同的绘制相邻, 按排好的顺序分组, 每组内由近到远
+    // 实例数据按组连续写进上传堆; 不用实例化时按对象顺序写, 每个绘制项单独绘制
+    BuildRenderQueue();
+    instance_batcher.Clear();
+    if(use_instancing)
+    {
+        for(std::uint32_t i = 0; i < render_queue.Size(); ++i)
+            instance_batcher.Add(render_queue[i].key & draw_key_state_mask, render_queue[i].payload);
+        instance_batcher.Build(box_instances.data(), instance_upload_buffer->MappedElements(), &JobSystem::Get());
+    }
+    else
+    {
+        std::copy(box_instances.begin(), box_instances.end(), instance_upload_buffer->MappedElements());
+    }
+
     // 通过reset重用记录命令的内存
     ThrowIfFailed(command_allocator->Reset());
 
     // command list 可以在命令提交到command_queue （执行ExecuteCommandList）后进行Reset操作
     // 重用command list 和内存
-    ThrowIfFailed(command_list->Reset(command_allocator.Get(), pso.Get()));
+    // PSO 还在后台编译时返回 nullptr, 这一帧跳过绘制; PSO 由 SubmitDraw 按绘制键设置
+    const PipelineLayout* layout = nullptr;
+    ID3D12PipelineState* current_pso = pso_manager->Resolve(pso, &layout);
+    // 热更新替换了PSO时 root signature 和描述符的位置可能也变了
+    if(layout != nullptr && layout != pipeline_layout)
+        BindPipelineLayout(layout);
+    ThrowIfFailed(command_list->Reset(command_allocator.Get(), nullptr));
 
     command_list->RSSetViewports(1, &viewport);
     command_list->RSSetScissorRects(1, &scissor_rect);
@@ -179,23 +348,30 @@ void Box3D::Draw()
     command_list->SetDescriptorHeaps(_countof(descriptor_heaps), cbv_heap.GetAddressOf());
 
     // rootsignature 设置shader所需资源信息
-    command_list->SetGraphicsRootSignature(root_signature.Get());
+    command_list->SetGraphicsRootSignature(pipeline_layout->root_signature.Get());
 
-    D3D12_VERTEX_BUFFER_VIEW views[2];
-    box_geometry->VertexBufferView(views);
-    command_list->IASetVertexBuffers(0, 2, views); 
-    const auto& index_buffer_view = box_geometry->IndexBufferView();
-    command_list->IASetIndexBuffer(&index_buffer_view);
     command_list->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    command_list->SetGraphicsRootDescriptorTable(0, cbv_heap->GetGPUDescriptorHandleForHeapStart());
+    command_list->SetGraphicsRootDescriptorTable(pass_table_parameter, cbv_heap->GetGPUDescriptorHandleForHeapStart());
 
-    command_list->DrawIndexedInstanced(
-                    box_geometry->drawargs["box"].index_count,
-                    1,
-                    0,
-                    0, 
-                    0);
+    draw_count = 0;
+    state_changes = 0;
+    submit_count = 0;
+    bound_pso = UINT32_MAX;
+    bound_geometry = nullptr;
+    if(current_pso != nullptr)
+    {
+        if(use_instancing)
+        {
+            for(const InstanceGroup& group : instance_batcher.Groups())
+                SubmitDraw(group.key, group.instance_count, group.first_instance);
+        }
+        else
+        {
+            for(std::uint32_t i = 0; i < render_queue.Size(); ++i)
+                SubmitDraw(render_queue[i].key, 1, render_queue[i].payload);
+        }
+    }
     
     //present buffer
     const auto& present_barrier = CD3DX12_RESOURCE_BARRIER::Transition(
@@ -206,6 +382,7 @@ void Box3D::Draw()
 
     //完成命令记录
     ThrowIfFailed(command_list->Close());
+    UpdateStats(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpu_start).count());
 
     ID3D12CommandList* cmdlist[] = {command_list.Get()};
     command_queue->ExecuteCommandLists(_countof(cmdlist), cmdlist);
@@ -219,13 +396,137 @@ void Box3D::Draw()
 
 }
 
+void Box3D::BuildRenderQueue()
+{
+    // 只有一个 PSO, 没有材质; mesh 为选中的 LOD, 深度为到包围球中心的距离
+    DrawKeyFields fields;
+    fields.pso = pso;
+
+    render_queue.Clear();
+    DrawItem* items = render_queue.Append(visible_count);
+    JobSystem& jobs = JobSystem::Get();
+    jobs.ParallelFor(visible_count, 4096, [&](std::uint32_t begin, std::uint32_t end){
+        DrawKeyFields item_fields = fields;
+        for(std::uint32_t v = begin; v < end; ++v)
+        {
+            const std::uint32_t i = visible_boxes[v];
+            const float dx = lod_objects.center_x[i] - eye_position.x;
+            const float dy = lod_objects.center_y[i] - eye_position.y;
+            const float dz = lod_objects.center_z[i] - eye_position.z;
+            item_fields.mesh = lod_objects.selected_lod[i];
+            item_fields.depth = QuantizeDrawDepth(std::sqrt(dx * dx + dy * dy + dz * dz), far_z);
+            items[v] = {EncodeDrawKey(item_fields), i};
+        }
+    });
+    render_queue.Sort(&jobs);
+}
+
+void Box3D::SubmitDraw(std::uint64_t key, UINT instance_count, UINT instance_base)
+{
+    // 排序后相邻的绘制大多状态相同, 只在变化时设置
+    const DrawKeyFields fields = DecodeDrawKey(key);
+    if(fields.pso != bound_pso)
+    {
+        command_list->SetPipelineState(pso_manager->Resolve(fields.pso));
+        bound_pso = fields.pso;
+        ++state_changes;
+    }
+
+    // 所有 LOD 共用 box_geometry 的缓冲
+    const MeshGeometry* geometry = box_geometry.get();
+    if(geometry != bound_geometry)
+    {
+        D3D12_VERTEX_BUFFER_VIEW views[2];
+        geometry->VertexBufferView(views);
+        command_list->IASetVertexBuffers(0, 2, views);
+        const auto& index_buffer_view = geometry->IndexBufferView();
+        command_list->IASetIndexBuffer(&index_buffer_view);
+        bound_geometry = geometry;
+        ++state_changes;
+    }
+
+    ++submit_count;
+    DrawSubmesh(*box_lods[fields.mesh], instance_count, instance_base);
+}
+
+void Box3D::DrawSubmesh(const SubmeshGeometry& submesh, UINT instance_count, UINT instance_base)
+{
+    // SV_InstanceID 总是从 0 开始, 起始实例通过根常量传给 shader
+    command_list->SetGraphicsRoot32BitConstant(per_draw_parameter, instance_base, 0);
+
+    // 拆成多段的 submesh 每段单独绘制
+    const SubmeshGeometry* draws = submesh.segments.empty() ? &submesh : submesh.segments.data();
+    const size_t count = submesh.segments.empty() ? 1 : submesh.segments.size();
+    for(size_t i = 0; i < count; ++i)
+    {
+        command_list->DrawIndexedInstanced(
+                        draws[i].index_count,
+                        instance_count,
+                        draws[i].start_index_location,
+                        draws[i].base_vertex_location,
+                        0);
+    }
+    draw_count += (UINT)count;
+}
+
+void Box3D::UpdateStats(double milliseconds)
+{
+    ++stats_frames;
+    cpu_milliseconds += milliseconds;
+    if(timer.TotalTime() - stats_time < 1.0f)
+        return;
+
+    // CalculateFrameStats 在标题后面加上 FPS
+    caption = L"Box3D boxes: " + std::to_wstring(box_count) +
+              L" visible: " + std::to_wstring(visible_count) +
+              (use_bvh ? L" bvh" : L" flat") +
+              (use_instancing ? L" instanced" : L" per object") +
+              L" draws: " + std::to_wstring(draw_count) +
+              // 每次绘制都设置 PSO 和顶点/索引缓冲时需要 2 * submit_count 次
+              L" state changes: " + std::to_wstring(state_changes) +
+              L" saved: " + std::to_wstring(2 * submit_count - state_changes) +
+              L" cpu ms: " + std::to_wstring(cpu_milliseconds / stats_frames);
+    stats_frames = 0;
+    cpu_milliseconds = 0.0;
+    stats_time = timer.TotalTime();
+}
+
 void Box3D::OnMouseDown(WPARAM btn_state, int x, int y)
 {
+    if((btn_state & MK_MBUTTON) != 0)
+        PickBox(x, y);
+
     last_mouse_pos.x = x;
     last_mouse_pos.y = y;
     SetCapture(hwnd);
 }
 
+void Box3D::PickBox(int x, int y)
+{
+    // 从近平面到远平面的射线, direction 的长度为两者的距离, 所以 max_distance 为 1
+    const XMMATRIX view_proj = XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj);
+    const XMMATRIX inv_view_proj = XMMatrixInverse(nullptr, view_proj);
+    const float ndc_x = 2.0f * x / viewport.Width - 1.0f;
+    const float ndc_y = 1.0f - 2.0f * y / viewport.Height;
+    const XMVECTOR near_point = XMVector3TransformCoord(XMVectorSet(ndc_x, ndc_y, 0.0f, 1.0f), inv_view_proj);
+    const XMVECTOR far_point = XMVector3TransformCoord(XMVectorSet(ndc_x, ndc_y, 1.0f, 1.0f), inv_view_proj);
+
+    const XMVECTOR direction = XMVectorSubtract(far_point, near_point);
+
+    BvhRay ray;
+    XMStoreFloat3(&ray.origin, near_point);
+    XMStoreFloat3(&ray.direction, direction);
+    ray.max_distance = 1.0f;
+    const BvhHit hit = scene_bvh.Raycast(ray);
+
+    std::string report = "Box3D pick: ";
+    if(hit.object == bvh_invalid_index)
+        report += "nothing\n";
+    else
+        report += "box " + std::to_string(hit.object) + " at distance " + std::to_string(hit.distance * XMVectorGetX(XMVector3Length(direction))) + "\n";
+    OutputDebugStringA(report.c_str());
+}
+
 void Box3D::OnMouseUp(WPARAM btn_state, int x, int y)
 {
     ReleaseCapture();
@@ -248,7 +549,7 @@ void Box3D::OnMouseMove(WPARAM btn_state, int x, int y)
         float dy = (0.005f * static_cast<float>(y - last_mouse_pos.y));
         radius += dx - dy; 
 
-        radius = MathHelper::Clamp(radius, 3.0f, 15.0f);
+        radius = MathHelper::Clamp(radius, 3.0f, max_radius);
     }
 
     last_mouse_pos.x = x;
@@ -258,7 +559,8 @@ void Box3D::OnMouseMove(WPARAM btn_state, int x, int y)
 void Box3D::BuildDescriptorHeaps()
 {
     D3D12_DESCRIPTOR_HEAP_DESC cbv_heap_desc;
-    cbv_heap_desc.NumDescriptors =  1;
+    // cbPerPass 和 g_instances
+    cbv_heap_desc.NumDescriptors =  2;
     cbv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     cbv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     cbv_heap_desc.NodeMask = 0;
@@ -268,88 +570,134 @@ void Box3D::BuildDescriptorHeaps()
 
 void Box3D::BuildConstantBuffers()
 {
-    object_upload_buffer = std::make_unique<UploadBuffer<ObjectConstants>>(device.Get(), 1, true);
-
-    UINT obj_cbb_bytesize = CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    
-    D3D12_GPU_VIRTUAL_ADDRESS cb_address = object_upload_buffer->Resource()->GetGPUVirtualAddress();
-    int index = 0;
-    cb_address += index * obj_cbb_bytesize;
-
-    D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc;
-    cbv_desc.BufferLocation = cb_address;
-    cbv_desc.SizeInBytes = obj_cbb_bytesize;
-
-    device->CreateConstantBufferView(&cbv_desc, cbv_heap->GetCPUDescriptorHandleForHeapStart());
+    // 描述符在 BindPipelineLayout 里按反射得到的位置创建
+    pass_upload_buffer = std::make_unique<UploadBuffer<PassConstants>>(device.Get(), 1, true);
 }
         
-void Box3D::BuildRootSignature()
+std::shared_ptr<const PipelineLayout> Box3D::BuildPipelineLayout()
 {
     // 定义shader程序需要什么杨的输入资源
     // 输入的资源就好像函数参数，root signature就好比函数签名
-
-    CD3DX12_ROOT_PARAMETER slot_root_parameter[1];
-
-    CD3DX12_DESCRIPTOR_RANGE cbv_table;
-    cbv_table.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-    slot_root_parameter[0].InitAsDescriptorTable(1, &cbv_table);
-
-    CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc(1, slot_root_parameter, 0, nullptr,
-        D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-    
-    ComPtr<ID3DBlob> serialize_root_signature = nullptr;
-    ComPtr<ID3DBlob> error_blob = nullptr;
-
-    HRESULT hr = D3D12SerializeRootSignature(
-        &root_signature_desc,
-        D3D_ROOT_SIGNATURE_VERSION_1,
-        serialize_root_signature.GetAddressOf(),
-        error_blob.GetAddressOf());
-    
-    if(error_blob != nullptr)
+    // 由VS/PS编译时的反射结果生成: cbPerPass(b0) 和 g_instances(t0) 放在第0个 descriptor table,
+    // cbPerDraw(b1) 每次绘制都变, 作为根常量
+    auto layout = std::make_shared<PipelineLayout>();
+    layout->reflected_root_signature = std::make_unique<ReflectedRootSignature>(
+        std::vector<const ShaderReflectionData*>{
+            mvs_permutations->ResolveReflection(mvs_features),
+            mps_permutations->ResolveReflection(mps_features)},
+        std::vector<std::string>{"cbPerDraw"});
+
+    // descriptor heap 只准备了 cbPerPass 和 g_instances, 热更新后绑定不是这三个时不能使用, 继续用旧PSO
+    // Draw 只设置一个 descriptor table, cbPerPass 和 g_instances 必须在同一个 table 中
+    const ReflectedRootSignature& reflected = *layout->reflected_root_signature;
+    UINT parameter = 0;
+    UINT pass_parameter = 0;
+    UINT instance_parameter = 0;
+    UINT table_offset = 0;
+    if(reflected.Bindings().size() != 3 ||
+       !reflected.FindBinding("cbPerPass", pass_parameter, table_offset) ||
+       !reflected.FindBinding("cbPerDraw", parameter, table_offset) ||
+       !reflected.FindBinding("g_instances", instance_parameter, table_offset) ||
+       pass_parameter != instance_parameter)
     {
-        OutputDebugStringA((char*)error_blob->GetBufferPointer());
+        throw DxException(E_INVALIDARG, L"BuildPipelineLayout cbPerPass cbPerDraw g_instances", AnsiToWString(__FILE__), __LINE__);
     }
 
-    ThrowIfFailed(hr);
+    ComPtr<ID3DBlob> serialize_root_signature = reflected.Serialize();
+
+    layout->root_signature_hash = HashRootSignatureBlob(serialize_root_signature.Get());
 
     ThrowIfFailed(device->CreateRootSignature(
         0,
         serialize_root_signature->GetBufferPointer(),
         serialize_root_signature->GetBufferSize(),
-        IID_PPV_ARGS(&root_signature)));
+        IID_PPV_ARGS(&layout->root_signature)));
+
+    // 顶点位置和颜色分别在 MeshGeometry::VertexBufferView 的 slot 0 和 slot 1
+    layout->input_layout = BuildInputLayout(
+        *mvs_permutations->ResolveReflection(mvs_features),
+        {
+            {"POSITION", 0, 0, PackedFormat(PackedAttribute::Position)},
+            {"COLOR", 0, 1, PackedFormat(PackedAttribute::Color)}
+        });
+
+    return layout;
+}
+
+void Box3D::BindPipelineLayout(const PipelineLayout* layout)
+{
+    // 上一帧结尾已经 FlushCommandQueue, GPU 不再读取旧的描述符, 可以直接改写
+    pipeline_layout = layout;
+    const ReflectedRootSignature& reflected = *layout->reflected_root_signature;
+    UINT parameter = 0;
+    UINT table_offset = 0;
+    reflected.FindBinding("cbPerDraw", per_draw_parameter, table_offset);
+    reflected.FindBinding("cbPerPass", pass_table_parameter, pass_table_offset);
+    reflected.FindBinding("g_instances", parameter, instance_table_offset);
+
+    D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc;
+    cbv_desc.BufferLocation = pass_upload_buffer->Resource()->GetGPUVirtualAddress();
+    cbv_desc.SizeInBytes = (UINT)CBLayout::CBVSize<PassConstants>;
+    CD3DX12_CPU_DESCRIPTOR_HANDLE cbv_handle(cbv_heap->GetCPUDescriptorHandleForHeapStart(), pass_table_offset, CB_SR_UA_VDescriptor_size);
+    device->CreateConstantBufferView(&cbv_desc, cbv_handle);
+
+    // 上传堆里的 StructuredBuffer, 每帧 CPU 直接写入, GPU 直接读取
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.FirstElement = 0;
+    srv_desc.Buffer.NumElements = box_count;
+    srv_desc.Buffer.StructureByteStride = sizeof(InstanceData);
+    srv_desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    CD3DX12_CPU_DESCRIPTOR_HANDLE srv_handle(cbv_heap->GetCPUDescriptorHandleForHeapStart(), instance_table_offset, CB_SR_UA_VDescriptor_size);
+    device->CreateShaderResourceView(instance_upload_buffer->Resource(), &srv_desc, srv_handle);
 }
     
 void Box3D::BuildShaderAndInputLayout()
 {
-    mvs_bytecode = CompileShader(
-                    L"c5/Shaders/color.hlsl",
-                    nullptr,
-                    "VS",
-                    "vs_5_0");
-    mps_bytecode = CompileShader(
-                    L"c5/Shaders/color.hlsl",
-                    nullptr,
-                    "PS",
-                    "ps_5_0");
-    
-    input_layouts = {
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
-    };
+    mvs_permutations = std::make_unique<ShaderPermutationSet>(
+                        L"c5/Shaders/color.hlsl",
+                        "VS",
+                        "vs_5_0",
+                        std::vector<std::string>{"ANIMATE"});
+    mps_permutations = std::make_unique<ShaderPermutationSet>(
+                        L"c5/Shaders/color.hlsl",
+                        "PS",
+                        "ps_5_0",
+                        std::vector<std::string>{"ALPHA_CLIP"});
+
+    // 只声明用到的组合, 其余变体不会编译
+    mvs_features = mvs_permutations->FeatureBit("ANIMATE");
+    mps_features = mps_permutations->FeatureBit("ALPHA_CLIP");
+    mvs_permutations->AddUsed(mvs_features);
+    mps_permutations->AddUsed(mps_features);
+
+    JobSystem& jobs = JobSystem::Get();
+    mvs_job = mvs_permutations->Compile(jobs, "CompileShader color.hlsl VS");
+    mps_job = mps_permutations->Compile(jobs, "CompileShader color.hlsl PS");
 }
 
 void Box3D::BuildPSO()
 {
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc;
-    ZeroMemory(&pso_desc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-    pso_desc.InputLayout.pInputElementDescs = input_layouts.data();
-    pso_desc.InputLayout.NumElements = (UINT)input_layouts.size();
+    // 等对应的shader编译完成后立刻在工作线程生成 root signature/input layout 并创建PSO, ID3D12Device 是线程安全的
+    // 热更新时 Rebuild 用同一个函数, layout 从新的反射结果重新生成
+    pso = pso_manager->Request("box", [this](D3D12_GRAPHICS_PIPELINE_STATE_DESC& pso_desc){
+        return FillPSODesc(pso_desc);
+    }, PSOManager::invalid_pso, {mvs_job, mps_job});
+}
 
-    pso_desc.pRootSignature = root_signature.Get();
+std::shared_ptr<const PipelineLayout> Box3D::FillPSODesc(D3D12_GRAPHICS_PIPELINE_STATE_DESC& pso_desc)
+{
+    std::shared_ptr<const PipelineLayout> layout = BuildPipelineLayout();
+    pso_desc.InputLayout = layout->input_layout.Desc();
+
+    pso_desc.pRootSignature = layout->root_signature.Get();
+    ID3DBlob* mvs_bytecode = mvs_permutations->Resolve(mvs_features);
     pso_desc.VS.pShaderBytecode = reinterpret_cast<BYTE*>(mvs_bytecode->GetBufferPointer());
     pso_desc.VS.BytecodeLength = mvs_bytecode->GetBufferSize();
 
+    ID3DBlob* mps_bytecode = mps_permutations->Resolve(mps_features);
     pso_desc.PS.pShaderBytecode = reinterpret_cast<BYTE*>(mps_bytecode->GetBufferPointer());
     pso_desc.PS.BytecodeLength = mps_bytecode->GetBufferSize();
 
@@ -368,93 +716,120 @@ void Box3D::BuildPSO()
     
     pso_desc.DSVFormat = depth_stencil_format;
 
-    ThrowIfFailed(device->CreateGraphicsPipelineState(
-        &pso_desc,
-        IID_PPV_ARGS(pso.GetAddressOf())));
+    return layout;
 }
 
 void Box3D::BuildBoxGeometry()
 {
-    std::array<VPositionData, 8> vertices = {
-        VPositionData({XMFLOAT3(-1.0f, -1.0f, -1.0f)}), 
-        VPositionData({XMFLOAT3(-1.0f, +1.0f, -1.0f)}), 
-        VPositionData({XMFLOAT3(+1.0f, +1.0f, -1.0f)}), 
-        VPositionData({XMFLOAT3(+1.0f, -1.0f, -1.0f)}), 
-        VPositionData({XMFLOAT3(-1.0f, -1.0f, +1.0f)}), 
-        VPositionData({XMFLOAT3(-1.0f, +1.0f, +1.0f)}), 
-        VPositionData({XMFLOAT3(+1.0f, +1.0f, +1.0f)}), 
-        VPositionData({XMFLOAT3(+1.0f, -1.0f, +1.0f)})
-    };
-
-    std::array<VColorData, 8> colors = {
-        VColorData({XMFLOAT4(Colors::White)}),
-        VColorData({XMFLOAT4(Colors::Black)}),
-        VColorData({XMFLOAT4(Colors::Red)}),
-        VColorData({XMFLOAT4(Colors::Green)}),
-        VColorData({XMFLOAT4(Colors::Blue)}),
-        VColorData({XMFLOAT4(Colors::Yellow)}),
-        VColorData({XMFLOAT4(Colors::Cyan)}),
-        VColorData({XMFLOAT4(Colors::Magenta)})
-    };
-
-    std::array<std::uint16_t, 36> indices = {
-        // front face
-		0, 1, 2,
-		0, 2, 3,
-
-		// back face
-		4, 6, 5,
-		4, 7, 6,
-
-		// left face
-		4, 5, 1,
-		4, 1, 0,
-
-		// right face
-		3, 2, 6,
-		3, 6, 7,
-
-		// top face
-		1, 5, 6,
-		1, 6, 2,
-
-		// bottom face
-		4, 0, 3,
-		4, 3, 7
-    };
-
-    const UINT vb_bytesize = (UINT)vertices.size() * sizeof(VPositionData);
-    const UINT vb_color_bytesize = (UINT)colors.size() * sizeof(VColorData);
-    const UINT ib_bytesize = (UINT)indices.size() * sizeof(std::uint16_t);
-
-    box_geometry = std::make_unique<MeshGeometry>();
-    box_geometry->name = "box";
-
-    ThrowIfFailed(D3DCreateBlob(vb_bytesize, box_geometry->vertex_buffer_cpu.GetAddressOf()));
-    CopyMemory(box_geometry->vertex_buffer_cpu->GetBufferPointer(), vertices.data(), vb_bytesize);
-    
-    ThrowIfFailed(D3DCreateBlob(vb_color_bytesize, box_geometry->vertex_color_buffer_cpu.GetAddressOf()));
-    CopyMemory(box_geometry->vertex_color_buffer_cpu->GetBufferPointer(), colors.data(), vb_color_bytesize);
-
-    ThrowIfFailed(D3DCreateBlob(ib_bytesize, box_geometry->index_buffer_cpu.GetAddressOf()));
-    CopyMemory(box_geometry->index_buffer_cpu->GetBufferPointer(), indices.data(), ib_bytesize);
-
-    box_geometry->vertex_buffer_gpu = CreateDefaultBuffer(device.Get(), command_list.Get(), vertices.data(), vb_bytesize, box_geometry->vertex_buffer_uploader);
-    box_geometry->vertex_color_buffer_gpu = CreateDefaultBuffer(device.Get(), command_list.Get(), colors.data(), vb_color_bytesize, box_geometry->vertex_buffer_uploader);
-    box_geometry->index_buffer_gpu = CreateDefaultBuffer(device.Get(), command_list.Get(), indices.data(), ib_bytesize, box_geometry->index_buffer_uploader);
-
-    box_geometry->vertex_byte_stride = sizeof(VPositionData);
-    box_geometry->vertex_color_byte_stride= sizeof(VColorData);
-    box_geometry->vertex_buffer_bytesize = vb_bytesize;
-    box_geometry->vertex_color_byte_stride = vb_color_bytesize;
-    box_geometry->index_format = DXGI_FORMAT_R16_UINT;
-    box_geometry->index_buffer_bytesize = ib_bytesize;
-
-    SubmeshGeometry submesh;
-    submesh.index_count = (UINT)indices.size();
-    submesh.start_index_location = 0;
-    submesh.base_vertex_location = 0;
-    box_geometry->drawargs["box"] = submesh;
+    // 优先映射 MeshConverter 生成的文件, 顶点直接从映射的页上传, 索引在文件中是压缩的, 解压后上传
+    // 没有转换好的文件时在内存中走同样的处理流程, 只是索引不压缩
+    auto mesh_file = std::make_shared<MappedMeshFile>();
+    if(!mesh_file->Open(L"c5/Models/box.mesh"))
+    {
+        // 先生成 float 格式的顶点和 32 位索引, 压缩和索引宽度由 ProcessMesh 决定
+        const GeometryGenerator::MeshSize size = GeometryGenerator::BoxSize(1);
+        std::vector<XMFLOAT3> positions(size.vertex_count);
+        std::vector<XMFLOAT4> colors(size.vertex_count);
+        std::vector<std::uint32_t> indices(size.index_count);
+
+        GeometryGenerator::VertexStreams streams;
+        streams.position = positions.data();
+
+        GeometryGenerator::IndexStream index_stream;
+        index_stream.data = indices.data();
+        index_stream.index_bytesize = sizeof(std::uint32_t);
+
+        GeometryGenerator::CreateBox(2.0f, 2.0f, 2.0f, 1, streams, index_stream);
+
+        // 颜色由位置映射到 [0, 1], 和原来一样每个角一种颜色
+        for(UINT i = 0; i < size.vertex_count; ++i)
+        {
+            XMVECTOR color = XMVectorMultiplyAdd(XMLoadFloat3(&positions[i]), XMVectorReplicate(0.5f), XMVectorReplicate(0.5f));
+            XMStoreFloat4(&colors[i], XMVectorSetW(color, 1.0f));
+        }
+
+        MeshPipelineInput input;
+        input.positions = positions.data();
+        input.colors = colors.data();
+        input.vertex_count = size.vertex_count;
+        input.indices = indices.data();
+        input.index_count = size.index_count;
+        input.submeshes.push_back({"box", 0, size.index_count});
+
+        std::string report;
+        const MeshFileContent content = ProcessMesh(input, JobSystem::Get(), &report);
+        OutputDebugStringA(report.c_str());
+        mesh_file->Adopt(SerializeMeshFile(content));
+    }
+
+    box_geometry = CreateMeshGeometry("box", mesh_file);
+    if(box_geometry == nullptr)
+        throw DxException(E_INVALIDARG, L"CreateMeshGeometry box", AnsiToWString(__FILE__), __LINE__);
+    const MeshFileHeader& header = mesh_file->Header();
+    box_quantization.scale = XMFLOAT3(header.position_scale);
+    box_quantization.offset = XMFLOAT3(header.position_offset);
+
+    // 已经加载过相同内容的网格时直接共用, 不再上传
+    bool is_new = false;
+    box_geometry = mesh_registry.Intern(box_geometry, is_new);
+    if(is_new)
+        UploadMeshGeometry(device.Get(), command_list.Get(), *box_geometry);
+    OutputDebugStringA(mesh_registry.Report().c_str());
+
+    // 名字只在这里换成 StringId 查一次, 绘制时直接用 SubmeshGeometry 指针; 没有的级别用最粗的一级
+    const SubmeshGeometry* box = box_geometry->drawargs.Find(InternString("box"));
+    if(box == nullptr)
+        throw DxException(E_INVALIDARG, L"BuildBoxGeometry box", AnsiToWString(__FILE__), __LINE__);
+    const UINT lod_count = std::min<UINT>(box->lod_count, max_lod_levels);
+    for(UINT lod = 0; lod < max_lod_levels; ++lod)
+    {
+        box_lods[lod] = box_geometry->drawargs.Find(InternString(LodDrawargName("box", std::min(lod, lod_count - 1))));
+        if(box_lods[lod] == nullptr)
+            throw DxException(E_INVALIDARG, L"BuildBoxGeometry box lod", AnsiToWString(__FILE__), __LINE__);
+    }
+}
+
+void Box3D::BuildScene()
+{
+    // box 排成边长 side 的立方体, 中心在原点, 颜色随位置变化; 只有一个 box 时和原来一样放在原点, 不改变颜色
+    const UINT side = (UINT)std::ceil(std::cbrt((double)box_count));
+    const float spacing = 3.0f;
+    const float half_extent = 0.5f * spacing * (side - 1);
+    max_radius = std::max(15.0f, 3.0f * half_extent);
+
+    float lod_errors[max_lod_levels];
+    const UINT lod_count = std::min<UINT>(box_lods[0]->lod_count, max_lod_levels);
+    for(UINT lod = 0; lod < lod_count; ++lod)
+        lod_errors[lod] = box_lods[lod]->lod_error;
+
+    box_instances.resize(box_count);
+    std::vector<BoundingBox> box_bounds(box_count);
+    for(UINT i = 0; i < box_count; ++i)
+    {
+        const XMFLOAT3 cell((float)(i % side), (float)(i / side % side), (float)(i / (side * side)));
+        const XMVECTOR position = XMVectorSubtract(XMVectorScale(XMLoadFloat3(&cell), spacing), XMVectorReplicate(half_extent));
+        const XMMATRIX world = XMMatrixTranslationFromVector(position);
+        XMStoreFloat3x4(&box_instances[i].world, world);
+        if(side > 1)
+        {
+            const XMVECTOR color = XMVectorLerpV(XMVectorReplicate(0.25f), XMVectorReplicate(1.0f), XMVectorScale(XMLoadFloat3(&cell), 1.0f / (side - 1)));
+            XMStoreFloat4(&box_instances[i].color, XMVectorSetW(color, 1.0f));
+        }
+
+        BoundingSphere sphere;
+        box_lods[0]->bounding_sphere.Transform(sphere, world);
+        lod_objects.Add(sphere, lod_errors, lod_count);
+        box_lods[0]->bounds.Transform(box_bounds[i], world);
+        culling_objects.Add(sphere, box_bounds[i]);
+    }
+    scene_bvh.Build(box_bounds.data(), box_count, &JobSystem::Get());
+    visible_boxes.resize(box_count);
+}
+
+void Box3D::BuildInstanceBuffer()
+{
+    // 上传堆里的 StructuredBuffer, 每帧 CPU 直接写入, GPU 直接读取; SRV 在 BindPipelineLayout 里创建
+    instance_upload_buffer = std::make_unique<UploadBuffer<InstanceData>>(device.Get(), box_count, false);
 }
 
 int main(int argc, char** argv)
@@ -465,7 +840,22 @@ int main(int argc, char** argv)
 
     try
     {
-        Box3D app(GetModuleHandle(NULL));
+        // --stress: 100K 个 box; --no-instancing: 每个 box 单独绘制, 和实例化对比绘制次数和 CPU 时间
+        // --flat-culling: 不用 BVH, 逐个剔除所有 box
+        UINT box_count = 1;
+        bool use_instancing = true;
+        bool use_bvh = true;
+        for(int i = 1; i < argc; ++i)
+        {
+            if(std::strcmp(argv[i], "--stress") == 0)
+                box_count = stress_box_count;
+            else if(std::strcmp(argv[i], "--no-instancing") == 0)
+                use_instancing = false;
+            else if(std::strcmp(argv[i], "--flat-culling") == 0)
+                use_bvh = false;
+        }
+
+        Box3D app(GetModuleHandle(NULL), box_count, use_instancing, use_bvh);
         if(!app.Initialize())
             return 0;
         
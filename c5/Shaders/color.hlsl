@@ -1,9 +1,29 @@
-cbuffer cbPerObject : register(b0)
+#include "packing.hlsli"
+
+cbuffer cbPerPass : register(b0)
 {
-    float4x4 g_worldviewproj;
+    float4x4 g_viewproj;
     float gtime;
+    float3 g_position_scale;
+    float3 g_position_offset;
+};
+
+// 根常量: 这次绘制的第一个实例在 g_instances 中的位置, SV_InstanceID 不包括 StartInstanceLocation
+cbuffer cbPerDraw : register(b1)
+{
+    uint g_instance_base;
+};
+
+// 和 Common/Instancing.h 的 InstanceData 对应
+struct InstanceData
+{
+    // 世界矩阵转置后的前三行
+    float4 world[3];
+    float4 color;
 };
 
+StructuredBuffer<InstanceData> g_instances : register(t0);
+
 struct VertexIn
 {
     float3 pos : POSITION;
@@ -16,19 +36,28 @@ struct VertexOut
     float4 color : COLOR;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instance_id : SV_InstanceID)
 {
     VertexOut vout;
+    vin.pos = DequantizePosition(vin.pos, g_position_scale, g_position_offset);
+#ifdef ANIMATE
     vin.pos.xy += 0.5f * sin(vin.pos.x) * sin(3.0f * gtime);
     vin.pos.z *= 0.6f + 0.4 * sin(2.0f * gtime);
+#endif
 
-    vout.pos = mul(float4(vin.pos, 1.0f), g_worldviewproj);
-    vout.color = vin.color;
+    InstanceData instance = g_instances[g_instance_base + instance_id];
+    float4 pos = float4(vin.pos, 1.0f);
+    float3 world_pos = float3(dot(instance.world[0], pos), dot(instance.world[1], pos), dot(instance.world[2], pos));
+
+    vout.pos = mul(float4(world_pos, 1.0f), g_viewproj);
+    vout.color = vin.color * instance.color;
     return vout;
 }
 
 float4 PS(VertexOut pin) :SV_Target
 {
+#ifdef ALPHA_CLIP
     clip(pin.color.r - 0.5f);
+#endif
     return pin.color;
-}
\ No newline at end of file
+}
@@ -0,0 +1,16 @@
+// 和 Common/VertexCompression.h 的编码对应
+
+// R16G16B16A16_UNORM 读出来在 [0, 1], 还原到包围盒内
+float3 DequantizePosition(float3 packed, float3 scale, float3 offset)
+{
+    return packed * scale + offset;
+}
+
+// R16G16_SNORM 读出来在 [-1, 1], 八面体编码还原成单位向量
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <cstring>
+
+#include "../Common/ConstantBufferLayout.h"
+
+using namespace DirectX;
+
+namespace
+{
+    int failure_count = 0;
+
+    #define CHECK(expr) Check((expr), #expr, __LINE__)
+
+    void Check(bool passed, const char* expr, int line)
+    {
+        if(!passed)
+        {
+            std::printf("ConstantBufferLayoutTest.cpp(%d): failed: %s\n", line, expr);
+            ++failure_count;
+        }
+    }
+
+    // 对应 HLSL:
+    // struct ObjectConstants { float4x4 world; float4 color; };
+    // struct MaterialConstants { float4 diffuse; float roughness; float3 fresnel; };
+    // struct LightConstants { float3 direction; float intensity; };
+    // cbuffer cbPerDraw : register(b1) { ObjectConstants object; MaterialConstants material; LightConstants light; };
+    struct ObjectConstants
+    {
+        XMFLOAT4X4 world;
+        XMFLOAT4 color;
+    };
+    CB_VALIDATE_LAYOUT(ObjectConstants, CB_FIELD(ObjectConstants, world), CB_FIELD(ObjectConstants, color));
+
+    struct MaterialConstants
+    {
+        XMFLOAT4 diffuse;
+        float roughness;
+        XMFLOAT3 fresnel;
+    };
+    CB_VALIDATE_LAYOUT(MaterialConstants, CB_FIELD(MaterialConstants, diffuse), CB_FIELD(MaterialConstants, roughness),
+                       CB_FIELD(MaterialConstants, fresnel));
+
+    // 12 + 4 字节, 在 HLSL 中补齐到 16
+    struct LightConstants
+    {
+        XMFLOAT3 direction;
+        float intensity;
+    };
+    CB_VALIDATE_LAYOUT(LightConstants, CB_FIELD(LightConstants, direction), CB_FIELD(LightConstants, intensity));
+
+    // 不是 16 的倍数, 下一个结构体要从新寄存器开始
+    struct TintConstants
+    {
+        float tint;
+    };
+    CB_VALIDATE_LAYOUT(TintConstants, CB_FIELD(TintConstants, tint));
+
+    using DrawConstants = PackedConstants<ObjectConstants, MaterialConstants, LightConstants>;
+    static_assert(DrawConstants::count == 3);
+    static_assert(DrawConstants::Offset<0>() == 0);
+    static_assert(DrawConstants::Offset<1>() == 80);
+    static_assert(DrawConstants::Offset<2>() == 112);
+    static_assert(DrawConstants::hlsl_bytesize == 128);
+    static_assert(DrawConstants::bytesize == 256, "three small structs share one 256 byte slot");
+    static_assert(DrawConstants::unpacked_bytesize == 768);
+
+    using TintedConstants = PackedConstants<TintConstants, LightConstants, TintConstants>;
+    static_assert(CBLayout::HlslSize<TintConstants> == 16);
+    static_assert(TintedConstants::Offset<1>() == 16);
+    static_assert(TintedConstants::Offset<2>() == 32);
+    static_assert(TintedConstants::hlsl_bytesize == 48);
+    static_assert(TintedConstants::bytesize == 256);
+
+    // 超过 256 字节时占两个 CBV 对齐单位
+    using LargeConstants = PackedConstants<ObjectConstants, ObjectConstants, ObjectConstants, ObjectConstants>;
+    static_assert(LargeConstants::hlsl_bytesize == 320);
+    static_assert(LargeConstants::bytesize == 512);
+
+    void TestWrite()
+    {
+        unsigned char slot[DrawConstants::bytesize];
+        std::memset(slot, 0xCD, sizeof(slot));
+
+        ObjectConstants object = {};
+        object.world._11 = 1.0f;
+        object.color = XMFLOAT4(0.25f, 0.5f, 0.75f, 1.0f);
+        MaterialConstants material = {};
+        material.roughness = 0.5f;
+        LightConstants light = {XMFLOAT3(0.0f, -1.0f, 0.0f), 2.0f};
+
+        DrawConstants::Write<0>(slot, object);
+        DrawConstants::Write<1>(slot, material);
+        DrawConstants::Write<2>(slot, light);
+
+        CHECK(std::memcmp(slot, &object, sizeof(object)) == 0);
+        CHECK(std::memcmp(slot + 80, &material, sizeof(material)) == 0);
+        CHECK(std::memcmp(slot + 112, &light, sizeof(light)) == 0);
+        // 用到的 128 字节之后不写
+        CHECK(slot[128] == 0xCD && slot[255] == 0xCD);
+    }
+}
+
+int main()
+{
+    TestWrite();
+
+    if(failure_count > 0)
+    {
+        std::printf("ConstantBufferLayoutTest: %d check(s) failed\n", failure_count);
+        return 1;
+    }
+    std::printf("ConstantBufferLayoutTest: all checks passed\n");
+    return 0;
+}
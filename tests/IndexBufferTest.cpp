@@ -0,0 +1,237 @@
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../Common/IndexBuffer.h"
+
+namespace
+{
+    int failure_count = 0;
+
+    #define CHECK(expr) Check((expr), #expr, __LINE__)
+
+    void Check(bool passed, const char* expr, int line)
+    {
+        if(!passed)
+        {
+            std::printf("IndexBufferTest.cpp(%d): failed: %s\n", line, expr);
+            ++failure_count;
+        }
+    }
+
+    // width x height 个顶点的网格, 按行输出三角形, 和优化过的网格一样顶点引用很集中
+    std::vector<std::uint32_t> GridIndices(std::uint32_t width, std::uint32_t height)
+    {
+        std::vector<std::uint32_t> indices;
+        for(std::uint32_t y = 0; y + 1 < height; ++y)
+        {
+            for(std::uint32_t x = 0; x + 1 < width; ++x)
+            {
+                const std::uint32_t v = y * width + x;
+                indices.insert(indices.end(), {v, v + width, v + 1, v + 1, v + width, v + width + 1});
+            }
+        }
+        return indices;
+    }
+
+    // 随机的三角形, 大部分顶点只能用 varint 差值表示
+    template<typename T>
+    std::vector<T> RandomIndices(std::size_t triangle_count, std::uint32_t max_index, std::uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::uint32_t> distribution(0, max_index);
+        std::vector<T> indices(triangle_count * 3);
+        for(T& index : indices)
+            index = (T)distribution(rng);
+        return indices;
+    }
+
+    // 编码可能轮换三角形的顶点, 但绕序不变
+    template<typename T>
+    bool SameTriangles(const std::vector<T>& expected, const std::vector<T>& actual)
+    {
+        if(expected.size() != actual.size())
+            return false;
+        for(std::size_t t = 0; t < expected.size(); t += 3)
+        {
+            bool same = false;
+            for(std::size_t r = 0; r < 3; ++r)
+                same = same || (actual[t] == expected[t + r] && actual[t + 1] == expected[t + (r + 1) % 3] && actual[t + 2] == expected[t + (r + 2) % 3]);
+            if(!same)
+                return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    std::vector<std::uint8_t> Encode(const std::vector<T>& indices)
+    {
+        std::vector<std::uint8_t> encoded(EncodeIndexBufferBound(indices.size()));
+        encoded.resize(EncodeIndexBuffer(encoded.data(), encoded.size(), indices.data(), indices.size()));
+        return encoded;
+    }
+
+    // 解码的输入复制到大小正好的缓冲里, 越界读取可以被 AddressSanitizer 发现
+    template<typename T>
+    bool Decode(std::vector<T>& indices, std::size_t index_count, const std::uint8_t* data, std::size_t size)
+    {
+        const std::vector<std::uint8_t> exact(data, data + size);
+        indices.assign(index_count, 0);
+        return DecodeIndexBuffer(indices.data(), index_count, exact.data(), exact.size());
+    }
+
+    template<typename T>
+    bool RoundTrip(const std::vector<T>& indices)
+    {
+        const std::vector<std::uint8_t> encoded = Encode(indices);
+        std::vector<T> decoded;
+        return !encoded.empty() && Decode(decoded, indices.size(), encoded.data(), encoded.size()) && SameTriangles(indices, decoded);
+    }
+
+    void TestRoundTrip()
+    {
+        const std::vector<std::uint32_t> grid = GridIndices(64, 64);
+        CHECK(RoundTrip(grid));
+        CHECK(RoundTrip(std::vector<std::uint16_t>(grid.begin(), grid.end())));
+        // 网格平均每个三角形不到 2 字节
+        CHECK(Encode(grid).size() < grid.size() / 3 * 2);
+
+        CHECK(RoundTrip(RandomIndices<std::uint16_t>(5000, 0xFFFF, 1)));
+        CHECK(RoundTrip(RandomIndices<std::uint32_t>(5000, 0xFFFFFFFF, 2)));
+        // 重复的顶点和退化三角形
+        CHECK(RoundTrip(RandomIndices<std::uint32_t>(5000, 3, 3)));
+        CHECK(RoundTrip(std::vector<std::uint32_t>()));
+
+        // 不完整的三角形被丢弃
+        std::vector<std::uint32_t> partial = {0, 1, 2, 3};
+        const std::vector<std::uint8_t> encoded = Encode(partial);
+        std::vector<std::uint32_t> decoded;
+        CHECK(Decode(decoded, 3, encoded.data(), encoded.size()));
+        CHECK(!Decode(decoded, 4, encoded.data(), encoded.size()));
+
+        // 输出缓冲不够时返回 0
+        std::vector<std::uint8_t> small(EncodeIndexBufferBound(grid.size()) - 1);
+        CHECK(EncodeIndexBuffer(small.data(), small.size(), grid.data(), grid.size()) == 0);
+    }
+
+    void TestCorruptInput()
+    {
+        const std::vector<std::uint32_t> indices = RandomIndices<std::uint32_t>(200, 100000, 4);
+        const std::vector<std::uint8_t> encoded = Encode(indices);
+        std::vector<std::uint32_t> decoded;
+
+        // 每一种截断
+        bool all_truncations_rejected = true;
+        for(std::size_t size = 0; size < encoded.size(); ++size)
+            all_truncations_rejected = all_truncations_rejected && !Decode(decoded, indices.size(), encoded.data(), size);
+        CHECK(all_truncations_rejected);
+
+        // 多出来的字节, 三角形数不对, 文件头不对
+        std::vector<std::uint8_t> extended = encoded;
+        extended.push_back(0);
+        CHECK(!Decode(decoded, indices.size(), extended.data(), extended.size()));
+        CHECK(!Decode(decoded, indices.size() - 3, encoded.data(), encoded.size()));
+        std::vector<std::uint8_t> header = encoded;
+        header[0] ^= 1;
+        CHECK(!Decode(decoded, indices.size(), header.data(), header.size()));
+
+        // 没有命中边缓存时顶点编码最大为 17
+        const std::uint8_t bad_vertex_code[] = {0xE0, 0xF0, 0, 0, 18};
+        CHECK(!Decode(decoded, 3, bad_vertex_code, sizeof(bad_vertex_code)));
+        // varint 超过 5 字节
+        const std::uint8_t long_varint[] = {0xE0, 0xF0, 0, 0, 17, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+        CHECK(!Decode(decoded, 3, long_varint, sizeof(long_varint)));
+        // 差值超出 16 位索引的范围
+        const std::uint8_t wide_index[] = {0xE0, 0xF0, 0, 0, 17, 0x80, 0x80, 0x08};
+        std::vector<std::uint16_t> decoded16;
+        CHECK(!Decode(decoded16, 3, wide_index, sizeof(wide_index)));
+        CHECK(Decode(decoded, 3, wide_index, sizeof(wide_index)));
+
+        // 随机改写一个字节, 结果可能仍然合法, 但不能读到输入之外
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<std::size_t> position(1, encoded.size() - 1);
+        std::uniform_int_distribution<std::uint32_t> byte(0, 255);
+        for(std::uint32_t i = 0; i < 1000; ++i)
+        {
+            std::vector<std::uint8_t> corrupt = encoded;
+            corrupt[position(rng)] = (std::uint8_t)byte(rng);
+            Decode(decoded, indices.size(), corrupt.data(), corrupt.size());
+        }
+    }
+
+    void TestPlan()
+    {
+        // 不超过 65536 个顶点时直接用 16 位, 不拆段
+        const std::vector<std::uint32_t> small = GridIndices(256, 256);
+        IndexBufferPlan plan = PlanIndexBuffer(small.data(), small.size(), 256 * 256, 32);
+        CHECK(plan.index_bytesize == sizeof(std::uint16_t));
+        CHECK(plan.segments.size() == 1);
+        CHECK(plan.vertex_sources.empty());
+        CHECK(plan.Bytesize() == small.size() * sizeof(std::uint16_t));
+
+        // 90000 个顶点, 拆成两段只复制一行顶点
+        constexpr std::uint32_t width = 300;
+        const std::vector<std::uint32_t> large = GridIndices(width, width);
+        const std::size_t vertex_count = width * width;
+        plan = PlanIndexBuffer(large.data(), large.size(), vertex_count, 32);
+        CHECK(plan.index_bytesize == sizeof(std::uint16_t));
+        CHECK(plan.segments.size() == 2);
+        CHECK(plan.vertex_sources.size() > vertex_count && plan.vertex_sources.size() < vertex_count + 2 * width);
+
+        std::vector<std::uint16_t> written(plan.Bytesize() / sizeof(std::uint16_t));
+        WriteIndexBuffer(written.data(), large.data(), large.size(), plan);
+
+        // 各段首尾相接, 段内编号经过 base_vertex 和 vertex_sources 回到原来的顶点
+        std::uint32_t next_start = 0;
+        bool same_vertices = true;
+        for(const IndexSegment& segment : plan.segments)
+        {
+            CHECK(segment.start_index == next_start && segment.index_count % 3 == 0);
+            next_start = segment.start_index + segment.index_count;
+            for(std::uint32_t i = segment.start_index; i < next_start; ++i)
+                same_vertices = same_vertices && plan.vertex_sources[segment.base_vertex + written[i]] == large[i];
+
+            // 每段的 16 位索引单独编码
+            const std::vector<std::uint16_t> local(written.begin() + segment.start_index, written.begin() + next_start);
+            CHECK(RoundTrip(local));
+        }
+        CHECK(next_start == large.size());
+        CHECK(same_vertices);
+
+        std::vector<std::uint32_t> gathered(plan.vertex_sources.size());
+        std::vector<std::uint32_t> vertices(vertex_count);
+        for(std::uint32_t v = 0; v < vertex_count; ++v)
+            vertices[v] = v * 7;
+        GatherVertexBuffer(gathered.data(), vertices.data(), sizeof(std::uint32_t), plan);
+        CHECK(gathered[plan.segments[1].base_vertex] == plan.vertex_sources[plan.segments[1].base_vertex] * 7);
+
+        // 跨段的 submesh 分两次绘制
+        const std::uint32_t boundary = plan.segments[1].start_index;
+        const std::vector<IndexSegment> range = SegmentsInRange(plan, boundary - 30, 60);
+        CHECK(range.size() == 2);
+        CHECK(range[0].start_index == boundary - 30 && range[0].index_count == 30 && range[0].base_vertex == 0);
+        CHECK(range[1].start_index == boundary && range[1].index_count == 30 && range[1].base_vertex == plan.segments[1].base_vertex);
+
+        // 顶点很大时复制顶点比 32 位索引更贵
+        plan = PlanIndexBuffer(large.data(), large.size(), vertex_count, 1 << 20);
+        CHECK(plan.index_bytesize == sizeof(std::uint32_t));
+        CHECK(plan.segments.size() == 1);
+        CHECK(plan.vertex_sources.empty());
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestCorruptInput();
+    TestPlan();
+
+    if(failure_count > 0)
+    {
+        std::printf("IndexBufferTest: %d check(s) failed\n", failure_count);
+        return 1;
+    }
+    std::printf("IndexBufferTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dxgiformat.h>
+
+#include "../Common/IndexBuffer.h"
+#include "../Common/MeshFile.h"
+
+namespace
+{
+    int failure_count = 0;
+
+    #define CHECK(expr) Check((expr), #expr, __LINE__)
+
+    void Check(bool passed, const char* expr, int line)
+    {
+        if(!passed)
+        {
+            std::printf("MeshFileTest.cpp(%d): failed: %s\n", line, expr);
+            ++failure_count;
+        }
+    }
+
+    // 一个四边形: 位置和 uv 两个流, 两个 submesh (LOD0 和 LOD1), LOD0 有一个拆段和一个 meshlet
+    MeshFileContent QuadContent(std::uint32_t index_format = DXGI_FORMAT_R16_UINT)
+    {
+        MeshFileContent content;
+        content.vertex_count = 4;
+        content.streams.resize(2);
+        content.streams[0].stride = 12;
+        content.streams[0].format = DXGI_FORMAT_R32G32B32_FLOAT;
+        content.streams[0].data.assign(4 * 12, 0);
+        content.streams[1].stride = 8;
+        content.streams[1].format = DXGI_FORMAT_R32G32_FLOAT;
+        content.streams[1].data.assign(4 * 8, 0);
+
+        const std::uint32_t indices[] = {0, 1, 2, 0, 2, 3};
+        content.index_count = 6;
+        content.index_format = index_format;
+        for(std::uint32_t index : indices)
+        {
+            if(index_format == DXGI_FORMAT_R16_UINT)
+                content.indices.insert(content.indices.end(), {(std::uint8_t)index, 0});
+            else
+                content.indices.insert(content.indices.end(), {(std::uint8_t)index, 0, 0, 0});
+        }
+
+        content.submeshes.resize(2);
+        SetMeshFileName(content.submeshes[0], "quad");
+        content.submeshes[0].index_count = 6;
+        content.submeshes[0].lod_count = 2;
+        content.submeshes[0].segment_count = 1;
+        content.submeshes[0].meshlet_count = 1;
+        SetMeshFileName(content.submeshes[1], "quad");
+        content.submeshes[1].lod = 1;
+        content.submeshes[1].index_count = 3;
+        content.submeshes[1].lod_count = 2;
+        content.segments.push_back(MeshFileSegment{6, 0, 0});
+        content.vertex_remap = {0, 1, 2, 3};
+
+        content.meshlets.push_back(MeshFileMeshlet{4, 0, 2, 0});
+        content.meshlet_bounds.resize(1);
+        content.meshlet_vertices = {0, 1, 2, 3};
+        content.meshlet_primitives = {0 | (1 << 10) | (2 << 20), 0 | (2 << 10) | (3 << 20)};
+        return content;
+    }
+
+    bool Adopt(std::vector<std::uint8_t> image)
+    {
+        MappedMeshFile file;
+        return file.Adopt(std::move(image));
+    }
+
+    // 改写序列化之后的文件头, 再交给 Adopt
+    template<typename Fn>
+    bool AdoptModified(Fn&& modify, const MeshFileContent& content = QuadContent())
+    {
+        std::vector<std::uint8_t> image = SerializeMeshFile(content);
+        MeshFileHeader header;
+        std::memcpy(&header, image.data(), sizeof(header));
+        modify(header, image);
+        std::memcpy(image.data(), &header, sizeof(header));
+        return Adopt(std::move(image));
+    }
+
+    template<typename T>
+    T* TableAt(std::vector<std::uint8_t>& image, const MeshFileRange& range)
+    {
+        return reinterpret_cast<T*>(image.data() + range.offset);
+    }
+
+    void TestValid()
+    {
+        MappedMeshFile file;
+        CHECK(file.Adopt(SerializeMeshFile(QuadContent())));
+        CHECK(file.IsOpen() && file.Verify());
+        CHECK(file.Header().submesh_count == 2 && file.Header().meshlet_count == 1);
+        CHECK(std::strcmp(file.Submeshes()[0].name, "quad") == 0);
+
+        std::uint16_t indices[6] = {};
+        CHECK(file.DecodedIndexBytesize() == sizeof(indices) && file.DecodeIndices(indices));
+        CHECK(indices[2] == 2 && indices[5] == 3);
+
+        CHECK(Adopt(SerializeMeshFile(QuadContent(DXGI_FORMAT_R32_UINT))));
+        CHECK(AdoptModified([](MeshFileHeader&, std::vector<std::uint8_t>&){}));
+    }
+
+    void TestHeader()
+    {
+        CHECK(!Adopt({}));
+        CHECK(!Adopt(std::vector<std::uint8_t>(sizeof(MeshFileHeader) - 1, 0)));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.magic = 0x4853454E; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.version = mesh_file_version - 1; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.version = mesh_file_version + 1; }));
+        // 文件被截断
+        CHECK(!AdoptModified([](MeshFileHeader&, std::vector<std::uint8_t>& image){ image.pop_back(); }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.file_bytesize += 64; }));
+    }
+
+    void TestStreams()
+    {
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.stream_count = mesh_file_max_streams + 1; }));
+        // 长度和 stride * vertex_count 不一致
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.streams[1].stride = 16; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.vertex_count = 5; }));
+        // 越过文件末尾, 没有对齐, 和文件头重叠, 偏移加长度溢出
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.streams[0].data.offset = h.file_bytesize; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.streams[0].data.offset += 4; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.streams[0].data.offset = 0; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.streams[0].data.offset = ~std::uint64_t(0) & ~std::uint64_t(63); }));
+    }
+
+    void TestSubmeshesAndSegments()
+    {
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.submesh_count = 3; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.submeshes.offset = h.file_bytesize + 64; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.segment_count = 2; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.segments.offset = h.file_bytesize; }));
+        // submesh 引用的拆段越界
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            TableAt<MeshFileSubmesh>(image, h.submeshes)[0].segment_offset = 1;
+        }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            TableAt<MeshFileSubmesh>(image, h.submeshes)[1].segment_count = 0xFFFFFFFF;
+        }));
+        // 名字没有结尾的 0
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            std::memset(TableAt<MeshFileSubmesh>(image, h.submeshes)[1].name, 'a', mesh_file_name_size);
+        }));
+        // 太长的名字写入时截断, 仍然可以通过
+        MeshFileContent content = QuadContent();
+        SetMeshFileName(content.submeshes[0], std::string(mesh_file_name_size + 8, 'b'));
+        CHECK(Adopt(SerializeMeshFile(content)));
+    }
+
+    void TestMeshlets()
+    {
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.meshlet_count = 2; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.meshlets.offset = h.file_bytesize; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.meshlet_bounds.bytesize = 32; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.meshlet_vertices.bytesize = 18; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.meshlet_vertices.bytesize += 64; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.meshlet_triangle_count = 3; }));
+        // meshlet 引用的顶点和三角形越界
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            TableAt<MeshFileMeshlet>(image, h.meshlets)[0].vertex_offset = 1;
+        }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            TableAt<MeshFileMeshlet>(image, h.meshlets)[0].primitive_count = 3;
+        }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            TableAt<MeshFileMeshlet>(image, h.meshlets)[0].primitive_offset = 0xFFFFFFFF;
+        }));
+        // submesh 引用的 meshlet 越界
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>& image){
+            TableAt<MeshFileSubmesh>(image, h.submeshes)[0].meshlet_count = 2;
+        }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.vertex_remap.bytesize = 6; }));
+    }
+
+    void TestIndices()
+    {
+        // 16 位的数据标成 32 位, 或者反过来
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_format = DXGI_FORMAT_R32_UINT; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_format = DXGI_FORMAT_R16_UINT; },
+                             QuadContent(DXGI_FORMAT_R32_UINT)));
+        // 不是索引格式
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_format = DXGI_FORMAT_R16G16_FLOAT; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_count = 5; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.indices.offset = h.file_bytesize; }));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_encoding = 2; }));
+
+        // 压缩的索引
+        MeshFileContent content = QuadContent();
+        const std::uint16_t indices[] = {0, 1, 2, 0, 2, 3};
+        content.indices.assign(EncodeIndexBufferBound(6), 0);
+        content.indices.resize(EncodeIndexBuffer(content.indices.data(), content.indices.size(), indices, 6));
+        content.index_encoding = mesh_index_encoding_compact;
+        MappedMeshFile file;
+        CHECK(file.Adopt(SerializeMeshFile(content)));
+        std::uint16_t decoded[6] = {};
+        CHECK(file.IndicesEncoded() && file.DecodeIndices(decoded));
+        CHECK(decoded[0] + decoded[1] + decoded[2] == 3);
+
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_format = DXGI_FORMAT_UNKNOWN; }, content));
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_count = 4; }, content));
+        // 编码后的长度超过上限
+        CHECK(!AdoptModified([](MeshFileHeader& h, std::vector<std::uint8_t>&){ h.index_count = 0; }, content));
+    }
+}
+
+int main()
+{
+    TestValid();
+    TestHeader();
+    TestStreams();
+    TestSubmeshesAndSegments();
+    TestMeshlets();
+    TestIndices();
+
+    if(failure_count > 0)
+    {
+        std::printf("MeshFileTest: %d check(s) failed\n", failure_count);
+        return 1;
+    }
+    std::printf("MeshFileTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../Common/JobSystem.h"
+#include "../Common/MeshImport.h"
+
+namespace
+{
+    int failure_count = 0;
+
+    #define CHECK(expr) Check((expr), #expr, __LINE__)
+
+    void Check(bool passed, const char* expr, int line)
+    {
+        if(!passed)
+        {
+            std::printf("MeshImportTest.cpp(%d): failed: %s\n", line, expr);
+            ++failure_count;
+        }
+    }
+
+    // 一个三角形: 36 字节位置 + 6 字节 16 位索引 + 2 字节对齐, 两个节点各引用一次
+    // VIEW0/ACCESSOR0 替换成位置的 bufferView/accessor 的额外字段, NODES 替换成节点数组
+    const char* triangle_gltf =
+        R"({"asset": {"version": "2.0"}, "scene": 0, "scenes": [{"nodes": [0]}],
+            "nodes": NODES,
+            "meshes": [{"name": "tri", "primitives": [{"attributes": {"POSITION": 0}, "indices": 1}]}],
+            "buffers": [{"byteLength": 44, "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAABAAIAAAA="}],
+            "bufferViews": [{"buffer": 0 VIEW0}, {"buffer": 0, "byteOffset": 36, "byteLength": 6}],
+            "accessors": [{"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" ACCESSOR0},
+                          {"bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR"}]})";
+
+    const char* default_nodes = R"([{"children": [1, 2]}, {"mesh": 0, "translation": [0, 0, 5]}, {"mesh": 0}])";
+    const char* default_view = R"(, "byteOffset": 0, "byteLength": 36)";
+
+    void Replace(std::string& text, const std::string& from, const std::string& to)
+    {
+        text.replace(text.find(from), from.size(), to);
+    }
+
+    std::string Gltf(const std::string& view, const std::string& accessor = "", const std::string& nodes = default_nodes)
+    {
+        std::string text = triangle_gltf;
+        Replace(text, "NODES", nodes);
+        Replace(text, "VIEW0", view);
+        Replace(text, "ACCESSOR0", accessor);
+        return text;
+    }
+
+    bool Import(const std::string& extension, const std::string& text, ImportedMesh& mesh, std::string& error)
+    {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / ("MeshImportTest" + extension);
+        {
+            std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+            fout << text;
+        }
+        mesh = ImportedMesh();
+        error.clear();
+        const bool result = ImportMesh(path.wstring(), JobSystem::Get(), mesh, nullptr, &error);
+        std::filesystem::remove(path);
+        return result;
+    }
+
+    bool ImportGltfText(const std::string& text, std::string& error)
+    {
+        ImportedMesh mesh;
+        return Import(".gltf", text, mesh, error);
+    }
+
+    void TestValidGltf()
+    {
+        ImportedMesh mesh;
+        std::string error;
+        CHECK(Import(".gltf", Gltf(default_view), mesh, error));
+        CHECK(mesh.indices.size() == 6);
+        CHECK(mesh.submeshes.size() == 2);
+    }
+
+    // 负数或者巨大的偏移转成 uint64 后, 加法会绕回来通过范围检查, 然后读到 buffer 之外
+    void TestAccessorRange()
+    {
+        std::string error;
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": -4096, "byteLength": 4132)"), error));
+        CHECK(error.find("byteOffset") != std::string::npos);
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 0, "byteLength": -1)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 0.5, "byteLength": 36)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 18446744073709551615, "byteLength": 36)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 0, "byteLength": 1e30)"), error));
+        // 不超过 2^53 但加起来超出 buffer
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 8, "byteLength": 9007199254740992)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 12, "byteLength": 36)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteLength": 36)", R"(, "byteOffset": -12)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteLength": 36)", R"(, "byteOffset": 4)"), error));
+        CHECK(!ImportGltfText(Gltf(R"(, "byteOffset": 0)"), error));
+
+        // byteOffset 可以省略
+        CHECK(ImportGltfText(Gltf(R"(, "byteLength": 36)"), error));
+    }
+
+    void TestEmptyImports()
+    {
+        ImportedMesh mesh;
+        std::string error;
+        CHECK(!Import(".obj", "", mesh, error));
+        CHECK(!error.empty());
+        CHECK(!Import(".obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\n", mesh, error));
+        CHECK(!error.empty());
+        CHECK(Import(".obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", mesh, error));
+        CHECK(mesh.indices.size() == 3);
+
+        // 节点引用自己, 或者一个节点有两个父节点
+        CHECK(!ImportGltfText(Gltf(default_view, "", R"([{"mesh": 0, "children": [0]}])"), error));
+        CHECK(!ImportGltfText(Gltf(default_view, "", R"([{"children": [1, 2]}, {"mesh": 0, "children": [2]}, {"mesh": 0}])"), error));
+        // 场景中没有节点
+        CHECK(!ImportGltfText(Gltf(default_view, "", "[]"), error));
+    }
+}
+
+int main()
+{
+    TestValidGltf();
+    TestAccessorRange();
+    TestEmptyImports();
+
+    if(failure_count > 0)
+    {
+        std::printf("MeshImportTest: %d check(s) failed\n", failure_count);
+        return 1;
+    }
+    std::printf("MeshImportTest: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <cstdio>
+#include <cstring>
+
+#include "../Common/PSOHash.h"
+
+namespace
+{
+    int failure_count = 0;
+
+    #define CHECK(expr) Check((expr), #expr, __LINE__)
+
+    void Check(bool passed, const char* expr, int line)
+    {
+        if(!passed)
+        {
+            std::printf("PSOHashTest.cpp(%d): failed: %s\n", line, expr);
+            ++failure_count;
+        }
+    }
+
+    const unsigned char vs_bytecode[] = {0x44, 0x58, 0x42, 0x43, 0x01, 0x02, 0x03, 0x04};
+    const unsigned char ps_bytecode[] = {0x44, 0x58, 0x42, 0x43, 0x05, 0x06, 0x07, 0x08};
+
+    // 和 Box3D 类似的最小PSO: 关闭blend, 开启深度, 关闭模板, 一个RTV
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC BaseDesc(const D3D12_INPUT_ELEMENT_DESC* elements, UINT element_count)
+    {
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+        std::memset(&desc, 0, sizeof(desc));
+        desc.VS = {vs_bytecode, sizeof(vs_bytecode)};
+        desc.PS = {ps_bytecode, sizeof(ps_bytecode)};
+        desc.InputLayout = {elements, element_count};
+        desc.SampleMask = UINT32_MAX;
+        desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+        desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+        desc.RasterizerState.DepthClipEnable = TRUE;
+        for(UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+        {
+            desc.BlendState.RenderTarget[i].SrcBlend = D3D12_BLEND_ONE;
+            desc.BlendState.RenderTarget[i].DestBlend = D3D12_BLEND_ZERO;
+            desc.BlendState.RenderTarget[i].BlendOp = D3D12_BLEND_OP_ADD;
+            desc.BlendState.RenderTarget[i].LogicOp = D3D12_LOGIC_OP_NOOP;
+            desc.BlendState.RenderTarget[i].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+        }
+        desc.DepthStencilState.DepthEnable = TRUE;
+        desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+        desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+        desc.DepthStencilState.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+        desc.DepthStencilState.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+        desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        desc.NumRenderTargets = 1;
+        desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+        desc.SampleDesc.Count = 1;
+        return desc;
+    }
+
+    const D3D12_INPUT_ELEMENT_DESC input_elements[] =
+    {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+    };
+
+    const std::uint64_t root_signature_hash = 0x1234;
+
+    std::uint64_t Key(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+    {
+        return HashGraphicsPipelineDesc(desc, root_signature_hash);
+    }
+
+    // 不影响PSO的字段: 修改后key不变
+    void TestIgnoredFields()
+    {
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC base = BaseDesc(input_elements, 2);
+        const std::uint64_t base_key = Key(base);
+        CHECK(base_key == Key(base));
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = base;
+        desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+        desc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+        desc.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_MAX;
+        desc.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_XOR;
+        CHECK(Key(desc) == base_key);
+
+        // IndependentBlendEnable 为 FALSE 时只有 RenderTarget[0] 生效
+        desc = base;
+        desc.BlendState.RenderTarget[1].BlendEnable = TRUE;
+        desc.BlendState.RenderTarget[1].RenderTargetWriteMask = 0;
+        CHECK(Key(desc) == base_key);
+
+        desc = base;
+        desc.DepthStencilState.DepthEnable = FALSE;
+        const std::uint64_t no_depth_key = Key(desc);
+        desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
+        desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+        CHECK(Key(desc) == no_depth_key);
+
+        desc = base;
+        desc.DepthStencilState.StencilReadMask = 0x0f;
+        desc.DepthStencilState.StencilWriteMask = 0xf0;
+        desc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
+        desc.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_INCR;
+        CHECK(Key(desc) == base_key);
+
+        // 超出 NumRenderTargets 的RTV格式
+        desc = base;
+        desc.RTVFormats[1] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        desc.RTVFormats[7] = DXGI_FORMAT_R32_FLOAT;
+        CHECK(Key(desc) == base_key);
+
+        desc = base;
+        desc.SampleDesc.Quality = 3;
+        CHECK(Key(desc) == base_key);
+
+        desc = base;
+        desc.InputLayout.pInputElementDescs = nullptr;
+        desc.InputLayout.NumElements = 0;
+        const std::uint64_t no_layout_key = Key(desc);
+        desc.InputLayout.pInputElementDescs = input_elements;
+        CHECK(Key(desc) == no_layout_key);
+
+        desc = base;
+        static const unsigned char cached_blob[] = {1, 2, 3};
+        desc.CachedPSO = {cached_blob, sizeof(cached_blob)};
+        CHECK(Key(desc) == base_key);
+    }
+
+    // 指针字段按内容哈希: 内容相同, 地址不同时key不变
+    void TestPointerContent()
+    {
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC base = BaseDesc(input_elements, 2);
+        const std::uint64_t base_key = Key(base);
+
+        unsigned char vs_copy[sizeof(vs_bytecode)];
+        std::memcpy(vs_copy, vs_bytecode, sizeof(vs_bytecode));
+        char position_name[] = "POSITION";
+        char color_name[] = "COLOR";
+        D3D12_INPUT_ELEMENT_DESC elements_copy[2] = {input_elements[0], input_elements[1]};
+        elements_copy[0].SemanticName = position_name;
+        elements_copy[1].SemanticName = color_name;
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = BaseDesc(elements_copy, 2);
+        desc.VS = {vs_copy, sizeof(vs_copy)};
+        CHECK(Key(desc) == base_key);
+
+        vs_copy[7] ^= 0xff;
+        CHECK(Key(desc) != base_key);
+        vs_copy[7] ^= 0xff;
+
+        color_name[0] = 'D';
+        CHECK(Key(desc) != base_key);
+    }
+
+    // 影响PSO的字段: 修改后key改变
+    void TestRelevantFields()
+    {
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC base = BaseDesc(input_elements, 2);
+        const std::uint64_t base_key = Key(base);
+
+        CHECK(HashGraphicsPipelineDesc(base, root_signature_hash + 1) != base_key);
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = base;
+        desc.PS = {vs_bytecode, sizeof(vs_bytecode)};
+        CHECK(Key(desc) != base_key);
+
+        // VS 和 PS 交换位置也要区分
+        desc = base;
+        desc.VS = base.PS;
+        desc.PS = base.VS;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.BlendState.RenderTarget[0].BlendEnable = TRUE;
+        const std::uint64_t blend_key = Key(desc);
+        CHECK(blend_key != base_key);
+        desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+        CHECK(Key(desc) != blend_key);
+
+        desc = base;
+        desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.DepthStencilState.StencilEnable = TRUE;
+        const std::uint64_t stencil_key = Key(desc);
+        CHECK(stencil_key != base_key);
+        desc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
+        CHECK(Key(desc) != stencil_key);
+
+        desc = base;
+        desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.RTVFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.NumRenderTargets = 2;
+        desc.RTVFormats[1] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        const std::uint64_t two_targets_key = Key(desc);
+        CHECK(two_targets_key != base_key);
+        desc.RTVFormats[1] = DXGI_FORMAT_R32_FLOAT;
+        CHECK(Key(desc) != two_targets_key);
+
+        desc = base;
+        desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.SampleDesc.Count = 4;
+        const std::uint64_t msaa_key = Key(desc);
+        CHECK(msaa_key != base_key);
+        desc.SampleDesc.Quality = 1;
+        CHECK(Key(desc) != msaa_key);
+
+        desc = base;
+        desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+        CHECK(Key(desc) != base_key);
+
+        desc = base;
+        desc.InputLayout.NumElements = 1;
+        CHECK(Key(desc) != base_key);
+
+        D3D12_INPUT_ELEMENT_DESC elements[2] = {input_elements[0], input_elements[1]};
+        elements[1].AlignedByteOffset = 16;
+        desc = BaseDesc(elements, 2);
+        CHECK(Key(desc) != base_key);
+    }
+}
+
+int main()
+{
+    TestIgnoredFields();
+    TestPointerContent();
+    TestRelevantFields();
+
+    if(failure_count > 0)
+    {
+        std::printf("PSOHashTest: %d check(s) failed\n", failure_count);
+        return 1;
+    }
+    std::printf("PSOHashTest: all checks passed\n");
+    return 0;
+}
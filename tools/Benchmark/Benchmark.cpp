@@ -0,0 +1,958 @@
+// Common 下各模块的吞吐量测试, 每个模式对应一个模块
+//   Benchmark geometry [vertex_count]
+//   Benchmark cache <box|grid|sphere|geosphere|cylinder|model.obj|model.gltf|model.glb> [detail] [threshold]
+//   Benchmark indices <box|grid|sphere|geosphere|cylinder|model.obj|model.gltf|model.glb> [detail]
+//   Benchmark bounds [vertex_count]
+//   Benchmark lod [object_count]
+//   Benchmark sort [draw_count]
+//   Benchmark intern [name_count]
+//   Benchmark cull [object_count]
+//   Benchmark bvh [object_count] [query_count]
+//   Benchmark meshlets <box|grid|sphere|geosphere|cylinder|model.obj|model.gltf|model.glb> [detail]
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../Common/Bounds.h"
+#include "../../Common/Bvh.h"
+#include "../../Common/FrustumCulling.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/IndexBuffer.h"
+#include "../../Common/JobSystem.h"
+#include "../../Common/LodSelection.h"
+#include "../../Common/Meshlet.h"
+#include "../../Common/MeshImport.h"
+#include "../../Common/MeshOptimizer.h"
+#include "../../Common/RenderQueue.h"
+#include "../../Common/StringId.h"
+
+using namespace DirectX;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double ElapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::uint32_t ArgOr(int argc, char** argv, int index, std::uint32_t fallback)
+    {
+        return argc > index ? (std::uint32_t)std::max(1, std::atoi(argv[index])) : fallback;
+    }
+
+    // 至少跑 iterations 次并且累计 200 ms, 返回单次的平均耗时
+    template<typename Fn>
+    double TimeMs(std::uint32_t iterations, Fn&& fn)
+    {
+        fn();
+        std::uint32_t count = 0;
+        const Clock::time_point start = Clock::now();
+        do
+        {
+            fn();
+            ++count;
+        }
+        while(count < iterations || ElapsedMs(start) < 200.0);
+        return ElapsedMs(start) / count;
+    }
+
+    //-----------------------------geometry--------------------------------
+    struct GeometryShape
+    {
+        const char* name;
+        GeometryGenerator::MeshSize (*generate)(std::uint32_t detail, const GeometryGenerator::VertexStreams&,
+                                                const GeometryGenerator::IndexStream&);
+        GeometryGenerator::MeshSize (*size)(std::uint32_t detail);
+    };
+
+    const GeometryShape geometry_shapes[] =
+    {
+        {"box", [](std::uint32_t d, const GeometryGenerator::VertexStreams& v, const GeometryGenerator::IndexStream& i)
+            { return GeometryGenerator::CreateBox(2.0f, 2.0f, 2.0f, d, v, i); },
+         [](std::uint32_t d) { return GeometryGenerator::BoxSize(d); }},
+        {"grid", [](std::uint32_t d, const GeometryGenerator::VertexStreams& v, const GeometryGenerator::IndexStream& i)
+            { return GeometryGenerator::CreateGrid(2.0f, 2.0f, d, d, v, i); },
+         [](std::uint32_t d) { return GeometryGenerator::GridSize(d, d); }},
+        {"sphere", [](std::uint32_t d, const GeometryGenerator::VertexStreams& v, const GeometryGenerator::IndexStream& i)
+            { return GeometryGenerator::CreateSphere(1.0f, d, d / 2, v, i); },
+         [](std::uint32_t d) { return GeometryGenerator::SphereSize(d, d / 2); }},
+        {"geosphere", [](std::uint32_t d, const GeometryGenerator::VertexStreams& v, const GeometryGenerator::IndexStream& i)
+            { return GeometryGenerator::CreateGeosphere(1.0f, d, v, i); },
+         [](std::uint32_t d) { return GeometryGenerator::GeosphereSize(d); }},
+        {"cylinder", [](std::uint32_t d, const GeometryGenerator::VertexStreams& v, const GeometryGenerator::IndexStream& i)
+            { return GeometryGenerator::CreateCylinder(1.0f, 0.5f, 2.0f, d, d / 4, v, i); },
+         [](std::uint32_t d) { return GeometryGenerator::CylinderSize(d, d / 4); }},
+    };
+
+    // 找到顶点数不小于 vertex_count 的最小细分, 顶点数随细分单调增长
+    std::uint32_t DetailForVertexCount(const GeometryShape& shape, std::uint32_t vertex_count)
+    {
+        std::uint32_t low = 4;
+        std::uint32_t high = 4;
+        while(shape.size(high).vertex_count < vertex_count)
+            high *= 2;
+        while(low < high)
+        {
+            const std::uint32_t mid = low + (high - low) / 2;
+            if(shape.size(mid).vertex_count < vertex_count)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    // 位置/法线/切线/uv 全部写出, SoA 和交错两种布局分别计时, 索引为 32 位
+    int BenchGeometry(int argc, char** argv)
+    {
+        const std::uint32_t target_vertex_count = ArgOr(argc, argv, 2, 1000000);
+        const std::uint32_t vertex_bytesize = sizeof(XMFLOAT3) * 3 + sizeof(XMFLOAT2);
+
+        std::printf("%-10s %10s %10s %14s %14s\n", "shape", "vertices", "indices", "SoA Mvert/s", "AoS Mvert/s");
+        for(const GeometryShape& shape : geometry_shapes)
+        {
+            const std::uint32_t detail = DetailForVertexCount(shape, target_vertex_count);
+            const GeometryGenerator::MeshSize size = shape.size(detail);
+
+            // 输出内存事先分配并写过一遍, 计时里不含缺页
+            std::vector<std::uint8_t> vertices(std::size_t(size.vertex_count) * vertex_bytesize, 0);
+            std::vector<std::uint32_t> indices(size.index_count, 0);
+            GeometryGenerator::IndexStream index_stream;
+            index_stream.data = indices.data();
+            index_stream.index_bytesize = sizeof(std::uint32_t);
+
+            std::uint8_t* base = vertices.data();
+            GeometryGenerator::VertexStreams soa;
+            soa.position = base;
+            soa.normal = base + std::size_t(size.vertex_count) * sizeof(XMFLOAT3);
+            soa.tangent = base + std::size_t(size.vertex_count) * sizeof(XMFLOAT3) * 2;
+            soa.uv = base + std::size_t(size.vertex_count) * sizeof(XMFLOAT3) * 3;
+
+            GeometryGenerator::VertexStreams aos;
+            aos.position = base;
+            aos.normal = base + sizeof(XMFLOAT3);
+            aos.tangent = base + sizeof(XMFLOAT3) * 2;
+            aos.uv = base + sizeof(XMFLOAT3) * 3;
+            aos.position_stride = aos.normal_stride = aos.tangent_stride = aos.uv_stride = vertex_bytesize;
+
+            const double soa_ms = TimeMs(5, [&] { shape.generate(detail, soa, index_stream); });
+            const double aos_ms = TimeMs(5, [&] { shape.generate(detail, aos, index_stream); });
+            std::printf("%-10s %10u %10u %14.1f %14.1f\n", shape.name, size.vertex_count, size.index_count,
+                        size.vertex_count / soa_ms / 1000.0, size.vertex_count / aos_ms / 1000.0);
+        }
+        return 0;
+    }
+
+    //-----------------------------cache--------------------------------
+    // 生成的形状或导入的模型, 索引为 32 位
+    bool LoadMesh(const std::string& input, std::uint32_t detail, std::vector<XMFLOAT3>& positions, std::vector<std::uint32_t>& indices)
+    {
+        if(std::filesystem::path(input).has_extension())
+        {
+            ImportedMesh mesh;
+            std::string error;
+            if(!ImportMesh(std::filesystem::path(input).wstring(), JobSystem::Get(), mesh, nullptr, &error))
+            {
+                std::fprintf(stderr, "%s: %s\n", input.c_str(), error.c_str());
+                return false;
+            }
+            positions = std::move(mesh.positions);
+            indices = std::move(mesh.indices);
+            return true;
+        }
+
+        for(const GeometryShape& shape : geometry_shapes)
+        {
+            if(input != shape.name)
+                continue;
+            const GeometryGenerator::MeshSize size = shape.size(detail);
+            positions.resize(size.vertex_count);
+            indices.resize(size.index_count);
+            GeometryGenerator::VertexStreams streams;
+            streams.position = positions.data();
+            GeometryGenerator::IndexStream index_stream;
+            index_stream.data = indices.data();
+            index_stream.index_bytesize = sizeof(std::uint32_t);
+            shape.generate(detail, streams, index_stream);
+            return true;
+        }
+        std::fprintf(stderr, "unknown shape: %s\n", input.c_str());
+        return false;
+    }
+
+    void PrintCacheStats(const char* label, const std::vector<std::uint32_t>& indices, const std::vector<XMFLOAT3>& positions, bool overdraw)
+    {
+        const VertexCacheStats fifo = AnalyzeVertexCache(indices.data(), indices.size(), positions.size(), default_vertex_cache_size, VertexCacheModel::FIFO);
+        const VertexCacheStats lru = AnalyzeVertexCache(indices.data(), indices.size(), positions.size(), default_vertex_cache_size, VertexCacheModel::LRU);
+        std::printf("  %-10s FIFO acmr %.3f atvr %.3f | LRU acmr %.3f atvr %.3f", label, fifo.acmr, fifo.atvr, lru.acmr, lru.atvr);
+        if(overdraw)
+            std::printf(" | overdraw %.3f",
+                        AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(XMFLOAT3)).overdraw);
+        std::printf("\n");
+    }
+
+    // 原始顺序, 三角形打乱后的顺序 (作者随手写的最坏情况), 以及 OptimizeVertexCache / OptimizeOverdraw 之后的结果
+    int BenchCache(int argc, char** argv)
+    {
+        if(argc < 3)
+            return -1;
+        std::vector<XMFLOAT3> positions;
+        std::vector<std::uint32_t> indices;
+        if(!LoadMesh(argv[2], ArgOr(argc, argv, 3, 256), positions, indices))
+            return 1;
+
+        const std::size_t triangle_count = indices.size() / 3;
+        // 软光栅估计 overdraw 比较慢, 太大的网格只统计缓存
+        const bool overdraw = triangle_count <= 2000000;
+        std::printf("%s: %zu vertices, %zu triangles, cache size %u\n", argv[2], positions.size(), triangle_count, default_vertex_cache_size);
+        PrintCacheStats("original", indices, positions, overdraw);
+
+        std::vector<std::uint32_t> shuffled(indices.size());
+        std::vector<std::uint32_t> order(triangle_count);
+        for(std::uint32_t i = 0; i < triangle_count; ++i)
+            order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        for(std::size_t i = 0; i < triangle_count; ++i)
+            std::copy_n(&indices[order[i] * 3], 3, &shuffled[i * 3]);
+        PrintCacheStats("shuffled", shuffled, positions, overdraw);
+
+        std::vector<std::uint32_t> optimized(indices.size());
+        const double cache_ms = TimeMs(1, [&] {
+            OptimizeVertexCache(optimized.data(), shuffled.data(), shuffled.size(), positions.size());
+        });
+        PrintCacheStats("tipsify", optimized, positions, overdraw);
+
+        const float threshold = argc > 4 ? (float)std::atof(argv[4]) : 1.05f;
+        std::vector<std::uint32_t> reordered(indices.size());
+        const double overdraw_ms = TimeMs(1, [&] {
+            OptimizeOverdraw(reordered.data(), optimized.data(), optimized.size(), positions.data(), positions.size(), sizeof(XMFLOAT3), threshold);
+        });
+        PrintCacheStats("overdraw", reordered, positions, overdraw);
+        const float acmr_ratio = AnalyzeVertexCache(reordered.data(), reordered.size(), positions.size()).acmr /
+                                 AnalyzeVertexCache(optimized.data(), optimized.size(), positions.size()).acmr;
+        std::printf("  FIFO acmr after overdraw / after tipsify = %.4f (threshold %.2f)\n", acmr_ratio, threshold);
+
+        std::printf("  OptimizeVertexCache %.2f ms (%.1f Mtri/s), OptimizeOverdraw %.2f ms (%.1f Mtri/s)\n",
+                    cache_ms, triangle_count / cache_ms / 1000.0, overdraw_ms, triangle_count / overdraw_ms / 1000.0);
+        return 0;
+    }
+
+    //-----------------------------indices--------------------------------
+    // 和 MeshPipeline 一样先做 vertex cache 和 vertex fetch 优化, 再测编码和解压的速度
+    int BenchIndices(int argc, char** argv)
+    {
+        if(argc < 3)
+            return -1;
+        std::vector<XMFLOAT3> positions;
+        std::vector<std::uint32_t> indices;
+        if(!LoadMesh(argv[2], ArgOr(argc, argv, 3, 256), positions, indices))
+            return 1;
+        indices.resize(indices.size() - indices.size() % 3);
+
+        OptimizeVertexCache(indices.data(), indices.data(), indices.size(), positions.size());
+        std::vector<std::uint32_t> remap(positions.size());
+        GenerateVertexFetchRemap(remap.data(), indices.data(), indices.size(), positions.size());
+        RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+        std::vector<std::uint8_t> encoded(EncodeIndexBufferBound(indices.size()));
+        std::size_t encoded_bytesize = 0;
+        const double encode_ms = TimeMs(5, [&] {
+            encoded_bytesize = EncodeIndexBuffer(encoded.data(), encoded.size(), indices.data(), indices.size());
+        });
+
+        std::vector<std::uint32_t> decoded(indices.size());
+        bool valid = true;
+        const double decode_ms = TimeMs(5, [&] {
+            valid = DecodeIndexBuffer(decoded.data(), decoded.size(), encoded.data(), encoded_bytesize) && valid;
+        });
+        // 编码可能轮换三角形的顶点, 按三角形比较时允许轮换
+        for(std::size_t t = 0; valid && t < indices.size(); t += 3)
+        {
+            bool same = false;
+            for(std::size_t r = 0; r < 3; ++r)
+                same = same || (decoded[t] == indices[t + r] && decoded[t + 1] == indices[t + (r + 1) % 3] && decoded[t + 2] == indices[t + (r + 2) % 3]);
+            valid = same;
+        }
+        if(!valid)
+        {
+            std::fprintf(stderr, "%s: decoded indices differ\n", argv[2]);
+            return 1;
+        }
+
+        const std::size_t triangle_count = indices.size() / 3;
+        const std::size_t raw_bytesize = indices.size() * (positions.size() <= 65536 ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+        std::printf("%s: %zu triangles, %zu -> %zu bytes (%.2f bytes/triangle)\n"
+                    "  encode %.3f ms (%.1f Mtri/s), decode %.3f ms (%.1f Mtri/s, %.2f GB/s of 32 bit indices)\n",
+                    argv[2], triangle_count, raw_bytesize, encoded_bytesize, (double)encoded_bytesize / triangle_count,
+                    encode_ms, triangle_count / encode_ms / 1000.0,
+                    decode_ms, triangle_count / decode_ms / 1000.0, indices.size() * sizeof(std::uint32_t) / decode_ms / 1e6);
+        return 0;
+    }
+
+    //-----------------------------bounds--------------------------------
+    // 随机的正态分布点, 整个缓冲单线程/线程池各算一次, 再按 meshlet 大小的索引范围逐段计算
+    int BenchBounds(int argc, char** argv)
+    {
+        const std::uint32_t vertex_count = ArgOr(argc, argv, 2, 10000000);
+        std::vector<XMFLOAT3> positions(vertex_count);
+        std::mt19937 rng(1);
+        std::normal_distribution<float> distribution(0.0f, 1.0f);
+        for(XMFLOAT3& p : positions)
+            p = XMFLOAT3(distribution(rng) * 3.0f + 1.0f, distribution(rng) - 2.0f, distribution(rng) * 0.5f);
+
+        JobSystem& jobs = JobSystem::Get();
+        MeshBounds serial;
+        MeshBounds parallel;
+        const double serial_ms = TimeMs(3, [&] { serial = ComputeBounds(positions.data(), vertex_count, sizeof(XMFLOAT3)); });
+        const double parallel_ms = TimeMs(3, [&] { parallel = ComputeBounds(positions.data(), vertex_count, sizeof(XMFLOAT3), &jobs); });
+
+        // meshlet: 64 个顶点, 顺序的索引
+        constexpr std::uint32_t meshlet_vertex_count = 64;
+        std::vector<std::uint32_t> indices(vertex_count);
+        for(std::uint32_t i = 0; i < vertex_count; ++i)
+            indices[i] = i;
+        float radius_sum = 0.0f;
+        const double meshlet_ms = TimeMs(3, [&] {
+            radius_sum = 0.0f;
+            for(std::uint32_t begin = 0; begin < vertex_count; begin += meshlet_vertex_count)
+            {
+                const std::uint32_t count = std::min(meshlet_vertex_count, vertex_count - begin);
+                radius_sum += ComputeBounds(indices.data() + begin, count, positions.data(), sizeof(XMFLOAT3)).sphere.Radius;
+            }
+        });
+
+        // 包围球和精确的最远距离比较
+        float farthest = 0.0f;
+        for(const XMFLOAT3& p : positions)
+            farthest = std::max(farthest, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&p), XMLoadFloat3(&parallel.sphere.Center)))));
+
+        const double megabytes = (double)vertex_count * sizeof(XMFLOAT3) / 1e6;
+        std::printf("%u vertices, %u workers\n"
+                    "  serial   %.2f ms (%.1f Mvert/s, %.2f GB/s)\n"
+                    "  parallel %.2f ms (%.1f Mvert/s, %.2f GB/s)\n"
+                    "  meshlets %.2f ms (%.1f Mvert/s, %u vertices each)\n"
+                    "  box extents %.3f %.3f %.3f, sphere radius %.3f (farthest vertex %.3f), serial radius %.3f\n",
+                    vertex_count, jobs.WorkerCount(),
+                    serial_ms, vertex_count / serial_ms / 1000.0, megabytes / serial_ms,
+                    parallel_ms, vertex_count / parallel_ms / 1000.0, megabytes / parallel_ms,
+                    meshlet_ms, vertex_count / meshlet_ms / 1000.0, meshlet_vertex_count,
+                    parallel.box.Extents.x, parallel.box.Extents.y, parallel.box.Extents.z,
+                    parallel.sphere.Radius, farthest, serial.sphere.Radius);
+        return radius_sum > 0.0f ? 0 : 1;
+    }
+
+    //-----------------------------lod--------------------------------
+    // 对象随机分布在 1000 x 1000 x 1000 的立方体中, 相机沿 x 轴穿过场景, 每个对象 5 级 LOD
+    // 统计每帧的耗时和 LOD 切换次数, 滞后为 0 时作为对比
+    int BenchLod(int argc, char** argv)
+    {
+        const std::uint32_t object_count = ArgOr(argc, argv, 2, 100000);
+        constexpr std::uint32_t frame_count = 200;
+
+        LodObjects objects;
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.5f, 3.0f);
+        for(std::uint32_t i = 0; i < object_count; ++i)
+        {
+            const float radius = size(rng);
+            const BoundingSphere sphere(XMFLOAT3(position(rng), position(rng), position(rng)), radius);
+            const float errors[5] = {0.0f, radius * 0.002f, radius * 0.008f, radius * 0.03f, radius * 0.1f};
+            objects.Add(sphere, errors, 5);
+        }
+
+        XMFLOAT4X4 proj;
+        XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f));
+        LodSelectionParams params;
+        params.projection_scale = LodProjectionScale(proj, 1080.0f);
+
+        JobSystem& jobs = JobSystem::Get();
+        std::printf("%u objects, %u frames, %u workers\n", object_count, frame_count, jobs.WorkerCount());
+        for(float hysteresis : {params.hysteresis, 0.0f})
+        {
+            params.hysteresis = hysteresis;
+            for(JobSystem* pool : {(JobSystem*)nullptr, &jobs})
+            {
+                std::fill(objects.selected_lod.begin(), objects.selected_lod.end(), 0u);
+                std::vector<std::uint32_t> previous = objects.selected_lod;
+                std::uint64_t switches = 0;
+                double total_ms = 0.0;
+                for(std::uint32_t frame = 0; frame < frame_count; ++frame)
+                {
+                    // 每帧前进 0.5, 再加一点抖动, 模拟相机的小幅晃动
+                    params.camera_position = XMFLOAT3(-50.0f + frame * 0.5f + (frame % 2 ? 0.3f : -0.3f), 0.0f, 0.0f);
+                    const Clock::time_point start = Clock::now();
+                    SelectLods(objects, params, pool);
+                    total_ms += ElapsedMs(start);
+                    // 第一帧从 LOD0 开始, 不算切换
+                    for(std::uint32_t i = 0; frame > 0 && i < object_count; ++i)
+                        switches += objects.selected_lod[i] != previous[i];
+                    previous = objects.selected_lod;
+                }
+
+                std::uint32_t histogram[max_lod_levels] = {};
+                for(std::uint32_t lod : objects.selected_lod)
+                    ++histogram[std::min(lod, max_lod_levels - 1)];
+                std::printf("  %-8s hysteresis %.2f: %.3f ms/frame (%.1f Mobj/s), %.1f lod switches/frame, last frame lods %u %u %u %u %u\n",
+                            pool == nullptr ? "serial" : "jobs", hysteresis, total_ms / frame_count,
+                            (double)object_count * frame_count / total_ms / 1000.0, (double)switches / (frame_count - 1),
+                            histogram[0], histogram[1], histogram[2], histogram[3], histogram[4]);
+            }
+        }
+        return 0;
+    }
+
+    //-----------------------------sort--------------------------------
+    // 随机的绘制: 2 个 layer, 8 个 PSO, 64 个材质, 512 个 mesh, 深度随机
+    // 和 std::stable_sort 比较结果与耗时, 统计排序前后按顺序提交时的状态切换次数
+    int BenchSort(int argc, char** argv)
+    {
+        const std::uint32_t draw_count = ArgOr(argc, argv, 2, 1000000);
+        std::vector<DrawItem> items(draw_count);
+        std::mt19937 rng(1);
+        for(std::uint32_t i = 0; i < draw_count; ++i)
+        {
+            DrawKeyFields fields;
+            fields.layer = rng() % 2;
+            fields.pso = rng() % 8;
+            fields.material = rng() % 64;
+            fields.mesh = rng() % 512;
+            fields.depth = QuantizeDrawDepth(std::uniform_real_distribution<float>(0.0f, 1000.0f)(rng), 1000.0f);
+            items[i] = {EncodeDrawKey(fields), i};
+        }
+
+        // 每次从未排序的副本开始, 拷贝也计入耗时, 两种排序一样
+        std::vector<DrawItem> sorted(draw_count);
+        std::vector<DrawItem> scratch(draw_count);
+        JobSystem& jobs = JobSystem::Get();
+        const double serial_ms = TimeMs(5, [&] {
+            sorted = items;
+            RadixSortDrawItems(sorted.data(), scratch.data(), draw_count);
+        });
+        const double parallel_ms = TimeMs(5, [&] {
+            sorted = items;
+            RadixSortDrawItems(sorted.data(), scratch.data(), draw_count, &jobs);
+        });
+        std::vector<DrawItem> reference(draw_count);
+        const double stable_sort_ms = TimeMs(5, [&] {
+            reference = items;
+            std::stable_sort(reference.begin(), reference.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+        });
+        for(std::uint32_t i = 0; i < draw_count; ++i)
+        {
+            if(sorted[i].key != reference[i].key || sorted[i].payload != reference[i].payload)
+            {
+                std::fprintf(stderr, "radix sort differs from std::stable_sort at %u\n", i);
+                return 1;
+            }
+        }
+
+        const RenderQueueStats before = CountStateChanges(items.data(), draw_count);
+        const RenderQueueStats after = CountStateChanges(sorted.data(), draw_count);
+        std::printf("%u draws, %u workers\n"
+                    "  radix serial   %.2f ms (%.1f Mkey/s)\n"
+                    "  radix jobs     %.2f ms (%.1f Mkey/s)\n"
+                    "  stable_sort    %.2f ms (%.1f Mkey/s)\n"
+                    "  state changes  unsorted %u (layer %u pso %u material %u mesh %u)\n"
+                    "                 sorted   %u (layer %u pso %u material %u mesh %u), %u saved (%.1f%%)\n",
+                    draw_count, jobs.WorkerCount(),
+                    serial_ms, draw_count / serial_ms / 1000.0,
+                    parallel_ms, draw_count / parallel_ms / 1000.0,
+                    stable_sort_ms, draw_count / stable_sort_ms / 1000.0,
+                    before.StateChanges(), before.layer_changes, before.pso_changes, before.material_changes, before.mesh_changes,
+                    after.StateChanges(), after.layer_changes, after.pso_changes, after.material_changes, after.mesh_changes,
+                    before.StateChanges() - after.StateChanges(),
+                    100.0 * (before.StateChanges() - after.StateChanges()) / std::max(1u, before.StateChanges()));
+        return 0;
+    }
+
+    //-----------------------------intern--------------------------------
+    // 模拟加载时登记的 submesh/LOD 名字: 第一次登记, 重复登记和只查找分别计时, 线程池上并行登记重复的名字
+    // 再比较一个网格的 drawargs 大小的 FlatIdMap 和以字符串为键的 unordered_map 的查找
+    int BenchIntern(int argc, char** argv)
+    {
+        const std::uint32_t name_count = ArgOr(argc, argv, 2, 100000);
+        std::vector<std::string> names(name_count);
+        // 和 LodDrawargName 的格式一样, 每个 submesh 4 级 LOD
+        for(std::uint32_t i = 0; i < name_count; ++i)
+            names[i] = "mesh_" + std::to_string(i / 4) + "_submesh" + (i % 4 == 0 ? "" : "_lod" + std::to_string(i % 4));
+
+        // 每次用新的 interner, 计时里包含它的析构
+        std::size_t count = 0;
+        const double insert_ms = TimeMs(3, [&] {
+            StringInterner interner;
+            for(const std::string& name : names)
+                interner.Intern(name);
+            count = interner.Count();
+        });
+
+        StringInterner interner;
+        std::vector<StringId> ids(name_count);
+        for(std::uint32_t i = 0; i < name_count; ++i)
+            ids[i] = interner.Intern(names[i]);
+        std::uint64_t sum = 0;
+        const double hit_ms = TimeMs(5, [&] {
+            for(const std::string& name : names)
+                sum += interner.Intern(name).value;
+        });
+        const double find_ms = TimeMs(5, [&] {
+            for(const std::string& name : names)
+                sum += interner.Find(name).value;
+        });
+        bool valid = count == name_count;
+        for(std::uint32_t i = 0; valid && i < name_count; ++i)
+            valid = interner.View(ids[i]) == names[i];
+
+        JobSystem& jobs = JobSystem::Get();
+        std::atomic<std::uint32_t> mismatches(0);
+        const double parallel_ms = TimeMs(5, [&] {
+            jobs.ParallelFor(name_count, 4096, [&](std::uint32_t begin, std::uint32_t end) {
+                std::uint32_t chunk_mismatches = 0;
+                for(std::uint32_t i = begin; i < end; ++i)
+                    chunk_mismatches += interner.Intern(names[i]) != ids[i];
+                mismatches += chunk_mismatches;
+            });
+        });
+        if(!valid || mismatches != 0)
+        {
+            std::fprintf(stderr, "interned ids or strings differ\n");
+            return 1;
+        }
+
+        // 一个网格 40 个 submesh, 每轮按顺序全部查一遍
+        constexpr std::uint32_t submesh_count = 40;
+        constexpr std::uint32_t lookup_rounds = 100000;
+        FlatIdMap<std::uint32_t> drawargs;
+        std::unordered_map<std::string, std::uint32_t> string_drawargs;
+        for(std::uint32_t i = 0; i < submesh_count; ++i)
+        {
+            drawargs.Insert(ids[i], i);
+            string_drawargs[names[i]] = i;
+        }
+        const double flat_ms = TimeMs(1, [&] {
+            for(std::uint32_t round = 0; round < lookup_rounds; ++round)
+                for(std::uint32_t i = 0; i < submesh_count; ++i)
+                    sum += *drawargs.Find(ids[i]);
+        });
+        const double string_map_ms = TimeMs(1, [&] {
+            for(std::uint32_t round = 0; round < lookup_rounds; ++round)
+                for(std::uint32_t i = 0; i < submesh_count; ++i)
+                    sum += string_drawargs.find(names[i])->second;
+        });
+
+        const double lookups = (double)submesh_count * lookup_rounds;
+        std::printf("%u names, %u workers\n"
+                    "  first intern    %.2f ms (%.1f Mname/s)\n"
+                    "  repeated intern %.2f ms (%.1f Mname/s)\n"
+                    "  find            %.2f ms (%.1f Mname/s)\n"
+                    "  intern on jobs  %.2f ms (%.1f Mname/s)\n"
+                    "  %u submeshes: FlatIdMap %.2f ns/lookup, unordered_map<string> %.2f ns/lookup (%llu)\n",
+                    name_count, jobs.WorkerCount(),
+                    insert_ms, name_count / insert_ms / 1000.0,
+                    hit_ms, name_count / hit_ms / 1000.0,
+                    find_ms, name_count / find_ms / 1000.0,
+                    parallel_ms, name_count / parallel_ms / 1000.0,
+                    submesh_count, flat_ms * 1e6 / lookups, string_map_ms * 1e6 / lookups, (unsigned long long)sum);
+        return 0;
+    }
+
+    //-----------------------------cull--------------------------------
+    // 对象随机分布在 1000 x 1000 x 1000 的立方体中, 相机在中心看向 +z
+    // 本机支持的每种指令集单线程和线程池各测一次, 结果和 Scalar 逐个比较
+    int BenchCull(int argc, char** argv)
+    {
+        const std::uint32_t object_count = ArgOr(argc, argv, 2, 1000000);
+
+        CullingObjects objects;
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.5f, 3.0f);
+        for(std::uint32_t i = 0; i < object_count; ++i)
+        {
+            const float radius = size(rng);
+            const XMFLOAT3 center(position(rng), position(rng), position(rng));
+            // AABB 比包围球小, 和平面相交的对象有一部分会被 AABB 剔除
+            const BoundingBox box(center, XMFLOAT3(radius * 0.577f, radius * 0.3f, radius * 0.577f));
+            objects.Add(BoundingSphere(center, radius), box);
+        }
+
+        XMFLOAT4X4 view_proj;
+        const XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMStoreFloat4x4(&view_proj, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f)));
+        const CullingFrustum frustum = ExtractFrustum(view_proj);
+
+        std::vector<std::uint32_t> reference(object_count);
+        std::vector<std::uint32_t> visible(object_count);
+        const std::uint32_t reference_count = CullObjects(objects, frustum, reference.data(), nullptr, CullingIsa::Scalar);
+
+        JobSystem& jobs = JobSystem::Get();
+        const CullingIsa best = BestCullingIsa();
+        std::printf("%u objects, %u visible, best isa %s, %u workers\n", object_count, reference_count, CullingIsaName(best), jobs.WorkerCount());
+        bool valid = true;
+        for(CullingIsa isa : {CullingIsa::Scalar, CullingIsa::Sse, CullingIsa::Avx2, CullingIsa::Avx512})
+        {
+            if(isa > best)
+                break;
+            for(JobSystem* pool : {(JobSystem*)nullptr, &jobs})
+            {
+                std::uint32_t visible_count = 0;
+                const double cull_ms = TimeMs(20, [&] { visible_count = CullObjects(objects, frustum, visible.data(), pool, isa); });
+                const bool same = visible_count == reference_count && std::equal(reference.begin(), reference.begin() + visible_count, visible.begin());
+                std::printf("  %-8s %-6s %.3f ms (%.1f Mobj/s)%s\n", CullingIsaName(isa), pool == nullptr ? "serial" : "jobs",
+                            cull_ms, object_count / cull_ms / 1000.0, same ? "" : ", differs from Scalar");
+                valid = valid && same;
+            }
+        }
+        return valid ? 0 : 1;
+    }
+
+    //-----------------------------bvh--------------------------------
+    bool BoxInFrustum(const CullingFrustum& frustum, const BoundingBox& box)
+    {
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            const float d = frustum.normal_x[p] * box.Center.x + frustum.normal_y[p] * box.Center.y + frustum.normal_z[p] * box.Center.z + frustum.distance[p];
+            const float r = std::fabs(frustum.normal_x[p]) * box.Extents.x + std::fabs(frustum.normal_y[p]) * box.Extents.y + std::fabs(frustum.normal_z[p]) * box.Extents.z;
+            if(d < -r)
+                return false;
+        }
+        return true;
+    }
+
+    bool BoxesOverlap(const BoundingBox& a, const BoundingBox& b)
+    {
+        return std::fabs(a.Center.x - b.Center.x) <= a.Extents.x + b.Extents.x &&
+               std::fabs(a.Center.y - b.Center.y) <= a.Extents.y + b.Extents.y &&
+               std::fabs(a.Center.z - b.Center.z) <= a.Extents.z + b.Extents.z;
+    }
+
+    // 射线和包围盒的 slab 测试, 起点在盒子内时距离为 0
+    bool RayHitsBox(const BvhRay& ray, const BoundingBox& box, float& distance)
+    {
+        const float origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+        const float direction[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+        const float center[3] = {box.Center.x, box.Center.y, box.Center.z};
+        const float extents[3] = {box.Extents.x, box.Extents.y, box.Extents.z};
+        float enter = 0.0f;
+        float leave = ray.max_distance;
+        for(std::uint32_t a = 0; a < 3; ++a)
+        {
+            const float inv = 1.0f / (std::fabs(direction[a]) > 1e-20f ? direction[a] : 1e-20f);
+            const float t0 = (center[a] - extents[a] - origin[a]) * inv;
+            const float t1 = (center[a] + extents[a] - origin[a]) * inv;
+            enter = std::max(enter, std::min(t0, t1));
+            leave = std::min(leave, std::max(t0, t1));
+        }
+        distance = enter;
+        return enter <= leave;
+    }
+
+    // 对象的 AABB 随机分布在 1000 x 1000 x 1000 的立方体中
+    // 构建 (单线程/线程池), Refit, 视锥剔除 (和 CullObjects 比较), 射线拾取和重叠查询的吞吐量
+    // 前 100 个查询和逐个对象的暴力结果比较
+    int BenchBvh(int argc, char** argv)
+    {
+        const std::uint32_t object_count = ArgOr(argc, argv, 2, 1000000);
+        const std::uint32_t query_count = ArgOr(argc, argv, 3, 100000);
+        constexpr std::uint32_t checked_query_count = 100;
+
+        std::vector<BoundingBox> boxes(object_count);
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> extent(0.2f, 2.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        for(BoundingBox& box : boxes)
+        {
+            box.Center = XMFLOAT3(position(rng), position(rng), position(rng));
+            box.Extents = XMFLOAT3(extent(rng), extent(rng), extent(rng));
+        }
+
+        JobSystem& jobs = JobSystem::Get();
+        Bvh bvh;
+        const double serial_build_ms = TimeMs(1, [&] { bvh.Build(boxes.data(), object_count); });
+        const double parallel_build_ms = TimeMs(1, [&] { bvh.Build(boxes.data(), object_count, &jobs); });
+        std::printf("%u objects, %zu nodes (%zu KB), %u workers\n"
+                    "  build serial  %.2f ms (%.1f Mobj/s)\n"
+                    "  build jobs    %.2f ms (%.1f Mobj/s)\n",
+                    object_count, bvh.Nodes().size(), bvh.Nodes().size() * sizeof(BvhNode) / 1024, jobs.WorkerCount(),
+                    serial_build_ms, object_count / serial_build_ms / 1000.0,
+                    parallel_build_ms, object_count / parallel_build_ms / 1000.0);
+
+        // 1% 的对象移动, 只更新它们的祖先节点
+        std::vector<std::uint32_t> moved;
+        for(std::uint32_t i = 0; i < object_count; i += 100)
+            moved.push_back(i);
+        for(std::uint32_t i : moved)
+            boxes[i].Center = XMFLOAT3(boxes[i].Center.x + unit(rng) * 5.0f, boxes[i].Center.y + unit(rng) * 5.0f, boxes[i].Center.z);
+        const double full_refit_ms = TimeMs(5, [&] { bvh.Refit(boxes.data()); });
+        const double moved_refit_ms = TimeMs(5, [&] { bvh.Refit(boxes.data(), moved.data(), (std::uint32_t)moved.size()); });
+        std::printf("  refit all     %.2f ms\n"
+                    "  refit %zu moved %.3f ms\n",
+                    full_refit_ms, moved.size(), moved_refit_ms);
+
+        // 相机在中心看向 +z, 另一个视锥放大 10 倍, 只看到很少的对象
+        const XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        CullingObjects flat;
+        for(const BoundingBox& box : boxes)
+            flat.Add(BoundingSphere(box.Center, XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents)))), box);
+        std::vector<std::uint32_t> visible(object_count);
+        bool valid = true;
+        for(float fov : {0.25f * XM_PI, 0.025f * XM_PI})
+        {
+            XMFLOAT4X4 view_proj;
+            XMStoreFloat4x4(&view_proj, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(fov, 16.0f / 9.0f, 1.0f, 1000.0f)));
+            const CullingFrustum frustum = ExtractFrustum(view_proj);
+
+            std::uint32_t visible_count = 0;
+            const double bvh_ms = TimeMs(20, [&] { visible_count = bvh.CullFrustum(frustum, visible.data()); });
+            std::vector<std::uint32_t> found(visible.begin(), visible.begin() + visible_count);
+            std::sort(found.begin(), found.end());
+            std::vector<std::uint32_t> expected;
+            for(std::uint32_t i = 0; i < object_count; ++i)
+            {
+                if(BoxInFrustum(frustum, boxes[i]))
+                    expected.push_back(i);
+            }
+            valid = valid && found == expected;
+
+            std::uint32_t flat_count = 0;
+            const double flat_ms = TimeMs(20, [&] { flat_count = CullObjects(flat, frustum, visible.data()); });
+            std::printf("  cull fov %4.1f deg: bvh %.3f ms (%u visible), CullObjects %s %.3f ms (%u visible)\n",
+                        XMConvertToDegrees(fov), bvh_ms, visible_count, CullingIsaName(BestCullingIsa()), flat_ms, flat_count);
+        }
+
+        std::vector<BvhRay> rays(query_count);
+        for(BvhRay& ray : rays)
+        {
+            ray.origin = XMFLOAT3(position(rng), position(rng), position(rng));
+            ray.direction = XMFLOAT3(unit(rng), unit(rng), unit(rng));
+        }
+        std::uint32_t hit_count = 0;
+        const double ray_ms = TimeMs(1, [&] {
+            hit_count = 0;
+            for(const BvhRay& ray : rays)
+                hit_count += bvh.Raycast(ray).object != bvh_invalid_index;
+        });
+        for(std::uint32_t q = 0; q < std::min(query_count, checked_query_count); ++q)
+        {
+            float nearest = FLT_MAX;
+            for(std::uint32_t i = 0; i < object_count; ++i)
+            {
+                float distance;
+                if(RayHitsBox(rays[q], boxes[i], distance))
+                    nearest = std::min(nearest, distance);
+            }
+            // 距离相同的对象可能不止一个, 只比较距离
+            valid = valid && bvh.Raycast(rays[q]).distance == nearest;
+        }
+
+        std::vector<BoundingBox> query_boxes(query_count);
+        for(std::uint32_t q = 0; q < query_count; ++q)
+            query_boxes[q] = BoundingBox(rays[q].origin, XMFLOAT3(5.0f, 5.0f, 5.0f));
+        std::vector<std::uint32_t> result;
+        std::size_t overlap_total = 0;
+        const double overlap_ms = TimeMs(1, [&] {
+            overlap_total = 0;
+            for(const BoundingBox& query : query_boxes)
+            {
+                result.clear();
+                overlap_total += bvh.QueryOverlap(query, result);
+            }
+        });
+        for(std::uint32_t q = 0; q < std::min(query_count, checked_query_count); ++q)
+        {
+            result.clear();
+            bvh.QueryOverlap(query_boxes[q], result);
+            std::uint32_t expected = 0;
+            for(const BoundingBox& box : boxes)
+                expected += BoxesOverlap(box, query_boxes[q]);
+            valid = valid && result.size() == expected;
+        }
+
+        std::printf("  raycast       %.2f ms (%.2f Mray/s, %u hits)\n"
+                    "  overlap       %.2f ms (%.2f Mquery/s, %.2f objects each)\n",
+                    ray_ms, query_count / ray_ms / 1000.0, hit_count,
+                    overlap_ms, query_count / overlap_ms / 1000.0, (double)overlap_total / query_count);
+        if(!valid)
+        {
+            std::fprintf(stderr, "bvh queries differ from brute force\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    //-----------------------------meshlets--------------------------------
+    // 三角形的 3 个顶点都在同一个裁剪平面之外时才算在视锥外, 和 CullMeshlets 的平面提取无关
+    bool TriangleInFrustum(const XMVECTOR clip[3])
+    {
+        for(std::uint32_t p = 0; p < 6; ++p)
+        {
+            bool all_outside = true;
+            for(std::uint32_t v = 0; v < 3; ++v)
+            {
+                const XMFLOAT4 c = XMFLOAT4(XMVectorGetX(clip[v]), XMVectorGetY(clip[v]), XMVectorGetZ(clip[v]), XMVectorGetW(clip[v]));
+                const float d[6] = {c.w + c.x, c.w - c.x, c.w + c.y, c.w - c.y, c.z, c.w - c.z};
+                all_outside = all_outside && d[p] < 0.0f;
+            }
+            if(all_outside)
+                return false;
+        }
+        return true;
+    }
+
+    // 和 BuildMeshlets 的法线方向一致: cross(p1 - p0, p2 - p0) 朝向相机的是正面
+    // 面积为 0 或者几乎侧对相机的三角形不算, 留一点浮点误差
+    bool TriangleFacesCamera(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2, FXMVECTOR camera)
+    {
+        const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+        const float length = XMVectorGetX(XMVector3Length(normal));
+        if(length <= 0.0f)
+            return false;
+        const XMVECTOR to_camera = XMVectorSubtract(camera, p0);
+        return XMVectorGetX(XMVector3Dot(normal, to_camera)) > 1e-4f * length * XMVectorGetX(XMVector3Length(to_camera));
+    }
+
+    // 先做 vertex cache 优化再切 meshlet, 相机绕模型一圈, 一半看向中心, 一半偏向一侧让视锥剔除起作用
+    // 被剔除的 meshlet 中的每个三角形都用裁剪空间坐标和自己的法线重新检查, 不能有视锥内的正面三角形
+    int BenchMeshlets(int argc, char** argv)
+    {
+        if(argc < 3)
+            return -1;
+        std::vector<XMFLOAT3> positions;
+        std::vector<std::uint32_t> indices;
+        if(!LoadMesh(argv[2], ArgOr(argc, argv, 3, 256), positions, indices))
+            return 1;
+        indices.resize(indices.size() - indices.size() % 3);
+        OptimizeVertexCache(indices.data(), indices.data(), indices.size(), positions.size());
+
+        MeshletBuffers buffers;
+        const double build_ms = TimeMs(1, [&] {
+            buffers = BuildMeshlets(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(XMFLOAT3));
+        });
+        const std::size_t triangle_count = indices.size() / 3;
+        std::printf("%s: %zu triangles, %zu meshlets (%.1f triangles each), build %.2f ms (%.1f Mtri/s)\n",
+                    argv[2], triangle_count, buffers.meshlets.size(), (double)triangle_count / buffers.meshlets.size(),
+                    build_ms, triangle_count / build_ms / 1000.0);
+
+        const BoundingSphere sphere = ComputeBounds(positions.data(), positions.size(), sizeof(XMFLOAT3)).sphere;
+        const XMVECTOR center = XMLoadFloat3(&sphere.Center);
+        const float radius = std::max(sphere.Radius, 1e-3f);
+        const XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.01f * radius, 10.0f * radius);
+
+        constexpr std::uint32_t camera_count = 8;
+        MeshletCullStats total;
+        std::vector<std::uint32_t> visible;
+        std::vector<std::uint8_t> is_visible(buffers.meshlets.size());
+        std::uint32_t wrongly_culled = 0;
+        for(std::uint32_t c = 0; c < camera_count; ++c)
+        {
+            const float angle = XM_2PI * c / camera_count;
+            const float height = (c % 3 == 0 ? 1.0f : -0.5f) * radius;
+            const XMVECTOR eye = XMVectorAdd(center, XMVectorSet(std::cos(angle) * 2.5f * radius, height, std::sin(angle) * 2.5f * radius, 0.0f));
+            // 奇数编号的相机看向模型边缘
+            const XMVECTOR target = c % 2 == 0 ? center : XMVectorAdd(center, XMVectorSet(-std::sin(angle) * radius, 0.0f, std::cos(angle) * radius, 0.0f));
+            const XMMATRIX view_proj = XMMatrixMultiply(XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)), proj);
+            XMFLOAT3 camera;
+            XMStoreFloat3(&camera, eye);
+
+            MeshletCullStats stats;
+            const double cull_ms = TimeMs(20, [&] { stats = CullMeshlets(buffers, view_proj, camera, &visible); });
+            total.meshlet_count += stats.meshlet_count;
+            total.frustum_culled += stats.frustum_culled;
+            total.cone_culled += stats.cone_culled;
+            total.triangle_count += stats.triangle_count;
+            total.visible_triangles += stats.visible_triangles;
+            std::printf("  camera %u: frustum %5.1f%%, cone %5.1f%%, triangles kept %5.1f%%, %.3f ms (%.1f Mmeshlet/s)\n",
+                        c, 100.0 * stats.frustum_culled / stats.meshlet_count, 100.0 * stats.cone_culled / stats.meshlet_count,
+                        100.0 * stats.visible_triangles / stats.triangle_count, cull_ms, stats.meshlet_count / cull_ms / 1000.0);
+
+            std::fill(is_visible.begin(), is_visible.end(), 0);
+            for(std::uint32_t i : visible)
+                is_visible[i] = 1;
+            for(std::size_t i = 0; i < buffers.meshlets.size(); ++i)
+            {
+                if(is_visible[i])
+                    continue;
+                const Meshlet& meshlet = buffers.meshlets[i];
+                for(std::uint32_t t = 0; t < meshlet.primitive_count; ++t)
+                {
+                    const std::uint32_t packed = buffers.primitive_indices[meshlet.primitive_offset + t];
+                    XMVECTOR p[3];
+                    XMVECTOR clip[3];
+                    for(std::uint32_t v = 0; v < 3; ++v)
+                    {
+                        const std::uint32_t local = (packed >> (v * 10)) & 0x3FF;
+                        p[v] = XMLoadFloat3(&positions[buffers.vertex_indices[meshlet.vertex_offset + local]]);
+                        clip[v] = XMVector4Transform(XMVectorSetW(p[v], 1.0f), view_proj);
+                    }
+                    if(TriangleFacesCamera(p[0], p[1], p[2], eye) && TriangleInFrustum(clip))
+                        ++wrongly_culled;
+                }
+            }
+        }
+        std::printf("  average: frustum %5.1f%%, cone %5.1f%%, triangles kept %5.1f%%\n",
+                    100.0 * total.frustum_culled / total.meshlet_count, 100.0 * total.cone_culled / total.meshlet_count,
+                    100.0 * total.visible_triangles / total.triangle_count);
+        if(wrongly_culled > 0)
+        {
+            std::fprintf(stderr, "%s: %u front facing triangles inside the frustum were culled\n", argv[2], wrongly_culled);
+            return 1;
+        }
+        return 0;
+    }
+
+    struct Mode
+    {
+        const char* name;
+        const char* usage;
+        int (*run)(int argc, char** argv);
+    };
+
+    const Mode modes[] =
+    {
+        {"geometry", "geometry [vertex_count]", BenchGeometry},
+        {"cache", "cache <box|grid|sphere|geosphere|cylinder|model.obj|model.gltf|model.glb> [detail] [threshold]", BenchCache},
+        {"indices", "indices <box|grid|sphere|geosphere|cylinder|model.obj|model.gltf|model.glb> [detail]", BenchIndices},
+        {"bounds", "bounds [vertex_count]", BenchBounds},
+        {"lod", "lod [object_count]", BenchLod},
+        {"sort", "sort [draw_count]", BenchSort},
+        {"intern", "intern [name_count]", BenchIntern},
+        {"cull", "cull [object_count]", BenchCull},
+        {"bvh", "bvh [object_count] [query_count]", BenchBvh},
+        {"meshlets", "meshlets <box|grid|sphere|geosphere|cylinder|model.obj|model.gltf|model.glb> [detail]", BenchMeshlets},
+    };
+}
+
+int main(int argc, char** argv)
+{
+    if(argc >= 2)
+    {
+        for(const Mode& mode : modes)
+        {
+            if(std::strcmp(argv[1], mode.name) != 0)
+                continue;
+            // 参数不够时返回 -1, 打印用法
+            const int result = mode.run(argc, argv);
+            if(result >= 0)
+                return result;
+            break;
+        }
+    }
+
+    std::fprintf(stderr, "usage:\n");
+    for(const Mode& mode : modes)
+        std::fprintf(stderr, "  Benchmark %s\n", mode.usage);
+    return 1;
+}
@@ -0,0 +1,230 @@
+// 离线生成 .mesh 文件, 以及映射加载和读取+拷贝加载的耗时对比
+//   MeshConverter <model.obj|model.gltf|model.glb> <output.mesh>
+//   MeshConverter <box|grid|sphere|geosphere|cylinder> <output.mesh> [detail]
+//   MeshConverter --bench <input.mesh> [iterations]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/JobSystem.h"
+#include "../../Common/MeshFile.h"
+#include "../../Common/MeshImport.h"
+#include "../../Common/MeshPipeline.h"
+
+using namespace DirectX;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double ElapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // 上传时每个字节都要读一遍, 两种加载方式都按这个代价计时
+    std::uint64_t TouchBytes(const void* data, std::uint64_t bytesize)
+    {
+        const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+        std::uint64_t sum = 0;
+        for(std::uint64_t i = 0; i < bytesize; i += 64)
+            sum += bytes[i];
+        return sum;
+    }
+
+    bool GenerateShape(const std::string& shape, std::uint32_t detail,
+                       std::vector<XMFLOAT3>& positions, std::vector<std::uint32_t>& indices)
+    {
+        GeometryGenerator::MeshSize size;
+        if(shape == "box")
+            size = GeometryGenerator::BoxSize(detail);
+        else if(shape == "grid")
+            size = GeometryGenerator::GridSize(detail, detail);
+        else if(shape == "sphere")
+            size = GeometryGenerator::SphereSize(detail, detail / 2);
+        else if(shape == "geosphere")
+            size = GeometryGenerator::GeosphereSize(detail);
+        else if(shape == "cylinder")
+            size = GeometryGenerator::CylinderSize(detail, detail / 4);
+        else
+            return false;
+
+        positions.resize(size.vertex_count);
+        indices.resize(size.index_count);
+
+        GeometryGenerator::VertexStreams streams;
+        streams.position = positions.data();
+        GeometryGenerator::IndexStream index_stream;
+        index_stream.data = indices.data();
+        index_stream.index_bytesize = sizeof(std::uint32_t);
+
+        // 尺寸和 c5/Box3D 一样, box 1 的输出和 Box3D 在内存中生成的完全相同
+        if(shape == "box")
+            GeometryGenerator::CreateBox(2.0f, 2.0f, 2.0f, detail, streams, index_stream);
+        else if(shape == "grid")
+            GeometryGenerator::CreateGrid(2.0f, 2.0f, detail, detail, streams, index_stream);
+        else if(shape == "sphere")
+            GeometryGenerator::CreateSphere(1.0f, detail, detail / 2, streams, index_stream);
+        else if(shape == "geosphere")
+            GeometryGenerator::CreateGeosphere(1.0f, detail, streams, index_stream);
+        else
+            GeometryGenerator::CreateCylinder(1.0f, 0.5f, 2.0f, detail, detail / 4, streams, index_stream);
+        return true;
+    }
+
+    int Write(MeshPipelineInput input, const std::filesystem::path& output)
+    {
+        // 离线生成的文件索引压缩存放, 加载时解压
+        input.encode_indices = true;
+        const Clock::time_point start = Clock::now();
+        std::string report;
+        const std::vector<std::uint8_t> image = SerializeMeshFile(ProcessMesh(input, JobSystem::Get(), &report));
+        const double process_ms = ElapsedMs(start);
+
+        if(!WriteMeshFile(output.wstring(), image))
+        {
+            std::fprintf(stderr, "failed to write %s\n", output.string().c_str());
+            return 1;
+        }
+        std::printf("%s%s: %zu bytes, processed in %.2f ms\n", report.c_str(), output.string().c_str(), image.size(), process_ms);
+        return 0;
+    }
+
+    int Import(const std::filesystem::path& model, const std::filesystem::path& output)
+    {
+        ImportedMesh mesh;
+        ImportStats stats;
+        std::string error;
+        if(!ImportMesh(model.wstring(), JobSystem::Get(), mesh, &stats, &error))
+        {
+            std::fprintf(stderr, "%s: %s\n", model.string().c_str(), error.c_str());
+            return 1;
+        }
+        std::printf("%s: %llu bytes imported in %.2f ms (%.1f MB/s), %zu vertices, %zu triangles, %zu submeshes\n",
+                    model.string().c_str(), (unsigned long long)stats.bytesize, stats.milliseconds, stats.MegabytesPerSecond(),
+                    mesh.positions.size(), mesh.indices.size() / 3, mesh.submeshes.size());
+        return Write(mesh.PipelineInput(), output);
+    }
+
+    int Generate(const std::string& shape, const std::filesystem::path& output, std::uint32_t detail)
+    {
+        std::vector<XMFLOAT3> positions;
+        std::vector<std::uint32_t> indices;
+        if(detail == 0)
+            detail = shape == "box" ? 1 : 64;
+        if(!GenerateShape(shape, detail, positions, indices))
+        {
+            std::fprintf(stderr, "unknown shape: %s\n", shape.c_str());
+            return 1;
+        }
+
+        // 颜色由位置映射到 [0, 1]
+        std::vector<XMFLOAT4> colors(positions.size());
+        for(std::size_t i = 0; i < positions.size(); ++i)
+        {
+            XMVECTOR color = XMVectorMultiplyAdd(XMLoadFloat3(&positions[i]), XMVectorReplicate(0.5f), XMVectorReplicate(0.5f));
+            XMStoreFloat4(&colors[i], XMVectorSetW(color, 1.0f));
+        }
+
+        MeshPipelineInput input;
+        input.positions = positions.data();
+        input.colors = colors.data();
+        input.vertex_count = positions.size();
+        input.indices = indices.data();
+        input.index_count = indices.size();
+        input.submeshes.push_back({shape, 0, (std::uint32_t)indices.size()});
+        return Write(input, output);
+    }
+
+    int Bench(const std::filesystem::path& input, std::uint32_t iterations)
+    {
+        const std::wstring filename = input.wstring();
+        MeshFileContent content;
+        MappedMeshFile mapped;
+        if(!ReadMeshFile(filename, content) || !mapped.Open(filename))
+        {
+            std::fprintf(stderr, "failed to load %s\n", input.string().c_str());
+            return 1;
+        }
+        if(!mapped.Verify())
+        {
+            std::fprintf(stderr, "%s: content hash mismatch\n", input.string().c_str());
+            return 1;
+        }
+        const std::size_t file_bytesize = mapped.Bytesize();
+        const std::uint64_t stored_index_bytesize = mapped.Header().indices.bytesize;
+        std::vector<std::uint8_t> decoded_indices(mapped.DecodedIndexBytesize());
+        mapped.Close();
+
+        // 两种方式都从打开文件计到上传源数据全部读过一遍为止, 文件都已经在系统缓存中
+        // 压缩的索引两种方式都要解压, 解压的时间单独再统计一次
+        std::uint64_t checksum = 0;
+        double read_ms = 0.0;
+        double map_ms = 0.0;
+        double open_ms = 0.0;
+        double decode_ms = 0.0;
+        for(std::uint32_t i = 0; i < iterations; ++i)
+        {
+            Clock::time_point start = Clock::now();
+            MeshFileContent read_content;
+            ReadMeshFile(filename, read_content);
+            for(const MeshFileContent::Stream& stream : read_content.streams)
+                checksum += TouchBytes(stream.data.data(), stream.data.size());
+            DecodeMeshFileIndices(decoded_indices.data(), read_content.index_format, read_content.index_count,
+                                  read_content.index_encoding, read_content.indices.data(), read_content.indices.size());
+            checksum += TouchBytes(decoded_indices.data(), decoded_indices.size());
+            read_ms += ElapsedMs(start);
+
+            start = Clock::now();
+            MappedMeshFile file;
+            file.Open(filename);
+            open_ms += ElapsedMs(start);
+            const MeshFileHeader& header = file.Header();
+            for(std::uint32_t s = 0; s < header.stream_count; ++s)
+                checksum += TouchBytes(file.StreamData(s), header.streams[s].data.bytesize);
+            if(file.IndicesEncoded())
+            {
+                const Clock::time_point decode_start = Clock::now();
+                file.DecodeIndices(decoded_indices.data());
+                decode_ms += ElapsedMs(decode_start);
+                checksum += TouchBytes(decoded_indices.data(), decoded_indices.size());
+            }
+            else
+            {
+                checksum += TouchBytes(file.IndexData(), header.indices.bytesize);
+            }
+            map_ms += ElapsedMs(start);
+        }
+
+        std::printf("%s: %zu bytes, %u iterations (checksum %llu)\n"
+                    "  read + copy: %.3f ms\n"
+                    "  map:         %.3f ms (open and validate %.3f ms)\n",
+                    input.string().c_str(), file_bytesize, iterations, (unsigned long long)checksum,
+                    read_ms / iterations, map_ms / iterations, open_ms / iterations);
+        if(decode_ms > 0.0)
+            std::printf("  index decode: %.3f ms, %zu -> %zu bytes, %.2f GB/s\n", decode_ms / iterations,
+                        (std::size_t)stored_index_bytesize, decoded_indices.size(), decoded_indices.size() * iterations / decode_ms / 1e6);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc >= 3 && std::strcmp(argv[1], "--bench") == 0)
+        return Bench(argv[2], argc >= 4 ? (std::uint32_t)std::max(1, std::atoi(argv[3])) : 100);
+    if(argc >= 3 && std::filesystem::path(argv[1]).has_extension())
+        return Import(argv[1], argv[2]);
+    if(argc >= 3)
+        return Generate(argv[1], argv[2], argc >= 4 ? (std::uint32_t)std::atoi(argv[3]) : 0);
+
+    std::fprintf(stderr, "usage: MeshConverter <model.obj|model.gltf|model.glb> <output.mesh>\n"
+                         "       MeshConverter <box|grid|sphere|geosphere|cylinder> <output.mesh> [detail]\n"
+                         "       MeshConverter --bench <input.mesh> [iterations]\n");
+    return 1;
+}